@@ -92,6 +92,224 @@ namespace newlang {
     }
 
 
+    /*
+     * Точные произведение и сумма для диапазонов, итераторов, словарей и целочисленных тензоров.
+     *
+     * Элементы объединяются бинарным разбиением (сбалансированным деревом), поэтому перемножаются
+     * длинные числа близкого размера, а не растущее значение на очередной малый множитель.
+     * Промежуточные значения хранятся в BigNum без сокращения, дробь сокращается один раз в конце.
+     * При большом количестве элементов части вычисляются параллельно в пуле потоков libtorch.
+     */
+    namespace {
+
+        constexpr int64_t REDUCE_LEAF = 16; ///< Количество элементов, которые объединяются последовательно
+        constexpr int64_t REDUCE_PARALLEL = 4096; ///< Минимальное количество элементов для одного потока
+
+        struct Fraction {
+            BigNum num;
+            BigNum den;
+
+            Fraction() {
+                num.SetOne();
+                den.SetOne();
+            }
+        };
+
+        void FractionCombine(Fraction &out, const Fraction &value, bool product) {
+            if(product) {
+                out.num.mul(value.num);
+                if(!value.den.isOne()) {
+                    out.den.mul(value.den);
+                }
+            } else if(BN_cmp(out.den.value, value.den.value) == 0) {
+                out.num.add(value.num);
+            } else {
+                BigNum cross(value.num);
+                cross.mul(out.den);
+                out.num.mul(value.den);
+                out.den.mul(value.den);
+                out.num.add(cross);
+            }
+        }
+
+        template <typename Item>
+        void FractionSplit(const Item &item, int64_t begin, int64_t end, Fraction &out, bool product) {
+            if(end - begin <= REDUCE_LEAF) {
+                if(!product) {
+                    out.num.SetZero();
+                }
+                Fraction value;
+                for (int64_t i = begin; i < end; i++) {
+                    item(i).GetAsBigNum(value.num, value.den);
+                    FractionCombine(out, value, product);
+                }
+                return;
+            }
+            int64_t middle = begin + (end - begin) / 2;
+            Fraction right;
+            FractionSplit(item, begin, middle, out, product);
+            FractionSplit(item, middle, end, right, product);
+            FractionCombine(out, right, product);
+        }
+
+        template <typename Item>
+        Rational FractionReduce(const Item &item, int64_t count, bool product) {
+            if(count <= 0) {
+                return Rational(product ? 1 : 0);
+            }
+
+            int64_t chunks = std::max<int64_t>(1, std::min<int64_t>(at::get_num_threads(), count / REDUCE_PARALLEL));
+            std::vector<Fraction> parts(chunks);
+            at::parallel_for(0, chunks, 1, [&](int64_t begin, int64_t end) {
+                for (int64_t i = begin; i < end; i++) {
+                    FractionSplit(item, count * i / chunks, count * (i + 1) / chunks, parts[i], product);
+                }
+            });
+
+            // Части объединяются попарно, пары одного уровня независимы
+            for (int64_t step = 1; step < chunks; step *= 2) {
+                at::parallel_for(0, (chunks + 2 * step - 1) / (2 * step), 1, [&](int64_t begin, int64_t end) {
+                    for (int64_t i = begin; i < end; i++) {
+                        int64_t pos = i * 2 * step;
+                        if(pos + step < chunks) {
+                            FractionCombine(parts[pos], parts[pos + step], product);
+                        }
+                    }
+                });
+            }
+
+            Rational result;
+            result.SetFromBigNum(parts[0].num, parts[0].den);
+            return result;
+        }
+
+        int64_t RangeValue(const Obj &range, const Obj &value) {
+            if(!value.is_integral()) {
+                LOG_RUNTIME("Exact reduction requires integer range, not '%s'!", range.toString().c_str());
+            }
+            return value.GetValueAsInteger();
+        }
+
+        int64_t RangeCount(int64_t start, int64_t stop, int64_t step) {
+            if(step == 0) {
+                LOG_RUNTIME("Range step must be different from zero!");
+            }
+            if(step > 0) {
+                return stop > start ? (stop - start + step - 1) / step : 0;
+            }
+            return start > stop ? (start - stop - step - 1) / -step : 0;
+        }
+
+        void CollectRational(const Obj &obj, std::vector<Rational> &items) {
+            if(obj.is_rational()) {
+                items.push_back(obj.m_rational);
+            } else if(obj.is_integral() && obj.is_scalar()) {
+                items.push_back(Rational(obj.GetValueAsInteger()));
+            } else if(obj.is_integral()) {
+                torch::Tensor data = obj.m_tensor.flatten().toType(at::ScalarType::Long).contiguous();
+                const int64_t *ptr = data.data_ptr<int64_t>();
+                for (int64_t i = 0; i < data.numel(); i++) {
+                    items.push_back(Rational(ptr[i]));
+                }
+            } else if(obj.is_range()) {
+                int64_t start = RangeValue(obj, *obj.at("start").second);
+                int64_t step = RangeValue(obj, *obj.at("step").second);
+                int64_t count = RangeCount(start, RangeValue(obj, *obj.at("stop").second), step);
+                for (int64_t i = 0; i < count; i++) {
+                    items.push_back(Rational(start + i * step));
+                }
+            } else if(obj.is_dictionary_type()) {
+                for (int64_t i = 0; i < obj.size(); i++) {
+                    CollectRational(*obj.at(i).second, items);
+                }
+            } else {
+                LOG_RUNTIME("Exact reduction requires integer or rational values, not '%s'!", obj.toString().c_str());
+            }
+        }
+
+        Rational ReduceRange(int64_t start, int64_t stop, int64_t step, bool product) {
+            return FractionReduce([start, step](int64_t i) {
+                return Rational(start + i * step);
+            }, RangeCount(start, stop, step), product);
+        }
+
+        ObjPtr ReduceArgs(const Obj &in, bool product) {
+            if(in.size() < 2) {
+                LOG_RUNTIME("Empty argument list parameter!");
+            }
+
+            if(in.size() == 2) {
+                Obj &arg = *in.at(1).second;
+                if(arg.is_range()) {
+                    return Obj::CreateRational(ReduceRange(RangeValue(arg, *arg.at("start").second),
+                            RangeValue(arg, *arg.at("stop").second), RangeValue(arg, *arg.at("step").second), product));
+                } else if(arg.getType() == ObjType::Iterator && arg.m_iterator->m_iter_obj->is_range()) {
+                    // Итератор по диапазону вычисляется без создания элементов и переходит в конец
+                    Obj &range = *arg.m_iterator->m_iter_obj;
+                    int64_t start = RangeValue(range, *range.m_iter_range_value);
+                    int64_t step = RangeValue(range, *range.at("step").second);
+                    int64_t count = RangeCount(start, RangeValue(range, *range.at("stop").second), step);
+                    Rational result = ReduceRange(start, start + count * step, step, product);
+                    range.m_iter_range_value = Obj::CreateValue(start + count * step, ObjType::None);
+                    return Obj::CreateRational(result);
+                }
+            }
+
+            std::vector<Rational> items;
+            for (int64_t i = 1; i < in.size(); i++) {
+                Obj &arg = *in.at(i).second;
+                if(arg.getType() == ObjType::Iterator) {
+                    ObjPtr item = arg.IteratorNext(0);
+                    while(item->getType() != ObjType::IteratorEnd) {
+                        CollectRational(*item, items);
+                        item = arg.IteratorNext(0);
+                    }
+                } else {
+                    CollectRational(arg, items);
+                }
+            }
+            return Obj::CreateRational(FractionReduce([&items](int64_t i) -> const Rational & {
+                return items[i];
+            }, items.size(), product));
+        }
+    }
+
+    NEWLANG_TRANSPARENT(prod) {
+        return ReduceArgs(in, true);
+    }
+
+    NEWLANG_TRANSPARENT(sum) {
+        return ReduceArgs(in, false);
+    }
+
+    /*
+     * Потоки libtorch (RunTime::SetThreads, SetInteropThreads и SetAffinity).
+     * threads() - текущие значения (threads=, interop=, affinity=,)
+     * threads(2), threads(threads=2, interop=1, affinity='0-3') - изменение и новые значения
+     */
+    NEWLANG_FUNCTION(threads) {
+        for (int64_t i = 1; i < in.size(); i++) {
+            const std::string &name = in.at(i).first;
+            const ObjPtr &value = in.at(i).second;
+            if(!value) {
+                LOG_RUNTIME("Empty argument '%s'!", name.c_str());
+            } else if((name.empty() && i == 1) || name.compare("threads") == 0) {
+                RunTime::SetThreads(value->GetValueAsInteger());
+            } else if(name.compare("interop") == 0) {
+                RunTime::SetInteropThreads(value->GetValueAsInteger());
+            } else if(name.compare("affinity") == 0) {
+                RunTime::SetAffinity(value->GetValueAsString());
+            } else {
+                LOG_RUNTIME("Unknown argument '%s' at index %d!", name.c_str(), static_cast<int> (i));
+            }
+        }
+        ObjPtr result = Obj::CreateDict();
+        result->push_back(Obj::CreateValue(RunTime::GetThreads(), ObjType::None), "threads");
+        result->push_back(Obj::CreateValue(RunTime::GetInteropThreads(), ObjType::None), "interop");
+        result->push_back(Obj::CreateString(RunTime::GetAffinity()), "affinity");
+        return result;
+    }
+
 #undef NEWLANG_FUNCTION
 #undef NEWLANG_TRANSPARENT
 
@@ -41,6 +41,11 @@ FUNC_TRANSPARENT(newlang_min, min);
 FUNC_TRANSPARENT(newlang_max, max);
 FUNC_TRANSPARENT(newlang_maks, max);
 
+FUNC_TRANSPARENT(newlang_prod, prod);
+FUNC_TRANSPARENT(newlang_sum, sum);
+
+FUNC_DIRECT(newlang_threads, threads);
+
 FUNC_TRANSPARENT(newlang_clone, clone);
 FUNC_TRANSPARENT(newlang_const_, const_);
 FUNC_TRANSPARENT(newlang_mutable_, mutable_);
@@ -2,6 +2,7 @@
 #include "pch.h"
 
 #include <context.h>
+#include <lazy.h>
 #include <newlang.h>
 #include <term.h>
 #include <types.h>
@@ -36,14 +37,28 @@ const char * Return::Abort = ":ErrorAbort";
 
 Context::Context(RuntimePtr global) : m_llvm_builder(LLVMCreateBuilder()) {
     m_runtime = global;
+    m_vm_enable = false;
+    m_jit_enable = false;
+    m_lazy_enable = false;
+    m_frame = nullptr;
+    m_interrupt_throw = 0;
 
-    m_main_module = std::make_shared<Module>();
+    m_main_module = MakeRef<Module>();
 
     ASSERT(m_main_module->m_var_type_current == ObjType::Module);
     m_main_module->m_var_is_init = true;
     m_main_module->m_is_main = true;
 
     m_terms = m_main_module.get();
+    m_global_count = 0;
+    m_purge = end();
+    m_lookup_count = 0;
+    m_lookup_hit = 0;
+    m_inplace_count = 0;
+    m_inplace_shared = 0;
+    m_vm_macros = 0;
+    m_vm_compile = 0;
+    m_vm_cached = 0;
 
 
 #ifdef _MSC_VER
@@ -134,18 +149,6 @@ Context::Context(RuntimePtr global) : m_llvm_builder(LLVMCreateBuilder()) {
     }
 
 
-    if(Context::m_funcs.empty()) {
-
-        //        VERIFY(CreateBuiltin("min(arg, ...)", (void *) &min, ObjType::PureFunc));
-        //        VERIFY(CreateBuiltin("мин(arg, ...)", (void *) &min, ObjType::PureFunc));
-        //        VERIFY(CreateBuiltin("max(arg, ...)", (void *) &max, ObjType::PureFunc));
-        //        VERIFY(CreateBuiltin("макс(arg, ...)", (void *) &max, ObjType::PureFunc));
-        //
-        //
-        //        VERIFY(CreateBuiltin("help(...)", (void *) &help, ObjType::PureFunc));
-
-    }
-
     if(Context::m_types.empty()) {
 
         VERIFY(RegisterTypeHierarchy(ObjType::None,{}));
@@ -182,6 +185,7 @@ Context::Context(RuntimePtr global) : m_llvm_builder(LLVMCreateBuilder()) {
         VERIFY(RegisterTypeHierarchy(ObjType::StrChar,{":String"}));
         VERIFY(RegisterTypeHierarchy(ObjType::StrWide,{":String"}));
         VERIFY(RegisterTypeHierarchy(ObjType::FmtChar,{":String"}));
+        VERIFY(RegisterTypeHierarchy(ObjType::ViewChar,{":String"}));
 
         VERIFY(RegisterTypeHierarchy(ObjType::Dictionary,{":Any"}));
         VERIFY(RegisterTypeHierarchy(ObjType::Class,{":Dictionary"}));
@@ -221,6 +225,25 @@ Context::Context(RuntimePtr global) : m_llvm_builder(LLVMCreateBuilder()) {
 
     }
 
+    if(Context::m_funcs.empty()) {
+
+        //        VERIFY(CreateBuiltin("min(arg, ...)", (void *) &min, ObjType::PureFunc));
+        //        VERIFY(CreateBuiltin("мин(arg, ...)", (void *) &min, ObjType::PureFunc));
+        //        VERIFY(CreateBuiltin("max(arg, ...)", (void *) &max, ObjType::PureFunc));
+        //        VERIFY(CreateBuiltin("макс(arg, ...)", (void *) &max, ObjType::PureFunc));
+        //
+        //
+        //        VERIFY(CreateBuiltin("help(...)", (void *) &help, ObjType::PureFunc));
+
+        // Точные произведение и сумма (бинарное разбиение), регистрируются после типов для разбора прототипа
+        VERIFY(CreateBuiltin("prod(...)", (void *) &newlang::prod, ObjType::PureFunc));
+        VERIFY(CreateBuiltin("sum(...)", (void *) &newlang::sum, ObjType::PureFunc));
+
+        // Управление потоками libtorch
+        VERIFY(CreateBuiltin("threads(...)", (void *) &newlang::threads, ObjType::Function));
+
+    }
+
     if(Context::m_builtin_calls.empty()) {
 #define REGISTER_FUNC(name, func)                                                                                      \
     ASSERT(Context::m_builtin_calls.find(name) == Context::m_builtin_calls.end());                                     \
@@ -302,6 +325,10 @@ ObjPtr Context::RegisterObject(ObjPtr var) {
         var->getName() = var->getName().substr(1);
     } else {
         m_terms->push_back(var, var->getName());
+        if(m_global_count + 1 == m_terms->size()) {
+            m_global_index.emplace(var->getName(), var);
+            m_global_count++;
+        }
     }
     push_back(var, var->getName());
 
@@ -370,7 +397,7 @@ ObjPtr Context::Eval(Context *ctx, TermPtr term, Obj *args, bool eval_block, Cat
 }
 
 ObjPtr Context::eval_END(Context *ctx, const TermPtr &term, Obj *args, bool eval_block) {
-    return Obj::CreateNone();
+    return Obj::None();
 }
 
 ObjPtr Context::eval_UNKNOWN(Context *ctx, const TermPtr &term, Obj *args, bool eval_block) {
@@ -600,6 +627,123 @@ ObjPtr Context::eval_NAMESPACE(Context *ctx, const TermPtr &term, Obj *args, boo
     return nullptr;
 }
 
+bool Context::AssignInPlace(Context *ctx, Obj &target, char op, const ObjPtr &value) {
+    ASSERT(value);
+    if(target.m_is_const) {
+        return false;
+    }
+
+    if(target.is_tensor_type() && !target.is_scalar() && value->is_tensor_type()) {
+        if(at::holds_alternative<NativeData>(target.m_var)) {
+            return false;
+        }
+        if(target.m_tensor.use_count() != 1) {
+            ctx->m_inplace_shared++;
+            return false;
+        }
+        // Данные, общие с копиями объекта, копируются оператором при записи (Obj::DetachTensor_)
+
+        if(!value->is_scalar()) {
+            // Результат должен совпадать по размерности с переменной, иначе ошибку выдаст присвоение с копией
+            at::IntArrayRef dims = target.m_tensor.sizes();
+            at::IntArrayRef val_dims = value->m_tensor.sizes();
+            if(val_dims.size() > dims.size()) {
+                return false;
+            }
+            for (size_t i = 1; i <= val_dims.size(); i++) {
+                if(val_dims[val_dims.size() - i] != 1 && val_dims[val_dims.size() - i] != dims[dims.size() - i]) {
+                    return false;
+                }
+            }
+        }
+        if(op != '+' && op != '-' && op != '*' && op != '/') {
+            return false;
+        }
+
+        ObjType type = target.m_var_type_current;
+        torch::Tensor data = target.m_tensor;
+        try {
+            switch(op) {
+                case '+':
+                    target.operator+=(value);
+                    break;
+                case '-':
+                    target.operator-=(value);
+                    break;
+                case '*':
+                    target.operator*=(value);
+                    break;
+                default:
+                    target.operator/=(value);
+                    break;
+            }
+        } catch (...) {
+            // При повышении типа оператор работает с копией данных, поэтому достаточно вернуть исходные данные
+            target.m_tensor = data;
+            target.m_var_type_current = type;
+            throw;
+        }
+        if(target.m_var_type_current != type) {
+            // Тип результата был повышен, а исходные данные не изменились.
+            // Результат присваивается с приведением к типу переменной, как при обычном присвоении.
+            ObjPtr result = Obj::CreateTensor(target.m_tensor);
+            result->m_var_type_current = target.m_var_type_current;
+            target.m_tensor = data;
+            target.m_var_type_current = type;
+            target.SetValue_(result);
+        }
+        ctx->m_inplace_count++;
+        return true;
+    }
+
+    if(op == '+' && (target.m_var_type_current == ObjType::StrChar || target.m_var_type_current == ObjType::StrWide)
+            && value->m_var_type_current == target.m_var_type_current) {
+        target.operator+=(value);
+        ctx->m_inplace_count++;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Присвоение вида x = x + y (-, *, /) одной переменной без индексов.
+ */
+static bool IsAssignOperator(const TermPtr &lval, const TermPtr &rval) {
+    if(lval->getTermID() != TermID::NAME || lval->isCall() || lval->Right() || lval->m_list || isType(lval->m_text)) {
+        return false;
+    }
+    if(rval->getTermID() != TermID::OPERATOR || rval->m_const || rval->m_text.size() != 1 || !rval->Left() || !rval->Right()) {
+        return false;
+    }
+    if(rval->m_text[0] != '+' && rval->m_text[0] != '-' && rval->m_text[0] != '*' && rval->m_text[0] != '/') {
+        return false;
+    }
+    TermPtr left = rval->Left();
+    return left->getTermID() == TermID::NAME && !left->isCall() && !left->Right() && left->m_text.compare(lval->m_text) == 0;
+}
+
+/*
+ * Правая часть присвоения x = x + y. Если левый операнд - сам объект переменной,
+ * результат записывается в него (AssignInPlace) и возвращается этот же объект.
+ */
+static ObjPtr EvalAssignOperator(Context *ctx, const ObjPtr &target, const TermPtr &rval, Obj *args, bool eval_block) {
+    ObjPtr left = Context::EvalOperand(ctx, rval->Left(), args, eval_block);
+    ObjPtr right = Context::EvalOperand(ctx, rval->Right(), args, eval_block);
+    if(left.get() == target.get() && Context::AssignInPlace(ctx, *target, rval->m_text[0], right)) {
+        return target;
+    }
+    switch(rval->m_text[0]) {
+        case '+':
+            return left->operator+(right);
+        case '-':
+            return left->operator-(right);
+        case '*':
+            return left->operator*(right);
+    }
+    ASSERT(rval->m_text[0] == '/');
+    return left->operator/(right);
+}
+
 ObjPtr Context::CREATE_OR_ASSIGN(Context *ctx, const TermPtr &term, Obj *local_vars, CreateMode mode) {
     // Присвоить значение можно как одному термину, так и сразу нескольким при
     // раскрытии словаря: var1, var2, _ = ... func(); 
@@ -654,13 +798,10 @@ ObjPtr Context::CREATE_OR_ASSIGN(Context *ctx, const TermPtr &term, Obj *local_v
             result = Obj::CreateNone();
         } else {
             // LOG_DEBUG("find: %s", ctx->NamespaseFull(elem->GetFullName()).c_str());
-            auto found = ctx->find(ctx->NamespaseFull(elem->GetFullName()));
-            if(found == ctx->end() && mode == CreateMode::ASSIGN_ONLY) {
-                NL_PARSER(elem, "Object '%s' (%s) not found!", elem->m_text.c_str(), ctx->NamespaseFull(elem->GetFullName()).c_str());
-            }
-
-            if(found != ctx->end()) {
-                result = (*found).second.lock(); // Но она может быть возвращена как локальная
+            std::string full_name = ctx->NamespaseFull(elem->GetFullName());
+            result = ctx->FindSession(full_name); // Но она может быть возвращена как локальная
+            if(!result && mode == CreateMode::ASSIGN_ONLY) {
+                NL_PARSER(elem, "Object '%s' (%s) not found!", elem->m_text.c_str(), full_name.c_str());
             }
 
             if(result && mode == CreateMode::CREATE_ONLY) {
@@ -668,7 +809,8 @@ ObjPtr Context::CREATE_OR_ASSIGN(Context *ctx, const TermPtr &term, Obj *local_v
             }
 
             if(!term->Right()) { // Удаление глобальной переменной
-                ctx->ListType::erase(found);
+                ctx->RemoveSession(full_name);
+                ctx->SetSlot(elem, nullptr);
             } else {
                 if(!result && (mode == CreateMode::ASSIGN_ONLY)) {
                     NL_PARSER(term->Left(), "Object '%s' (%s) not found!", term->Left()->m_text.c_str(), ctx->NamespaseFull(elem->GetFullName()).c_str());
@@ -679,6 +821,7 @@ ObjPtr Context::CREATE_OR_ASSIGN(Context *ctx, const TermPtr &term, Obj *local_v
                         NL_PARSER(term->Left(), "Fail create lvalue object!");
                     }
                 }
+                ctx->SetSlot(elem, result);
             }
         }
         list_obj.push_back(result);
@@ -704,6 +847,8 @@ ObjPtr Context::CREATE_OR_ASSIGN(Context *ctx, const TermPtr &term, Obj *local_v
         ASSERT(list_obj.size() == 1);
         // Имя класса появляется только при операции присвоения в левой части оператора
         rval = ctx->CreateClass(term->Left()->GetFullName(), term->Right(), local_vars);
+    } else if(list_obj.size() == 1 && list_obj[0] && IsAssignOperator(list_term[0], term->Right())) {
+        rval = EvalAssignOperator(ctx, list_obj[0], term->Right(), local_vars, is_eval_block);
     } else {
         rval = Eval(ctx, term->Right(), local_vars, is_eval_block, CatchType::CATCH_AUTO);
     }
@@ -723,7 +868,7 @@ ObjPtr Context::CREATE_OR_ASSIGN(Context *ctx, const TermPtr &term, Obj *local_v
                     if(i < rval->size()) {
                         list_obj[i]->SetValue_((*rval)[i].second); //->Clone()
                     } else {
-                        list_obj[i]->SetValue_(Obj::CreateNone());
+                        list_obj[i]->SetValue_(Obj::None());
                     }
                 }
             }
@@ -763,12 +908,20 @@ ObjPtr Context::CREATE_OR_ASSIGN(Context *ctx, const TermPtr &term, Obj *local_v
                 if(list_term[i]->Right()) {
                     ASSERT(list_term[i]->Right()->GetTokenID() == TermID::INDEX);
                     list_obj[i]->index_set_(MakeIndex(ctx, list_term[i]->Right(), local_vars), rval);
+                } else if(rval.get() == list_obj[i].get()) {
+                    // Значение уже записано в объект переменной (x = x + y, s = s ++ t)
+                    if(term->Right()->getTermID() == TermID::OPERATOR && term->Right()->m_text.compare("++") == 0) {
+                        ctx->m_inplace_count++;
+                    }
                 } else {
                     list_obj[i]->SetValue_(rval);
                 }
                 if(list_obj[i]->m_var_type_current == ObjType::Function && rval->is_block()) {
                     list_obj[i]->m_var_type_current = ObjType::EVAL_FUNCTION;
                 }
+                if(list_obj[i]->m_var_type_current == ObjType::EVAL_FUNCTION && rval->is_block()) {
+                    ResolveSlots(list_obj[i]->m_prototype, list_obj[i]->m_sequence);
+                }
                 result = list_obj[i];
             }
         }
@@ -802,10 +955,8 @@ ObjPtr Context::eval_FUNCTION(Context *ctx, const TermPtr &term, Obj * args, boo
     ASSERT(term->Left());
     ASSERT(ctx);
 
-    auto found = ctx->find(term->Left()->m_text);
     if(!term->Right()) {
-        if(found != ctx->end()) {
-            ctx->ListType::erase(found);
+        if(ctx->RemoveSession(term->Left()->m_text)) {
             return Obj::Yes();
         }
         return Obj::No();
@@ -828,6 +979,7 @@ ObjPtr Context::eval_FUNCTION(Context *ctx, const TermPtr &term, Obj * args, boo
         lval->m_var_type_fixed = lval->m_var_type_current;
         lval->m_var_is_init = true;
         lval->m_sequence = term->Right();
+        ResolveSlots(lval->m_prototype, lval->m_sequence);
     }
 
     return ctx->RegisterObject(lval);
@@ -874,36 +1026,60 @@ ObjPtr Context::eval_ARGS(Context *ctx, const TermPtr &term, Obj * args, bool ev
 }
 
 ObjPtr Context::eval_WHILE(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
+    ObjPtr result = ExecWhile(ctx, term, args, eval_block);
+    ThrowInterrupt(ctx);
+    return result;
+}
+
+ObjPtr Context::ExecWhile(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
 
     ASSERT(term->Left());
     ASSERT(term->Right());
 
     bool is_interrupt;
 
-    ObjPtr result = Obj::CreateNone();
-    ObjPtr cond = CallBlock(ctx, term->Left(), args, eval_block, CatchType::CATCH_AUTO, &is_interrupt);
+    ObjPtr result = Obj::None();
+    ObjPtr cond = ExecBlock(ctx, term->Left(), args, eval_block, CatchType::CATCH_AUTO, &is_interrupt);
+    if(ctx->m_interrupt) {
+        return cond;
+    }
     if(!cond->GetValueAsBoolean() && !term->m_follow.empty()) {
         ASSERT(term->m_follow.size() == 1);
         result = CreateRVal(ctx, term->m_follow[0], args, CatchType::CATCH_AUTO);
     } else {
         while(cond->GetValueAsBoolean()) {
 
+            if(ctx->m_frame) {
+                ctx->m_frame->m_loops++;
+            }
             //            LOG_DEBUG("result %s", result->toString().c_str());
-            result = CallBlock(ctx, term->Right(), args, eval_block, CatchType::CATCH_AUTO, &is_interrupt);
+            result = ExecBlock(ctx, term->Right(), args, eval_block, CatchType::CATCH_AUTO, &is_interrupt);
 
-            if(is_interrupt || result->op_class_test(Return::Break, ctx)) {
+            if(ctx->m_interrupt) {
+                // Прерывание не перехвачено телом цикла и передается дальше
                 break;
-            } else if(is_interrupt || result->op_class_test(Return::Continue, ctx)) {
+            } else if(is_interrupt || TestInterrupt(*result, ObjType::Break, Return::Break, ctx)) {
+                break;
+            } else if(TestInterrupt(*result, ObjType::Continue, Return::Continue, ctx)) {
                 continue;
             }
 
-            cond = CallBlock(ctx, term->Left(), args, eval_block, CatchType::CATCH_AUTO, nullptr);
+            cond = ExecBlock(ctx, term->Left(), args, eval_block, CatchType::CATCH_AUTO, nullptr);
+            if(ctx->m_interrupt) {
+                return cond;
+            }
         }
     }
     return result;
 }
 
 ObjPtr Context::eval_DOWHILE(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
+    ObjPtr result = ExecDoWhile(ctx, term, args, eval_block);
+    ThrowInterrupt(ctx);
+    return result;
+}
+
+ObjPtr Context::ExecDoWhile(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
     ASSERT(term->Left());
     ASSERT(term->Right());
 
@@ -912,12 +1088,22 @@ ObjPtr Context::eval_DOWHILE(Context *ctx, const TermPtr &term, Obj * args, bool
     bool is_interrupt;
     do {
 
-        result = CreateRVal(ctx, term->Left(), args, CatchType::CATCH_AUTO);
-        cond = CallBlock(ctx, term->Right(), args, true, CatchType::CATCH_AUTO, &is_interrupt);
+        if(term->Left()->IsBlock()) {
+            result = ExecBlock(ctx, term->Left(), args, true, CatchType::CATCH_AUTO, nullptr);
+            if(ctx->m_interrupt) {
+                return result;
+            }
+        } else {
+            result = CreateRVal(ctx, term->Left(), args, CatchType::CATCH_AUTO);
+        }
+        cond = ExecBlock(ctx, term->Right(), args, true, CatchType::CATCH_AUTO, &is_interrupt);
 
-        if(is_interrupt && cond->op_class_test(Return::Break, ctx)) {
+        if(ctx->m_interrupt) {
+            // Прерывание не перехвачено и передается дальше
+            return cond;
+        } else if(is_interrupt && TestInterrupt(*cond, ObjType::Break, Return::Break, ctx)) {
             break;
-        } else if(is_interrupt && cond->op_class_test(Return::Continue, ctx)) {
+        } else if(is_interrupt && TestInterrupt(*cond, ObjType::Continue, Return::Continue, ctx)) {
             continue;
         }
 
@@ -927,6 +1113,12 @@ ObjPtr Context::eval_DOWHILE(Context *ctx, const TermPtr &term, Obj * args, bool
 }
 
 ObjPtr Context::eval_FOLLOW(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
+    ObjPtr result = ExecFollow(ctx, term, args, eval_block);
+    ThrowInterrupt(ctx);
+    return result;
+}
+
+ObjPtr Context::ExecFollow(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
 
     /*
      * [cond] --> {expr};
@@ -941,10 +1133,10 @@ ObjPtr Context::eval_FOLLOW(Context *ctx, const TermPtr &term, Obj * args, bool
 
         if(cond->GetValueAsBoolean() || (i + 1 == term->m_follow.size() && cond->is_none_type())) {
 
-            return CallBlock(ctx, term->m_follow[i]->Right(), args, true, CatchType::CATCH_AUTO, nullptr);
+            return ExecBlock(ctx, term->m_follow[i]->Right(), args, true, CatchType::CATCH_AUTO, nullptr);
         }
     }
-    return Obj::CreateNone();
+    return Obj::None();
 }
 
 bool Context::MatchCompare(Obj &match, ObjPtr &value, MatchMode mode, Context *ctx) {
@@ -985,6 +1177,25 @@ bool Context::MatchEstimate(Obj &match, const TermPtr &match_item, MatchMode mod
     return false;
 }
 
+Context::MatchMode Context::GetMatchMode(const TermPtr &term) {
+    if(term->m_op_mode < 0) {
+        if(term->m_text.compare("==>") == 0) {
+            term->m_op_mode = static_cast<int> (MatchMode::MatchEqual);
+        } else if(term->m_text.compare("===>") == 0) {
+            term->m_op_mode = static_cast<int> (MatchMode::MatchStrict);
+        } else if(term->m_text.compare("~>") == 0) {
+            term->m_op_mode = static_cast<int> (MatchMode::TYPE_NAME);
+        } else if(term->m_text.compare("~~>") == 0) {
+            term->m_op_mode = static_cast<int> (MatchMode::TYPE_EQUAL);
+        } else if(term->m_text.compare("~~~>") == 0) {
+            term->m_op_mode = static_cast<int> (MatchMode::TYPE_STRICT);
+        } else {
+            NL_PARSER(term, "Unknown pattern matching type!");
+        }
+    }
+    return static_cast<MatchMode> (term->m_op_mode);
+}
+
 ObjPtr Context::eval_MATCHING(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
     /*
      * [match] ==> { # ~> ~~> ~~~> ===>
@@ -997,20 +1208,7 @@ ObjPtr Context::eval_MATCHING(Context *ctx, const TermPtr &term, Obj * args, boo
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    MatchMode mode;
-    if(term->m_text.compare("==>") == 0) {
-        mode = MatchMode::MatchEqual;
-    } else if(term->m_text.compare("===>") == 0) {
-        mode = MatchMode::MatchStrict;
-    } else if(term->m_text.compare("~>") == 0) {
-        mode = MatchMode::TYPE_NAME;
-    } else if(term->m_text.compare("~~>") == 0) {
-        mode = MatchMode::TYPE_EQUAL;
-    } else if(term->m_text.compare("~~~>") == 0) {
-        mode = MatchMode::TYPE_STRICT;
-    } else {
-        NL_PARSER(term, "Unknown pattern matching type!");
-    }
+    MatchMode mode = GetMatchMode(term);
 
     ObjPtr value = CreateRVal(ctx, term->Left(), args);
     TermPtr list = term->Right();
@@ -1073,11 +1271,20 @@ ObjPtr Context::eval_SOURCE(Context *ctx, const TermPtr &term, Obj * args, bool
  */
 
 ObjPtr Context::eval_OPERATOR(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
-    if(Context::m_ops.find(term->m_text) == Context::m_ops.end()) {
+    if(term->m_const) {
+        // Выражение было вычислено при загрузке (FoldConstants)
+        return term->m_const->Clone();
+    }
+    if(!term->m_op_func) {
+        // Обработчик оператора ищется один раз и сохраняется в термине
+        auto found = Context::m_ops.find(term->m_text);
+        if(found == Context::m_ops.end()) {
 
-        LOG_RUNTIME("Eval op '%s' not exist!", term->m_text.c_str());
+            LOG_RUNTIME("Eval op '%s' not exist!", term->m_text.c_str());
+        }
+        term->m_op_func = found->second;
     }
-    return (*Context::m_ops[term->m_text])(ctx, term, args, eval_block);
+    return (*term->m_op_func)(ctx, term, args, eval_block);
 }
 
 /*
@@ -1085,12 +1292,22 @@ ObjPtr Context::eval_OPERATOR(Context *ctx, const TermPtr &term, Obj * args, boo
  *
  */
 
+/*
+ * Левый операнд операторов, которые изменяют его значение на месте.
+ * Общие неизменяемые объекты (Obj::None, Obj::Yes, ...) заменяются копией.
+ */
+static inline ObjPtr EvalMutable(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
+    ObjPtr result = Context::Eval(ctx, term, args, eval_block);
+    Obj::CopyOnWrite(result);
+    return result;
+}
+
 ObjPtr Context::op_EQUAL(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
     ASSERT(term);
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_equal(Eval(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
+    return EvalOperand(ctx, term->Left(), args, eval_block)->op_equal(EvalOperand(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_ACCURATE(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1098,7 +1315,7 @@ ObjPtr Context::op_ACCURATE(Context *ctx, const TermPtr &term, Obj * args, bool
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_accurate(Eval(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
+    return EvalOperand(ctx, term->Left(), args, eval_block)->op_accurate(EvalOperand(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_NE(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1106,7 +1323,7 @@ ObjPtr Context::op_NE(Context *ctx, const TermPtr &term, Obj * args, bool eval_b
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_equal(Eval(ctx, term->Right(), args, eval_block)) ? Obj::No() : Obj::Yes();
+    return EvalOperand(ctx, term->Left(), args, eval_block)->op_equal(EvalOperand(ctx, term->Right(), args, eval_block)) ? Obj::No() : Obj::Yes();
 }
 
 ObjPtr Context::op_LT(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1114,7 +1331,7 @@ ObjPtr Context::op_LT(Context *ctx, const TermPtr &term, Obj * args, bool eval_b
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator<(Eval(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
+    return EvalOperand(ctx, term->Left(), args, eval_block)->operator<(EvalOperand(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_GT(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1122,7 +1339,7 @@ ObjPtr Context::op_GT(Context *ctx, const TermPtr &term, Obj * args, bool eval_b
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator>(Eval(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
+    return EvalOperand(ctx, term->Left(), args, eval_block)->operator>(EvalOperand(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_LE(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1130,7 +1347,7 @@ ObjPtr Context::op_LE(Context *ctx, const TermPtr &term, Obj * args, bool eval_b
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator<=(Eval(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
+    return EvalOperand(ctx, term->Left(), args, eval_block)->operator<=(EvalOperand(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_GE(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1138,7 +1355,7 @@ ObjPtr Context::op_GE(Context *ctx, const TermPtr &term, Obj * args, bool eval_b
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator>=(Eval(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
+    return EvalOperand(ctx, term->Left(), args, eval_block)->operator>=(EvalOperand(ctx, term->Right(), args, eval_block)) ? Obj::Yes() : Obj::No();
 }
 
 /*
@@ -1210,20 +1427,24 @@ ObjPtr Context::op_PLUS(Context *ctx, const TermPtr &term, Obj * args, bool eval
     ASSERT(term);
     ASSERT(term->Right());
     if(term->Left()) {
-
-        return Eval(ctx, term->Left(), args, eval_block)->operator+(Eval(ctx, term->Right(), args, eval_block));
+        if(ctx && ctx->m_lazy_enable) {
+            return TensorExpr::Eval(ctx, term, args, eval_block);
+        }
+        return EvalOperand(ctx, term->Left(), args, eval_block)->operator+(EvalOperand(ctx, term->Right(), args, eval_block));
     }
-    return Eval(ctx, term->Left(), args, eval_block)->operator+();
+    return EvalMutable(ctx, term->Left(), args, eval_block)->operator+();
 }
 
 ObjPtr Context::op_MINUS(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
     ASSERT(term);
     ASSERT(term->Right());
     if(term->Left()) {
-
-        return Eval(ctx, term->Left(), args, eval_block)->operator-(Eval(ctx, term->Right(), args, eval_block));
+        if(ctx && ctx->m_lazy_enable) {
+            return TensorExpr::Eval(ctx, term, args, eval_block);
+        }
+        return EvalOperand(ctx, term->Left(), args, eval_block)->operator-(EvalOperand(ctx, term->Right(), args, eval_block));
     }
-    return Eval(ctx, term->Left(), args, eval_block)->operator-();
+    return EvalMutable(ctx, term->Left(), args, eval_block)->operator-();
 }
 
 ObjPtr Context::op_DIV(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1231,7 +1452,10 @@ ObjPtr Context::op_DIV(Context *ctx, const TermPtr &term, Obj * args, bool eval_
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator/(Eval(ctx, term->Right(), args, eval_block));
+    if(ctx && ctx->m_lazy_enable) {
+        return TensorExpr::Eval(ctx, term, args, eval_block);
+    }
+    return EvalOperand(ctx, term->Left(), args, eval_block)->operator/(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_DIV_CEIL(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1239,7 +1463,7 @@ ObjPtr Context::op_DIV_CEIL(Context *ctx, const TermPtr &term, Obj * args, bool
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_div_ceil(Eval(ctx, term->Right(), args, eval_block));
+    return EvalOperand(ctx, term->Left(), args, eval_block)->op_div_ceil(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_MUL(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1247,7 +1471,10 @@ ObjPtr Context::op_MUL(Context *ctx, const TermPtr &term, Obj * args, bool eval_
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator*(Eval(ctx, term->Right(), args, eval_block));
+    if(ctx && ctx->m_lazy_enable) {
+        return TensorExpr::Eval(ctx, term, args, eval_block);
+    }
+    return EvalOperand(ctx, term->Left(), args, eval_block)->operator*(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_REM(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1255,7 +1482,7 @@ ObjPtr Context::op_REM(Context *ctx, const TermPtr &term, Obj * args, bool eval_
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator%(Eval(ctx, term->Right(), args, eval_block));
+    return EvalOperand(ctx, term->Left(), args, eval_block)->operator%(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_POW(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1263,7 +1490,7 @@ ObjPtr Context::op_POW(Context *ctx, const TermPtr &term, Obj * args, bool eval_
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_pow(Eval(ctx, term->Right(), args, eval_block));
+    return EvalOperand(ctx, term->Left(), args, eval_block)->op_pow(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 /*
@@ -1275,7 +1502,7 @@ ObjPtr Context::op_PLUS_(Context *ctx, const TermPtr &term, Obj * args, bool eva
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator+=(Eval(ctx, term->Right(), args, eval_block));
+    return EvalMutable(ctx, term->Left(), args, eval_block)->operator+=(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_MINUS_(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1283,7 +1510,7 @@ ObjPtr Context::op_MINUS_(Context *ctx, const TermPtr &term, Obj * args, bool ev
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator-=(Eval(ctx, term->Right(), args, eval_block));
+    return EvalMutable(ctx, term->Left(), args, eval_block)->operator-=(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_DIV_(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1291,7 +1518,7 @@ ObjPtr Context::op_DIV_(Context *ctx, const TermPtr &term, Obj * args, bool eval
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator/=(Eval(ctx, term->Right(), args, eval_block));
+    return EvalMutable(ctx, term->Left(), args, eval_block)->operator/=(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_DIV_CEIL_(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1299,7 +1526,7 @@ ObjPtr Context::op_DIV_CEIL_(Context *ctx, const TermPtr &term, Obj * args, bool
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_div_ceil_(Eval(ctx, term->Right(), args, eval_block));
+    return EvalMutable(ctx, term->Left(), args, eval_block)->op_div_ceil_(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_MUL_(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1307,7 +1534,7 @@ ObjPtr Context::op_MUL_(Context *ctx, const TermPtr &term, Obj * args, bool eval
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator*=(Eval(ctx, term->Right(), args, eval_block));
+    return EvalMutable(ctx, term->Left(), args, eval_block)->operator*=(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_REM_(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1315,7 +1542,7 @@ ObjPtr Context::op_REM_(Context *ctx, const TermPtr &term, Obj * args, bool eval
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->operator%=(Eval(ctx, term->Right(), args, eval_block));
+    return EvalMutable(ctx, term->Left(), args, eval_block)->operator%=(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_POW_(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1323,7 +1550,7 @@ ObjPtr Context::op_POW_(Context *ctx, const TermPtr &term, Obj * args, bool eval
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_pow_(Eval(ctx, term->Right(), args, eval_block));
+    return EvalMutable(ctx, term->Left(), args, eval_block)->op_pow_(EvalOperand(ctx, term->Right(), args, eval_block));
 }
 
 ObjPtr Context::op_CONCAT(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1331,7 +1558,7 @@ ObjPtr Context::op_CONCAT(Context *ctx, const TermPtr &term, Obj * args, bool ev
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Eval(ctx, term->Left(), args, eval_block)->op_concat_(Eval(ctx, term->Right(), args, eval_block), ConcatMode::Append);
+    return EvalMutable(ctx, term->Left(), args, eval_block)->op_concat_(Eval(ctx, term->Right(), args, eval_block), ConcatMode::Append);
 }
 
 ObjPtr Context::op_TYPE_EQ(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1340,9 +1567,9 @@ ObjPtr Context::op_TYPE_EQ(Context *ctx, const TermPtr &term, Obj * args, bool e
     ASSERT(term->Right());
 
     if(isType(term->Right()->GetFullName())) {
-        return Obj::CreateBool(Eval(ctx, term->Left(), args, eval_block)->op_class_test(term->Right()->GetFullName().c_str(), ctx));
+        return Eval(ctx, term->Left(), args, eval_block)->op_class_test(term->Right()->GetFullName().c_str(), ctx) ? Obj::Yes() : Obj::No();
     }
-    return Obj::CreateBool(Eval(ctx, term->Left(), args, eval_block)->op_class_test(Eval(ctx, term->Right(), args, eval_block), ctx));
+    return Eval(ctx, term->Left(), args, eval_block)->op_class_test(Eval(ctx, term->Right(), args, eval_block), ctx) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_TYPE_EQ2(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1350,7 +1577,7 @@ ObjPtr Context::op_TYPE_EQ2(Context *ctx, const TermPtr &term, Obj * args, bool
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Obj::CreateBool(Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), false));
+    return Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), false) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_TYPE_EQ3(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1358,7 +1585,7 @@ ObjPtr Context::op_TYPE_EQ3(Context *ctx, const TermPtr &term, Obj * args, bool
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Obj::CreateBool(Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), true));
+    return Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), true) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_TYPE_NE(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1366,9 +1593,9 @@ ObjPtr Context::op_TYPE_NE(Context *ctx, const TermPtr &term, Obj * args, bool e
     ASSERT(term->Left());
     ASSERT(term->Right());
     if(isType(term->Right()->GetFullName())) {
-        return Obj::CreateBool(!Eval(ctx, term->Left(), args, eval_block)->op_class_test(term->Right()->GetFullName().c_str(), ctx));
+        return !Eval(ctx, term->Left(), args, eval_block)->op_class_test(term->Right()->GetFullName().c_str(), ctx) ? Obj::Yes() : Obj::No();
     }
-    return Obj::CreateBool(!Eval(ctx, term->Left(), args, eval_block)->op_class_test(Eval(ctx, term->Right(), args, eval_block), ctx));
+    return !Eval(ctx, term->Left(), args, eval_block)->op_class_test(Eval(ctx, term->Right(), args, eval_block), ctx) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_TYPE_NE2(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1376,7 +1603,7 @@ ObjPtr Context::op_TYPE_NE2(Context *ctx, const TermPtr &term, Obj * args, bool
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Obj::CreateBool(!Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), false));
+    return !Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), false) ? Obj::Yes() : Obj::No();
 }
 
 ObjPtr Context::op_TYPE_NE3(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1384,7 +1611,7 @@ ObjPtr Context::op_TYPE_NE3(Context *ctx, const TermPtr &term, Obj * args, bool
     ASSERT(term->Left());
     ASSERT(term->Right());
 
-    return Obj::CreateBool(!Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), true));
+    return !Eval(ctx, term->Left(), args, eval_block)->op_duck_test(Eval(ctx, term->Right(), args, eval_block), true) ? Obj::Yes() : Obj::No();
 }
 
 /*
@@ -1437,7 +1664,7 @@ ObjPtr Context::op_SPACESHIP(Context *ctx, const TermPtr &term, Obj * args, bool
  *
  */
 
-ObjPtr eval_int(Context *ctx, const TermPtr &term, Obj * args, bool eval_block, ObjType type) {
+ObjPtr Context::CreateInterrupt(Context *ctx, const TermPtr &term, Obj * args, bool eval_block, ObjType type) {
 
     ObjPtr ret = Obj::CreateType(type, type, true);
     if(term->Right()) {
@@ -1448,15 +1675,17 @@ ObjPtr eval_int(Context *ctx, const TermPtr &term, Obj * args, bool eval_block,
         //        ret->push_back(Obj::CreateNone());
     }
     ASSERT(ret);
-    throw Return(ret);
+    return ret;
 }
 
 ObjPtr Context::eval_INT_PLUS(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
-    return eval_int(ctx, term, args, eval_block, ObjType::RetPlus);
+    ctx->m_interrupt_throw++;
+    throw Return(CreateInterrupt(ctx, term, args, eval_block, ObjType::RetPlus));
 }
 
 ObjPtr Context::eval_INT_MINUS(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
-    return eval_int(ctx, term, args, eval_block, ObjType::RetMinus);
+    ctx->m_interrupt_throw++;
+    throw Return(CreateInterrupt(ctx, term, args, eval_block, ObjType::RetMinus));
 }
 
 ObjPtr Context::eval_INT_REPEAT(Context *ctx, const TermPtr &term, Obj * args, bool eval_block) {
@@ -1464,13 +1693,106 @@ ObjPtr Context::eval_INT_REPEAT(Context *ctx, const TermPtr &term, Obj * args, b
     return nullptr;
 }
 
+void Context::ThrowInterrupt(Context *ctx) {
+    if(ctx->m_interrupt) {
+        ObjPtr ret;
+        ret.swap(ctx->m_interrupt);
+        ctx->m_interrupt_throw++;
+        throw Return(ret);
+    }
+}
+
+bool Context::TestInterrupt(Obj &obj, ObjType type, const char *name, Context *ctx) {
+    // Быстрая проверка без поиска имени типа для Break и Continue
+    ObjType check_type = obj.m_var_type_current;
+    if(obj.m_var_type_current == ObjType::Type || (!obj.m_var_is_init && obj.m_var_type_current == ObjType::None)) {
+        check_type = obj.m_var_type_fixed;
+    }
+    if(check_type == type) {
+        return true;
+    } else if(obj.m_class_name.empty() && obj.m_class_parents.empty()) {
+        return false;
+    }
+    return obj.op_class_test(name, ctx);
+}
+
+ObjPtr Context::ExecTerm(Context *ctx, const TermPtr &term, Obj * local_vars, bool eval_block) {
+    switch(term->getTermID()) {
+        case TermID::INT_PLUS:
+            ctx->m_interrupt = CreateInterrupt(ctx, term, local_vars, eval_block, ObjType::RetPlus);
+            return ctx->m_interrupt;
+        case TermID::INT_MINUS:
+            ctx->m_interrupt = CreateInterrupt(ctx, term, local_vars, eval_block, ObjType::RetMinus);
+            return ctx->m_interrupt;
+        case TermID::WHILE:
+            return ExecWhile(ctx, term, local_vars, eval_block);
+        case TermID::FOLLOW:
+            return ExecFollow(ctx, term, local_vars, eval_block);
+        case TermID::DOWHILE:
+            return ExecDoWhile(ctx, term, local_vars, eval_block);
+        default:
+            return Eval(ctx, term, local_vars, eval_block, CatchType::CATCH_NONE);
+    }
+}
+
+/*
+ * Перехват прерывания блоком.
+ * Возвращает true, если прерывание обработано и result содержит возвращаемое значение,
+ * и false, если прерывание нужно передать дальше.
+ */
+bool Context::CatchInterrupt(Context *ctx, const TermPtr &block, CatchType type_catch, TermID auto_type, Obj &ret, ObjPtr &result) {
+
+    ASSERT(ret.m_return_obj);
+
+    if(type_catch == CatchType::CATCH_NONE || auto_type == TermID::NONE || (type_catch == CatchType::CATCH_AUTO && auto_type == TermID::BLOCK)) {
+        return false;
+    } else if(auto_type == TermID::BLOCK_PLUS) {
+        if((type_catch == CatchType::CATCH_PLUS || type_catch == CatchType::CATCH_AUTO)
+                && ret.m_var_type_current == ObjType::RetPlus) {
+            result = ret.m_return_obj;
+            return true;
+        }
+        return false;
+    } else if(auto_type == TermID::BLOCK_MINUS) {
+        if((type_catch == CatchType::CATCH_MINUS || type_catch == CatchType::CATCH_AUTO)
+                && ret.m_var_type_current == ObjType::RetMinus) {
+            result = ret.m_return_obj;
+            return true;
+        }
+        return false;
+    } else if((type_catch == CatchType::CATCH_ALL ||
+            (type_catch == CatchType::CATCH_AUTO && auto_type == TermID::BLOCK_TRY))
+            && !block->m_type_allowed.empty()) { // Если есть фильтр для типа
+        // Тип данных при возврате не соответствует фильтру, пробросить прерывание дальше
+        bool is_return = false;
+        for (size_t i = 0; i < block->m_type_allowed.size(); i++) {
+            if(ret.m_return_obj->op_class_test(block->m_type_allowed[i]->getText().c_str(), ctx)) {
+                is_return = true;
+                break;
+            }
+        }
+        if(!is_return) {
+            return false;
+        }
+    }
+
+    result = ret.m_return_obj;
+    return true;
+}
+
 ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars, bool eval_block, CatchType type_catch, bool *has_interrupt) {
+    ObjPtr result = ExecBlock(ctx, block, local_vars, eval_block, type_catch, has_interrupt);
+    ThrowInterrupt(ctx);
+    return result;
+}
+
+ObjPtr Context::ExecBlock(Context *ctx, const TermPtr &block, Obj * local_vars, bool eval_block, CatchType type_catch, bool *has_interrupt) {
     if(has_interrupt) {
         *has_interrupt = false;
     }
 
     bool call_else = !block->m_follow.empty();
-    ObjPtr result = Obj::CreateNone();
+    ObjPtr result = Obj::None();
     TermID auto_type = TermID::NONE;
 
     if(block->IsBlock()) {
@@ -1486,7 +1808,7 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
                     //                    LOG_DEBUG("NS %s (%d)", block->m_block[i]->m_class.c_str(), (int)ctx->m_ns_stack.size());
                     bool is_ns = ctx->NamespasePush(block->m_block[i]->m_class);
                     try {
-                        result = CallBlock(ctx, block->m_block[i], local_vars, eval_block, CatchType::CATCH_AUTO, has_interrupt);
+                        result = ExecBlock(ctx, block->m_block[i], local_vars, eval_block, CatchType::CATCH_AUTO, has_interrupt);
                     } catch (...) {
                         if(is_ns) {
                             ctx->NamespasePop();
@@ -1497,7 +1819,10 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
                         ctx->NamespasePop();
                     }
                 } else {
-                    result = Eval(ctx, block->m_block[i], local_vars, eval_block, CatchType::CATCH_NONE);
+                    result = ExecTerm(ctx, block->m_block[i], local_vars, eval_block);
+                }
+                if(ctx->m_interrupt) {
+                    break;
                 }
             }
 
@@ -1506,7 +1831,7 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
                 //                LOG_DEBUG("NS %s (%d)", block->m_class.c_str(), (int)ctx->m_ns_stack.size());
                 bool is_ns = ctx->NamespasePush(block->m_class);
                 try {
-                    result = CallBlock(ctx, block, local_vars, eval_block, CatchType::CATCH_AUTO, has_interrupt);
+                    result = ExecBlock(ctx, block, local_vars, eval_block, CatchType::CATCH_AUTO, has_interrupt);
                 } catch (...) {
                     if(is_ns) {
                         ctx->NamespasePop();
@@ -1517,7 +1842,7 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
                     ctx->NamespasePop();
                 }
             } else {
-                result = Eval(ctx, block, local_vars, eval_block, CatchType::CATCH_NONE);
+                result = ExecTerm(ctx, block, local_vars, eval_block);
             }
         }
 
@@ -1529,40 +1854,10 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
         }
 
         ASSERT(obj.m_obj);
-        ASSERT(obj.m_obj->m_return_obj);
-
-        if(type_catch == CatchType::CATCH_NONE || auto_type == TermID::NONE || (type_catch == CatchType::CATCH_AUTO && auto_type == TermID::BLOCK)) {
-            throw;
-        } else if(auto_type == TermID::BLOCK_PLUS) {
-            if((type_catch == CatchType::CATCH_PLUS || type_catch == CatchType::CATCH_AUTO)
-                    && obj.m_obj->m_var_type_current == ObjType::RetPlus) {
-                return obj.m_obj->m_return_obj;
-            }
+        if(!CatchInterrupt(ctx, block, type_catch, auto_type, *obj.m_obj, result)) {
             throw;
-        } else if(auto_type == TermID::BLOCK_MINUS) {
-            if((type_catch == CatchType::CATCH_MINUS || type_catch == CatchType::CATCH_AUTO)
-                    && obj.m_obj->m_var_type_current == ObjType::RetMinus) {
-                return obj.m_obj->m_return_obj;
-            }
-            throw;
-        } else if((type_catch == CatchType::CATCH_ALL ||
-                (type_catch == CatchType::CATCH_AUTO && auto_type == TermID::BLOCK_TRY))
-                && !block->m_type_allowed.empty()) { // Если есть фильтр для типа
-            // Тип данных при возврате не соответствует фильтру, пробросить исключение дальше
-            bool is_return = false;
-            for (size_t i = 0; i < block->m_type_allowed.size(); i++) {
-                if(obj.m_obj->m_return_obj->op_class_test(block->m_type_allowed[i]->getText().c_str(), ctx)) {
-                    is_return = true;
-                    break;
-                }
-            }
-            if(!is_return) {
-                throw;
-            }
         }
 
-        result = obj.m_obj->m_return_obj;
-
     } catch (std::exception &obj) {
 
         call_else = false;
@@ -1577,6 +1872,17 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
         result->m_value = std::string(obj.what());
     }
 
+    if(ctx->m_interrupt) {
+        // Прерывание без исключения, обрабатывается так же как и Return
+        if(has_interrupt) {
+            *has_interrupt = true;
+        }
+        if(CatchInterrupt(ctx, block, type_catch, auto_type, *ctx->m_interrupt, result)) {
+            ctx->m_interrupt.reset();
+        }
+        return result;
+    }
+
     if(call_else) {
         //        
         //        if(block->m_follow.size()!=1){
@@ -1589,7 +1895,7 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
         //        ASSERT(block->m_follow.size() == 1);
 
         if(block->IsBlock()) {
-            result = CallBlock(ctx, block->m_follow[0], local_vars, eval_block, CatchType::CATCH_AUTO, has_interrupt);
+            result = ExecBlock(ctx, block->m_follow[0], local_vars, eval_block, CatchType::CATCH_AUTO, has_interrupt);
         } else {
             result = Eval(ctx, block->m_follow[0], local_vars, eval_block, CatchType::CATCH_NONE);
         }
@@ -1600,6 +1906,199 @@ ObjPtr Context::CallBlock(Context *ctx, const TermPtr &block, Obj * local_vars,
     return result;
 }
 
+/*
+ * Разрешение имен аргументов и локальных переменных функции в индексы ячеек кадра вызова.
+ * Ячейки 0..N - аргументы в порядке прототипа ($0 - сама функция), далее - локальные переменные,
+ * которые создаются в теле функции. Вложенные функции имеют собственный кадр и не просматриваются.
+ * Имена, которые не удалось разрешить ($$, $*, сессионные и глобальные объекты), ищутся по имени как и раньше.
+ */
+static bool IsSlotName(const std::string &name) {
+    return !name.empty() && name.compare("_") != 0 && name.find("::") == std::string::npos && !isLocalAny(name.c_str());
+}
+
+template <typename F>
+static void ForEachTerm(const TermPtr &term, std::set<Term *> &visited, F func) {
+    if(!term || visited.find(term.get()) != visited.end()) {
+        return;
+    }
+    visited.insert(term.get());
+    if(!func(term)) {
+        return;
+    }
+    ForEachTerm(term->m_left, visited, func);
+    ForEachTerm(term->m_right, visited, func);
+    ForEachTerm(term->m_list, visited, func);
+    for (size_t i = 0; i < term->size(); i++) {
+        ForEachTerm((*term)[i].second, visited, func);
+    }
+    for (auto &elem : term->m_block) {
+        ForEachTerm(elem, visited, func);
+    }
+    for (auto &elem : term->m_follow) {
+        ForEachTerm(elem, visited, func);
+    }
+}
+
+void Context::ResolveSlots(const TermPtr &proto, const TermPtr &body) {
+    if(!proto || !body) {
+        return;
+    }
+
+    std::map<std::string, int> slots;
+    int args = static_cast<int> (proto->size()) + 1;
+    for (int i = 0; i < proto->size(); i++) {
+        std::string name = proto->name(i).empty() ? (*proto)[i].second->getText() : proto->name(i);
+        if(IsSlotName(name)) {
+            slots[name] = i + 1;
+        }
+    }
+    int count = args;
+
+    std::set<Term *> visited;
+    ForEachTerm(body, visited, [&](const TermPtr & term) {
+        if(term->IsFunction()) {
+            return false;
+        } else if(term->getTermID() == TermID::CREATE || term->getTermID() == TermID::CREATE_OR_ASSIGN) {
+            TermPtr next = term->Left();
+            while(next && next->getTermID() != TermID::END) {
+                if(next->isCall()) {
+                    return false; // Определение вложенной функции
+                }
+                if(next->getTermID() == TermID::NAME && !next->Right() && IsSlotName(next->m_text) && slots.find(next->m_text) == slots.end()) {
+                    slots[next->m_text] = count++;
+                }
+                next = next->m_list;
+            }
+        }
+        return true;
+    });
+
+    visited.clear();
+    ForEachTerm(body, visited, [&](const TermPtr & term) {
+        if(term->IsFunction()) {
+            return false;
+        } else if(term->getTermID() == TermID::CREATE || term->getTermID() == TermID::CREATE_OR_ASSIGN) {
+            if(term->Left() && term->Left()->isCall()) {
+                return false;
+            }
+        }
+        term->m_slot = -1;
+        term->m_slot_scope = nullptr;
+        if(term->getTermID() == TermID::NAME && !term->isCall()) {
+            bool is_local = isLocal(term->m_text);
+            auto found = slots.find(is_local ? term->m_text.substr(1) : term->m_text);
+            // Через $name доступны только аргументы функции
+            if(found != slots.end() && (!is_local || found->second < args)) {
+                term->m_slot = found->second;
+                term->m_slot_scope = body.get();
+            }
+        } else if(term->getTermID() == TermID::ARGUMENT && term->m_text.size() > 1 && term->m_text[0] == '$' && isdigit(term->m_text[1])) {
+            size_t index = IndexArg(term);
+            if(index < static_cast<size_t> (args)) {
+                term->m_slot = static_cast<int> (index);
+                term->m_slot_scope = body.get();
+            }
+        }
+        return true;
+    });
+
+    body->m_frame_args = args;
+    body->m_frame_size = count;
+}
+
+/*
+ * Сворачиваются только операторы, результат которых зависит лишь от значений операндов.
+ * Конкатенация изменяет левый операнд, но для литерала это всегда его копия.
+ */
+static bool IsFoldOperator(const std::string &op) {
+    static const std::set<std::string> fold_ops = {"+", "-", "*", "/", "//", "%", "**", "++"};
+    return fold_ops.find(op) != fold_ops.end();
+}
+
+/*
+ * Все элементы литерала тензора - константы, а тип элементов (если указан) - встроенный.
+ */
+static bool IsFoldTensor(const TermPtr &term) {
+    if(!term->size()) {
+        return false;
+    }
+    for (size_t i = 0; i < term->size(); i++) {
+        if(!(*term)[i].second || !(*term)[i].second->m_const) {
+            return false;
+        }
+    }
+    bool has_error = false;
+    typeFromString(term->m_type_name, nullptr, &has_error);
+    return !has_error;
+}
+
+static bool FoldTerm(Context *ctx, const TermPtr &term, std::set<Term *> &visited) {
+    if(!term || visited.find(term.get()) != visited.end()) {
+        return false;
+    }
+    visited.insert(term.get());
+
+    bool left = FoldTerm(ctx, term->m_left, visited);
+    bool right = FoldTerm(ctx, term->m_right, visited);
+    FoldTerm(ctx, term->m_list, visited);
+    for (size_t i = 0; i < term->size(); i++) {
+        FoldTerm(ctx, (*term)[i].second, visited);
+    }
+    for (auto &elem : term->m_block) {
+        FoldTerm(ctx, elem, visited);
+    }
+    for (auto &elem : term->m_follow) {
+        FoldTerm(ctx, elem, visited);
+    }
+
+    if(term->m_const) {
+        return true;
+    }
+
+    switch(term->getTermID()) {
+        case TermID::INTEGER:
+        case TermID::NUMBER:
+        case TermID::STRCHAR:
+        case TermID::STRWIDE:
+        case TermID::RATIONAL:
+            break;
+
+        case TermID::OPERATOR:
+            if(left && right && IsFoldOperator(term->m_text)) {
+                break;
+            }
+            return false;
+
+        case TermID::TENSOR:
+            if(IsFoldTensor(term)) {
+                // Литерал тензора создается один раз при загрузке, а при выполнении копируется
+                break;
+            }
+            return false;
+
+        default:
+            return false;
+    }
+
+    // Ошибки (неверный тип литерала, деление на ноль) не обрабатываются при загрузке,
+    // а возникнут при выполнении выражения как и без свертки констант.
+    Obj args;
+    try {
+        ObjPtr value = Context::Eval(ctx, term, &args, false);
+        if(value && !term->m_const) {
+            term->m_const = value;
+        }
+    } catch (...) {
+        term->m_const = nullptr;
+    }
+    return !!term->m_const;
+}
+
+bool Context::FoldConstants(Context *ctx, const TermPtr &term) {
+    std::set<Term *> visited;
+    return FoldTerm(ctx, term, visited);
+}
+
 ObjPtr Context::CreateNative(const char *proto, const char *module, bool lazzy, const char *mangle_name) {
     TermPtr term;
     try {
@@ -1633,7 +2132,8 @@ ObjPtr Context::CreateNative(TermPtr proto, const char *module, bool lazzy, cons
             LOG_RUNTIME("Cannot create native variable without specifying the type!");
         }
 
-        type = typeFromString(proto->m_type_name, this);
+        // Имя типа без размерности
+        type = typeFromString(proto->GetType() ? proto->GetType()->m_text : proto->m_type_name, this);
         switch(type) {
             case ObjType::Bool:
             case ObjType::Int8:
@@ -1650,6 +2150,7 @@ ObjPtr Context::CreateNative(TermPtr proto, const char *module, bool lazzy, cons
             case ObjType::Single:
             case ObjType::Double:
             case ObjType::Pointer:
+            case ObjType::ViewChar:
                 break;
             default:
                 LOG_RUNTIME("Creating a variable with type '%s' is not supported!", proto->m_type_name.c_str());
@@ -1715,11 +2216,28 @@ ObjPtr Context::CreateNative(TermPtr proto, const char *module, bool lazzy, cons
         //        result->m_var = m_runtime->GetNativeAddr(
         //                result->m_func_mangle_name.empty() ? proto->m_text.c_str() : result->m_func_mangle_name.c_str(), module);
 
+        // Массив в нативной памяти (name:Int32[10] или name:ViewChar[64]) используется без копирования
+        std::vector<int64_t> dims;
+        if(proto->GetType()) {
+            for (auto &dim : proto->GetType()->m_dims) {
+                ObjPtr temp = CreateRVal(this, dim, true);
+                NL_CHECK(temp && temp->is_integer(), "Native data dimension '%s' not integer!", dim->toString().c_str());
+                dims.push_back(temp->GetValueAsInteger());
+            }
+        }
+
         if(result->is_function_type() || type == ObjType::Pointer) {
             NL_CHECK(at::get<void *>(result->m_var), "Error getting address '%s' from '%s'!", proto->toString().c_str(), module);
+        } else if(ptr && type == ObjType::ViewChar) {
+            NL_CHECK(dims.size() == 1, "Native byte string '%s' requires one dimension!", proto->toString().c_str());
+            result->m_var = Obj::CreateBytesView(ptr, dims[0])->m_var;
+            result->m_var_is_init = true;
         } else if(ptr && result->is_tensor_type()) {
-            //            result->m_tensor = torch::from_blob(at::get<void *>(result->m_var),{
-            //            }, toTorchType(type));
+            if(!dims.empty()) {
+                ObjPtr view = Obj::CreateTensorView(ptr, type, dims);
+                result->m_tensor = view->m_tensor;
+                result->m_var = view->m_var;
+            }
             result->m_var_is_init = true;
         } else {
 
@@ -1750,7 +2268,7 @@ void Context::CleanUp() {
     auto iter = begin();
     while(iter != end()) {
         if(iter->second.expired()) {
-            iter = ListType::erase(iter);
+            iter = Erase(iter);
         } else {
 
             iter++;
@@ -1758,21 +2276,143 @@ void Context::CleanUp() {
     }
 }
 
-ObjPtr Context::FindSessionTerm(const char *name, bool current_only) {
-    CleanUp();
-    auto found = find(MakeName(name));
-    while(found != end()) {
-        ObjPtr obj = found->second.lock();
-        if(obj) {
+Context::ListType::iterator Context::Erase(ListType::iterator iter) {
+    ASSERT(iter != end());
+    auto found = m_symbol_index.find(iter->first);
+    if(found != m_symbol_index.end() && m_symbols[found->second].m_iter == iter) {
+        // Следующая запись с тем же именем ищется при очередном обращении к символу
+        m_symbols[found->second].m_valid = false;
+    }
+    if(m_purge == iter) {
+        m_purge++;
+    }
+    return ListType::erase(iter);
+}
 
+void Context::SymbolInsert(ListType::iterator iter, bool is_front) {
+    auto found = m_symbol_index.find(iter->first);
+    if(found == m_symbol_index.end()) {
+        return; // Символ будет создан при первом поиске
+    }
+    Symbol &sym = m_symbols[found->second];
+    if(is_front) {
+        // Новая запись перекрывает все остальные с таким же именем
+        sym.m_iter = iter;
+        sym.m_valid = true;
+    } else if(sym.m_valid && sym.m_iter == end()) {
+        sym.m_iter = iter;
+    }
+}
+
+bool Context::RemoveSession(const std::string &name) {
+    if(!FindSession(name)) {
+        return false;
+    }
+    Symbol &sym = m_symbols[GetSymbol(name)];
+    ASSERT(sym.m_valid && sym.m_iter != end());
+    Erase(sym.m_iter);
+    return true;
+}
+
+size_t Context::GetSymbol(const std::string &name) {
+    auto found = m_symbol_index.find(name);
+    if(found != m_symbol_index.end()) {
+        return found->second;
+    }
+    m_symbols.push_back({name, end(), false});
+    m_symbol_index[name] = m_symbols.size() - 1;
+    return m_symbols.size() - 1;
+}
+
+ObjPtr Context::FindSymbol(size_t handle) {
+    ASSERT(handle < m_symbols.size());
+
+    m_lookup_count++;
+
+    // Удаление нескольких освободившихся записей за один поиск
+    for (size_t i = 0; i < PURGE_STEP && !empty(); i++) {
+        if(m_purge == end()) {
+            m_purge = begin();
+        }
+        if(m_purge->second.expired()) {
+            Erase(m_purge);
+        } else {
+            m_purge++;
+        }
+    }
+
+    Symbol &sym = m_symbols[handle];
+    if(sym.m_valid) {
+        if(sym.m_iter == end()) {
+            m_lookup_hit++;
+            return nullptr;
+        }
+        ObjPtr obj = sym.m_iter->second.lock();
+        if(obj) {
+            m_lookup_hit++;
             return obj;
         }
-        ListType::erase(found);
-        found++;
+    }
+
+    sym.m_iter = end();
+    sym.m_valid = true;
+    auto iter = begin();
+    while(iter != end()) {
+        if(iter->first.compare(sym.m_name) == 0) {
+            ObjPtr obj = iter->second.lock();
+            if(obj) {
+                sym.m_iter = iter;
+                return obj;
+            }
+            iter = Erase(iter);
+            continue;
+        }
+        iter++;
     }
     return nullptr;
 }
 
+ObjPtr Context::FindSessionTerm(const char *name, bool current_only) {
+    return FindSession(MakeName(name));
+}
+
+ObjPtr Context::FindGlobalTerm(const std::string name) {
+    if(m_global_count != m_terms->size()) {
+        // Модуль изменялся не через RegisterObject, индекс нужно построить заново
+        m_global_index.clear();
+        for (auto &elem : *m_terms) {
+            m_global_index.emplace(elem.first, elem.second);
+        }
+        m_global_count = m_terms->size();
+    }
+    m_lookup_count++;
+    auto found = m_global_index.find(MakeName(name));
+    if(found != m_global_index.end()) {
+        m_lookup_hit++;
+        return found->second;
+    }
+    return GetObject(name);
+}
+
+std::string Context::StatInfo() {
+    std::string result("Lookup: ");
+    result += std::to_string(m_lookup_count);
+    result += ", hit: ";
+    result += std::to_string(m_lookup_hit);
+    if(m_lookup_count) {
+        result += " (";
+        result += std::to_string(m_lookup_hit * 100 / m_lookup_count);
+        result += "%)";
+    }
+    result += ", symbols: ";
+    result += std::to_string(m_symbols.size());
+    result += ", in-place assign: ";
+    result += std::to_string(m_inplace_count);
+    result += ", shared: ";
+    result += std::to_string(m_inplace_shared);
+    return result;
+}
+
 /*
  * обращение по имени - доступ только к локальному объекту (разрешение имени во
  * время компиляции). обращение как к сессионному обекту - если есть локальный,
@@ -1810,7 +2450,7 @@ bool Context::CheckOrLoadModule(std::string str) {
     std::string name = ExtractModuleName(str.c_str());
     if(m_modules.find(name) == m_modules.end()) {
 
-        std::shared_ptr<Module> module = m_runtime->LoadModule(*this, str.c_str(), true);
+        Ref<Module> module = m_runtime->LoadModule(*this, str.c_str(), true);
         if(module) {
             m_modules[name] = std::move(module);
         }
@@ -1874,21 +2514,27 @@ std::string newlang::ReadFile(const char *fileName) {
     return ss.str();
 }
 
+std::string newlang::GetTextMD5(const std::string &text) {
+    llvm::MD5 hash;
+    hash.update(text);
+
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+
+    llvm::SmallString<32> str;
+    llvm::MD5::stringifyResult(result, str);
+    return str.c_str();
+}
+
 ObjPtr Context::CreateLVal(Context *ctx, TermPtr term, Obj * args) {
 
     ASSERT(ctx);
     ASSERT(term);
     ASSERT(!term->m_text.empty());
 
-    ctx->CleanUp();
-
-    auto iter = ctx->find(ctx->NamespaseFull(term->GetFullName()));
-
-    if(iter != ctx->end()) {
-        ObjPtr obj = (*iter).second.lock();
-        if(obj) {
-            return obj;
-        }
+    ObjPtr obj = ctx->FindSession(ctx->NamespaseFull(term->GetFullName()));
+    if(obj) {
+        return obj;
     }
 
     //    if (ctx->select(term->m_text).complete()) {
@@ -1940,105 +2586,64 @@ ObjPtr Context::CreateLVal(Context *ctx, TermPtr term, Obj * args) {
 ObjPtr Context::CreateRVal(Context *ctx, const char *source, Obj * local_vars, bool eval_block, CatchType no_catch) {
     Parser parser;
     parser.Parse(source, &m_macros);
+    FoldConstants(ctx, parser.GetAst());
 
     return CreateRVal(ctx, parser.GetAst(), local_vars, eval_block, no_catch);
 }
 
-void Context::ItemTensorEval_(torch::Tensor &tensor, c10::IntArrayRef shape, std::vector<Index> &ind, const int64_t pos,
-        ObjPtr &obj, ObjPtr & args) {
-    ASSERT(pos < static_cast<int64_t> (ind.size()));
-    if(pos + 1 < static_cast<int64_t> (ind.size())) {
-        for (ind[pos] = 0; ind[pos].integer() < shape[pos]; ind[pos] = ind[pos].integer() + 1) {
-            ItemTensorEval_(tensor, shape, ind, pos + 1, obj, args);
-        }
-    } else {
-
-        at::Scalar value;
-        ObjType type = fromTorchType(tensor.scalar_type());
-
-        for (ind[pos] = 0; ind[pos].integer() < shape[pos]; ind[pos] = ind[pos].integer() + 1) {
-
-            switch(type) {
-                case ObjType::Int8:
-                case ObjType::Char:
-                case ObjType::Byte:
-                case ObjType::Int16:
-                case ObjType::Word:
-                case ObjType::Int32:
-                case ObjType::DWord:
-                case ObjType::Int64:
-                case ObjType::DWord64:
-                    value = at::Scalar(obj->Call(this)->GetValueAsInteger()); // args
-                    tensor.index_put_(ind, value);
-                    break;
-                case ObjType::Float32:
-                case ObjType::Float64:
-                case ObjType::Single:
-                case ObjType::Double:
-                    value = at::Scalar(obj->Call(this)->GetValueAsNumber()); // args
-                    tensor.index_put_(ind, value);
-
-                    break;
-                default:
-                    ASSERT(!"Not implemented!");
-            }
-        }
+/*
+ * Элементы вычисляются по порядку (по строкам) и записываются подряд в непрерывный буфер тензора.
+ */
+template <typename T, typename V>
+static void FillTensorItems(torch::Tensor &tensor, V value) {
+    T *ptr = tensor.data_ptr<T>();
+    ASSERT(ptr);
+    int64_t count = tensor.numel();
+    for (int64_t i = 0; i < count; i++) {
+        ptr[i] = static_cast<T> (value());
     }
 }
 
 void Context::ItemTensorEval(torch::Tensor &self, ObjPtr obj, ObjPtr args) {
-    if(self.dim() == 0) {
 
-        signed char *ptr_char = nullptr;
-        int16_t *ptr_short = nullptr;
-        int32_t *ptr_int = nullptr;
-        int64_t *ptr_long = nullptr;
-        float *ptr_float = nullptr;
-        double *ptr_double = nullptr;
+    torch::Tensor data = self.is_contiguous() ? self : torch::empty_like(self, at::MemoryFormat::Contiguous);
 
-        switch(fromTorchType(self.scalar_type())) {
-            case ObjType::Int8:
-                ptr_char = self.data_ptr<signed char>();
-                ASSERT(ptr_char);
-                *ptr_char = static_cast<signed char> (obj->Call(this)->GetValueAsInteger());
-                return;
-            case ObjType::Int16:
-                ptr_short = self.data_ptr<int16_t>();
-                ASSERT(ptr_short);
-                *ptr_short = static_cast<int16_t> (obj->Call(this)->GetValueAsInteger());
-                return;
-            case ObjType::Int32:
-                ptr_int = self.data_ptr<int32_t>();
-                ASSERT(ptr_int);
-                *ptr_int = static_cast<int32_t> (obj->Call(this)->GetValueAsInteger());
-                return;
-            case ObjType::Int64:
-                ptr_long = self.data_ptr<int64_t>();
-                ASSERT(ptr_long);
-                *ptr_long = static_cast<int64_t> (obj->Call(this)->GetValueAsInteger());
-                return;
-            case ObjType::Float32:
-                ptr_float = self.data_ptr<float>();
-                ASSERT(ptr_float);
-                *ptr_float = static_cast<float> (obj->Call(this)->GetValueAsNumber());
-                return;
-            case ObjType::Float64:
-                ptr_double = self.data_ptr<double>();
-                ASSERT(ptr_double);
-                *ptr_double = static_cast<double> (obj->Call(this)->GetValueAsNumber());
-                return;
-        }
+    auto integer = [&]() {
+        return obj->Call(this)->GetValueAsInteger(); // args
+    };
+    auto number = [&]() {
+        return obj->Call(this)->GetValueAsNumber(); // args
+    };
 
-        ASSERT(!"Not implemented!");
-    } else {
+    switch(fromTorchType(self.scalar_type())) {
+        case ObjType::Int8:
+            FillTensorItems<signed char>(data, integer);
+            break;
+        case ObjType::Int16:
+            FillTensorItems<int16_t>(data, integer);
+            break;
+        case ObjType::Int32:
+            FillTensorItems<int32_t>(data, integer);
+            break;
+        case ObjType::Int64:
+            FillTensorItems<int64_t>(data, integer);
+            break;
+        case ObjType::Float32:
+            FillTensorItems<float>(data, number);
+            break;
+        case ObjType::Float64:
+            FillTensorItems<double>(data, number);
+            break;
+        default:
+            ASSERT(!"Not implemented!");
+    }
 
-        c10::IntArrayRef shape = self.sizes(); // Кол-во эментов в каждом измерении
-        std::vector<Index> ind(shape.size(),
-                0); // Счетчик обхода всех эелемнтов тензора
-        ItemTensorEval_(self, shape, ind, 0, obj, args);
+    if(!data.is_same(self)) {
+        self.copy_(data);
     }
 }
 
+
 std::vector<int64_t> GetTensorShape(Context *ctx, TermPtr type, Obj * local_vars, bool eval_block) {
     std::vector<int64_t> result(type->size());
     for (int i = 0; i < type->size(); i++) {
@@ -2101,34 +2706,42 @@ std::vector<Index> Context::MakeIndex(Context *ctx, TermPtr term, Obj * local_va
         if(term->at(i).second->getTermID() == TermID::ELLIPSIS) {
             result.push_back(Index("..."));
         } else {
-
             ObjPtr temp = ctx->CreateRVal(ctx, term->at(i).second, local_vars);
+            result.push_back(MakeIndexValue(term->at(i).second, i, *temp));
+        }
+    }
+    return result;
+}
 
-            if(temp->is_none_type()) {
-
-                result.push_back(Index(at::indexing::None));
-            } else if(temp->is_integer() || temp->is_bool_type()) {
+Index Context::MakeIndexValue(const TermPtr &term, int i, Obj &value) {
+    if(value.is_none_type()) {
 
-                if(temp->is_scalar()) {
-                    result.push_back(Index(temp->GetValueAsInteger()));
-                } else if(temp->m_tensor.dim() == 1) {
-                    result.push_back(Index(temp->m_tensor));
-                } else {
-                    NL_PARSER(term->at(i).second, "Extra dimensions index not support '%d'!", i);
-                }
-            } else if(temp->is_range()) {
+        return Index(at::indexing::None);
+    } else if(value.is_integer() || value.is_bool_type()) {
 
-                int64_t start = temp->at("start").second->GetValueAsInteger();
-                int64_t stop = temp->at("stop").second->GetValueAsInteger();
-                int64_t step = temp->at("step").second->GetValueAsInteger();
+        if(value.is_scalar()) {
+            return Index(value.GetValueAsInteger());
+        } else if(value.m_tensor.dim() == 1) {
+            return Index(value.m_tensor);
+        }
+        NL_PARSER(term, "Extra dimensions index not support '%d'!", i);
+    } else if(value.is_range()) {
 
-                result.push_back(Index(at::indexing::Slice(start, stop, step)));
-            } else {
+        int64_t start = value.at("start").second->GetValueAsInteger();
+        int64_t stop = value.at("stop").second->GetValueAsInteger();
+        int64_t step = value.at("step").second->GetValueAsInteger();
 
-                NL_PARSER(term->at(i).second, "Fail tensor index '%d'!", i);
-            }
-        }
+        return Index(at::indexing::Slice(start, stop, step));
     }
+    NL_PARSER(term, "Fail tensor index '%d'!", i);
+}
+
+/*
+ * Пустой объект результата, который заполняется при создании значения
+ */
+static inline ObjPtr CreateResult(const TermPtr &term) {
+    ObjPtr result = Obj::CreateNone();
+    result->m_is_reference = !!term->m_ref;
     return result;
 }
 
@@ -2144,10 +2757,16 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
     ObjPtr args = nullptr;
     ObjPtr value = nullptr;
     TermPtr field = nullptr;
+    ObjPtr *slot = nullptr;
     std::string full_name;
 
-    result = Obj::CreateNone();
-    result->m_is_reference = !!term->m_ref;
+    if(term->m_const) {
+        // Константа не изменяется, а результат может быть изменен вызывающей стороной
+        return term->m_const->Clone();
+    }
+
+    // Объект результата создается только там, где он заполняется, т.к. большинство
+    // терминов возвращают уже существующий объект
 
     int64_t val_int;
     double val_dbl;
@@ -2167,7 +2786,8 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
                 result->m_var_type_fixed = typeFromString(term->m_type_name, ctx);
                 result->m_var_type_current = result->m_var_type_fixed;
             }
-            return result;
+            term->m_const = result;
+            return result->Clone();
 
         case TermID::NUMBER:
             val_dbl = parseDouble(term->getText().c_str());
@@ -2179,13 +2799,16 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
                 result->m_var_type_fixed = typeFromString(term->m_type_name, ctx);
                 result->m_var_type_current = result->m_var_type_fixed;
             }
-            return result;
+            term->m_const = result;
+            return result->Clone();
 
         case TermID::STRWIDE:
-            return Obj::CreateString(utf8_decode(term->getText()));
+            term->m_const = Obj::CreateString(utf8_decode(term->getText()));
+            return term->m_const->Clone();
 
         case TermID::STRCHAR:
-            return Obj::CreateString(term->getText());
+            term->m_const = Obj::CreateString(term->getText());
+            return term->m_const->Clone();
 
             /*        case TermID::FIELD:
                         if(module && module->HasFunc(term->GetFullName().c_str())) {
@@ -2205,6 +2828,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
             //@todo Что делать с пустыми значениями? Это None ???
         case TermID::EMPTY:
+            result = CreateResult(term);
             result->m_var_type_current = ObjType::None;
             result->m_var_is_init = false;
             return result;
@@ -2227,7 +2851,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
                 ctx->CreateArgs_(args, term, local_vars);
 
                 if(term->isReturn()) {
-                    return result;
+                    return CreateResult(term);
                 }
 
                 result = temp->Call(ctx, args.get());
@@ -2237,6 +2861,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
             if(term->GetType()) {
 
+                result = CreateResult(term);
                 result->m_var_type_current = typeFromString(term->GetType()->m_text, ctx);
                 result->m_var_type_fixed = result->m_var_type_current;
                 result->m_var_is_init = false; // Нельзя считать значение
@@ -2258,6 +2883,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
             if(term->m_text.compare("_") == 0) {
 
+                result = CreateResult(term);
                 result->m_var_type_current = ObjType::None;
                 return result;
 
@@ -2265,6 +2891,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
                 //- **\parent** - Родительский объект (**$$**)
 
+                result = CreateResult(term);
                 result->m_var_type_current = ObjType::Dictionary;
                 result->m_var_name = "$$";
 
@@ -2276,7 +2903,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
                         result->push_back(Obj::CreateString(iter->first));
                         iter++;
                     } else {
-                        iter = ctx->ListType::erase(iter);
+                        iter = ctx->Erase(iter);
                     }
                 }
 
@@ -2287,6 +2914,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
                 //- **\args** - Все аргументы функции (**$\***)
 
+                result = CreateResult(term);
                 result->m_var_type_current = ObjType::Dictionary;
                 result->m_var_name = "$*";
                 result->m_var_is_init = true;
@@ -2486,11 +3114,14 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
 
 
-            if(isLocal(term->m_text.c_str())) {
+            slot = ctx->FindSlot(term);
+            if(slot && isLocal(term->m_text)) {
+                return *slot;
+            } else if(isLocal(term->m_text.c_str())) {
                 full_name = MakeName(term->m_text);
                 return local_vars->at(full_name).second;
             } else {
-                result = ctx->GetTerm(term->GetFullName().c_str(), term->isRef());
+                result = slot ? *slot : ctx->GetTerm(term->GetFullName().c_str(), term->isRef());
 
                 // Типы данных обрабатываются тут, а не в вызовах функций (TermID::CALL)
 
@@ -2679,6 +3310,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
         case TermID::TENSOR:
         case TermID::DICT:
+            result = CreateResult(term);
             result->m_var_type_current = ObjType::Dictionary;
             ctx->CreateArgs_(result, term, local_vars);
 
@@ -2716,6 +3348,10 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
         case TermID::ARGUMENT:
 
+            slot = ctx->FindSlot(term);
+            if(slot) {
+                return *slot;
+            }
             val_int = IndexArg(term);
             if(val_int < local_vars->size()) {
                 return local_vars->at(val_int).second;
@@ -2737,6 +3373,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
             //            return CallBlock(ctx, term, local_vars, CatchType::CATCH_MINUS);
 
         case TermID::ELLIPSIS:
+            result = CreateResult(term);
             result->m_var_type_current = ObjType::Ellipsis;
             result->m_var_type_fixed = ObjType::None;
             result->m_var_is_init = true;
@@ -2744,6 +3381,7 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
 
         case TermID::RANGE:
 
+            result = CreateResult(term);
             result->m_var_type_current = ObjType::Dictionary;
             for (int i = 0; i < term->size(); i++) {
                 ASSERT(!term->name(i).empty());
@@ -2761,7 +3399,8 @@ ObjPtr Context::CreateRVal(Context *ctx, TermPtr term, Obj * local_vars, bool ev
             return result;
 
         case TermID::RATIONAL:
-            return Obj::CreateRational(term->m_text);
+            term->m_const = Obj::CreateRational(term->m_text);
+            return term->m_const->Clone();
 
         case TermID::ITERATOR:
 
@@ -2907,7 +3546,7 @@ ObjPtr Context::CreateClass(std::string class_name, TermPtr body, Obj * local_va
         std::string replace(base->m_class_name.substr(1));
         replace += "::";
 
-        std::set<Variable<Obj>::PairType *> rollback;
+        std::vector<Variable<Obj>::PairType> rollback;
 
 
         try {
@@ -2918,7 +3557,7 @@ ObjPtr Context::CreateClass(std::string class_name, TermPtr body, Obj * local_va
                 // Только один конструктор у класса
                 obj = Obj::CreateFunc(constructor, &Obj::ConstructorStub_, ObjType::PureFunc);
                 push_back(obj, constructor); // weak_ptr
-                rollback.insert(&m_terms->push_back(obj, constructor));
+                rollback.push_back(m_terms->push_back(obj, constructor));
             }
 
             for (auto &elem : methods) {
@@ -2943,7 +3582,7 @@ ObjPtr Context::CreateClass(std::string class_name, TermPtr body, Obj * local_va
                 if(m_terms->find(name) == m_terms->end()) {
                     // LOG_DEBUG("new name %s", name.c_str());
                     push_back(obj, name); // weak_ptr
-                    rollback.insert(&m_terms->push_back(obj, name));
+                    rollback.push_back(m_terms->push_back(obj, name));
                 }
             }
 
@@ -3003,10 +3642,11 @@ ObjPtr Context::CreateClass(std::string class_name, TermPtr body, Obj * local_va
 
 
             for (auto &elem : rollback) {
-                // LOG_DEBUG("Rollback: '%s'", elem->first.c_str());
+                // LOG_DEBUG("Rollback: '%s'", elem.first.c_str());
                 // remove(find(elem.first)); // weak_ptr
-                m_terms->remove(*elem);
+                m_terms->remove(elem);
             }
+            m_global_count = std::numeric_limits<size_t>::max(); // Индекс будет построен заново
 
             throw;
         }
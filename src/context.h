@@ -11,11 +11,13 @@
 
 namespace newlang {
 
+    class VmProgram;
 
     std::string GetFileExt(const char * str);
     std::string AddDefaultFileExt(const char * str, const char *ext_default);
     std::string ReplaceFileExt(const char * str, const char *ext_old, const char *ext_new);
     std::string ReadFile(const char *fileName);
+    std::string GetTextMD5(const std::string &text);
 
     bool Tranliterate(const wchar_t c, std::wstring &str);
     std::string MangleName(const char * name);
@@ -192,14 +194,8 @@ namespace newlang {
                 m_timestamp = asctime(timeinfo);
             }
 
-            llvm::ErrorOr<llvm::MD5::MD5Result> md5 = llvm::sys::fs::md5_contents((int)*file);
-            if (!md5) {
-                m_md5 = "????????????????????????????????";
-            } else {
-                llvm::SmallString<32> hash;
-                llvm::MD5::stringifyResult((*md5), hash);
-                m_md5 = hash.c_str();
-            }
+            // Файл уже прочитан до конца, поэтому md5 считается по прочитанному тексту
+            m_md5 = GetTextMD5(m_source);
             llvm::sys::fs::closeFile(*file);
 
             m_var_is_init = true;
@@ -211,7 +207,7 @@ namespace newlang {
         }
     };
 
-    class Context : public Variable<Obj, std::weak_ptr<Obj> >, public std::enable_shared_from_this<Context> {
+    class Context : public VariableList<Obj, WeakRef<Obj> > {
     public:
 
         const char * SYS__DESTRUCTOR__ = "_____";
@@ -237,6 +233,16 @@ namespace newlang {
         };
         static ObjPtr CREATE_OR_ASSIGN(Context *ctx, const TermPtr & term, Obj *args, CreateMode mode);
 
+        /*
+         * Присвоение x = x + y (-, *, /) без копии левого операнда: значение value применяется
+         * к объекту переменной target на месте, как в x += y. Выполняется для тензоров, которые
+         * не используются другими объектами (иначе изменение было бы видно через них), и для строк.
+         * Данные, общие с копиями объекта, копируются перед записью (Obj::DetachTensor_).
+         * Тип переменной сохраняется, как при обычном присвоении. Возвращает false, если
+         * присвоение нужно выполнить обычным способом (с копией).
+         */
+        static bool AssignInPlace(Context *ctx, Obj &target, char op, const ObjPtr &value);
+
 #define DEFINE_CASE(name) \
     static ObjPtr eval_ ## name(Context *ctx, const TermPtr &term, Obj *args, bool eval_block = false);
 
@@ -261,7 +267,50 @@ namespace newlang {
 
         LLVMBuilderRef m_llvm_builder;
 
-        std::map<std::string, std::shared_ptr<Module>> m_modules;
+        std::map<std::string, Ref<Module>> m_modules;
+
+        bool m_vm_enable; ///< Выполнять код через байт-код виртуальной машины (vm.h), а не обходом дерева терминов
+        bool m_jit_enable; ///< Компилировать часто вызываемые функции в машинный код (jit.h)
+        bool m_lazy_enable; ///< Вычислять арифметические выражения с тензорами одним проходом (lazy.h)
+        ObjPtr m_interrupt; ///< Прерывание (RetPlus/RetMinus), которое передается вверх по блокам без выброса исключения
+        uint64_t m_interrupt_throw; ///< Количество прерываний, переданных исключением Return
+
+        /*
+         * Кадр вызова функции с объектами аргументов и локальных переменных, 
+         * доступ к которым выполняется по индексу ячейки, а не поиском по имени.
+         */
+        struct Frame {
+            Term *m_scope;
+            std::vector<ObjPtr> m_slot;
+            int64_t m_loops; ///< Количество итераций циклов в теле функции (Obj::m_jit_hot)
+        };
+        Frame *m_frame; ///< Кадр текущей выполняемой функции или nullptr
+
+        static void ResolveSlots(const TermPtr &proto, const TermPtr &body);
+
+        /*
+         * Литералы преобразуются в объекты, а константные выражения из литералов
+         * (арифметика, конкатенация строк) вычисляются один раз при загрузке.
+         * Результат сохраняется в Term::m_const.
+         */
+        static bool FoldConstants(Context *ctx, const TermPtr &term);
+
+        inline ObjPtr * FindSlot(const TermPtr &term) {
+            // Внутри пространства имен имена разрешаются поиском, как и при создании (SetSlot)
+            if (m_frame && term->m_slot >= 0 && term->m_slot_scope == m_frame->m_scope &&
+                    static_cast<size_t> (term->m_slot) < m_frame->m_slot.size() && m_frame->m_slot[term->m_slot] && m_ns_stack.empty()) {
+                return &m_frame->m_slot[term->m_slot];
+            }
+            return nullptr;
+        }
+
+        inline void SetSlot(const TermPtr &term, ObjPtr obj) {
+            // Внутри пространства имен локальные объекты создаются с полным именем, поэтому не кешируются
+            if (m_frame && term->m_slot >= 0 && term->m_slot_scope == m_frame->m_scope &&
+                    static_cast<size_t> (term->m_slot) < m_frame->m_slot.size() && m_ns_stack.empty()) {
+                m_frame->m_slot[term->m_slot] = obj;
+            }
+        }
 
         static std::vector<std::string> SplitString(const char * str, const char *delim) {
 
@@ -297,6 +346,10 @@ namespace newlang {
 
         void clear_() override {
             Variable::clear_();
+            for (auto &elem : m_symbols) {
+                elem.m_valid = false;
+            }
+            m_purge = end();
 
             m_modules.clear();
 
@@ -304,10 +357,89 @@ namespace newlang {
             m_terms->clear_();
             m_terms->m_var_is_init = true;
             m_terms->m_var_type_current = ObjType::Module;
+            m_global_index.clear();
+            m_global_count = 0;
 
             m_ns_stack.clear();
         }
 
+        /*
+         * Таблица символов сессионных объектов.
+         * 
+         * Сами объекты по прежнему хранятся в списке контекста (порядок важен для перекрытия имен),
+         * а для поиска используется хеш-индекс интернированных имен. Номер символа (handle) не меняется
+         * все время жизни контекста и может кешироваться в местах вызова. Символ хранит итератор
+         * на первую запись с этим именем или end(), если объект отсутствует (тоже кешируется).
+         * 
+         * Записи с освободившимися weak_ptr являются "надгробиями" и удаляются постепенно,
+         * по несколько штук при каждом поиске (PurgeStep), а не полным просмотром списка.
+         * Поэтому все изменения списка контекста должны выполняться только через методы ниже.
+         */
+        struct Symbol {
+            std::string m_name;
+            ListType::iterator m_iter;
+            bool m_valid;
+        };
+
+        static const size_t PURGE_STEP = 4;
+
+        inline void push_front(const PairType & p) {
+            ListType::push_front(p);
+            SymbolInsert(begin(), true);
+        }
+
+        inline PairType & push_back(const PairType & p) {
+            ListType::push_back(p);
+            SymbolInsert(std::prev(end()), false);
+            return back();
+        }
+
+        inline PairType & push_back(const Type value, const std::string &name = "") {
+            return push_back(pair(value, name));
+        }
+
+        inline void pop_front() {
+            Erase(begin());
+        }
+
+        void erase(const int64_t index) override {
+            Erase(at_index(index));
+        }
+
+        ListType::iterator Erase(ListType::iterator iter);
+        void SymbolInsert(ListType::iterator iter, bool is_front);
+        bool RemoveSession(const std::string &name);
+
+        size_t GetSymbol(const std::string &name);
+        ObjPtr FindSymbol(size_t handle);
+
+        inline ObjPtr FindSession(const std::string &name) {
+            return FindSymbol(GetSymbol(name));
+        }
+
+        std::string StatInfo();
+
+        uint64_t m_lookup_count; ///< Количество поисков объектов по имени
+        uint64_t m_lookup_hit; ///< Из них найдено по индексу без просмотра списка
+        uint64_t m_inplace_count; ///< Присвоений x = x + y и s = s ++ t, выполненных без копии (AssignInPlace)
+        uint64_t m_inplace_shared; ///< Присвоений с копией из-за тензора, общего с другим объектом
+
+        /*
+         * Кеш байт-кода для ExecStr в режиме виртуальной машины. Повторное выполнение
+         * того же исходного текста не требует разбора и компиляции, а программа
+         * компилируется один раз для разобранного дерева терминов.
+         * Кеш сбрасывается при изменении набора макросов.
+         */
+        struct VmCacheItem {
+            TermPtr exec;
+            std::shared_ptr<VmProgram> prog;
+        };
+        static const size_t VM_CACHE_SIZE = 256;
+        std::map<std::string, VmCacheItem> m_vm_cache;
+        size_t m_vm_macros; ///< Количество макросов на момент заполнения кеша
+        uint64_t m_vm_compile; ///< Количество компиляций в байт-код
+        uint64_t m_vm_cached; ///< Количество выполнений байт-кода из кеша
+
         inline ObjPtr ExecFile(const std::string &filename, Obj *args = nullptr, CatchType int_catch = CatchType::CATCH_ALL) {
             std::string source = ReadFile(filename.c_str());
             if (source.empty()) {
@@ -317,17 +449,35 @@ namespace newlang {
         }
 
         inline ObjPtr ExecStr(const std::string str, Obj *args = nullptr, CatchType int_catch = CatchType::CATCH_AUTO) {
-            TermPtr exec = Parser::ParseString(str, &m_macros);
             ObjPtr temp;
             if (args == nullptr) {
                 temp = Obj::CreateNone();
                 args = temp.get();
             }
+            if (m_vm_enable) {
+                return ExecVM(str, args);
+            }
+            TermPtr exec = Parser::ParseString(str, &m_macros);
+            FoldConstants(this, exec);
             return Eval(this, exec, args, true, int_catch);
         }
 
+        ObjPtr ExecVM(const std::string &source, Obj *args);
+        ObjPtr ExecVM(TermPtr exec, Obj *args);
+
         static ObjPtr Eval(Context *ctx, TermPtr term, Obj *args, bool eval_block, CatchType int_catch = CatchType::CATCH_AUTO);
 
+        /*
+         * Вычисление операнда, значение которого только читается (правый операнд операторов
+         * и операнды сравнений). Для констант возвращается сам объект из термина без копирования.
+         */
+        inline static ObjPtr EvalOperand(Context *ctx, const TermPtr &term, Obj *args, bool eval_block) {
+            if (term->m_const) {
+                return term->m_const;
+            }
+            return Eval(ctx, term, args, eval_block);
+        }
+
         static ObjPtr ExpandAssign(Context *ctx, TermPtr lvar, TermPtr rval, Obj *args, CreateMode mode);
         static ObjPtr ExpandCreate(Context *ctx, TermPtr lvar, TermPtr rval, Obj * args);
 
@@ -361,8 +511,8 @@ namespace newlang {
         void CreateArgs_(ObjPtr &args, TermPtr &term, Obj * local_vars);
 
         static std::vector<Index> MakeIndex(Context *ctx, TermPtr term, Obj * local_vars);
+        static Index MakeIndexValue(const TermPtr &term, int i, Obj &value);
 
-        void ItemTensorEval_(torch::Tensor &tensor, c10::IntArrayRef shape, std::vector<Index> &ind, const int64_t pos, ObjPtr & obj, ObjPtr & args);
         void ItemTensorEval(torch::Tensor &tensor, ObjPtr obj, ObjPtr args);
 
         void ReadBuiltInProto(ProtoType & proto);
@@ -371,13 +521,7 @@ namespace newlang {
         ObjPtr RegisterObject(ObjPtr var);
 
         ObjPtr RemoveObject(const char * name) {
-            std::string str(name);
-            if (str.size() && (str[0] == '$' || str[0] == '@')) {
-                str = str.substr(1);
-            }
-            auto found = find(name);
-            if (found != end()) {
-                ListType::erase(found);
+            if (RemoveSession(name)) {
                 return Obj::Yes();
             }
             return Obj::No();
@@ -388,9 +532,9 @@ namespace newlang {
             if (str.size() && (str[0] == '$')) {
                 str = str.substr(1);
             }
-            auto found = find(str);
-            if (found != end()) {
-                return found->second.lock();
+            ObjPtr found = FindSession(str);
+            if (found) {
+                return found;
             }
             auto func = m_funcs.find(str);
             if (func != m_funcs.end()) {
@@ -405,8 +549,13 @@ namespace newlang {
 
         RuntimePtr m_runtime; // Глобальный контекс, если к нему есть доступ
 
-        std::shared_ptr<Module> m_main_module;
+        Ref<Module> m_main_module;
         Module * m_terms;
+        std::unordered_map<std::string, ObjPtr> m_global_index; ///< Хеш-индекс объектов модуля m_terms
+        size_t m_global_count; ///< Размер m_terms на момент построения индекса
+        std::vector<Symbol> m_symbols;
+        std::unordered_map<std::string, size_t> m_symbol_index;
+        ListType::iterator m_purge;
         std::vector<std::string> m_ns_stack;
 
         bool NamespasePush(const std::string &name) {
@@ -479,13 +628,7 @@ namespace newlang {
 
         ObjPtr FindGlobalTerm(TermPtr term);
 
-        ObjPtr FindGlobalTerm(const std::string name) {
-            auto found = m_terms->find(MakeName(name));
-            if (found != m_terms->end()) {
-                return found->second;
-            }
-            return GetObject(name);
-        }
+        ObjPtr FindGlobalTerm(const std::string name);
 
         void RegisterInContext(ObjPtr & args) {
             RegisterInContext(*args);
@@ -505,6 +648,27 @@ namespace newlang {
 
         static ObjPtr CallBlock(Context *ctx, const TermPtr &block, Obj *local_vars, bool eval_block, CatchType catch_type, bool *has_interrupt);
 
+        /*
+         * Выполнение блока без выброса исключения для прерываний ++ и --.
+         * :Break, :Continue и :Error - это значения прерывания (--:Break--, ++:Error(1)++),
+         * поэтому они передаются тем же способом.
+         * Прерывание, которое не было перехвачено блоком, остается в ctx->m_interrupt
+         * и обрабатывается вызывающим кодом. CallBlock - обертка, которая преобразует
+         * необработанное прерывание в исключение Return для остальных мест вызова.
+         * Без исключения обрабатываются только прерывания, записанные отдельным оператором
+         * в блоке, цикле или следовании. Прерывание внутри выражения (res := ++1++)
+         * и ошибки из нативного кода по прежнему передаются исключением.
+         */
+        static ObjPtr ExecBlock(Context *ctx, const TermPtr &block, Obj *local_vars, bool eval_block, CatchType catch_type, bool *has_interrupt);
+        static ObjPtr ExecTerm(Context *ctx, const TermPtr &term, Obj *local_vars, bool eval_block);
+        static ObjPtr ExecWhile(Context *ctx, const TermPtr &term, Obj *args, bool eval_block);
+        static ObjPtr ExecFollow(Context *ctx, const TermPtr &term, Obj *args, bool eval_block);
+        static ObjPtr ExecDoWhile(Context *ctx, const TermPtr &term, Obj *args, bool eval_block);
+        static bool CatchInterrupt(Context *ctx, const TermPtr &block, CatchType type_catch, TermID auto_type, Obj &ret, ObjPtr &result);
+        static ObjPtr CreateInterrupt(Context *ctx, const TermPtr &term, Obj *args, bool eval_block, ObjType type);
+        static void ThrowInterrupt(Context *ctx);
+        static bool TestInterrupt(Obj &obj, ObjType type, const char *name, Context *ctx);
+
         static ObjPtr EvalBlockAND(Context *ctx, const TermPtr &block, Obj * local_vars);
         static ObjPtr EvalBlockOR(Context *ctx, const TermPtr &block, Obj * local_vars);
         static ObjPtr EvalBlockXOR(Context *ctx, const TermPtr &block, Obj * local_vars);
@@ -767,6 +931,7 @@ namespace newlang {
             TYPE_EQUAL,
             TYPE_STRICT,
         };
+        static MatchMode GetMatchMode(const TermPtr &term);
         static bool MatchCompare(Obj &match, ObjPtr &value, MatchMode mode, Context * ctx);
         static bool MatchEstimate(Obj &match, const TermPtr &match_item, MatchMode mode, Context *ctx, Obj * args);
 
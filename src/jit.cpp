@@ -0,0 +1,971 @@
+#include "pch.h"
+
+#include <atomic>
+#include <mutex>
+
+#include <llvm-c/Error.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+
+#include <jit.h>
+#include <context.h>
+#include <term.h>
+#include <types.h>
+
+using namespace newlang;
+
+namespace {
+
+    std::atomic<int64_t> g_jit_compiled;
+    std::atomic<int64_t> g_jit_failed;
+    std::atomic<int64_t> g_jit_calls;
+    std::atomic<int64_t> g_jit_deopt;
+    std::atomic<int64_t> g_jit_trampolines;
+
+    std::string TakeErrorMessage(LLVMErrorRef error) {
+        char *message = LLVMGetErrorMessage(error);
+        std::string result(message);
+        LLVMDisposeErrorMessage(message);
+        return result;
+    }
+
+    /*
+     * Общий для процесса экземпляр LLJIT. Никогда не удаляется, т.к. машинный код функций
+     * может удаляться из деструкторов статических объектов при завершении процесса.
+     */
+    struct JitEngine {
+        std::mutex mutex;
+        LLVMOrcLLJITRef jit;
+        uint64_t counter;
+        std::map<std::string, JitCode::TrampolineType *> trampolines;
+    };
+
+    JitEngine * CreateEngine() {
+        LLVMInitializeNativeTarget();
+        LLVMInitializeNativeAsmPrinter();
+
+        JitEngine *engine = new JitEngine();
+        engine->counter = 0;
+
+        LLVMErrorRef error = LLVMOrcCreateLLJIT(&engine->jit, nullptr);
+        if(error) {
+            LOG_RUNTIME("Fail create LLJIT: %s", TakeErrorMessage(error).c_str());
+        }
+
+        // Функции математической библиотеки (fmod, floor) берутся из адресного пространства процесса
+        LLVMOrcDefinitionGeneratorRef generator;
+        error = LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(&generator, LLVMOrcLLJITGetGlobalPrefix(engine->jit), nullptr, nullptr);
+        if(error) {
+            LOG_RUNTIME("Fail create symbol generator: %s", TakeErrorMessage(error).c_str());
+        }
+        LLVMOrcJITDylibAddGenerator(LLVMOrcLLJITGetMainJITDylib(engine->jit), generator);
+        return engine;
+    }
+
+    JitEngine & Engine() {
+        static JitEngine *engine = CreateEngine();
+        return *engine;
+    }
+
+    /*
+     * Построение LLVM IR из тела функции.
+     *
+     * Аргументы и локальные переменные адресуются по индексам ячеек кадра (Context::ResolveSlots)
+     * и хранятся в alloca, которые затем переводятся в регистры оптимизатором (mem2reg).
+     * Тип значения каждой переменной определяется при ее создании и не может меняться.
+     * Переменная, созданная внутри цикла, условия или вложенного блока, недоступна после него.
+     */
+    class JitBuilder {
+    public:
+
+        typedef JitCode::Kind Kind;
+
+        JitBuilder(LLVMContextRef context, LLVMModuleRef module, const TermPtr &body) :
+        m_context(context), m_module(module), m_scope(body.get()), m_loop_depth(0) {
+            m_builder = LLVMCreateBuilderInContext(m_context);
+            m_alloca = LLVMCreateBuilderInContext(m_context);
+            m_i1 = LLVMInt1TypeInContext(m_context);
+            m_i32 = LLVMInt32TypeInContext(m_context);
+            m_i64 = LLVMInt64TypeInContext(m_context);
+            m_f64 = LLVMDoubleTypeInContext(m_context);
+            m_vars.resize(body->m_frame_size);
+        }
+
+        ~JitBuilder() {
+            LLVMDisposeBuilder(m_builder);
+            LLVMDisposeBuilder(m_alloca);
+        }
+
+        bool Build(const char *name, const TermPtr &body, const std::vector<Kind> &args) {
+            LLVMTypeRef ptr_type = LLVMPointerType(m_i64, 0);
+            LLVMTypeRef params[] = {ptr_type, ptr_type};
+            LLVMTypeRef func_type = LLVMFunctionType(m_i32, params, 2, false);
+            m_func = LLVMAddFunction(m_module, name, func_type);
+
+            LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(m_context, m_func, "entry");
+            LLVMBasicBlockRef start = LLVMAppendBasicBlockInContext(m_context, m_func, "start");
+            m_deopt = LLVMAppendBasicBlockInContext(m_context, m_func, "deopt");
+
+            LLVMPositionBuilderAtEnd(m_builder, m_deopt);
+            LLVMBuildRet(m_builder, LLVMConstInt(m_i32, static_cast<uint64_t> (-1), true));
+
+            LLVMPositionBuilderAtEnd(m_alloca, entry);
+            for (size_t i = 0; i < args.size(); i++) {
+                ASSERT(i + 1 < m_vars.size());
+                LLVMValueRef index = LLVMConstInt(m_i64, i, false);
+                LLVMValueRef ptr = LLVMBuildGEP2(m_alloca, m_i64, LLVMGetParam(m_func, 0), &index, 1, "");
+                LLVMValueRef value = LLVMBuildLoad2(m_alloca, m_i64, ptr, "");
+
+                Var &var = m_vars[i + 1];
+                var.kind = args[i];
+                var.is_arg = true;
+                if(var.kind == Kind::Number) {
+                    value = LLVMBuildBitCast(m_alloca, value, m_f64, "");
+                }
+                var.ptr = LLVMBuildAlloca(m_alloca, TypeOf(var.kind), "");
+                LLVMBuildStore(m_alloca, value, var.ptr);
+            }
+
+            LLVMPositionBuilderAtEnd(m_builder, start);
+            Value result;
+            if(!Lower(body, result)) {
+                return false;
+            }
+
+            LLVMValueRef kind = LLVMConstInt(m_i32, static_cast<uint64_t> (result.kind), false);
+            if(result.kind != Kind::None) {
+                LLVMValueRef value = result.value;
+                if(result.kind == Kind::Number) {
+                    value = LLVMBuildBitCast(m_builder, value, m_i64, "");
+                }
+                LLVMBuildStore(m_builder, value, LLVMGetParam(m_func, 1));
+                if(result.is_none) {
+                    kind = LLVMBuildSelect(m_builder, result.is_none, LLVMConstInt(m_i32, static_cast<uint64_t> (Kind::None), false), kind, "");
+                }
+            }
+            LLVMBuildRet(m_builder, kind);
+
+            LLVMBuildBr(m_alloca, start);
+            return true;
+        }
+
+    protected:
+
+        /*
+         * Значение выражения. Для цикла и условия без ветки иначе значение
+         * может отсутствовать (None), что определяется во время выполнения флагом is_none.
+         */
+        struct Value {
+            Kind kind = Kind::None;
+            LLVMValueRef value = nullptr;
+            LLVMValueRef is_none = nullptr;
+        };
+
+        struct Var {
+            Kind kind = Kind::None; ///< None - переменная еще не создана
+            LLVMValueRef ptr = nullptr;
+            bool is_arg = false;
+        };
+
+        inline LLVMTypeRef TypeOf(Kind kind) {
+            return kind == Kind::Number ? m_f64 : m_i64;
+        }
+
+        inline bool IsScalar(const Value &value) {
+            return value.kind != Kind::None && !value.is_none;
+        }
+
+        Var * FindVar(const TermPtr &term) {
+            if(term->m_slot <= 0 || term->m_slot_scope != m_scope || static_cast<size_t> (term->m_slot) >= m_vars.size()) {
+                return nullptr;
+            }
+            if(term->isCall() || term->isReturn() || term->GetType() || term->Right() || term->size()) {
+                return nullptr;
+            }
+            return &m_vars[term->m_slot];
+        }
+
+        LLVMValueRef ToNumber(const Value &value) {
+            if(value.kind == Kind::Number) {
+                return value.value;
+            }
+            return LLVMBuildSIToFP(m_builder, value.value, m_f64, "");
+        }
+
+        /*
+         * Логическое значение как в Obj::GetValueAsBoolean() для скаляров (приведение к целому)
+         */
+        LLVMValueRef ToBool(const Value &value) {
+            if(value.kind != Kind::Number) {
+                return LLVMBuildICmp(m_builder, LLVMIntNE, value.value, LLVMConstInt(m_i64, 0, false), "");
+            }
+            LLVMValueRef above = LLVMBuildFCmp(m_builder, LLVMRealOGE, value.value, LLVMConstReal(m_f64, 1), "");
+            LLVMValueRef below = LLVMBuildFCmp(m_builder, LLVMRealOLE, value.value, LLVMConstReal(m_f64, -1), "");
+            return LLVMBuildOr(m_builder, above, below, "");
+        }
+
+        LLVMValueRef CallFloor(LLVMValueRef value) {
+            LLVMTypeRef func_type = LLVMFunctionType(m_f64, &m_f64, 1, false);
+            LLVMValueRef func = LLVMGetNamedFunction(m_module, "llvm.floor.f64");
+            if(!func) {
+                func = LLVMAddFunction(m_module, "llvm.floor.f64", func_type);
+            }
+            return LLVMBuildCall2(m_builder, func_type, func, &value, 1, "");
+        }
+
+        /*
+         * Переход в блок деоптимизации при выполнении условия
+         */
+        void DeoptIf(LLVMValueRef cond) {
+            LLVMBasicBlockRef next = LLVMAppendBasicBlockInContext(m_context, m_func, "");
+            LLVMBuildCondBr(m_builder, cond, m_deopt, next);
+            LLVMPositionBuilderAtEnd(m_builder, next);
+        }
+
+        bool Lower(const TermPtr &term, Value &out) {
+            out = Value();
+            Var *var;
+            switch(term->getTermID()) {
+                case TermID::INTEGER:
+                    if(term->GetType()) {
+                        return false;
+                    }
+                    out.kind = Kind::Integer;
+                    out.value = LLVMConstInt(m_i64, static_cast<uint64_t> (parseInteger(term->getText().c_str())), true);
+                    return true;
+
+                case TermID::NUMBER:
+                    if(term->GetType()) {
+                        return false;
+                    }
+                    out.kind = Kind::Number;
+                    out.value = LLVMConstReal(m_f64, parseDouble(term->getText().c_str()));
+                    return true;
+
+                case TermID::NAME:
+                case TermID::ARGUMENT:
+                    var = FindVar(term);
+                    if(!var || var->kind == Kind::None) {
+                        return false;
+                    }
+                    out.kind = var->kind;
+                    out.value = LLVMBuildLoad2(m_builder, TypeOf(var->kind), var->ptr, "");
+                    return true;
+
+                case TermID::OPERATOR:
+                    // Выражение из литералов, вычисленное при загрузке (Context::FoldConstants)
+                    if(term->m_const && term->m_const->m_var_type_fixed == ObjType::None && term->m_const->is_scalar()) {
+                        if(term->m_const->is_integral()) {
+                            out.kind = Kind::Integer;
+                            out.value = LLVMConstInt(m_i64, static_cast<uint64_t> (term->m_const->GetValueAsInteger()), true);
+                            return true;
+                        } else if(term->m_const->is_floating()) {
+                            out.kind = Kind::Number;
+                            out.value = LLVMConstReal(m_f64, term->m_const->GetValueAsNumber());
+                            return true;
+                        }
+                    }
+                    return LowerOperator(term, out);
+
+                case TermID::ASSIGN:
+                case TermID::CREATE:
+                case TermID::CREATE_OR_ASSIGN:
+                    return LowerAssign(term, out);
+
+                case TermID::BLOCK:
+                    return LowerBlock(term, out);
+
+                case TermID::WHILE:
+                    return LowerWhile(term, out);
+
+                case TermID::FOLLOW:
+                    return LowerFollow(term, out);
+
+                default:
+                    return false;
+            }
+        }
+
+        bool LowerBlock(const TermPtr &term, Value &out) {
+            if(!term->m_follow.empty() || !term->m_type_allowed.empty() || !term->m_class.empty()) {
+                return false;
+            }
+            out = Value();
+            for (auto &elem : term->m_block) {
+                // Вложенный блок выполняется в своем пространстве имен
+                std::vector<Var> save;
+                if(elem->getTermID() == TermID::BLOCK) {
+                    save = m_vars;
+                }
+                if(!Lower(elem, out)) {
+                    return false;
+                }
+                if(elem->getTermID() == TermID::BLOCK) {
+                    m_vars.swap(save);
+                }
+            }
+            return true;
+        }
+
+        LLVMValueRef LowerArithmetic(const std::string &op, const Value &left, const Value &right, Kind &kind) {
+            // Арифметика с логическими значениями остается интерпретатору
+            if(left.kind == Kind::Boolean || right.kind == Kind::Boolean) {
+                return nullptr;
+            }
+            if(left.kind == Kind::Integer && right.kind == Kind::Integer && op.compare("/") != 0 && op.compare("//") != 0) {
+                kind = Kind::Integer;
+                if(op.compare("+") == 0) {
+                    return LLVMBuildAdd(m_builder, left.value, right.value, "");
+                } else if(op.compare("-") == 0) {
+                    return LLVMBuildSub(m_builder, left.value, right.value, "");
+                } else if(op.compare("*") == 0) {
+                    return LLVMBuildMul(m_builder, left.value, right.value, "");
+                } else if(op.compare("%") == 0) {
+                    // Деление на ноль выполняет интерпретатор, а остаток от деления на -1 всегда ноль
+                    DeoptIf(LLVMBuildICmp(m_builder, LLVMIntEQ, right.value, LLVMConstInt(m_i64, 0, false), ""));
+                    LLVMValueRef minus_one = LLVMBuildICmp(m_builder, LLVMIntEQ, right.value, LLVMConstInt(m_i64, static_cast<uint64_t> (-1), true), "");
+                    LLVMValueRef divisor = LLVMBuildSelect(m_builder, minus_one, LLVMConstInt(m_i64, 1, false), right.value, "");
+                    return LLVMBuildSRem(m_builder, left.value, divisor, "");
+                }
+                return nullptr;
+            }
+
+            // Деление и операции с числом с плавающей точкой всегда возвращают Float64 (Obj::operator/= и т.д.)
+            kind = Kind::Number;
+            LLVMValueRef a = ToNumber(left);
+            LLVMValueRef b = ToNumber(right);
+            if(op.compare("+") == 0) {
+                return LLVMBuildFAdd(m_builder, a, b, "");
+            } else if(op.compare("-") == 0) {
+                return LLVMBuildFSub(m_builder, a, b, "");
+            } else if(op.compare("*") == 0) {
+                return LLVMBuildFMul(m_builder, a, b, "");
+            } else if(op.compare("/") == 0) {
+                return LLVMBuildFDiv(m_builder, a, b, "");
+            } else if(op.compare("//") == 0) {
+                return CallFloor(LLVMBuildFDiv(m_builder, a, b, ""));
+            } else if(op.compare("%") == 0) {
+                return LLVMBuildFRem(m_builder, a, b, "");
+            }
+            return nullptr;
+        }
+
+        LLVMValueRef LowerCompare(const std::string &op, const Value &left, const Value &right) {
+            static const std::map<std::string, std::pair<LLVMIntPredicate, LLVMRealPredicate>> predicates = {
+                {"<", {LLVMIntSLT, LLVMRealOLT}},
+                {">", {LLVMIntSGT, LLVMRealOGT}},
+                {"<=", {LLVMIntSLE, LLVMRealOLE}},
+                {">=", {LLVMIntSGE, LLVMRealOGE}},
+                {"==", {LLVMIntEQ, LLVMRealOEQ}},
+                {"!=", {LLVMIntNE, LLVMRealUNE}},
+            };
+            auto found = predicates.find(op);
+            if(found == predicates.end()) {
+                return nullptr;
+            }
+            LLVMValueRef cmp;
+            if(left.kind != Kind::Number && right.kind != Kind::Number) {
+                cmp = LLVMBuildICmp(m_builder, found->second.first, left.value, right.value, "");
+            } else {
+                cmp = LLVMBuildFCmp(m_builder, found->second.second, ToNumber(left), ToNumber(right), "");
+            }
+            return LLVMBuildZExt(m_builder, cmp, m_i64, "");
+        }
+
+        bool LowerOperator(const TermPtr &term, Value &out) {
+            static const std::set<std::string> arithmetic = {"+", "-", "*", "/", "//", "%"};
+            static const std::set<std::string> assign = {"+=", "-=", "*=", "/=", "//=", "%="};
+
+            if(!term->Left() || !term->Right() || term->m_list) {
+                return false;
+            }
+            const std::string &op = term->m_text;
+            Value left;
+            Value right;
+
+            if(assign.find(op) != assign.end()) {
+                Var *var = FindVar(term->Left());
+                if(!var || var->is_arg || var->kind == Kind::None) {
+                    return false;
+                }
+                if(!Lower(term->Right(), right) || !IsScalar(right)) {
+                    return false;
+                }
+                left.kind = var->kind;
+                left.value = LLVMBuildLoad2(m_builder, TypeOf(var->kind), var->ptr, "");
+                out.value = LowerArithmetic(op.substr(0, op.size() - 1), left, right, out.kind);
+                // Изменение типа переменной не поддерживается
+                if(!out.value || out.kind != var->kind) {
+                    return false;
+                }
+                LLVMBuildStore(m_builder, out.value, var->ptr);
+                return true;
+            }
+
+            if(!Lower(term->Left(), left) || !IsScalar(left) || !Lower(term->Right(), right) || !IsScalar(right)) {
+                return false;
+            }
+            if(arithmetic.find(op) != arithmetic.end()) {
+                out.value = LowerArithmetic(op, left, right, out.kind);
+            } else {
+                out.kind = Kind::Boolean;
+                out.value = LowerCompare(op, left, right);
+            }
+            return out.value != nullptr;
+        }
+
+        bool LowerAssign(const TermPtr &term, Value &out) {
+            // Только присвоение одной локальной переменной без индексов и указания типа
+            TermPtr lval = term->Left();
+            TermPtr rval = term->Right();
+            if(!lval || !rval || lval->m_list || rval->m_list || lval->getTermID() != TermID::NAME) {
+                return false;
+            }
+            Var *var = FindVar(lval);
+            if(!var || var->is_arg) {
+                return false;
+            }
+            if(term->getTermID() == TermID::ASSIGN && var->kind == Kind::None) {
+                return false;
+            }
+            // Повторное создание переменной - ошибка, которую должен выдать интерпретатор
+            if(term->getTermID() == TermID::CREATE && (var->kind != Kind::None || m_loop_depth)) {
+                return false;
+            }
+
+            if(!Lower(rval, out) || !IsScalar(out)) {
+                return false;
+            }
+            if(var->kind == Kind::None) {
+                var->kind = out.kind;
+                var->ptr = LLVMBuildAlloca(m_alloca, TypeOf(out.kind), "");
+            } else if(var->kind != out.kind) {
+                return false;
+            }
+            LLVMBuildStore(m_builder, out.value, var->ptr);
+            return true;
+        }
+
+        bool LowerCond(const TermPtr &term, LLVMValueRef &cond) {
+            Value value;
+            if(!Lower(term, value) || !IsScalar(value)) {
+                return false;
+            }
+            cond = ToBool(value);
+            return true;
+        }
+
+        /*
+         * Аналог Context::ExecWhile. Значение цикла - результат последней итерации или None.
+         */
+        bool LowerWhile(const TermPtr &term, Value &out) {
+            if(!term->Left() || !term->Right() || !term->m_follow.empty()) {
+                return false;
+            }
+            LLVMBasicBlockRef cond_block = LLVMAppendBasicBlockInContext(m_context, m_func, "while");
+            LLVMBasicBlockRef body_block = LLVMAppendBasicBlockInContext(m_context, m_func, "");
+            LLVMBasicBlockRef exit_block = LLVMAppendBasicBlockInContext(m_context, m_func, "");
+
+            LLVMValueRef is_none = LLVMBuildAlloca(m_alloca, m_i1, "");
+            LLVMBuildStore(m_builder, LLVMConstInt(m_i1, 1, false), is_none);
+            LLVMBuildBr(m_builder, cond_block);
+
+            LLVMPositionBuilderAtEnd(m_builder, cond_block);
+            LLVMValueRef cond;
+            if(!LowerCond(term->Left(), cond)) {
+                return false;
+            }
+            LLVMBuildCondBr(m_builder, cond, body_block, exit_block);
+
+            LLVMPositionBuilderAtEnd(m_builder, body_block);
+            std::vector<Var> save = m_vars;
+            Value body;
+            m_loop_depth++;
+            bool is_done = Lower(term->Right(), body);
+            m_loop_depth--;
+            m_vars.swap(save);
+            if(!is_done) {
+                return false;
+            }
+
+            out = Value();
+            out.kind = body.kind;
+            LLVMValueRef value = nullptr;
+            if(body.kind != Kind::None) {
+                value = LLVMBuildAlloca(m_alloca, TypeOf(body.kind), "");
+                LLVMBuildStore(m_builder, body.value, value);
+            }
+            LLVMBuildStore(m_builder, body.is_none ? body.is_none : LLVMConstInt(m_i1, 0, false), is_none);
+            LLVMBuildBr(m_builder, cond_block);
+
+            LLVMPositionBuilderAtEnd(m_builder, exit_block);
+            if(value) {
+                out.value = LLVMBuildLoad2(m_builder, TypeOf(body.kind), value, "");
+                out.is_none = LLVMBuildLoad2(m_builder, m_i1, is_none, "");
+            }
+            return true;
+        }
+
+        /*
+         * Аналог Context::ExecFollow. Все ветки должны возвращать значения одного вида.
+         */
+        bool LowerFollow(const TermPtr &term, Value &out) {
+            LLVMBasicBlockRef exit_block = LLVMAppendBasicBlockInContext(m_context, m_func, "");
+            LLVMBasicBlockRef none_block = LLVMGetInsertBlock(m_builder); // Ни одно условие не выполнено
+            std::vector<std::pair<LLVMBasicBlockRef, Value>> branches;
+            Kind kind = Kind::None;
+
+            for (size_t i = 0; i < term->m_follow.size(); i++) {
+                TermPtr cond_term = term->m_follow[i]->Left();
+                TermPtr body_term = term->m_follow[i]->Right();
+                if(!cond_term || !body_term) {
+                    return false;
+                }
+
+                LLVMBasicBlockRef body_block = LLVMAppendBasicBlockInContext(m_context, m_func, "");
+                LLVMBasicBlockRef next_block = nullptr;
+                if(cond_term->getTermID() == TermID::NONE && i + 1 == term->m_follow.size()) {
+                    // [_] --> {else}
+                    LLVMBuildBr(m_builder, body_block);
+                } else {
+                    LLVMValueRef cond;
+                    if(!LowerCond(cond_term, cond)) {
+                        return false;
+                    }
+                    next_block = LLVMAppendBasicBlockInContext(m_context, m_func, "");
+                    LLVMBuildCondBr(m_builder, cond, body_block, next_block);
+                }
+
+                LLVMPositionBuilderAtEnd(m_builder, body_block);
+                std::vector<Var> save = m_vars;
+                Value body;
+                bool is_done = Lower(body_term, body);
+                m_vars.swap(save);
+                if(!is_done) {
+                    return false;
+                }
+                if(body.kind != Kind::None) {
+                    if(kind != Kind::None && kind != body.kind) {
+                        return false;
+                    }
+                    kind = body.kind;
+                }
+                branches.push_back(std::make_pair(LLVMGetInsertBlock(m_builder), body));
+
+                none_block = next_block;
+                if(!next_block) {
+                    break;
+                }
+                LLVMPositionBuilderAtEnd(m_builder, next_block);
+            }
+
+            out = Value();
+            out.kind = kind;
+            LLVMValueRef value = nullptr;
+            LLVMValueRef is_none = nullptr;
+            if(kind != Kind::None) {
+                value = LLVMBuildAlloca(m_alloca, TypeOf(kind), "");
+                is_none = LLVMBuildAlloca(m_alloca, m_i1, "");
+            }
+            for (auto &branch : branches) {
+                LLVMPositionBuilderAtEnd(m_builder, branch.first);
+                if(value) {
+                    if(branch.second.kind != Kind::None) {
+                        LLVMBuildStore(m_builder, branch.second.value, value);
+                    }
+                    LLVMValueRef flag = branch.second.kind == Kind::None ? LLVMConstInt(m_i1, 1, false) :
+                            (branch.second.is_none ? branch.second.is_none : LLVMConstInt(m_i1, 0, false));
+                    LLVMBuildStore(m_builder, flag, is_none);
+                }
+                LLVMBuildBr(m_builder, exit_block);
+            }
+            if(none_block) {
+                LLVMPositionBuilderAtEnd(m_builder, none_block);
+                if(value) {
+                    LLVMBuildStore(m_builder, LLVMConstInt(m_i1, 1, false), is_none);
+                }
+                LLVMBuildBr(m_builder, exit_block);
+            }
+
+            LLVMPositionBuilderAtEnd(m_builder, exit_block);
+            if(value) {
+                out.value = LLVMBuildLoad2(m_builder, TypeOf(kind), value, "");
+                out.is_none = LLVMBuildLoad2(m_builder, m_i1, is_none, "");
+            }
+            return true;
+        }
+
+        LLVMContextRef m_context;
+        LLVMModuleRef m_module;
+        LLVMBuilderRef m_builder;
+        LLVMBuilderRef m_alloca; ///< Для alloca в начале функции
+        LLVMValueRef m_func;
+        LLVMBasicBlockRef m_deopt;
+        LLVMTypeRef m_i1;
+        LLVMTypeRef m_i32;
+        LLVMTypeRef m_i64;
+        LLVMTypeRef m_f64;
+
+        Term *m_scope;
+        int m_loop_depth;
+        std::vector<Var> m_vars;
+    };
+
+    /*
+     * Вид значения фактического аргумента или JitCode::Kind::None, если аргумент не скаляр
+     */
+    JitCode::Kind KindOfArg(Obj *arg) {
+        if(arg && arg->is_scalar() && !arg->m_is_reference) {
+            if(arg->is_integral()) {
+                return JitCode::Kind::Integer;
+            } else if(arg->is_floating()) {
+                return JitCode::Kind::Number;
+            }
+        }
+        return JitCode::Kind::None;
+    }
+
+    /*
+     * Символ способа передачи значения в сигнатуре переходника (NativeCall)
+     */
+    char TrampolineSign(ObjType type) {
+        switch(type) {
+            case ObjType::None:
+                return 'v';
+            case ObjType::Bool:
+                return 'b';
+            case ObjType::Int8:
+                return 'c';
+            case ObjType::Int16:
+                return 's';
+            case ObjType::Int32:
+                return 'i';
+            case ObjType::Int64:
+                return 'l';
+            case ObjType::Float32:
+                return 'f';
+            case ObjType::Float64:
+                return 'd';
+            case ObjType::Pointer:
+            case ObjType::StrChar:
+            case ObjType::StrWide:
+                return 'p';
+            default:
+                return 0;
+        }
+    }
+
+    LLVMTypeRef TrampolineValueType(LLVMContextRef context, char sign) {
+        switch(sign) {
+            case 'v':
+                return LLVMVoidTypeInContext(context);
+            case 'b':
+            case 'c':
+                return LLVMInt8TypeInContext(context);
+            case 's':
+                return LLVMInt16TypeInContext(context);
+            case 'i':
+                return LLVMInt32TypeInContext(context);
+            case 'l':
+                return LLVMInt64TypeInContext(context);
+            case 'f':
+                return LLVMFloatTypeInContext(context);
+            case 'd':
+                return LLVMDoubleTypeInContext(context);
+            default:
+                ASSERT(sign == 'p');
+                return LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+        }
+    }
+
+}
+
+JitCodePtr JitCode::Compile(Context *ctx, Obj &func, Obj &args) {
+    const TermPtr &proto = func.m_prototype;
+    const TermPtr &body = func.m_sequence;
+    if(!ctx || !proto || !body || body->m_frame_size < 0 || body->m_frame_args != proto->size() + 1 || args.size() != body->m_frame_args) {
+        g_jit_failed++;
+        return nullptr;
+    }
+
+    JitCodePtr result = MakeRef<JitCode>();
+    for (int i = 0; i < proto->size(); i++) {
+        const TermPtr &arg = (*proto)[i].second;
+        if(!arg || arg->getTermID() == TermID::ELLIPSIS) {
+            g_jit_failed++;
+            return nullptr;
+        }
+
+        // Объявленный тип аргумента или тип фактического аргумента при компиляции
+        Kind kind = KindOfArg(args[i + 1].second.get());
+        if(proto->name(i).empty() && arg->GetType()) {
+            bool has_error = false;
+            ObjType type = ctx->BaseTypeFromString(arg->m_type_name, &has_error);
+            if(has_error) {
+                kind = Kind::None;
+            } else if(isIntegralType(type, true)) {
+                kind = Kind::Integer;
+            } else if(isFloatingType(type)) {
+                kind = Kind::Number;
+            } else {
+                kind = Kind::None;
+            }
+        }
+        if(kind == Kind::None) {
+            g_jit_failed++;
+            return nullptr;
+        }
+        result->m_args.push_back(kind);
+    }
+
+    JitEngine &engine = Engine();
+    std::lock_guard<std::mutex> lock(engine.mutex);
+
+    std::string name("nl_jit_");
+    name += std::to_string(engine.counter++);
+
+    LLVMOrcThreadSafeContextRef ts_context = LLVMOrcCreateNewThreadSafeContext();
+    LLVMModuleRef module = LLVMModuleCreateWithNameInContext(name.c_str(), LLVMOrcThreadSafeContextGetContext(ts_context));
+    LLVMSetTarget(module, LLVMOrcLLJITGetTripleString(engine.jit));
+    LLVMSetDataLayout(module, LLVMOrcLLJITGetDataLayoutStr(engine.jit));
+
+    bool is_done;
+    {
+        JitBuilder builder(LLVMOrcThreadSafeContextGetContext(ts_context), module, body);
+        is_done = builder.Build(name.c_str(), body, result->m_args);
+    }
+
+    char *message = nullptr;
+    if(is_done && LLVMVerifyModule(module, LLVMReturnStatusAction, &message)) {
+        LOG_WARNING("JIT verify '%s' fail: %s", func.m_var_name.c_str(), message);
+        is_done = false;
+    }
+    if(message) {
+        LLVMDisposeMessage(message);
+    }
+
+    if(is_done) {
+        LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+        LLVMErrorRef error = LLVMRunPasses(module, "default<O2>", nullptr, options);
+        LLVMDisposePassBuilderOptions(options);
+        if(error) {
+            LOG_WARNING("JIT optimize '%s' fail: %s", func.m_var_name.c_str(), TakeErrorMessage(error).c_str());
+            is_done = false;
+        }
+    }
+
+    if(!is_done) {
+        LLVMDisposeModule(module);
+        LLVMOrcDisposeThreadSafeContext(ts_context);
+        g_jit_failed++;
+        return nullptr;
+    }
+
+    // Модуль передается во владение LLJIT
+    LLVMOrcThreadSafeModuleRef ts_module = LLVMOrcCreateNewThreadSafeModule(module, ts_context);
+    LLVMOrcDisposeThreadSafeContext(ts_context);
+
+    result->m_tracker = LLVMOrcJITDylibCreateResourceTracker(LLVMOrcLLJITGetMainJITDylib(engine.jit));
+    LLVMErrorRef error = LLVMOrcLLJITAddLLVMIRModuleWithRT(engine.jit, result->m_tracker, ts_module);
+    if(error) {
+        LOG_RUNTIME("JIT add module '%s' fail: %s", func.m_var_name.c_str(), TakeErrorMessage(error).c_str());
+    }
+
+    LLVMOrcExecutorAddress address;
+    error = LLVMOrcLLJITLookup(engine.jit, &address, name.c_str());
+    if(error) {
+        LOG_RUNTIME("JIT lookup '%s' fail: %s", func.m_var_name.c_str(), TakeErrorMessage(error).c_str());
+    }
+    result->m_entry = reinterpret_cast<EntryType *> (address);
+
+    g_jit_compiled++;
+    return result;
+}
+
+JitCode::~JitCode() {
+    if(m_tracker) {
+        JitEngine &engine = Engine();
+        std::lock_guard<std::mutex> lock(engine.mutex);
+        LLVMErrorRef error = LLVMOrcResourceTrackerRemove(m_tracker);
+        if(error) {
+            LOG_WARNING("JIT remove code fail: %s", TakeErrorMessage(error).c_str());
+        }
+        LLVMOrcReleaseResourceTracker(m_tracker);
+    }
+}
+
+ObjPtr JitCode::Call(Obj &args) {
+    ASSERT(m_entry);
+
+    int64_t values[16];
+    std::vector<int64_t> buffer;
+    int64_t *data = values;
+    if(m_args.size() > sizeof (values) / sizeof (values[0])) {
+        buffer.resize(m_args.size());
+        data = buffer.data();
+    }
+
+    // Проверка типов аргументов (type guard)
+    if(args.size() != static_cast<int64_t> (m_args.size()) + 1) {
+        m_deopt++;
+        g_jit_deopt++;
+        return nullptr;
+    }
+    for (size_t i = 0; i < m_args.size(); i++) {
+        Obj *arg = args[i + 1].second.get();
+        if(KindOfArg(arg) != m_args[i]) {
+            m_deopt++;
+            g_jit_deopt++;
+            return nullptr;
+        }
+        if(m_args[i] == Kind::Number) {
+            double number = arg->GetValueAsNumber();
+            memcpy(&data[i], &number, sizeof (number));
+        } else {
+            data[i] = arg->GetValueAsInteger();
+        }
+    }
+
+    int64_t value = 0;
+    int32_t kind = (*m_entry)(data, &value);
+    g_jit_calls++;
+
+    if(kind == static_cast<int32_t> (Kind::Integer)) {
+        return Obj::CreateValue(value, ObjType::None);
+    } else if(kind == static_cast<int32_t> (Kind::Number)) {
+        double number;
+        memcpy(&number, &value, sizeof (number));
+        return Obj::CreateValue(number, ObjType::None);
+    } else if(kind == static_cast<int32_t> (Kind::Boolean)) {
+        return value ? Obj::Yes() : Obj::No();
+    } else if(kind == static_cast<int32_t> (Kind::None)) {
+        return Obj::None();
+    }
+    m_deopt++;
+    g_jit_deopt++;
+    return nullptr;
+}
+
+JitCode::TrampolineType * JitCode::GetTrampoline(const ObjType *args, size_t count, ObjType result) {
+
+    // Сигнатура по способам передачи значений, например "d:cfdl" для double(int8_t, float, double, int64_t)
+    std::string sign(1, TrampolineSign(result));
+    if(!sign[0]) {
+        return nullptr;
+    }
+    sign += ':';
+    for (size_t i = 0; i < count; i++) {
+        char ch = TrampolineSign(args[i]);
+        if(!ch || ch == 'v') {
+            return nullptr;
+        }
+        sign += ch;
+    }
+
+    JitEngine &engine = Engine();
+    std::lock_guard<std::mutex> lock(engine.mutex);
+
+    auto found = engine.trampolines.find(sign);
+    if(found != engine.trampolines.end()) {
+        return found->second;
+    }
+
+    std::string name("nl_native_");
+    name += std::to_string(engine.counter++);
+
+    LLVMOrcThreadSafeContextRef ts_context = LLVMOrcCreateNewThreadSafeContext();
+    LLVMContextRef context = LLVMOrcThreadSafeContextGetContext(ts_context);
+    LLVMModuleRef module = LLVMModuleCreateWithNameInContext(name.c_str(), context);
+    LLVMSetTarget(module, LLVMOrcLLJITGetTripleString(engine.jit));
+    LLVMSetDataLayout(module, LLVMOrcLLJITGetDataLayoutStr(engine.jit));
+
+    LLVMTypeRef i8_ptr = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+    LLVMTypeRef i64 = LLVMInt64TypeInContext(context);
+    LLVMTypeRef i64_ptr = LLVMPointerType(i64, 0);
+
+    LLVMTypeRef result_type = TrampolineValueType(context, sign[0]);
+    std::vector<LLVMTypeRef> arg_types;
+    for (size_t i = 0; i < count; i++) {
+        arg_types.push_back(TrampolineValueType(context, sign[i + 2]));
+    }
+    LLVMTypeRef native_type = LLVMFunctionType(result_type, arg_types.data(), static_cast<unsigned> (count), false);
+
+    LLVMTypeRef params[] = {i8_ptr, i64_ptr, i64_ptr};
+    LLVMValueRef func = LLVMAddFunction(module, name.c_str(), LLVMFunctionType(LLVMVoidTypeInContext(context), params, 3, false));
+    LLVMBuilderRef builder = LLVMCreateBuilderInContext(context);
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlockInContext(context, func, "entry"));
+
+    std::vector<LLVMValueRef> values;
+    for (size_t i = 0; i < count; i++) {
+        LLVMValueRef index = LLVMConstInt(i64, i, false);
+        LLVMValueRef ptr = LLVMBuildGEP2(builder, i64, LLVMGetParam(func, 1), &index, 1, "");
+        ptr = LLVMBuildBitCast(builder, ptr, LLVMPointerType(arg_types[i], 0), "");
+        values.push_back(LLVMBuildLoad2(builder, arg_types[i], ptr, ""));
+    }
+
+    LLVMValueRef callee = LLVMBuildBitCast(builder, LLVMGetParam(func, 0), LLVMPointerType(native_type, 0), "");
+    LLVMValueRef call = LLVMBuildCall2(builder, native_type, callee, values.data(), static_cast<unsigned> (count), "");
+
+    // Короткие целые расширяются вызывающей стороной (как у C компилятора)
+    unsigned signext = LLVMGetEnumAttributeKindForName("signext", 7);
+    unsigned zeroext = LLVMGetEnumAttributeKindForName("zeroext", 7);
+    for (size_t i = 0; i < count; i++) {
+        if(args[i] == ObjType::Bool) {
+            LLVMAddCallSiteAttribute(call, static_cast<LLVMAttributeIndex> (i + 1), LLVMCreateEnumAttribute(context, zeroext, 0));
+        } else if(args[i] == ObjType::Int8 || args[i] == ObjType::Int16) {
+            LLVMAddCallSiteAttribute(call, static_cast<LLVMAttributeIndex> (i + 1), LLVMCreateEnumAttribute(context, signext, 0));
+        }
+    }
+
+    if(result != ObjType::None) {
+        LLVMBuildStore(builder, call, LLVMBuildBitCast(builder, LLVMGetParam(func, 2), LLVMPointerType(result_type, 0), ""));
+    }
+    LLVMBuildRetVoid(builder);
+    LLVMDisposeBuilder(builder);
+
+    char *message = nullptr;
+    if(LLVMVerifyModule(module, LLVMReturnStatusAction, &message)) {
+        LOG_WARNING("JIT verify trampoline '%s' fail: %s", sign.c_str(), message);
+        LLVMDisposeMessage(message);
+        LLVMDisposeModule(module);
+        LLVMOrcDisposeThreadSafeContext(ts_context);
+        engine.trampolines[sign] = nullptr;
+        return nullptr;
+    }
+    if(message) {
+        LLVMDisposeMessage(message);
+    }
+
+    // Модуль передается во владение LLJIT
+    LLVMOrcThreadSafeModuleRef ts_module = LLVMOrcCreateNewThreadSafeModule(module, ts_context);
+    LLVMOrcDisposeThreadSafeContext(ts_context);
+
+    LLVMErrorRef error = LLVMOrcLLJITAddLLVMIRModule(engine.jit, LLVMOrcLLJITGetMainJITDylib(engine.jit), ts_module);
+    if(error) {
+        LOG_RUNTIME("JIT add trampoline '%s' fail: %s", sign.c_str(), TakeErrorMessage(error).c_str());
+    }
+
+    LLVMOrcExecutorAddress address;
+    error = LLVMOrcLLJITLookup(engine.jit, &address, name.c_str());
+    if(error) {
+        LOG_RUNTIME("JIT lookup trampoline '%s' fail: %s", sign.c_str(), TakeErrorMessage(error).c_str());
+    }
+
+    g_jit_trampolines++;
+    return engine.trampolines[sign] = reinterpret_cast<TrampolineType *> (address);
+}
+
+std::string JitCode::StatInfo() {
+    std::string result("JIT compiled: ");
+    result += std::to_string(g_jit_compiled.load());
+    result += ", failed: ";
+    result += std::to_string(g_jit_failed.load());
+    result += ", native calls: ";
+    result += std::to_string(g_jit_calls.load());
+    result += ", deopt: ";
+    result += std::to_string(g_jit_deopt.load());
+    result += ", trampolines: ";
+    result += std::to_string(g_jit_trampolines.load());
+    return result;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef INCLUDED_NEWLANG_JIT_
+#define INCLUDED_NEWLANG_JIT_
+
+#include "pch.h"
+
+#include <llvm-c/Orc.h>
+
+#include <types.h>
+
+namespace newlang {
+
+    /*
+     * Машинный код часто вызываемой функции (LLVM ORC JIT).
+     *
+     * Obj::Call считает количество вызовов функции и итераций циклов в ее теле (Obj::m_jit_hot).
+     * После HOT_THRESHOLD тело функции компилируется в машинный код, который используется вместо
+     * интерпретатора при следующих вызовах. Компилируются только функции без побочных эффектов
+     * с числовыми аргументами (объявленными как :Int..:Int64, :Float32, :Float64 или с типами
+     * фактических аргументов на момент компиляции), арифметикой, сравнениями, локальными переменными,
+     * циклами и условиями. Для остальных функций компиляция не выполняется.
+     *
+     * Перед каждым вызовом проверяются типы аргументов (type guard). При несовпадении типов,
+     * а также при ошибке во время выполнения (например, деление на ноль) вызов выполняется
+     * интерпретатором заново (деоптимизация), что возможно из-за отсутствия побочных эффектов.
+     */
+    class JitCode : public RefCounted {
+    public:
+
+        constexpr static int64_t HOT_THRESHOLD = 1000;
+        constexpr static int64_t DEOPT_LIMIT = 100; ///< После этого количества деоптимизаций машинный код удаляется
+
+        enum class Kind : uint8_t {
+            None,
+            Integer,
+            Number,
+            Boolean, ///< Результат сравнения, хранится как целое 0 или 1
+        };
+
+        /*
+         * Аргументы и результат передаются как int64_t, у чисел с плавающей точкой побитово.
+         * Возвращает вид результата (Kind) или отрицательное значение для деоптимизации.
+         */
+        typedef int32_t EntryType(const int64_t *args, int64_t *result);
+
+        JitCode(const JitCode &) = delete;
+        JitCode & operator=(const JitCode &) = delete;
+        ~JitCode();
+
+        /*
+         * Компиляция функции func для аргументов args (в порядке прототипа, как в Obj::Call).
+         * Возвращает nullptr, если функция не может быть скомпилирована.
+         */
+        static Ref<JitCode> Compile(Context *ctx, Obj &func, Obj &args);
+
+        /*
+         * Вызов машинного кода. Возвращает nullptr, если вызов должен выполнить интерпретатор.
+         */
+        ObjPtr Call(Obj &args);
+
+        inline int64_t GetDeoptCount() const {
+            return m_deopt;
+        }
+
+        /*
+         * Переходник для прямого вызова нативной функции с фиксированным количеством аргументов (Obj::CallNative).
+         * Значения аргументов передаются в массиве по 8 байт на аргумент (значение в начале элемента),
+         * результат записывается в начало result.
+         */
+        typedef void TrampolineType(void *func, const int64_t *args, int64_t *result);
+
+        /*
+         * Переходник для типов аргументов и результата Bool, Int8, Int16, Int32, Int64, Float32, Float64,
+         * Pointer (StrChar, StrWide) и None для результата void. Переходники кешируются по сигнатуре
+         * и не удаляются. Возвращает nullptr, если тип не поддерживается.
+         */
+        static TrampolineType * GetTrampoline(const ObjType *args, size_t count, ObjType result);
+
+        static std::string StatInfo();
+
+    protected:
+
+        template <typename T, typename... Args> friend Ref<T> MakeRef(Args &&... args);
+
+        JitCode() : m_entry(nullptr), m_tracker(nullptr), m_deopt(0) {
+        }
+
+        std::vector<Kind> m_args;
+        EntryType *m_entry;
+        LLVMOrcResourceTrackerRef m_tracker;
+        int64_t m_deopt;
+    };
+
+    typedef Ref<JitCode> JitCodePtr;
+
+}
+
+#endif //INCLUDED_NEWLANG_JIT_
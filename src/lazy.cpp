@@ -0,0 +1,336 @@
+#include "pch.h"
+
+#include <atomic>
+
+#include <lazy.h>
+#include <context.h>
+#include <term.h>
+#include <types.h>
+
+using namespace newlang;
+
+namespace {
+
+    std::atomic<int64_t> g_lazy_fused;
+    std::atomic<int64_t> g_lazy_eager;
+    std::atomic<int64_t> g_lazy_ops;
+    std::atomic<int64_t> g_lazy_buffers;
+
+    enum class LazyOp : uint8_t {
+        None,
+        Plus,
+        Minus,
+        Mul,
+        Div,
+    };
+
+    /*
+     * Узел графа выражения. У листа есть значение value, у оператора - номера узлов операндов.
+     * Поддерево без тензоров вычисляется сразу и становится листом.
+     */
+    struct LazyNode {
+        LazyOp op;
+        int left;
+        int right;
+        int input; ///< Номер входного тензора графа для листа с тензором
+        bool tensor; ///< Результат узла - тензор
+        ObjPtr value;
+        ObjPtr probe; ///< Результат узла для тензоров из одного элемента
+        at::ScalarType dtype; ///< Тип элементов результата узла с тензором
+        at::Scalar scalar; ///< Значение листа со скаляром
+    };
+
+    struct LazyGraph {
+        std::vector<LazyNode> nodes;
+        std::vector<Obj *> objects;
+        std::vector<torch::Tensor> inputs; ///< Одномерные представления входных тензоров
+        std::vector<int64_t> shape;
+        bool fusable;
+    };
+
+    /*
+     * Буферы промежуточных значений одного потока. Освобожденный буфер
+     * используется для следующего промежуточного значения того же типа.
+     */
+    class LazyBuffers {
+    public:
+
+        int Acquire(at::ScalarType dtype) {
+            for (size_t i = 0; i < m_buffers.size(); i++) {
+                if(!m_busy[i] && m_buffers[i].scalar_type() == dtype) {
+                    m_busy[i] = true;
+                    return static_cast<int> (i);
+                }
+            }
+            g_lazy_buffers++;
+            m_buffers.push_back(torch::empty({TensorExpr::CHUNK_NUMEL}, torch::dtype(dtype)));
+            m_busy.push_back(true);
+            return static_cast<int> (m_buffers.size() - 1);
+        }
+
+        torch::Tensor Get(int slot, int64_t size) {
+            return m_buffers[slot].narrow(0, 0, size);
+        }
+
+        void Release(int slot) {
+            m_busy[slot] = false;
+        }
+
+    protected:
+        std::vector<torch::Tensor> m_buffers;
+        std::vector<bool> m_busy;
+    };
+
+    LazyOp GetLazyOp(const TermPtr &term) {
+        if(term->m_const || term->getTermID() != TermID::OPERATOR || !term->Left() || !term->Right()) {
+            return LazyOp::None;
+        }
+        if(term->m_text.compare("+") == 0) {
+            return LazyOp::Plus;
+        } else if(term->m_text.compare("-") == 0) {
+            return LazyOp::Minus;
+        } else if(term->m_text.compare("*") == 0) {
+            return LazyOp::Mul;
+        } else if(term->m_text.compare("/") == 0) {
+            return LazyOp::Div;
+        }
+        return LazyOp::None;
+    }
+
+    /*
+     * Те же вызовы операторов Obj, что и в Context::op_PLUS, op_MINUS, op_MUL и op_DIV.
+     */
+    ObjPtr ApplyObj(LazyOp op, const ObjPtr &left, const ObjPtr &right) {
+        switch(op) {
+            case LazyOp::Plus:
+                return left->operator+(right);
+            case LazyOp::Minus:
+                return left->operator-(right);
+            case LazyOp::Mul:
+                return left->operator*(right);
+            case LazyOp::Div:
+                return left->operator/(right);
+        }
+        LOG_RUNTIME("Unknown lazy operator %d!", static_cast<int> (op));
+    }
+
+    template <typename T>
+    void ApplyChunk(LazyOp op, torch::Tensor &dest, const T &value) {
+        switch(op) {
+            case LazyOp::Plus:
+                dest.add_(value);
+                return;
+            case LazyOp::Minus:
+                dest.sub_(value);
+                return;
+            case LazyOp::Mul:
+                dest.mul_(value);
+                return;
+            case LazyOp::Div:
+                dest.div_(value);
+                return;
+        }
+        LOG_RUNTIME("Unknown lazy operator %d!", static_cast<int> (op));
+    }
+
+    void AddInput(LazyGraph &graph, LazyNode &node) {
+        for (size_t i = 0; i < graph.objects.size(); i++) {
+            if(graph.objects[i] == node.value.get()) {
+                node.input = static_cast<int> (i);
+                return;
+            }
+        }
+        const torch::Tensor &tensor = node.value->m_tensor;
+        if(!tensor.device().is_cpu() || !tensor.is_contiguous() || tensor.numel() < TensorExpr::MIN_NUMEL) {
+            graph.fusable = false;
+            return;
+        }
+        if(graph.inputs.empty()) {
+            graph.shape = tensor.sizes().vec();
+        } else if(tensor.sizes().vec() != graph.shape) {
+            // Размеры согласуются (broadcast) обычными операторами
+            graph.fusable = false;
+            return;
+        }
+        node.input = static_cast<int> (graph.inputs.size());
+        graph.objects.push_back(node.value.get());
+        graph.inputs.push_back(tensor.view({-1}));
+    }
+
+    /*
+     * Операнды вычисляются в том же порядке, что и без отложенного режима,
+     * а выражения из одних скаляров - сразу после вычисления своих операндов.
+     */
+    int BuildNode(Context *ctx, const TermPtr &term, Obj *args, bool eval_block, LazyGraph &graph) {
+        LazyNode node;
+        node.op = GetLazyOp(term);
+        node.left = -1;
+        node.right = -1;
+        node.input = -1;
+        node.dtype = at::ScalarType::Undefined;
+        if(node.op == LazyOp::None) {
+            node.value = Context::EvalOperand(ctx, term, args, eval_block);
+            node.tensor = node.value->is_tensor_type() && !node.value->is_scalar();
+        } else {
+            node.left = BuildNode(ctx, term->Left(), args, eval_block, graph);
+            node.right = BuildNode(ctx, term->Right(), args, eval_block, graph);
+            node.tensor = graph.nodes[node.left].tensor || graph.nodes[node.right].tensor;
+            if(!node.tensor) {
+                node.value = ApplyObj(node.op, graph.nodes[node.left].value, graph.nodes[node.right].value);
+                node.op = LazyOp::None;
+            } else if(!graph.nodes[node.left].tensor) {
+                // Скаляр слева от тензора
+                graph.fusable = false;
+            }
+        }
+        if(node.op == LazyOp::None) {
+            if(node.tensor) {
+                AddInput(graph, node);
+            } else if(!node.value->is_scalar()) {
+                // Рациональные числа, строки, словари и т.д.
+                graph.fusable = false;
+            }
+        }
+        graph.nodes.push_back(node);
+        return static_cast<int> (graph.nodes.size() - 1);
+    }
+
+    /*
+     * Вычисление графа обычными операторами.
+     */
+    ObjPtr EvalNode(LazyGraph &graph, int index) {
+        LazyNode &node = graph.nodes[index];
+        if(node.op == LazyOp::None) {
+            return node.value;
+        }
+        ObjPtr left = EvalNode(graph, node.left);
+        return ApplyObj(node.op, left, EvalNode(graph, node.right));
+    }
+
+    /*
+     * Типы промежуточных значений (повышение типа, фиксированный тип переменной) определяются
+     * теми же операторами Obj над тензорами из одного элемента.
+     */
+    void ProbeNode(LazyGraph &graph, int index) {
+        LazyNode &node = graph.nodes[index];
+        if(node.op == LazyOp::None) {
+            if(node.tensor) {
+                node.probe = Obj::CreateTensor(torch::zeros({1}, node.value->m_tensor.options()));
+                node.probe->m_var_type_current = node.value->m_var_type_current;
+                node.probe->m_var_type_fixed = node.value->m_var_type_fixed;
+            } else {
+                node.probe = node.value;
+                if(node.value->is_floating()) {
+                    node.scalar = node.value->GetValueAsNumber();
+                } else {
+                    node.scalar = node.value->GetValueAsInteger();
+                }
+            }
+        } else {
+            ProbeNode(graph, node.left);
+            ProbeNode(graph, node.right);
+            node.probe = ApplyObj(node.op, graph.nodes[node.left].probe, graph.nodes[node.right].probe);
+        }
+        if(node.tensor) {
+            ASSERT(node.probe->m_tensor.defined());
+            node.dtype = node.probe->m_tensor.scalar_type();
+        }
+    }
+
+    /*
+     * Вычисление блока [begin, begin + size) значения узла в dest (тип элементов узла).
+     */
+    void FillChunk(const LazyGraph &graph, int index, torch::Tensor &dest, int64_t begin, int64_t size, LazyBuffers &buffers) {
+        const LazyNode &node = graph.nodes[index];
+        if(node.op == LazyOp::None) {
+            ASSERT(node.tensor);
+            dest.copy_(graph.inputs[node.input].narrow(0, begin, size));
+            return;
+        }
+
+        const LazyNode &left = graph.nodes[node.left];
+        if(left.op == LazyOp::None || left.dtype == node.dtype) {
+            FillChunk(graph, node.left, dest, begin, size, buffers);
+        } else {
+            int slot = buffers.Acquire(left.dtype);
+            torch::Tensor temp = buffers.Get(slot, size);
+            FillChunk(graph, node.left, temp, begin, size, buffers);
+            dest.copy_(temp);
+            buffers.Release(slot);
+        }
+
+        const LazyNode &right = graph.nodes[node.right];
+        if(!right.tensor) {
+            ApplyChunk(node.op, dest, right.scalar);
+        } else if(right.op == LazyOp::None) {
+            ApplyChunk(node.op, dest, graph.inputs[right.input].narrow(0, begin, size));
+        } else {
+            int slot = buffers.Acquire(right.dtype);
+            torch::Tensor temp = buffers.Get(slot, size);
+            FillChunk(graph, node.right, temp, begin, size, buffers);
+            ApplyChunk(node.op, dest, temp);
+            buffers.Release(slot);
+        }
+    }
+
+}
+
+ObjPtr TensorExpr::Eval(Context *ctx, const TermPtr &term, Obj *args, bool eval_block) {
+    LazyGraph graph;
+    graph.fusable = true;
+    int root = BuildNode(ctx, term, args, eval_block, graph);
+    if(graph.nodes[root].op == LazyOp::None) {
+        // Выражение без тензоров уже вычислено
+        return graph.nodes[root].value;
+    }
+
+    if(graph.fusable) {
+        try {
+            ProbeNode(graph, root);
+        } catch (...) {
+            // Ошибка возникнет при вычислении обычными операторами с исходными значениями в сообщении
+            graph.fusable = false;
+        }
+    }
+    if(!graph.fusable) {
+        g_lazy_eager++;
+        return EvalNode(graph, root);
+    }
+
+    const LazyNode &node = graph.nodes[root];
+    int64_t numel = graph.inputs[0].numel();
+    int64_t chunks = (numel + CHUNK_NUMEL - 1) / CHUNK_NUMEL;
+    torch::Tensor result = torch::empty({numel}, torch::dtype(node.dtype));
+
+    at::parallel_for(0, chunks, PARALLEL_NUMEL / CHUNK_NUMEL, [&](int64_t begin, int64_t end) {
+        LazyBuffers buffers;
+        for (int64_t i = begin; i < end; i++) {
+            int64_t start = i * CHUNK_NUMEL;
+            torch::Tensor dest = result.narrow(0, start, std::min(CHUNK_NUMEL, numel - start));
+            FillChunk(graph, root, dest, start, dest.size(0), buffers);
+        }
+    });
+
+    for (auto &elem : graph.nodes) {
+        if(elem.op != LazyOp::None) {
+            g_lazy_ops++;
+        }
+    }
+    g_lazy_fused++;
+
+    ObjPtr value = node.probe;
+    value->m_tensor = result.view(graph.shape);
+    return value;
+}
+
+std::string TensorExpr::StatInfo() {
+    std::string result("Lazy tensor expressions fused: ");
+    result += std::to_string(g_lazy_fused.load());
+    result += ", operators: ";
+    result += std::to_string(g_lazy_ops.load());
+    result += ", eager: ";
+    result += std::to_string(g_lazy_eager.load());
+    result += ", buffers: ";
+    result += std::to_string(g_lazy_buffers.load());
+    return result;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef INCLUDED_NEWLANG_LAZY_
+#define INCLUDED_NEWLANG_LAZY_
+
+#include "pch.h"
+
+#include <term.h>
+#include <object.h>
+
+namespace newlang {
+
+    class Context;
+
+    /*
+     * Отложенное вычисление арифметики с тензорами (Context::m_lazy_enable).
+     *
+     * Без него каждый оператор выражения a + b * c - d копирует левый операнд (Obj::Clone)
+     * и выполняет над копией отдельный проход по памяти. В отложенном режиме операторы
+     * + - * / выражения не выполняются сразу, а записываются в граф, листья которого - значения
+     * операндов (одинаковые объекты становятся одним входом графа). Граф вычисляется, когда значение
+     * покидает арифметическое выражение (присваивание, вывод, индексация, вызов функции, сравнение).
+     *
+     * Если все тензоры графа одного размера, непрерывные и не меньше MIN_NUMEL элементов,
+     * результат вычисляется одним проходом блоками по CHUNK_NUMEL элементов (блоки вычисляются
+     * параллельно): каждый блок проходит всю цепочку операторов, пока находится в кеше процессора.
+     * Левый операнд вычисляется сразу в буфер результата оператора, а буферы промежуточных
+     * значений правых операндов повторно используются после того, как значение прочитано.
+     * Блоки делятся между потоками libtorch (RunTime::SetThreads) по PARALLEL_NUMEL элементов.
+     *
+     * Типы промежуточных значений и ошибки несовместимых типов определяются выполнением
+     * тех же операторов Obj над тензорами из одного элемента, поэтому результат совпадает
+     * с вычислением без отложенного режима. Остальные выражения вычисляются обычными операторами.
+     */
+    class TensorExpr {
+    public:
+
+        constexpr static int64_t MIN_NUMEL = 1 << 15;
+        constexpr static int64_t CHUNK_NUMEL = 1 << 15;
+        /// Минимальное количество элементов для одного потока (меньшие тензоры вычисляются в одном потоке)
+        constexpr static int64_t PARALLEL_NUMEL = 1 << 18;
+
+        /*
+         * Вычисление выражения term (оператор + - * / с двумя операндами) и всех вложенных в него
+         * арифметических операторов. Операнды вычисляются слева направо, как и без отложенного режима.
+         */
+        static ObjPtr Eval(Context *ctx, const TermPtr &term, Obj *args, bool eval_block);
+
+        static std::string StatInfo();
+    };
+
+}
+
+#endif //INCLUDED_NEWLANG_LAZY_
@@ -4,6 +4,12 @@
 #include <newlang.h>
 #include <builtin.h>
 
+#include "llvm/Support/DynamicLibrary.h"
+
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
 using namespace newlang;
 
 //LLVMBuilderRef RunTime::m_llvm_builder = nullptr;
@@ -667,19 +673,21 @@ std::string Compiler::MakeCppFileCallArgs(CompileInfo &ci, TermPtr &args, TermPt
 }
 
 std::string Compiler::EncodeNonAsciiCharacters(const char * in) {
-    std::string text(in);
-    text = std::regex_replace(text, std::regex("\""), "\\\"");
-    text = std::regex_replace(text, std::regex("\n"), "\\x0A\" \"");
-    text = std::regex_replace(text, std::regex("\\\\n"), "\\\\n");
-
+    // Восьмеричные коды не длиннее трех цифр и не захватывают следующие символы, как \x
     std::string src;
-    for (size_t i = 0; i < text.length(); i++) {
-        if(static_cast<unsigned char> (text[i]) > 127) {
-            src += "\\x";
-            src += BinToHex((const uint8_t *) &text[i], 1);
+    for (const char *ptr = in; *ptr; ptr++) {
+        unsigned char ch = static_cast<unsigned char> (*ptr);
+        if(ch == '\n') {
+            src += "\\n\"\n\"";
+        } else if(ch == '"' || ch == '\\' || ch == '?') {
+            src += '\\';
+            src += *ptr;
+        } else if(ch < ' ' || ch > 126) {
+            char buf[5];
+            snprintf(buf, sizeof (buf), "\\%03o", ch);
+            src += buf;
         } else {
-
-            src += text[i];
+            src += *ptr;
         }
     }
     return src;
@@ -733,49 +741,44 @@ bool Compiler::MakeCppFile(TermPtr ast, std::ostream &out, const char * source,
 }
 
 bool Compiler::Execute(const char *exec, std::string *out, int *exit_code) {
-    //    int status;
-    //    pid_t pid;
-    //
-    //    int mypipe[2];
-    //    pipe(mypipe);
-    //
-    //    pid = fork();
-    //    if(pid < 0) {
-    //        LOG_ERROR("Fork fail");
-    //        return false;
-    //    } else if(!pid) {
-    //        close(mypipe[0]); /* close unused in */
-    //        dup2(mypipe[1], 1); /* stdout to pipe out */
-    //
-    //        execl("/bin/bash", "bash", "-c", exec, NULL);
-    //
-    //        close(mypipe[1]);
-    //        _exit(EXIT_SUCCESS);
-    //    }
-    //
-    //    pid = wait(&status);
-    //
-    //    /* parent process */
-    //    close(mypipe[1]); /* close unused out */
-    //
-    //    char buf[1024] = "";
-    //    ssize_t nbytes;
-    //    /* read from pipe in */
-    //    while((nbytes = read(mypipe[0], buf, sizeof (buf))) > 0) {
-    //        if(out) {
-    //            out->append(buf, nbytes);
-    //        }
-    //    }
-    //    close(mypipe[0]);
-    //
-    //    if(WIFEXITED(status)) {
-    //        if(exit_code) {
-    //
-    //            *exit_code = WEXITSTATUS(status);
-    //        }
-    //        return true;
-    //    }
-    return false;
+    ASSERT(exec);
+#ifdef _WIN32
+    FILE *pipe = _popen(exec, "r");
+#else
+    // Вывод ошибок компилятора нужен вместе со стандартным выводом
+    std::string cmd(exec);
+    cmd += " 2>&1";
+    FILE *pipe = popen(cmd.c_str(), "r");
+#endif
+    if(!pipe) {
+        LOG_ERROR("Fail execute '%s'", exec);
+        return false;
+    }
+
+    char buf[1024];
+    size_t nbytes;
+    while((nbytes = fread(buf, 1, sizeof (buf), pipe)) > 0) {
+        if(out) {
+            out->append(buf, nbytes);
+        }
+    }
+
+#ifdef _WIN32
+    int status = _pclose(pipe);
+    if(exit_code) {
+        *exit_code = status;
+    }
+    return status != -1;
+#else
+    int status = pclose(pipe);
+    if(status == -1 || !WIFEXITED(status)) {
+        return false;
+    }
+    if(exit_code) {
+        *exit_code = WEXITSTATUS(status);
+    }
+    return true;
+#endif
 }
 
 //llvm::ExecutionEngine * NewLang::JITCompileCPP(const char* source, const char *file_name) {
@@ -854,38 +857,117 @@ bool Compiler::Execute(const char *exec, std::string *out, int *exit_code) {
 //    return m_jit->CompileModule(source, opts);
 //}
 
-//bool Compiler::CompileModule(const char* filename, const char* output) {
-//
-//    std::string in_data = ReadFile(filename);
-//    if(in_data.empty()) {
-//        LOG_DEBUG("Not found or empty file '%s'", filename);
-//        return false;
-//    }
-//
-//    TermPtr term;
-//    Parser p(term);
-//    p.Parse(in_data.c_str());
-//    if(!term) {
-//        LOG_DEBUG("Fail parsing file '%s'", filename);
-//        return false;
-//    }
-//
-//    std::string temp_name(filename);
-//    temp_name.append(".temp");
-//
-//    std::ostringstream sstr;
-//    Context ctx(RunTime::Init());
-//    MakeCppFile(term, sstr, in_data.c_str(), &ctx);
-//
-//    std::string file_name(temp_name);
-//    file_name.append(".cpp");
-//
-//    std::ofstream file(file_name);
-//    file << sstr.str();
-//    file.close();
-//
-//    return Compiler::GccMakeModule(file_name.c_str(), output);
-//}
+std::string Compiler::GetCompiler() {
+    const char *cxx = getenv("NLC_CXX");
+    if(cxx && *cxx) {
+        return cxx;
+    }
+    return "c++";
+}
+
+std::string Compiler::GetCompilerVersion() {
+    // Версия компилятора проверяется один раз за время работы процесса
+    static std::string version;
+    static bool is_checked = false;
+    if(!is_checked) {
+        is_checked = true;
+        std::string out;
+        int exit_code = -1;
+        std::string exec = GetCompiler() + " --version";
+        if(Execute(exec.c_str(), &out, &exit_code) && exit_code == 0) {
+            version = out.substr(0, out.find('\n'));
+        }
+    }
+    return version;
+}
+
+std::string Compiler::MakeModuleKey(const std::string &source) {
+
+    // Модуль собирается заново при изменении исходного текста, версии NewLang или компилятора
+    llvm::MD5 hash;
+    hash.update(GetTextMD5(source));
+    hash.update(GIT_SOURCE);
+    hash.update(GetCompilerVersion());
+
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+
+    llvm::SmallString<32> key;
+    llvm::MD5::stringifyResult(result, key);
+    return key.c_str();
+}
+
+std::string Compiler::MakeModuleStamp(const char *filename) {
+    ASSERT(filename);
+
+    llvm::sys::fs::file_status status;
+    if(llvm::sys::fs::status(filename, status)) {
+        return "";
+    }
+    std::string result(std::to_string(status.getSize()));
+    result += ":";
+    result += std::to_string(status.getLastModificationTime().time_since_epoch().count());
+    result += ":";
+    result += GIT_SOURCE;
+    return result;
+}
+
+std::string Compiler::MakeModuleCacheName(const char *filename) {
+    ASSERT(filename);
+
+    // Модуль сохраняется рядом с исходным файлом: example.nlp -> example.nlm
+    llvm::SmallString<1024> path(filename);
+    llvm::sys::path::replace_extension(path, ".nlm");
+    return path.c_str();
+}
+
+bool Compiler::CompileModule(const char *filename, const char *output, std::string *out) {
+    ASSERT(filename);
+    ASSERT(output);
+
+    // Метка берется до чтения файла, чтобы изменение файла во время сборки обнаружилось при следующей загрузке
+    std::string module_stamp = MakeModuleStamp(filename);
+    std::string in_data = ReadFile(filename);
+    if(in_data.empty()) {
+        LOG_DEBUG("Not found or empty file '%s'", filename);
+        return false;
+    }
+
+    std::string module_key = MakeModuleKey(in_data);
+
+    // Генератор C++ кода для тела модуля (MakeSequenceOpsCpp) пока не реализован, поэтому модуль
+    // содержит исходный текст, который выполняется интерпретатором без повторного чтения файла.
+    // Функция NEWLANG_PREFIX_main_module_func вызывается вместо интерпретатора, если она есть в модуле.
+    std::ostringstream sstr;
+    sstr << "\n//Module source\n";
+    sstr << "extern \"C\" const char * " NEWLANG_PREFIX "_module_source;\n";
+    sstr << "const char * " NEWLANG_PREFIX "_module_source=\"" << EncodeNonAsciiCharacters(in_data.c_str()) << "\";\n";
+    sstr << "\n//Module key\n";
+    sstr << "extern \"C\" const char * " NEWLANG_PREFIX "_module_key;\n";
+    sstr << "const char * " NEWLANG_PREFIX "_module_key=\"" << module_key << "\";\n";
+    sstr << "\n//Module stamp\n";
+    sstr << "extern \"C\" const char * " NEWLANG_PREFIX "_module_stamp;\n";
+    sstr << "const char * " NEWLANG_PREFIX "_module_stamp=\"" << EncodeNonAsciiCharacters(module_stamp.c_str()) << "\";\n";
+
+    std::string file_name(output);
+    file_name.append(".cpp");
+
+    std::ofstream file(file_name, std::ios::trunc);
+    file << sstr.str();
+    file.close();
+
+    std::string result;
+    int exit_code = -1;
+    bool done = GccMakeModule(file_name.c_str(), output, nullptr, &result, &exit_code) && exit_code == 0;
+    llvm::sys::fs::remove(file_name);
+    if(out) {
+        *out = result;
+    }
+    if(!done) {
+        LOG_DEBUG("Fail compile module '%s' (exit code %d):\n%s", output, exit_code, result.c_str());
+    }
+    return done;
+}
 
 
 //std::string NewLang::MakeFunctionsHeaderSourceForJIT(TermPtr asg);
@@ -974,64 +1056,51 @@ bool Compiler::Execute(const char *exec, std::string *out, int *exit_code) {
 //}
 
 bool Compiler::GccMakeModule(const char * in_file, const char * module, const char * opts, std::string *out, int *exit_code) {
+    ASSERT(in_file);
+    ASSERT(module);
+
+    // Сборка во временный файл, чтобы другой процесс не загрузил недописанный модуль из кеша
+    std::string temp_file(module);
+    temp_file.append(".temp");
+
+    std::string exec(GetCompiler());
+    exec.append(" -std=c++17 -shared -fPIC -O2 ");
+    const char *flags = getenv("NLC_CXXFLAGS");
+    if(flags) {
+        exec.append(flags);
+        exec.append(" ");
+    }
+    if(opts) {
+        exec.append(opts);
+        exec.append(" ");
+    }
+    exec.append("-o \"");
+    exec.append(temp_file);
+    exec.append("\" \"");
+    exec.append(in_file);
+    exec.append("\"");
+
+    LOG_DEBUG("%s", exec.c_str());
+
+    int result = -1;
+    if(!Execute(exec.c_str(), out, &result) || result != 0) {
+        llvm::sys::fs::remove(temp_file);
+        if(exit_code) {
+            *exit_code = result;
+        }
+        return false;
+    }
 
-    //char temp[MAXPATHLEN];
-    //if(!getcwd(temp, sizeof (temp))) {
-    //    return false;
-    //}
-
-    //std::string dir(temp);
-
-    //std::string out_file(dir);
-
-    //out_file.append("/");
-    //out_file.append(module);
-    ////    out_file.append(".so");
-
-    //if(!opts) {
-    //    struct stat file_src;
-    //    struct stat file_so;
-    //    if(lstat(in_file, &file_src) == 0 && lstat(out_file.c_str(), &file_so) == 0) {
-    //        if(file_src.st_mtime < file_so.st_mtime && file_so.st_size) {
-    //            LOG_DEBUG("Skip build %s", out_file.c_str());
-    //            return true;
-    //        }
-    //    }
-    //}
-
-    //std::remove(out_file.c_str());
-
-
-    ////g++ -std=c++17  -c -g -DDEBUG -DLOG_LEVEL_NORMAL=LOG_LEVEL_DEBUG -DUNITTEST -I.. -I../contrib/googletest/googletest -I../contrib/googletest/googletest/include -MMD -MP -MF "test_gen.cpp.o.d" -o test_out.o test_gen.cpp
-
-    //std::string exec("cd ");
-    //exec.append(dir);
-    //exec.append(" && ");
-
-    //exec.append("g++ -std=c++14 -Werror=return-type -c -g -fPIC -DDEBUG -DLOG_LEVEL_NORMAL=LOG_LEVEL_DEBUG ");
-    //if(opts) {
-    //    exec.append(opts);
-    //}
-    //exec.append(" -I.. -I../contrib/googletest/googletest -I../contrib/googletest/googletest/include -I../contrib/torch/include/torch/csrc/api/include -I../contrib/torch/include -MMD -MP -MF \"");
-    //exec.append(in_file);
-    //exec.append(".o.d\" -o ");
-    //exec.append(in_file);
-    //exec.append(".o ");
-    //exec.append(in_file);
-
-    //exec.append(" && ");
-
-    ////g++ -o test_gen.so test_gen.o -shared -fPIC
-    //exec.append("g++ -o ");
-    //exec.append(out_file);
-    //exec.append(" ");
-    //exec.append(in_file);
-    //exec.append(".o -shared -fPIC");
-
-    //LOG_DEBUG("%s", exec.c_str());
-
-    //return Execute(exec.c_str(), out, exit_code);
-    return false;
+    std::error_code ec = llvm::sys::fs::rename(temp_file, module);
+    if(ec) {
+        LOG_ERROR("Fail rename module '%s': %s", temp_file.c_str(), ec.message().c_str());
+        llvm::sys::fs::remove(temp_file);
+        return false;
+    }
+    if(exit_code) {
+        *exit_code = result;
+    }
+    return true;
 }
 
 Compiler::Compiler(RuntimePtr rt) : m_runtime(rt) {
@@ -1253,7 +1322,131 @@ Compiler::Compiler(RuntimePtr rt) : m_runtime(rt) {
 //    }
 //}
 
-std::shared_ptr<Module> RunTime::LoadModule(Context &ctx, const char *term, bool init) {
+namespace {
+
+    int64_t ParseThreadCount(const char *arg, const char *prefix) {
+        const char *value = arg + strlen(prefix);
+        char *end = nullptr;
+        int64_t count = strtoll(value, &end, 10);
+        if(!*value || *end || count <= 0) {
+            LOG_RUNTIME("Invalid number of threads in system arg '%s'!", arg);
+        }
+        return count;
+    }
+
+}
+
+void RunTime::SystemArg(const char *arg) {
+    ASSERT(arg);
+    if(strstr(arg, "-nlc-search=") == arg) {
+        m_search_dir = Context::SplitString(arg + strlen("-nlc-search="), ";");
+    } else if(strstr(arg, "-nlc-threads=") == arg) {
+        SetThreads(ParseThreadCount(arg, "-nlc-threads="));
+    } else if(strstr(arg, "-nlc-interop-threads=") == arg) {
+        SetInteropThreads(ParseThreadCount(arg, "-nlc-interop-threads="));
+    } else if(strstr(arg, "-nlc-affinity=") == arg) {
+        SetAffinity(arg + strlen("-nlc-affinity="));
+    } else {
+        LOG_RUNTIME("System arg '%s' not found!", arg);
+    }
+}
+
+void RunTime::SetThreads(int64_t count) {
+    if(count <= 0) {
+        LOG_RUNTIME("Invalid number of threads %ld!", count);
+    }
+    at::set_num_threads(static_cast<int> (count));
+}
+
+int64_t RunTime::GetThreads() {
+    return at::get_num_threads();
+}
+
+void RunTime::SetInteropThreads(int64_t count) {
+    if(count <= 0) {
+        LOG_RUNTIME("Invalid number of inter-op threads %ld!", count);
+    }
+    if(count == GetInteropThreads()) {
+        return;
+    }
+    try {
+        at::set_num_interop_threads(static_cast<int> (count));
+    } catch (std::exception &ex) {
+        // Пул потоков уже создан
+        LOG_RUNTIME("Fail set number of inter-op threads %ld: %s", count, ex.what());
+    }
+}
+
+int64_t RunTime::GetInteropThreads() {
+    return at::get_num_interop_threads();
+}
+
+void RunTime::SetAffinity(const std::string &cpus) {
+#ifdef _WIN32
+    LOG_RUNTIME("Processor affinity '%s' not implemented!", cpus.c_str());
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto &item : Context::SplitString(cpus.c_str(), ",")) {
+        int first;
+        int last;
+        char tail;
+        if(sscanf(item.c_str(), "%d-%d%c", &first, &last, &tail) != 2) {
+            if(sscanf(item.c_str(), "%d%c", &first, &tail) != 1) {
+                LOG_RUNTIME("Invalid processor list '%s'!", cpus.c_str());
+            }
+            last = first;
+        }
+        if(first < 0 || last < first || last >= CPU_SETSIZE) {
+            LOG_RUNTIME("Invalid processor list '%s'!", cpus.c_str());
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if(!CPU_COUNT(&set)) {
+        LOG_RUNTIME("Empty processor list '%s'!", cpus.c_str());
+    }
+    if(sched_setaffinity(0, sizeof (set), &set) != 0) {
+        LOG_RUNTIME("Fail set processor affinity '%s': %s", cpus.c_str(), strerror(errno));
+    }
+#endif
+}
+
+std::string RunTime::GetAffinity() {
+#ifdef _WIN32
+    return std::string();
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof (set), &set) != 0) {
+        LOG_RUNTIME("Fail get processor affinity: %s", strerror(errno));
+    }
+    // Список процессоров в том же виде, что и в -nlc-affinity
+    std::string result;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if(!CPU_ISSET(cpu, &set)) {
+            continue;
+        }
+        int last = cpu;
+        while(last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) {
+            last++;
+        }
+        if(!result.empty()) {
+            result += ",";
+        }
+        result += std::to_string(cpu);
+        if(last > cpu) {
+            result += "-";
+            result += std::to_string(last);
+        }
+        cpu = last;
+    }
+    return result;
+#endif
+}
+
+Ref<Module> RunTime::LoadModule(Context &ctx, const char *term, bool init) {
     ASSERT(term);
 
 
@@ -1289,7 +1482,7 @@ std::shared_ptr<Module> RunTime::LoadModule(Context &ctx, const char *term, bool
             if(llvm::sys::fs::exists(full_path)) {
                 LOG_DEBUG("Module '%s' load from file '%s'!", term, full_path.c_str());
 
-                std::shared_ptr<Module> module = std::make_shared<Module>();
+                Ref<Module> module = MakeRef<Module>();
                 if(module->Load(ctx, full_path.c_str(), false)) {
 
                     ctx.m_terms = module.get();
@@ -1304,6 +1497,7 @@ std::shared_ptr<Module> RunTime::LoadModule(Context &ctx, const char *term, bool
                             module->at(i).first.insert(0, name);
                         }
                     }
+                    module->ResetIndex();
 
                     return module;
                 }
@@ -1474,22 +1668,91 @@ bool CheckClearFunction(TermPtr term) {
 //    return RunTime::Instance()->ExecModule(name, ReplaceFileExt(name, ".ctx", ".nlm").c_str(), true, ctx)->getType() != ObjType::Error;
 //}
 
-ObjPtr RunTime::ExecModule(const char *mod, const char *output, bool cached, Context * ctx) {
-    /*std::string source = ReadFile(mod);
-    Obj args;
-    if(cached && access(output, F_OK) != -1 && LoadModule(output, true)) {
-        if(m_modules[output]->m_source && *(m_modules[output]->m_source) && source.compare(*(m_modules[output]->m_source)) == 0) {
-            LOG_DEBUG("Load cached module '%s'", output);
-            return m_modules[output]->Main(ctx, args);
+ObjPtr RunTime::ExecModule(const char *mod, const char *output, bool cached, Context * ctx, Obj *args) {
+    ASSERT(mod);
+    ASSERT(ctx);
+
+    std::string stamp = Compiler::MakeModuleStamp(mod);
+    if(stamp.empty()) {
+        LOG_RUNTIME("Fail load module from file '%s'!", mod);
+    }
+
+    // Путь к библиотеке без каталога dlopen ищет в системных каталогах
+    llvm::SmallString<1024> full_path(output ? output : Compiler::MakeModuleCacheName(mod));
+    llvm::sys::fs::make_absolute(full_path);
+    std::string file_name = full_path.c_str();
+
+    // Исходный текст читается, только если модуль из кеша нельзя использовать по метке файла
+    Ref<Module> module;
+    auto load_source = [&]() {
+        if(!module) {
+            module = MakeRef<Module>();
+            if(!module->Load(*ctx, mod, true)) {
+                LOG_RUNTIME("Fail load module from file '%s'!", mod);
+            }
+        }
+    };
+
+    // Модуль из кеша используется без чтения исходного файла и без запуска компилятора, если метка файла
+    // не изменилась. Иначе модуль используется, только если он собран из того же исходного текста тем же компилятором.
+    llvm::sys::DynamicLibrary lib;
+    bool can_load = true;
+    bool is_outdated = false;
+    if(cached && llvm::sys::fs::exists(file_name)) {
+        std::string error;
+        lib = llvm::sys::DynamicLibrary::getPermanentLibrary(file_name.c_str(), &error);
+        if(!lib.isValid()) {
+            LOG_DEBUG("Fail load cached module '%s': %s", file_name.c_str(), error.c_str());
+        } else {
+            const char **module_stamp = static_cast<const char **> (lib.getAddressOfSymbol(NEWLANG_PREFIX "_module_stamp"));
+            const char **module_key = static_cast<const char **> (lib.getAddressOfSymbol(NEWLANG_PREFIX "_module_key"));
+            if(module_stamp && stamp.compare(*module_stamp) == 0) {
+                LOG_DEBUG("Load cached module '%s'", file_name.c_str());
+            } else {
+                load_source();
+                if(module_key && Compiler::MakeModuleKey(module->m_source).compare(*module_key) == 0) {
+                    // Файл изменился без изменения текста, модуль пересобирается только для обновления метки
+                    LOG_DEBUG("Load cached module '%s' with outdated stamp", file_name.c_str());
+                    is_outdated = true;
+                } else {
+                    // Загруженную библиотеку нельзя выгрузить, поэтому пересобранный модуль будет использован при следующем запуске
+                    LOG_DEBUG("Disabled cached module '%s'", file_name.c_str());
+                    lib = llvm::sys::DynamicLibrary();
+                    can_load = false;
+                }
+            }
         }
-        LOG_DEBUG("Disabled cached module '%s'\nsource:\n%s\nmodule:\n%s", output, source.c_str(), m_modules[output]->m_source ? *(m_modules[output]->m_source) : "nullptr");
-        UnLoadModule(ctx, output);
     }
-    if(NewLang::CompileModule(module, output) && LoadModule(output)) {
-        return m_modules[output]->Main(ctx, args);
-    }*/
-    LOG_RUNTIME("Fail compile module '%s' form file '%s'.", output, mod);
-    return nullptr;
+
+    if(!lib.isValid() || is_outdated) {
+        std::string out;
+        if(Compiler::CompileModule(mod, file_name.c_str(), &out)) {
+            if(!lib.isValid() && can_load) {
+                std::string error;
+                lib = llvm::sys::DynamicLibrary::getPermanentLibrary(file_name.c_str(), &error);
+                if(!lib.isValid()) {
+                    LOG_WARNING("Fail load module '%s': %s", file_name.c_str(), error.c_str());
+                }
+            }
+        } else {
+            LOG_WARNING("Fail compile module '%s' form file '%s', the interpreter is used.\n%s", file_name.c_str(), mod, out.c_str());
+        }
+    }
+
+    if(lib.isValid()) {
+        typedef ObjPtr ModuleMainType(Context *ctx, Obj & in);
+        ModuleMainType *main_func = reinterpret_cast<ModuleMainType *> (lib.getAddressOfSymbol(NEWLANG_PREFIX "_main_module_func"));
+        if(main_func) {
+            Obj empty(ObjType::Dictionary);
+            return (*main_func)(ctx, args ? *args : empty);
+        }
+        const char **module_source = static_cast<const char **> (lib.getAddressOfSymbol(NEWLANG_PREFIX "_module_source"));
+        if(module_source && *module_source) {
+            return ctx->ExecStr(*module_source, args);
+        }
+    }
+    load_source();
+    return ctx->ExecStr(module->m_source, args);
 }
 
 void Compiler::ReplaceSourceVariable(CompileInfo &ci, size_t count, std::string &body) {
@@ -69,14 +69,45 @@ namespace newlang {
         }
 
 
-        std::shared_ptr<Module> LoadModule(Context &ctx, const char *name_str, bool init);
+        Ref<Module> LoadModule(Context &ctx, const char *name_str, bool init);
         bool UnLoadModule(Context &ctx, const char *name_str, bool deinit);
-        ObjPtr ExecModule(const char *module, const char *output, bool cached, Context * ctx);
+        /*
+         * Выполнение файла через нативный модуль. Модуль собирается внешним компилятором (NLC_CXX, по умолчанию c++)
+         * и сохраняется рядом с исходным файлом (Compiler::MakeModuleCacheName), если имя output не задано.
+         * При cached == true ранее собранный модуль загружается без повторной сборки, а если метка исходного
+         * файла не изменилась (Compiler::MakeModuleStamp), то без чтения исходного файла и запуска компилятора.
+         * Генератор C++ кода для тела модуля не реализован, поэтому модуль содержит только исходный текст и ключ,
+         * а выполняет его интерпретатор, если в модуле нет функции NEWLANG_PREFIX_main_module_func.
+         */
+        ObjPtr ExecModule(const char *module, const char *output, bool cached, Context * ctx, Obj *args = nullptr);
 
         void * GetNativeAddr(const char * name, const char *module = nullptr);
 
         static std::string GetLastErrorMessage();
 
+        /*
+         * Системный аргумент командной строки:
+         * -nlc-search=sss;sss;sss;sss - каталоги поиска модулей
+         * -nlc-threads=N - количество потоков для параллельных операций над тензорами (SetThreads)
+         * -nlc-interop-threads=N - количество потоков для параллельного выполнения операций (SetInteropThreads)
+         * -nlc-affinity=0-3,6 - процессоры, на которых выполняется процесс (SetAffinity)
+         */
+        void SystemArg(const char *arg);
+
+        /*
+         * Потоки libtorch. Если на одном сервере запускается несколько процессов, каждый из них
+         * по умолчанию использует все ядра, поэтому количество потоков и процессоры задаются явно.
+         * Количество inter-op потоков можно изменить только до начала параллельной работы libtorch,
+         * а привязка к процессорам действует на текущий поток и потоки, созданные после нее,
+         * поэтому они задаются при запуске. Скрипт управляет ими функцией threads(...).
+         */
+        static void SetThreads(int64_t count);
+        static int64_t GetThreads();
+        static void SetInteropThreads(int64_t count);
+        static int64_t GetInteropThreads();
+        static void SetAffinity(const std::string &cpus);
+        static std::string GetAffinity();
+
         std::string m_work_dir;
         std::string m_exec_dir;
         std::vector<std::string> m_search_dir;
@@ -84,9 +115,6 @@ namespace newlang {
 
     protected:
 
-        /*
-         * -nlc-search=sss;sss;sss;sss
-         */
         bool ParseArgs(int argc, const char** argv) {
 
             for (int i = 0; i < argc; i++) {
@@ -94,14 +122,7 @@ namespace newlang {
                 m_args->push_back(Obj::CreateString(argv[i]));
 
                 if (strstr(argv[i], "-nlc-") == argv[i]) {
-                    if (strstr(argv[i], "-nlc-search=") == argv[i]) {
-                        std::string list(argv[i]);
-                        list = list.substr(strlen("-nlc-search="));
-                        m_search_dir = Context::SplitString(list.c_str(), ";");
-                    } else if (strstr(argv[i], "-nlc-search=") == argv[i]) {
-                    } else {
-                        LOG_RUNTIME("System arg '%s' not found!", argv[i]);
-                    }
+                    SystemArg(argv[i]);
                 }
             }
 
@@ -240,7 +261,21 @@ namespace newlang {
         static std::string EncodeNonAsciiCharacters(const char * text);
 
 
-        static bool CompileModule(const char *filename, const char *output);
+        static std::string GetCompiler();
+        static std::string GetCompilerVersion();
+        /*
+         * Ключ модуля в кеше из md5 исходного текста, версии NewLang и версии компилятора.
+         * Используется и при сборке модуля (nlc --compile), и при его загрузке (nlc --exec).
+         */
+        static std::string MakeModuleKey(const std::string &source);
+        /*
+         * Метка исходного файла из его размера, времени изменения и версии NewLang.
+         * Проверяется при загрузке модуля из кеша без чтения файла и без запуска компилятора,
+         * а ключ модуля (MakeModuleKey) сравнивается, только если метка изменилась.
+         */
+        static std::string MakeModuleStamp(const char *filename);
+        static std::string MakeModuleCacheName(const char *filename);
+        static bool CompileModule(const char *filename, const char *output, std::string *out = nullptr);
         //    static ObjPtr ExecModule(const char *module, const char *output, bool cached, Context *ctx);
 
         //    std::string MakeFunctionsSourceForJIT(TermPtr ast, Context *ctx);
@@ -10,6 +10,8 @@
 
 #include <autocomplete.h>
 #include <newlang.h>
+#include <jit.h>
+#include <lazy.h>
 
 
 // * 30.04.2021
@@ -59,9 +61,9 @@ namespace newlang {
     _(ModeVersion,  2)\
     _(ModeInter,    3)\
     _(ModeEval,     4) \
-    _(ModeExec,     5)
+    _(ModeExec,     5) \
+    _(ModeCompile,  6)
 
-        //    _(COMPILE,  6)
 
         enum class Mode : uint8_t {
 #define DEFINE_ENUM(name, value) name = value,
@@ -92,6 +94,7 @@ namespace newlang {
         std::string m_ifile; //< Имя входного файла (если есть)
         std::string m_ofile; //< Имя выходного файла (если есть)
         bool m_is_silent; //< Нужно ли выводит сообщения
+        bool m_is_stat; //< Вывод статистики выполнения
         std::string m_output; //<  Информация для вывода, в т.ч. при ошибке о текст подсказки
         std::string m_eval; //<  Входная информация для выполнения
         Context m_ctx;
@@ -120,6 +123,10 @@ namespace newlang {
             std::vector<const char *> argv;
             for (size_t i = 0; i < split.size(); i++) {
                 argv.push_back(split[i].data());
+                if (strstr(argv.back(), "-nlc-") == argv.back()) {
+                    // В конструкторе NLC() системные аргументы не передаются в RunTime::Init
+                    m_ctx.m_runtime->SystemArg(argv.back());
+                }
             }
             ParseArgs(argv.size(), argv.data());
         }
@@ -174,10 +181,14 @@ namespace newlang {
             m_ofile.clear();
             m_output.clear();
             m_is_silent = false;
+            m_is_stat = false;
 
             bool is_debug = false;
             bool is_help = false;
             bool is_ver = false;
+            bool is_vm = false;
+            bool is_jit = false;
+            bool is_lazy = false;
             std::string load_list;
             std::string load_only;
             std::string compile;
@@ -197,14 +208,26 @@ namespace newlang {
                     | lyra::opt(m_ofile, "filename") ["-o"]["--output"] ("Output file name.")
                     | lyra::opt(load_list, "list") ["-l"] ["--load"]("List of load modules.")
                     | lyra::opt(load_only, "list") ["--load-only"]("List of load only modules (without init module after load).")
-                    | lyra::opt(compile, "filename") ["-c"] ["--compile"]("Compile input file and build NLM module.")
-                    | lyra::opt(exec, "filename") ["-x"] ["--exec"]("Compile and make module, load and eXecute main module function.")
+                    | lyra::opt(compile, "filename") ["-c"] ["--compile"]("Build NLM module with the source text of input file.")
+                    | lyra::opt(exec, "filename") ["-x"] ["--exec"]("Build or load cached NLM module and eXecute it.")
                     | lyra::opt(m_ifile, "filename") ["-e"] ["--eval"]("Evaluate file in interpreter mode.")
+                    | lyra::opt(is_vm) ["--vm"]("Execute with the bytecode virtual machine instead of walking the syntax tree.")
+                    | lyra::opt(is_jit) ["--jit"]("Compile hot numeric functions to native code.")
+                    | lyra::opt(is_lazy) ["--lazy"]("Evaluate tensor arithmetic expressions in one fused pass.")
+                    | lyra::opt(m_is_stat) ["--stat"]("Print runtime statistics after evaluation.")
                     | lyra::arg(m_eval, "expression") ("Evaluate expression excluding compilation.")
                     ;
 
 
-            auto result = cli.parse({static_cast<int> (argc), argv});
+            // Системные аргументы -nlc-... обрабатываются в RunTime (RunTime::SystemArg)
+            std::vector<const char *> cli_argv;
+            for (int i = 0; i < argc; i++) {
+                if (strstr(argv[i], "-nlc-") != argv[i]) {
+                    cli_argv.push_back(argv[i]);
+                }
+            }
+
+            auto result = cli.parse({static_cast<int> (cli_argv.size()), cli_argv.data()});
             if (!result) {
                 m_mode = Mode::ModeError;
                 m_output = result.message();
@@ -215,6 +238,10 @@ namespace newlang {
                 utils::Logger::Instance()->SetLogLevel(LOG_LEVEL_DEBUG);
             }
 
+            m_ctx.m_vm_enable = is_vm;
+            m_ctx.m_jit_enable = is_jit;
+            m_ctx.m_lazy_enable = is_lazy;
+
             if (is_help) {
                 m_mode = Mode::ModeHelp;
                 std::ostringstream out;
@@ -252,12 +279,12 @@ namespace newlang {
             if (cnt > 1) {
                 m_mode = Mode::ModeError;
                 m_output = "Select only one mode: Compile, eXec or Eval!";
-                //        } else if (!compile.empty()) {
-                //            m_mode = Mode::COMPILE;
-                //            m_ifile = compile;
-                //        } else if (!exec.empty()) {
-                //            m_mode = Mode::EXEC;
-                //            m_ifile = exec;
+            } else if (!compile.empty()) {
+                m_mode = Mode::ModeCompile;
+                m_ifile = compile;
+            } else if (!exec.empty()) {
+                m_mode = Mode::ModeExec;
+                m_ifile = exec;
             } else if (!m_eval.empty() || !m_ifile.empty()) {
                 m_mode = Mode::ModeEval;
             } else {
@@ -286,37 +313,26 @@ namespace newlang {
                 if (m_mode == Mode::ModeError || m_mode == Mode::ModeVersion || m_mode == Mode::ModeHelp) {
                     LOG_INFO("%s", m_output.c_str());
                     return 0;
-                    //            } else if (m_mode == Mode::COMPILE || m_mode == Mode::EXEC) {
-                    //
-                    //                if (m_ifile.empty()) {
-                    //                    LOG_RUNTIME("Empty input file!");
-                    //                    m_ifile = AddDefaultFileExt(m_ifile.c_str(), ".nlp");
-                    //                }
-                    //                if (m_ofile.empty()) {
-                    //                    m_ofile = m_ifile;
-                    //                    m_ofile = ReplaceFileExt(m_ofile.c_str(), ".nlp", ".nlm");
-                    //                } else {
-                    //                    m_ofile = AddDefaultFileExt(m_ofile.c_str(), ".nlm");
-                    //                }
-                    //
-                    //                switch (m_mode) {
-                    //                    case Mode::COMPILE:
-                    //                        //                        if (!m_ctx.m_runtime->m_info.global->CompileModule(m_ifile.c_str(), m_ofile.c_str())) {
-                    //                        LOG_RUNTIME("Compile file '%s' fail!", m_ifile.c_str());
-                    //                        //                        }
-                    //                        break;
-                    //                    case Mode::EXEC:
-                    //#warning EVAL
-                    //                        ASSERT(false);
-                    //                        //                        ObjPtr result = NewLang::ExecModule(m_ifile.c_str(), m_ofile.c_str(), true, &m_ctx);
-                    //                        //                        m_output = result->GetValueAsString();
-                    //                        break;
-                    //                }
-                } else if (m_mode == Mode::ModeEval) {
+                } else if (m_mode == Mode::ModeCompile) {
+
+                    m_ifile = AddDefaultFileExt(m_ifile.c_str(), ".nlp");
+                    if (m_ofile.empty()) {
+                        m_ofile = Compiler::MakeModuleCacheName(m_ifile.c_str());
+                    }
+
+                    std::string out;
+                    if (!Compiler::CompileModule(m_ifile.c_str(), m_ofile.c_str(), &out)) {
+                        LOG_RUNTIME("Compile file '%s' fail!\n%s", m_ifile.c_str(), out.c_str());
+                    }
+                    LOG_INFO("Module '%s' created", m_ofile.c_str());
+                } else if (m_mode == Mode::ModeEval || m_mode == Mode::ModeExec) {
 
                     Obj *arg_ptr = nullptr;
                     ObjPtr dict = Obj::CreateType(ObjType::Dictionary, ObjType::Dictionary, true);
                     std::string source;
+                    if (m_mode == Mode::ModeExec) {
+                        m_ifile = AddDefaultFileExt(m_ifile.c_str(), ".nlp");
+                    }
                     if (!m_ifile.empty()) {
                         source = ReadFile(m_ifile.c_str());
                         if (source.empty()) {
@@ -344,7 +360,20 @@ namespace newlang {
 
 
 
-                    ObjPtr result = m_ctx.ExecStr(source, arg_ptr, Context::CatchType::CATCH_AUTO);
+                    ObjPtr result;
+                    if (m_mode == Mode::ModeExec) {
+                        result = m_ctx.m_runtime->ExecModule(m_ifile.c_str(), nullptr, true, &m_ctx, arg_ptr);
+                    } else {
+                        result = m_ctx.ExecStr(source, arg_ptr, Context::CatchType::CATCH_AUTO);
+                    }
+
+                    if (m_is_stat) {
+                        LOG_INFO("%s", m_ctx.StatInfo().c_str());
+                        LOG_INFO("%s", MemoryPool::StatInfo().c_str());
+                        LOG_INFO("%s", JitCode::StatInfo().c_str());
+                        LOG_INFO("%s", TensorExpr::StatInfo().c_str());
+                        LOG_INFO("%s", Obj::TensorStatInfo().c_str());
+                    }
 
                     if (result && m_local_vars.find(result.get()) == m_local_vars.end()) {
                         m_local_vars[result.get()] = result;
@@ -1,24 +1,46 @@
 #include "pch.h"
 
+#include <atomic>
+
 #include "contrib/logger/logger.h"
 #include "types.h"
 #include "variable.h"
 
 #include <context.h>
+#include <jit.h>
 #include <newlang.h>
 #include <object.h>
 #include <term.h>
 
 using namespace newlang;
 
+namespace {
+
+    std::atomic<int64_t> g_tensor_shared;
+    std::atomic<int64_t> g_tensor_detach;
+
+}
+
 std::ostream &operator<<(std::ostream &out, newlang::Obj &var) {
+    if(var.is_rational()) {
+        // Длинная дробь выводится в поток без промежуточной строки
+        if(var.m_is_reference) {
+            out << "&";
+        }
+        out << var.m_var_name;
+        if(!var.m_var_name.empty()) {
+            out << "=";
+        }
+        var.m_rational.GetAsString(out);
+        return out;
+    }
     out << var.toString().c_str();
     return out;
 }
 
 std::ostream &operator<<(std::ostream &out, newlang::ObjPtr var) {
     if(var) {
-        out << var->toString().c_str();
+        out << *var;
     } else {
         out << "<NOT OBJECT>";
     }
@@ -74,6 +96,8 @@ int64_t Obj::size(int64_t dim) const {
         return m_value.size();
     } else if(m_var_type_current == ObjType::StrWide) {
         return m_string.size();
+    } else if(m_var_type_current == ObjType::ViewChar) {
+        return at::get<NativeData>(m_var).size;
     }
     return Variable::size();
 }
@@ -119,6 +143,8 @@ int64_t Obj::resize_(int64_t new_size, ObjPtr fill, const std::string name) {
     } else if(is_dictionary_type()) {
         return Variable::resize(new_size, fill ? fill : Obj::CreateNone(), name);
     } else if(is_tensor_type()) {
+        // Изменение размера затрагивает общие данные копий
+        DetachTensor_();
         std::vector<int64_t> sizes;
         for (int i = 0; i < m_tensor.dim(); i++) {
             sizes.push_back(m_tensor.size(i));
@@ -192,6 +218,17 @@ const Variable<Obj>::PairType & Obj::at(int64_t index) const {
         }
         LOG_RUNTIME("Index '%ld' not exists in byte string '%s'!", index, "WIDE");
 
+    } else if(m_var_type_current == ObjType::ViewChar) {
+        const NativeData &data = at::get<NativeData>(m_var);
+        if(index < 0) {
+            index = data.size + index; // Позиция с конца строки
+        }
+        if(index >= 0 && index < data.size) {
+            m_str_pair = pair(CreateString(std::string(1, static_cast<const char *> (data.ptr)[index])));
+            return m_str_pair;
+        }
+        LOG_RUNTIME("Index '%ld' not exists in native byte string!", index);
+
     } else if(is_tensor_type()) {
         ASSERT(!is_scalar());
         torch::Tensor t = m_tensor.index({index});
@@ -215,6 +252,17 @@ Variable<Obj>::PairType & Obj::at(int64_t index) {
         }
         LOG_RUNTIME("Index '%ld' not exists in byte string '%s'!", index, "WIDE");
 
+    } else if(m_var_type_current == ObjType::ViewChar) {
+        NativeData &data = at::get<NativeData>(m_var);
+        if(index < 0) {
+            index = data.size + index; // Позиция с конца строки
+        }
+        if(index >= 0 && index < data.size) {
+            m_str_pair = pair(CreateString(std::string(1, static_cast<char *> (data.ptr)[index])));
+            return m_str_pair;
+        }
+        LOG_RUNTIME("Index '%ld' not exists in native byte string!", index);
+
     } else if(is_tensor_type()) {
         ASSERT(!is_scalar());
         ASSERT(m_tensor.defined());
@@ -252,6 +300,20 @@ const ObjPtr Obj::index_get(const std::vector<Index> &index) const {
         }
         LOG_RUNTIME("Index '%s' not exists in WIDE string '%s'!", IndexToString(index).c_str(), utf8_encode(m_string).c_str());
 
+    } else if(m_var_type_current == ObjType::ViewChar) {
+        if(index.size() != 1 || !index[0].is_integer()) {
+            LOG_RUNTIME("The index must be an integer value '%s'!", IndexToString(index).c_str());
+        }
+        const NativeData &data = at::get<NativeData>(m_var);
+        int64_t pos = index[0].integer();
+        if(pos < 0) {
+            pos = data.size + pos; // Позиция с конца строки
+        }
+        if(pos >= 0 && pos < data.size) {
+            return CreateString(std::string(1, static_cast<const char *> (data.ptr)[pos]));
+        }
+        LOG_RUNTIME("Index '%s' not exists in native byte string!", IndexToString(index).c_str());
+
     } else if(is_tensor_type()) {
         ASSERT(!is_scalar());
         ASSERT(m_tensor.defined());
@@ -297,11 +359,32 @@ ObjPtr Obj::index_set_(const std::vector<Index> &index, const ObjPtr value) {
         }
         LOG_RUNTIME("Index '%s' not exists in byte string '%s'!", IndexToString(index).c_str(), "WIDE");
 
+    } else if(m_var_type_current == ObjType::ViewChar) {
+        if(index.size() != 1 || !index[0].is_integer()) {
+            LOG_RUNTIME("The index must be an integer value '%s'!", IndexToString(index).c_str());
+        }
+        NativeData &data = at::get<NativeData>(m_var);
+        int64_t pos = index[0].integer();
+        if(pos < 0) {
+            pos = data.size + pos; // Позиция с конца строки
+        }
+        // Размер нативных данных не изменяется, поэтому заменяется только один байт
+        std::string str = value->toType(ObjType::StrChar)->m_value;
+        if(str.size() != 1) {
+            LOG_RUNTIME("Only one byte can be set in native byte string!");
+        }
+        if(pos >= 0 && pos < data.size) {
+            static_cast<char *> (data.ptr)[pos] = str[0];
+            return shared();
+        }
+        LOG_RUNTIME("Index '%s' not exists in native byte string!", IndexToString(index).c_str());
+
     } else if(is_tensor_type()) {
         ASSERT(!is_scalar());
         ASSERT(m_tensor.defined());
 
         ObjPtr temp = value->toType(fromTorchType(m_tensor.scalar_type()));
+        DetachTensor_();
         if(temp->is_scalar()) {
             if(temp->is_integral()) {
                 m_tensor.index_put_(index, temp->GetValueAsInteger());
@@ -392,6 +475,7 @@ ObjPtr Obj::operator+=(Obj value) {
     if(is_tensor_type()) {
         if(value.is_tensor_type()) {
             testResultIntegralType(value.m_var_type_current, true);
+            DetachTensor_();
             if(is_scalar() && value.is_scalar()) {
                 if(is_floating()) {
                     ASSERT(at::holds_alternative<double>(m_var));
@@ -463,6 +547,7 @@ ObjPtr Obj::operator-=(Obj value) {
         m_var_type_current = value.m_var_type_current;
     } else if(is_tensor_type() && value.is_tensor_type()) {
         testResultIntegralType(value.m_var_type_current, true);
+        DetachTensor_();
         if(is_scalar() && value.is_scalar()) {
             if(is_floating()) {
                 ASSERT(at::holds_alternative<double>(m_var));
@@ -498,7 +583,7 @@ ObjPtr Obj::operator-=(Obj value) {
                 for (int i = 0; i < value.size(); i++) {
                     auto found = find(value.name(i));
                     if(found != end()) {
-                        ListType::erase(found);
+                        Variable::erase(found);
                     }
                 }
                 return shared();
@@ -520,6 +605,7 @@ ObjPtr Obj::operator*=(Obj value) {
         m_var_type_current = value.m_var_type_current;
     } else if(is_tensor_type() && value.is_tensor_type()) {
         testResultIntegralType(value.m_var_type_current, true);
+        DetachTensor_();
         if(is_scalar() && value.is_scalar()) {
             if(is_floating()) {
                 ASSERT(at::holds_alternative<double>(m_var));
@@ -592,6 +678,7 @@ ObjPtr Obj::operator*=(Obj value) {
 ObjPtr Obj::operator/=(Obj value) {
     if(is_tensor_type() && value.is_tensor_type()) {
         testResultIntegralType(ObjType::Float64, true);
+        DetachTensor_();
         if(is_scalar() && value.is_scalar()) {
             if(is_floating()) {
                 ASSERT(at::holds_alternative<double>(m_var));
@@ -632,6 +719,7 @@ ObjPtr Obj::op_div_ceil_(Obj & value) {
     if(is_tensor_type() && value.is_tensor_type()) {
         ObjType type = m_var_type_current;
         testResultIntegralType(ObjType::Float32, false);
+        DetachTensor_();
         if(is_scalar() && value.is_scalar()) {
             if(is_floating()) {
                 ASSERT(at::holds_alternative<double>(m_var));
@@ -677,6 +765,7 @@ ObjPtr Obj::op_div_ceil_(Obj & value) {
 ObjPtr Obj::operator%=(Obj value) {
     if(is_tensor_type() && value.is_tensor_type()) {
         testResultIntegralType(value.m_var_type_current, true);
+        DetachTensor_();
         if(is_scalar() && value.is_scalar()) {
             if(is_floating()) {
                 ASSERT(at::holds_alternative<double>(m_var));
@@ -744,7 +833,9 @@ void Obj::CloneDataTo(Obj & clone) const {
         clone.m_string = m_string;
         clone.m_return_obj = m_return_obj;
 
-        clone.m_rational = *m_rational.clone();
+        if(m_var_type_current == ObjType::Rational) {
+            clone.m_rational = m_rational;
+        }
         clone.m_iterator = m_iterator;
         if(m_iter_range_value) {
             clone.m_iter_range_value = m_iter_range_value->Clone();
@@ -759,11 +850,48 @@ void Obj::CloneDataTo(Obj & clone) const {
             *const_cast<TermPtr *> (&clone.m_prototype) = m_prototype;
         }
         if(m_tensor.defined()) {
-            clone.m_tensor = m_tensor.clone();
+            clone.m_tensor = ShareTensor();
+            if(at::holds_alternative<NativeData>(m_var)) {
+                clone.m_var = at::monostate();
+            }
+        }
+        if(m_var_type_current == ObjType::ViewChar) {
+            // Копия нативных данных становится обычной строкой
+            clone.m_value = GetValueAsString();
+            clone.m_var = at::monostate();
+            clone.m_var_type_current = ObjType::StrChar;
+            if(clone.m_var_type_fixed == ObjType::ViewChar) {
+                clone.m_var_type_fixed = ObjType::StrChar;
+            }
         }
     }
 }
 
+torch::Tensor Obj::ShareTensor() const {
+    ASSERT(m_tensor.defined());
+    if(at::holds_alternative<NativeData>(m_var)) {
+        // Нативные данные могут измениться без ведома объекта
+        return m_tensor.clone();
+    }
+    g_tensor_shared++;
+    return m_tensor.alias();
+}
+
+void Obj::DetachTensor_() {
+    if(m_tensor.defined() && !at::holds_alternative<NativeData>(m_var) && m_tensor.storage().use_count() > 1) {
+        m_tensor = m_tensor.clone();
+        g_tensor_detach++;
+    }
+}
+
+std::string Obj::TensorStatInfo() {
+    std::string result("Tensor clones with shared data: ");
+    result += std::to_string(g_tensor_shared.load());
+    result += ", copied on write: ";
+    result += std::to_string(g_tensor_detach.load());
+    return result;
+}
+
 void Obj::ClonePropTo(Obj & clone) const {
 
     NL_CHECK(!isLocalType(m_var_type_current), "Local object not clonable!");
@@ -839,6 +967,12 @@ std::string Obj::toString(bool deep) const {
                 result.append("'");
                 return result;
 
+            case ObjType::ViewChar:
+                result += "'";
+                result += GetValueAsString();
+                result.append("'");
+                return result;
+
             case ObjType::StrWide: // name:='string' or name:="string"
                 result += "\"";
                 result += utf8_encode(m_string);
@@ -1019,7 +1153,7 @@ std::string Obj::toString(bool deep) const {
                         temp->push_back(Obj::CreateString(iter->first));
                         iter++;
                     } else {
-                        iter = ctx->ListType::erase(iter);
+                        iter = ctx->Erase(iter);
                     }
                 }
 
@@ -1144,6 +1278,12 @@ std::string Obj::GetValueAsString() const {
         case ObjType::FmtChar:
             return m_value;
 
+        case ObjType::ViewChar:
+        {
+            const NativeData &data = at::get<NativeData>(m_var);
+            return std::string(static_cast<const char *> (data.ptr), data.size);
+        }
+
         case ObjType::StrWide:
         case ObjType::FmtWide:
             return utf8_encode(m_string);
@@ -1228,7 +1368,7 @@ ObjPtr Obj::CreateFunc(std::string prototype, TransparentType *func_addr, ObjTyp
 
 ObjPtr Obj::CreateFunc(Context *ctx, TermPtr proto, ObjType type, const std::string var_name) {
     ASSERT(type == ObjType::Function || type == ObjType::PureFunc);
-    ObjPtr result = std::make_shared<Obj>(type, var_name.c_str(), proto);
+    ObjPtr result = MakeRef<Obj>(type, var_name.c_str(), proto);
     Obj local;
     Obj args(ctx, proto, false, &local);
     args.ClonePropTo(*result);
@@ -1239,6 +1379,37 @@ ObjPtr Obj::CreateFunc(Context *ctx, TermPtr proto, ObjType type, const std::str
     return result;
 }
 
+ObjPtr Obj::CreateTensorView(void *ptr, ObjType type, const std::vector<int64_t> &shape, std::function<void(void *)> release) {
+    NL_CHECK(ptr, "Native data not exist!");
+    NL_CHECK(!shape.empty(), "Native data view requires dimensions!");
+    if(!isSimpleType(type) || isGenericType(type)) {
+        LOG_RUNTIME("Native data view for type '%s' not supported!", newlang::toString(type));
+    }
+    torch::TensorOptions options = torch::TensorOptions().dtype(toTorchType(type));
+    ObjPtr result = CreateTensor(release ? torch::from_blob(ptr, shape, release, options) : torch::from_blob(ptr, shape, options));
+
+    // Признак представления, которое не копируется при присвоении (память освобождает сам тензор)
+    NativeData data;
+    data.ptr = ptr;
+    data.size = result->m_tensor.nbytes();
+    result->m_var = std::move(data);
+    return result;
+}
+
+ObjPtr Obj::CreateBytesView(void *ptr, int64_t size, std::function<void(void *)> release) {
+    NL_CHECK(ptr, "Native data not exist!");
+    NL_CHECK(size >= 0, "Fail size native data %ld!", size);
+    ObjPtr result = CreateType(ObjType::ViewChar, ObjType::ViewChar, true);
+    NativeData data;
+    data.ptr = ptr;
+    data.size = size;
+    if(release) {
+        data.hold = std::shared_ptr<void>(ptr, release);
+    }
+    result->m_var = std::move(data);
+    return result;
+}
+
 Obj::Obj(Context *ctx, const TermPtr term, bool as_value, Obj * local_vars) {
 
     if(!term) {
@@ -1251,6 +1422,7 @@ Obj::Obj(Context *ctx, const TermPtr term, bool as_value, Obj * local_vars) {
     m_dimensions = nullptr;
     m_var_is_init = false;
     m_is_const = false;
+    m_jit_hot = 0;
     m_var = at::monostate();
     ASSERT(!m_tensor.defined());
 
@@ -1308,7 +1480,7 @@ ObjPtr Obj::Call(Context *ctx, Obj * args, bool direct, ObjPtr self) {
         Obj local;
         ObjPtr param;
         if(m_prototype) {
-            param = std::make_shared<Obj>(ctx, m_prototype, false, &local);
+            param = MakeRef<Obj>(ctx, m_prototype, false, &local);
             param->m_var_type_current = ObjType::Dictionary;
         } else {
             param = Obj::CreateDict();
@@ -1339,7 +1511,57 @@ ObjPtr Obj::Call(Context *ctx, Obj * args, bool direct, ObjPtr self) {
         } else if(m_var_type_current == ObjType::NativeFunc) {
             result = CallNative(ctx, *param.get());
         } else if(m_var_type_current == ObjType::EVAL_FUNCTION || m_var_type_current == ObjType::BLOCK || m_var_type_current == ObjType::BLOCK_TRY || m_var_type_current == ObjType::BLOCK_PLUS || m_var_type_current == ObjType::BLOCK_MINUS) {
-            result = Context::CallBlock(ctx, m_sequence, param.get(), true, Context::CatchType::CATCH_AUTO, nullptr);
+            // Кадр с аргументами функции в порядке прототипа (Context::ResolveSlots)
+            Context::Frame frame;
+            Context::Frame *save_frame = nullptr;
+            bool is_frame = ctx && m_sequence && m_sequence->m_frame_size >= 0;
+
+            // Часто вызываемая функция выполняется в машинном коде (jit.h)
+            bool is_jit = is_frame && ctx->m_jit_enable && m_var_type_current == ObjType::EVAL_FUNCTION && m_jit_hot >= 0;
+            if(is_jit && !m_jit && m_jit_hot >= JitCode::HOT_THRESHOLD) {
+                m_jit = JitCode::Compile(ctx, *this, *param);
+                if(!m_jit) {
+                    m_jit_hot = -1; // Функция не может быть скомпилирована
+                }
+            }
+            if(is_jit && m_jit) {
+                result = m_jit->Call(*param);
+                if(!result && m_jit->GetDeoptCount() > JitCode::DEOPT_LIMIT) {
+                    m_jit.reset();
+                    m_jit_hot = -1;
+                }
+            }
+
+            if(!result) {
+                if(is_frame) {
+                    frame.m_scope = m_sequence.get();
+                    frame.m_loops = 0;
+                    frame.m_slot.resize(m_sequence->m_frame_size);
+                    int pos = 0;
+                    for (auto &elem : *param) {
+                        if(pos >= m_sequence->m_frame_args) {
+                            break;
+                        }
+                        frame.m_slot[pos++] = elem.second;
+                    }
+                    save_frame = ctx->m_frame;
+                    ctx->m_frame = &frame;
+                }
+                try {
+                    result = Context::CallBlock(ctx, m_sequence, param.get(), true, Context::CatchType::CATCH_AUTO, nullptr);
+                } catch (...) {
+                    if(is_frame) {
+                        ctx->m_frame = save_frame;
+                    }
+                    throw;
+                }
+                if(is_frame) {
+                    ctx->m_frame = save_frame;
+                }
+                if(is_jit && !m_jit && m_jit_hot >= 0) {
+                    m_jit_hot += 1 + frame.m_loops;
+                }
+            }
         } else if(m_var_type_current == ObjType::Virtual) {
             LOG_RUNTIME("Call virtual function '%s' not allowed!", toString().c_str());
         } else {
@@ -1692,6 +1914,7 @@ bool Obj::op_accurate(Obj & value) {
 ObjPtr Obj::op_bit_and_set(Obj &obj, bool strong) {
     if(m_var_type_current == ObjType::Int64) {
         if(m_var_type_current == obj.m_var_type_current) {
+            DetachTensor_();
             m_tensor.bitwise_and_(obj.m_tensor);
             //            m_values.integer &= obj.m_values.integer;
             return shared();
@@ -1816,6 +2039,7 @@ ObjPtr Obj::op_pow_(Obj & obj) {
             }
         } else {
             ASSERT(m_tensor.defined());
+            DetachTensor_();
             m_tensor.pow_(obj.GetValueAsNumber());
         }
         return shared();
@@ -1991,30 +2215,223 @@ std::vector<int64_t> newlang::TensorShapeFromDict(const Obj * obj) {
 }
 
 /*
- * Так как под виндой не получается передавать аргументы в функции при вызове LLVMRunFunction вернул libffi.
+ * Подготовленный вызов нативной функции (Obj::m_native).
+ * Типы аргументов из прототипа и тип результата определяются один раз при первом вызове,
+ * а ffi_cif создается для каждого набора способов передачи аргументов (для функций
+ * с переменным числом аргументов он зависит от количества и типов дополнительных аргументов).
  */
+struct newlang::NativeCall {
 
-ObjPtr Obj::CallNative(Context *ctx, Obj args) {
+    constexpr static size_t MAX_CIF = 16; ///< Ограничение количества ffi_cif у одной функции
+    constexpr static size_t STACK_ARGS = 16; ///< Аргументы размещаются в стеке, если их не больше
+    constexpr static int64_t TRAMPOLINE_THRESHOLD = 100; ///< Количество вызовов через ffi_call до создания переходника
 
-    if(!ctx || !ctx->m_runtime) {
-        LOG_RUNTIME("Fail context for call native!");
-    }
+    struct Arg {
+        ObjType type; ///< Тип аргумента в прототипе
+        bool is_undefined; ///< Тип аргумента в прототипе не указан
+        bool is_format; ///< Строка формата printf (FmtChar)
+    };
 
+    struct Cif {
+        std::vector<ObjType> kind; ///< Способ передачи каждого аргумента
+        std::vector<ffi_type *> type;
+        ffi_cif cif;
+        JitCode::TrampolineType *trampoline = nullptr; ///< Прямой вызов без ffi_call (JitCode::GetTrampoline)
+        int64_t calls = 0; ///< Количество вызовов или -1, если переходник не создается
+    };
 
-    ffi_cif m_cif;
-    std::vector<ffi_type *> m_args_type;
-    std::vector<void *> m_args_ptr;
+    void *func;
+    std::vector<Arg> args;
+    bool is_ellipsis;
+    ObjType result; ///< Базовый тип результата
+    ObjType result_type; ///< Тип результата из прототипа (для Bool и Byte)
+    ffi_type *result_ffi;
+    std::vector<std::unique_ptr<Cif>> cif;
+    size_t cif_next; ///< Заменяемый ffi_cif при превышении MAX_CIF
 
     union VALUE {
         const void *ptr;
-        //        ObjPtr obj;
-        size_t size;
         int64_t integer;
+        int32_t int32;
+        int16_t int16;
+        int8_t int8;
+        uint8_t boolean;
         double number;
-        bool boolean;
+        float single;
     };
-    std::vector<VALUE> m_args_val;
-    VALUE temp;
+
+    /*
+     * Способ передачи значения типа type (тип ffi и поле VALUE)
+     */
+    static ObjType KindFromType(ObjType type) {
+        switch(type) {
+            case ObjType::Bool:
+                return ObjType::Bool;
+            case ObjType::Int8:
+            case ObjType::Char:
+            case ObjType::Byte:
+                return ObjType::Int8;
+            case ObjType::Int16:
+            case ObjType::Word:
+                return ObjType::Int16;
+            case ObjType::Int32:
+            case ObjType::DWord:
+                return ObjType::Int32;
+            case ObjType::Int64:
+            case ObjType::DWord64:
+                return ObjType::Int64;
+            case ObjType::Float32:
+            case ObjType::Single:
+                return ObjType::Float32;
+            case ObjType::Float64:
+            case ObjType::Double:
+                return ObjType::Float64;
+            case ObjType::StrChar:
+            case ObjType::StrWide:
+            case ObjType::Pointer:
+                return type;
+            default:
+                return ObjType::None;
+        }
+    }
+
+    static ffi_type * FfiFromKind(Context *ctx, ObjType kind) {
+        switch(kind) {
+            case ObjType::Bool:
+                return ctx->m_ffi_type_uint8;
+            case ObjType::Int8:
+                return ctx->m_ffi_type_sint8;
+            case ObjType::Int16:
+                return ctx->m_ffi_type_sint16;
+            case ObjType::Int32:
+                return ctx->m_ffi_type_sint32;
+            case ObjType::Int64:
+                return ctx->m_ffi_type_sint64;
+            case ObjType::Float32:
+                return ctx->m_ffi_type_float;
+            case ObjType::Float64:
+                return ctx->m_ffi_type_double;
+            case ObjType::StrChar:
+            case ObjType::StrWide:
+            case ObjType::Pointer:
+                return ctx->m_ffi_type_pointer;
+            default:
+                return nullptr;
+        }
+    }
+
+    NativeCall(Context *ctx, void *ptr, const TermPtr &proto) : func(ptr), cif_next(0) {
+
+        is_ellipsis = (proto->size() && (*proto)[proto->size() - 1].second->getTermID() == TermID::ELLIPSIS);
+        size_t check_count = is_ellipsis ? proto->size() - 1 : proto->size();
+        for (size_t i = 0; i < check_count; i++) {
+            TermPtr &arg = (*proto)[i].second;
+            Arg plan;
+            plan.is_undefined = arg->m_type_name.empty();
+            plan.type = plan.is_undefined ? ObjType::None : typeFromString(arg->m_type_name, ctx);
+            plan.is_format = arg->GetType() && arg->GetType()->m_text.compare(newlang::toString(ObjType::FmtChar)) == 0;
+            args.push_back(plan);
+        }
+
+        NL_CHECK(!proto->m_type_name.empty(), "Undefined return type '%s'", proto->toString().c_str());
+
+        result = ctx->BaseTypeFromString(proto->m_type_name);
+        result_type = typeFromString(proto->m_type_name);
+        switch(result) {
+            case ObjType::StrChar:
+            case ObjType::StrWide:
+                result_ffi = ctx->m_ffi_type_pointer;
+                break;
+            case ObjType::None:
+                result_ffi = ctx->m_ffi_type_void;
+                break;
+            default:
+                result_ffi = FfiFromKind(ctx, KindFromType(result));
+                if(!result_ffi) {
+                    LOG_RUNTIME("Native return type '%s' not implemented!", proto->m_type_name.c_str());
+                }
+        }
+    }
+
+    Cif * GetCif(Context *ctx, const ObjType *kind, size_t count) {
+        for (auto &elem : cif) {
+            if(elem->kind.size() == count && std::equal(elem->kind.begin(), elem->kind.end(), kind)) {
+                return elem.get();
+            }
+        }
+
+        std::unique_ptr<Cif> prep = std::make_unique<Cif>();
+        prep->kind.assign(kind, kind + count);
+        for (size_t i = 0; i < count; i++) {
+            prep->type.push_back(FfiFromKind(ctx, kind[i]));
+        }
+
+        ffi_status status;
+        //    ASSERT(ctx->m_func_abi == FFI_DEFAULT_ABI); // Нужны другие типы вызовов ???
+        if(is_ellipsis) {
+            status = ctx->m_ffi_prep_cif_var(&prep->cif, FFI_DEFAULT_ABI, static_cast<unsigned int> (std::min(args.size(), count)),
+                    static_cast<unsigned int> (count), result_ffi, prep->type.data());
+        } else {
+            status = ctx->m_ffi_prep_cif(&prep->cif, FFI_DEFAULT_ABI, static_cast<unsigned int> (count), result_ffi, prep->type.data());
+        }
+        if(status != FFI_OK) {
+            return nullptr;
+        }
+
+        // Функции с переменным числом аргументов вызываются только через libffi
+        if(is_ellipsis) {
+            prep->calls = -1;
+        }
+
+        if(cif.size() < MAX_CIF) {
+            cif.push_back(std::move(prep));
+            return cif.back().get();
+        }
+        cif_next = (cif_next + 1) % MAX_CIF;
+        cif[cif_next] = std::move(prep);
+        return cif[cif_next].get();
+    }
+};
+
+/*
+ * Так как под виндой не получается передавать аргументы в функции при вызове LLVMRunFunction вернул libffi.
+ */
+
+ObjPtr Obj::CallNativeDirect(Context *ctx, const ObjPtr *args, size_t count) {
+    ASSERT(m_var_type_current == ObjType::NativeFunc);
+    if(!ctx || !m_prototype || static_cast<size_t> (m_prototype->size()) != count) {
+        return nullptr;
+    }
+
+    // Аргументы приводятся к типам прототипа так же, как в Obj::ConvertToArgs_
+    Obj param(ObjType::Dictionary);
+    param.push_back(pair(shared(), "$0"));
+    for (size_t i = 0; i < count; i++) {
+        const TermPtr &proto = (*m_prototype)[i].second;
+        if(!m_prototype->name(i).empty() || proto->getTermID() == TermID::ELLIPSIS || proto->m_type_name.empty() || proto->isRef()) {
+            return nullptr;
+        }
+        bool has_error = false;
+        ObjType base_type = ctx->BaseTypeFromString(proto->m_type_name, &has_error);
+        if(has_error) {
+            return nullptr;
+        }
+        if(!canCast(args[i]->getTypeAsLimit(), base_type)) {
+            // Строку с одним символом можно преобразовать в арифметичсекий тип
+            if(!(isArithmeticType(base_type) && args[i]->is_string_type() && args[i]->size() == 1)) {
+                return nullptr;
+            }
+        }
+        param.push_back(args[i]->toType(base_type));
+    }
+    return CallNative(ctx, param);
+}
+
+ObjPtr Obj::CallNative(Context *ctx, Obj &args) {
+
+    if(!ctx || !ctx->m_runtime) {
+        LOG_RUNTIME("Fail context for call native!");
+    }
 
     ASSERT(m_var_type_current == ObjType::NativeFunc);
     ASSERT(m_prototype);
@@ -2022,259 +2439,211 @@ ObjPtr Obj::CallNative(Context *ctx, Obj args) {
     ASSERT(at::holds_alternative<void *>(m_var));
     void * func_ptr = at::get<void *>(m_var);
 
-    if(!func_ptr) {
-        NL_CHECK(m_module_name.empty() || ctx, "You cannot load a module without access to the runtime context!");
-        func_ptr = LLVMSearchForAddressOfSymbol(m_func_mangle_name.empty() ? m_prototype->m_text.c_str() : m_func_mangle_name.c_str());
-    }
-    NL_CHECK(func_ptr, "Fail load func name '%s' (%s) or fail load module '%s'!", m_prototype->m_text.c_str(),
-            m_func_mangle_name.empty() ? m_prototype->m_text.c_str() : m_func_mangle_name.c_str(),
-            m_module_name.empty() ? "none" : m_module_name.c_str());
+    if(!m_native || (func_ptr && func_ptr != m_native->func)) {
+        if(!func_ptr) {
+            NL_CHECK(m_module_name.empty() || ctx, "You cannot load a module without access to the runtime context!");
+            func_ptr = LLVMSearchForAddressOfSymbol(m_func_mangle_name.empty() ? m_prototype->m_text.c_str() : m_func_mangle_name.c_str());
+        }
+        NL_CHECK(func_ptr, "Fail load func name '%s' (%s) or fail load module '%s'!", m_prototype->m_text.c_str(),
+                m_func_mangle_name.empty() ? m_prototype->m_text.c_str() : m_func_mangle_name.c_str(),
+                m_module_name.empty() ? "none" : m_module_name.c_str());
 
-    bool is_ellipsis = (m_prototype->size() && (*m_prototype)[m_prototype->size() - 1].second->getTermID() == TermID::ELLIPSIS);
-    size_t check_count = is_ellipsis ? m_prototype->size() - 1 : m_prototype->size();
+        m_native = std::make_shared<NativeCall>(ctx, func_ptr, m_prototype);
+    }
+    NativeCall &native = *m_native;
 
     // Пропустить нулевой аргумент для нативных функций
-    for (int i = 1; i < args.size(); i++) {
+    size_t count = args.size() > 0 ? static_cast<size_t> (args.size() - 1) : 0;
+
+    NativeCall::VALUE stack_val[NativeCall::STACK_ARGS];
+    void *stack_ptr[NativeCall::STACK_ARGS];
+    ObjType stack_kind[NativeCall::STACK_ARGS];
+
+    std::vector<NativeCall::VALUE> heap_val;
+    std::vector<void *> heap_ptr;
+    std::vector<ObjType> heap_kind;
+
+    NativeCall::VALUE *m_args_val = stack_val;
+    void **m_args_ptr = stack_ptr;
+    ObjType *m_args_kind = stack_kind;
+    if(count > NativeCall::STACK_ARGS) {
+        heap_val.resize(count);
+        heap_ptr.resize(count);
+        heap_kind.resize(count);
+        m_args_val = heap_val.data();
+        m_args_ptr = heap_ptr.data();
+        m_args_kind = heap_kind.data();
+    }
+
+    for (size_t pind = 0; pind < count; pind++) {
 
-        ASSERT(args[i].second);
-        if(args[i].second->m_is_reference) {
-            LOG_RUNTIME("Argument REFERENCE! %s", args[i].second->toString().c_str());
+        int i = static_cast<int> (pind + 1); // Индекс прототипа на единицу меньше из-за пустого нулевого аргумента
+        Obj *arg = args[i].second.get();
+
+        ASSERT(arg);
+        if(arg->m_is_reference) {
+            LOG_RUNTIME("Argument REFERENCE! %s", arg->toString().c_str());
         }
 
-        size_t pind = i - 1; // Индекс прототипа на единицу меньше из-за пустого нулевого аргумента
+        ObjType type = arg->getTypeAsLimit();
+        ObjType kind = NativeCall::KindFromType(type);
+        if(arg->is_tensor_type() && !arg->is_scalar()) {
+            // Данные тензора передаются по указателю без копирования, но нативная функция
+            // может их изменить, поэтому общие с другими объектами данные копируются
+            arg->DetachTensor_();
+            NL_CHECK(arg->m_tensor.is_contiguous(), "Tensor data for native arg '%s' is not contiguous!", arg->toString().c_str());
+            type = ObjType::Pointer;
+            kind = ObjType::Pointer;
+        } else if(type == ObjType::ViewChar) {
+            kind = ObjType::StrChar;
+        }
+        if(kind == ObjType::None) {
+            LOG_RUNTIME("Native arg '%s' not implemented!", arg->toString().c_str());
+        }
 
-        ObjType type = args[i].second->getTypeAsLimit();
-        switch(type) {
+        if(pind < native.args.size()) {
+            NativeCall::Arg &plan = native.args[pind];
+            NL_CHECK(!plan.is_undefined, "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
+            NL_CHECK(canCast(type, plan.type), "Fail cast from '%s' to '%s'",
+                    (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
+
+            // Число передается в размере аргумента из прототипа, а не минимальном для значения
+            ObjType proto_kind = NativeCall::KindFromType(plan.type);
+            if(isSimpleType(kind) && isSimpleType(proto_kind)) {
+                kind = proto_kind;
+            }
+        } else {
+            // Продвижение типов для дополнительных аргументов функций с переменным числом аргументов
+            if(kind == ObjType::Bool || kind == ObjType::Int8 || kind == ObjType::Int16) {
+                kind = ObjType::Int32;
+            } else if(kind == ObjType::Float32) {
+                kind = ObjType::Float64;
+            }
+        }
+
+        NativeCall::VALUE &val = m_args_val[pind];
+        switch(kind) {
             case ObjType::Bool:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_uint8);
-                temp.boolean = args[i].second->GetValueAsBoolean();
-                m_args_val.push_back(temp);
+                val.boolean = arg->GetValueAsBoolean();
                 break;
-
             case ObjType::Int8:
-            case ObjType::Char:
-            case ObjType::Byte:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_sint8);
-                temp.integer = args[i].second->GetValueAsInteger();
-                m_args_val.push_back(temp);
+                val.int8 = static_cast<int8_t> (arg->GetValueAsInteger());
                 break;
-
             case ObjType::Int16:
-            case ObjType::Word:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_sint16);
-                temp.integer = args[i].second->GetValueAsInteger();
-                m_args_val.push_back(temp);
+                val.int16 = static_cast<int16_t> (arg->GetValueAsInteger());
                 break;
-
             case ObjType::Int32:
-            case ObjType::DWord:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_sint32);
-                temp.integer = args[i].second->GetValueAsInteger();
-                m_args_val.push_back(temp);
+                val.int32 = static_cast<int32_t> (arg->GetValueAsInteger());
                 break;
-
             case ObjType::Int64:
-            case ObjType::DWord64:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_sint64);
-                temp.integer = args[i].second->GetValueAsInteger();
-                m_args_val.push_back(temp);
+                val.integer = arg->GetValueAsInteger();
                 break;
-
             case ObjType::Float32:
-            case ObjType::Single:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_float);
-                temp.number = args[i].second->GetValueAsNumber();
-                m_args_val.push_back(temp);
+                val.single = static_cast<float> (arg->GetValueAsNumber());
                 break;
-
             case ObjType::Float64:
-            case ObjType::Double:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_double);
-                temp.number = args[i].second->GetValueAsNumber();
-                m_args_val.push_back(temp);
+                val.number = arg->GetValueAsNumber();
                 break;
-
             case ObjType::StrChar:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
+                if(arg->m_var_type_current == ObjType::ViewChar) {
+                    val.ptr = at::get<NativeData>(arg->m_var).ptr;
+                } else {
+                    val.ptr = arg->m_value.c_str();
                 }
-                m_args_type.push_back(ctx->m_ffi_type_pointer);
-                temp.ptr = args[i].second->m_value.c_str();
-                m_args_val.push_back(temp);
                 break;
-
             case ObjType::StrWide:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_pointer);
-                temp.ptr = args[i].second->m_string.c_str();
-                m_args_val.push_back(temp);
-                break;
-
-            case ObjType::Pointer:
-                if(pind < check_count) {
-                    NL_CHECK(!(*m_prototype)[pind].second->m_type_name.empty(), "Undefined type arg '%s'", (*m_prototype)[pind].second->toString().c_str());
-                    NL_CHECK(canCast(type, typeFromString((*m_prototype)[pind].second->m_type_name, ctx)), "Fail cast from '%s' to '%s'",
-                            (*m_prototype)[pind].second->m_type_name.c_str(), newlang::toString(type));
-                }
-                m_args_type.push_back(ctx->m_ffi_type_pointer);
-                temp.ptr = at::get<void *>(args[i].second->m_var);
-                m_args_val.push_back(temp);
+                val.ptr = arg->m_string.c_str();
                 break;
-
             default:
-                LOG_RUNTIME("Native arg '%s' not implemented!", args[i].second->toString().c_str());
+                ASSERT(kind == ObjType::Pointer);
+                if(arg->is_tensor_type()) {
+                    val.ptr = arg->m_tensor.data_ptr();
+                } else {
+                    val.ptr = at::get<void *>(arg->m_var);
+                }
         }
-        if(pind < check_count && (*m_prototype)[pind].second->GetType()) {
-            if((*m_prototype)[pind].second->GetType()->m_text.compare(newlang::toString(ObjType::FmtChar)) == 0) {
-                NL_CHECK(ParsePrintfFormat(&args, i), "Fail format string or type args!");
-            }
+        m_args_kind[pind] = kind;
+        m_args_ptr[pind] = &val;
+
+        if(pind < native.args.size() && native.args[pind].is_format) {
+            NL_CHECK(ParsePrintfFormat(&args, i), "Fail format string or type args!");
         }
     }
 
-    for (size_t i = 0; i < m_args_val.size(); i++) {
-        m_args_ptr.push_back((void *) &m_args_val[i]);
+    NativeCall::Cif *cif = native.GetCif(ctx, m_args_kind, count);
+    if(!cif) {
+        LOG_RUNTIME("Fail native call '%s'!", toString().c_str());
     }
 
-    NL_CHECK(!m_prototype->m_type_name.empty(), "Undefined return type '%s'", m_prototype->toString().c_str());
-
-    VALUE res_value;
-    ffi_type *result_ffi_type = nullptr;
+    // Часто вызываемая функция с фиксированным прототипом вызывается через переходник без ffi_call
+    if(cif->calls >= 0 && !cif->trampoline && ++cif->calls > NativeCall::TRAMPOLINE_THRESHOLD) {
+        cif->trampoline = JitCode::GetTrampoline(m_args_kind, count, NativeCall::KindFromType(native.result));
+        if(!cif->trampoline) {
+            cif->calls = -1;
+        }
+    }
 
-    ObjType type = ctx->BaseTypeFromString(m_prototype->m_type_name);
+    NativeCall::VALUE res_value;
+    res_value.integer = 0;
+    if(cif->trampoline) {
+        static_assert(sizeof (NativeCall::VALUE) == sizeof (int64_t), "Trampoline args must be 8 bytes");
+        (*cif->trampoline)(native.func, reinterpret_cast<const int64_t *> (m_args_val), &res_value.integer);
+    } else {
+        ctx->m_ffi_call(&cif->cif, FFI_FN(native.func), &res_value, m_args_ptr);
+    }
 
+    ObjType type = native.result;
     switch(type) {
+        case ObjType::None:
+            return Obj::CreateNone();
+
         case ObjType::Bool:
-            result_ffi_type = ctx->m_ffi_type_uint8;
-            break;
+            // Возвращаемый тип может быть как Byte, так и Bool
+            return Obj::CreateValue(static_cast<uint8_t> (res_value.integer), native.result_type);
 
         case ObjType::Int8:
         case ObjType::Char:
         case ObjType::Byte:
-            result_ffi_type = ctx->m_ffi_type_sint8;
-            break;
+            return Obj::CreateValue(static_cast<int8_t> (res_value.integer), type);
 
         case ObjType::Int16:
         case ObjType::Word:
-            result_ffi_type = ctx->m_ffi_type_sint16;
-            break;
+            return Obj::CreateValue(static_cast<int16_t> (res_value.integer), type);
 
         case ObjType::Int32:
         case ObjType::DWord:
-            result_ffi_type = ctx->m_ffi_type_sint32;
-            break;
+            return Obj::CreateValue(static_cast<int32_t> (res_value.integer), type);
 
         case ObjType::Int64:
         case ObjType::DWord64:
-            result_ffi_type = ctx->m_ffi_type_sint64;
-            break;
+            return Obj::CreateValue(res_value.integer, type);
 
         case ObjType::Float32:
         case ObjType::Single:
-            result_ffi_type = ctx->m_ffi_type_float;
-            break;
+            return Obj::CreateValue(static_cast<double> (res_value.single), type);
 
         case ObjType::Float64:
         case ObjType::Double:
-            result_ffi_type = ctx->m_ffi_type_double;
-            break;
+            return Obj::CreateValue(res_value.number, type);
 
-        case ObjType::Pointer:
         case ObjType::StrChar:
+            return Obj::CreateString(reinterpret_cast<const char *> (res_value.ptr));
+
         case ObjType::StrWide:
-            result_ffi_type = ctx->m_ffi_type_pointer;
-            break;
+            return Obj::CreateString(reinterpret_cast<const wchar_t *> (res_value.ptr));
 
-        case ObjType::None:
-            result_ffi_type = ctx->m_ffi_type_void;
-            break;
+        case ObjType::Pointer:
+        {
+            ObjPtr result = ctx->GetTypeFromString(m_prototype->m_type_name);
+            result->m_var = (void *) res_value.ptr;
+            result->m_var_is_init = true;
+            return result;
+        }
 
         default:
             LOG_RUNTIME("Native return type '%s' not implemented!", m_prototype->m_type_name.c_str());
     }
 
-    //    ASSERT(ctx->m_func_abi == FFI_DEFAULT_ABI); // Нужны другие типы вызовов ???
-    if(ctx->m_ffi_prep_cif(&m_cif, FFI_DEFAULT_ABI, static_cast<unsigned int> (m_args_type.size()), result_ffi_type, m_args_type.data()) == FFI_OK) {
-
-        ctx->m_ffi_call(&m_cif, FFI_FN(func_ptr), &res_value, m_args_ptr.data());
-
-        if(result_ffi_type == ctx->m_ffi_type_void) {
-            return Obj::CreateNone();
-        } else if(result_ffi_type == ctx->m_ffi_type_uint8) {
-            // Возвращаемый тип может быть как Byte, так и Bool
-            return Obj::CreateValue(static_cast<uint8_t> (res_value.integer), typeFromString(m_prototype->m_type_name));
-        } else if(result_ffi_type == ctx->m_ffi_type_sint8) {
-            return Obj::CreateValue(static_cast<int8_t> (res_value.integer), type);
-        } else if(result_ffi_type == ctx->m_ffi_type_sint16) {
-            return Obj::CreateValue(static_cast<int16_t> (res_value.integer), type);
-        } else if(result_ffi_type == ctx->m_ffi_type_sint32) {
-            return Obj::CreateValue(static_cast<int32_t> (res_value.integer), type);
-        } else if(result_ffi_type == ctx->m_ffi_type_sint64) {
-            return Obj::CreateValue(res_value.integer, type);
-        } else if(result_ffi_type == ctx->m_ffi_type_float) {
-            return Obj::CreateValue(res_value.number, type);
-        } else if(result_ffi_type == ctx->m_ffi_type_double) {
-            return Obj::CreateValue(res_value.number, type);
-        } else if(result_ffi_type == ctx->m_ffi_type_pointer) {
-            if(type == ObjType::StrChar) {
-                return Obj::CreateString(reinterpret_cast<const char *> (res_value.ptr));
-            } else if(type == ObjType::StrWide) {
-                return Obj::CreateString(reinterpret_cast<const wchar_t *> (res_value.ptr));
-            } else if(type == ObjType::Pointer) {
-                ObjPtr result = ctx->GetTypeFromString(m_prototype->m_type_name);
-                result->m_var = (void *) res_value.ptr;
-                result->m_var_is_init = true;
-                return result;
-            } else {
-                LOG_RUNTIME("Error result type '%s' or not implemented!", m_prototype->m_type_name.c_str());
-            }
-        } else {
-            LOG_RUNTIME("Native return type '%s' not implemented!", m_prototype->m_type_name.c_str());
-        }
-    }
-
-    LOG_RUNTIME("Fail native call '%s'!", toString().c_str());
-
     return Obj::CreateNone();
 
 
@@ -2592,6 +2961,103 @@ bool newlang::ParsePrintfFormat(Obj *args, int start) {
  * 
  */
 
+namespace {
+
+    /*
+     * Скалярное значение элемента с проверкой диапазона, как при создании тензора torch::full.
+     */
+    template <typename T>
+    T GetTensorItemValue(const Obj &item, int64_t index) {
+        if(item.is_integral()) {
+            int64_t value = item.GetValueAsInteger();
+            if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value) {
+                if(value < static_cast<int64_t> (std::numeric_limits<T>::min()) || value > static_cast<int64_t> (std::numeric_limits<T>::max())) {
+                    LOG_RUNTIME("Value %ld at index %ld cannot be converted to type %s without overflow!",
+                            value, index, newlang::toString(fromTorchType(c10::CppTypeToScalarType<T>::value)));
+                }
+            }
+            return static_cast<T> (value);
+        }
+        ASSERT(item.is_floating());
+        return static_cast<T> (item.GetValueAsNumber());
+    }
+
+    template <typename T>
+    void WriteTensorItems(const Obj &dict, const std::vector<int64_t> &offsets, torch::Tensor &to) {
+        T *ptr = to.data_ptr<T>();
+        ASSERT(ptr);
+        at::parallel_for(0, dict.size(), TENSOR_BUILD_GRAIN, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; i++) {
+                const Obj &item = *dict.at(i).second;
+                if(item.is_scalar()) {
+                    ptr[offsets[i]] = GetTensorItemValue<T>(item, i);
+                } else {
+                    to.narrow(0, offsets[i], offsets[i + 1] - offsets[i]).copy_(item.m_tensor.reshape({-1}));
+                }
+            }
+        });
+    }
+
+}
+
+void newlang::ConvertDictToTensor(const Obj &from, torch::Tensor &to, ObjType type) {
+    if(!from.size()) {
+        LOG_RUNTIME("Fail convert empty dictionary to tensor!");
+    }
+
+    // Смещение каждого элемента в одномерном тензоре результата
+    std::vector<int64_t> offsets(from.size() + 1, 0);
+    for (int64_t i = 0; i < from.size(); i++) {
+        const ObjPtr &item = from.at(i).second;
+        if(!item) {
+            LOG_RUNTIME("Fail convert nullptr to tensor at index %ld!", i);
+        }
+        if(item->is_scalar()) {
+            ASSERT(!item->m_tensor.defined());
+            offsets[i + 1] = offsets[i] + 1;
+        } else {
+            ASSERT(item->m_tensor.defined());
+            offsets[i + 1] = offsets[i] + item->m_tensor.numel();
+        }
+    }
+
+    to = torch::empty({offsets.back()}, toTorchType(type));
+
+    switch(to.scalar_type()) {
+        case at::ScalarType::Bool:
+            WriteTensorItems<bool>(from, offsets, to);
+            return;
+        case at::ScalarType::Char:
+            WriteTensorItems<int8_t>(from, offsets, to);
+            return;
+        case at::ScalarType::Short:
+            WriteTensorItems<int16_t>(from, offsets, to);
+            return;
+        case at::ScalarType::Int:
+            WriteTensorItems<int32_t>(from, offsets, to);
+            return;
+        case at::ScalarType::Long:
+            WriteTensorItems<int64_t>(from, offsets, to);
+            return;
+        case at::ScalarType::Float:
+            WriteTensorItems<float>(from, offsets, to);
+            return;
+        case at::ScalarType::Double:
+            WriteTensorItems<double>(from, offsets, to);
+            return;
+        default:
+            // Остальные типы поэлементно
+            for (int64_t i = 0; i < from.size(); i++) {
+                const Obj &item = *from.at(i).second;
+                if(item.is_scalar()) {
+                    to[offsets[i]].fill_(item.is_integral() ? at::Scalar(item.GetValueAsInteger()) : at::Scalar(item.GetValueAsNumber()));
+                } else {
+                    to.narrow(0, offsets[i], offsets[i + 1] - offsets[i]).copy_(item.m_tensor.reshape({-1}));
+                }
+            }
+    }
+}
+
 void newlang::ConvertStringToTensor(const std::string &from, torch::Tensor &to, ObjType type) {
     if(from.empty()) {
         LOG_RUNTIME("Fail convert empty string to tensor!");
@@ -2702,6 +3168,15 @@ void newlang::ConvertTensorToDict(const torch::Tensor &from, Obj &to, std::vecto
  * Dict -> Tensor
  */
 void Obj::toType_(ObjType type) {
+    if(m_var_type_current == ObjType::ViewChar && type != ObjType::ViewChar && type != ObjType::Any) {
+        // Данные копируются из нативной памяти в обычную строку
+        m_value = GetValueAsString();
+        m_var = at::monostate();
+        m_var_type_current = ObjType::StrChar;
+        if(m_var_type_fixed == ObjType::ViewChar) {
+            m_var_type_fixed = ObjType::StrChar;
+        }
+    }
     if(m_var_type_current == type || type == ObjType::Any || (is_string_char_type() && isString(type))) {
         return;
     } else if(type == ObjType::None) {
@@ -2922,47 +3397,9 @@ void Obj::toType_(ObjType type) {
         ObjType summary_type = getSummaryTensorType(this, ObjType::None);
 
         /*
-         * Создается итоговый тензор требуемого типа и в него последоватльно добаляются все элементы словаря.
+         * Итоговый тензор требуемого типа создается сразу и элементы словаря записываются в него по порядку.
          */
-        torch::Dtype summary_torch_type = toTorchType(static_cast<ObjType> (summary_type));
-        if(at(0).second->is_scalar()) {
-            if(at(0).second->is_integral()) {
-                m_tensor = torch::full({1}, at(0).second->GetValueAsInteger(), summary_torch_type);
-            } else {
-                if(!at(0).second->is_floating()) {
-                    ASSERT(at(0).second->is_floating());
-                }
-                m_tensor = torch::full({1}, at(0).second->GetValueAsNumber(), summary_torch_type);
-            }
-        } else {
-            m_tensor = at(0).second->m_tensor.toType(summary_torch_type);
-        }
-
-        for (int i = 1; i < size(); i++) {
-
-            ObjPtr temp = at(i).second;
-            if(!temp) {
-                LOG_RUNTIME("Fail convert nullptr to tensor at index %d!", i);
-            }
-
-            torch::Tensor temp_tensor;
-            if(temp->is_scalar()) {
-                ASSERT(!temp->m_tensor.defined());
-                if(temp->is_integral()) {
-                    temp_tensor = torch::full({1}, temp->GetValueAsInteger(), summary_torch_type);
-                } else {
-                    if(!temp->is_floating()) {
-                        ASSERT(temp->is_floating());
-                    }
-                    temp_tensor = torch::full({1}, temp->GetValueAsNumber(), summary_torch_type);
-                }
-            } else {
-                ASSERT(temp->m_tensor.defined());
-                temp_tensor = temp->m_tensor.toType(summary_torch_type);
-            }
-
-            m_tensor = torch::cat({m_tensor, temp_tensor});
-        }
+        ConvertDictToTensor(*this, m_tensor, summary_type);
 
         Variable::clear_();
 
@@ -2995,7 +3432,7 @@ void Obj::toType_(ObjType type) {
 
 ObjPtr Obj::CreateBaseType(ObjType type) {
 
-    ObjPtr result = std::make_shared<Obj>(ObjType::Type);
+    ObjPtr result = MakeRef<Obj>(ObjType::Type);
     result->m_class_name = newlang::toString(type);
     result->m_var_type_fixed = type;
 
@@ -3014,6 +3451,28 @@ ObjPtr Obj::CreateBaseType(ObjType type) {
     return result;
 }
 
+/*
+ * Указатель на нативные данные, например, результат нативной функции с типом :Pointer
+ */
+bool Obj::IsNativeData(const Obj &obj) {
+    return !obj.is_function_type() && obj.m_var_type_fixed == ObjType::Pointer
+            && at::holds_alternative<void *>(obj.m_var) && at::get<void *>(obj.m_var);
+}
+
+/*
+ * Нативная функция с одним аргументом для освобождения памяти, например, free
+ */
+std::function<void(void *)> Obj::NativeRelease(const Obj &func) {
+    if(func.m_var_type_current != ObjType::NativeFunc || !at::holds_alternative<void *>(func.m_var) || !at::get<void *>(func.m_var)) {
+        LOG_RUNTIME("Native release function expected '%s'!", func.toString().c_str());
+    }
+    typedef void ReleaseType(void *);
+    ReleaseType *release = reinterpret_cast<ReleaseType *> (at::get<void *>(func.m_var));
+    return [release](void *ptr) {
+        (*release)(ptr);
+    };
+}
+
 ObjPtr Obj::BaseTypeConstructor(const Context *ctx, Obj & args) {
 
     if(args.empty() || !args[0].second) {
@@ -3041,6 +3500,13 @@ ObjPtr Obj::BaseTypeConstructor(const Context *ctx, Obj & args) {
     } else if(args[0].second->m_var_type_fixed == ObjType::Error || args[0].second->m_var_type_fixed == ObjType::ErrorParser
             || args[0].second->m_var_type_fixed == ObjType::ErrorRunTime || args[0].second->m_var_type_fixed == ObjType::ErrorSignal) {
         result = ConstructorError_(ctx, args);
+    } else if(args[0].second->m_var_type_fixed == ObjType::ViewChar && (args.size() == 2 || args.size() == 3)) {
+        // :ViewChar[Размер](указатель, release)
+        ObjPtr dims = args[0].second->m_dimensions;
+        NL_CHECK(dims && dims->size() == 1, "Native byte string requires one dimension!");
+        NL_CHECK(IsNativeData(*args[1].second), "Native data pointer expected!");
+        result = CreateBytesView(at::get<void *>(args[1].second->m_var), (*dims)[0].second->GetValueAsInteger(),
+                args.size() == 3 ? NativeRelease(*args[2].second) : nullptr);
     } else if(args[0].second->m_var_type_fixed == ObjType::StrChar && args.size() > 1) {
         result = Obj::CreateString("");
         for (int i = 1; i < args.size(); i++) {
@@ -3097,6 +3563,13 @@ ObjPtr Obj::ConstructorSimpleType_(const Context *ctx, Obj & args) {
         }
     }
 
+    if(!dims.empty() && args.size() <= 3 && IsNativeData(*args[1].second)) {
+        // :Тип[Размерность](указатель, release) - нативные данные без копирования
+        ObjPtr view = CreateTensorView(at::get<void *>(args[1].second->m_var), result->m_var_type_fixed, dims,
+                args.size() == 3 ? NativeRelease(*args[2].second) : nullptr);
+        view->m_var_type_fixed = result->m_var_type_fixed;
+        return view;
+    }
 
     if(args.size() == 2) {
         // Передано единственное значение (нулевой аргумент - сам объект, т.е. :Тип(Значение) )
@@ -5,6 +5,7 @@
 #include <pch.h>
 
 #include <types.h>
+#include <jit.h>
 #include <variable.h>
 #include <rational.h>
 
@@ -75,6 +76,13 @@ namespace newlang {
 
     /* Для конвертирования словаря в тензор для вывода общего типа данных для всех элементов */
     ObjType getSummaryTensorType(Obj *obj, ObjType start);
+    /*
+     * Одномерный тензор типа type из элементов словаря (скаляры и тензоры требуемого типа).
+     * Размер определяется за один проход, после чего элементы записываются в непрерывный буфер
+     * (параллельно для словарей больше TENSOR_BUILD_GRAIN элементов).
+     */
+    static const int64_t TENSOR_BUILD_GRAIN = 1 << 14;
+    void ConvertDictToTensor(const Obj &from, torch::Tensor &to, ObjType type);
     void ConvertStringToTensor(const std::string &from, torch::Tensor &to, ObjType type = ObjType::None);
     void ConvertStringToTensor(const std::wstring &from, torch::Tensor &to, ObjType type = ObjType::None);
     void ConvertTensorToString(const torch::Tensor &from, std::string &to, std::vector<Index> *index = nullptr);
@@ -190,8 +198,7 @@ namespace newlang {
         friend class Obj;
         friend class Variable<Obj>;
         friend class Context;
-        friend class Variable<Context, std::weak_ptr<Context>>;
-
+        
         enum class IterCmp : int8_t {
             No = static_cast<int8_t> (ObjType::None), /* skip data */
             Yes = static_cast<int8_t> (ObjType::Iterator), /* return data */
@@ -219,7 +226,7 @@ namespace newlang {
          * @param obj
          * @param find_key
          */
-        explicit Iterator(std::shared_ptr<T> obj, const char * find_key = "(.|\\n)*") :
+        explicit Iterator(Ref<T> obj, const char * find_key = "(.|\\n)*") :
         Iterator(obj, &CompareFuncDefault, reinterpret_cast<T *> (const_cast<char *> (find_key)), static_cast<void *> (this)) {
         }
 
@@ -230,8 +237,8 @@ namespace newlang {
          * @param arg
          * @param extra
          */
-        Iterator(std::shared_ptr<T> obj, CompareFuncType *func, T *arg, void * extra = nullptr) :
-        m_iter_obj(obj), m_match(), m_func(func), m_func_args(arg), m_func_extra(extra), m_found(m_iter_obj->begin()), m_base_filter(nullptr) {
+        Iterator(Ref<T> obj, CompareFuncType *func, T *arg, void * extra = nullptr) :
+        m_iter_obj(obj), m_match(), m_func(func), m_func_args(arg), m_func_extra(extra), m_found(0), m_base_filter(nullptr) {
             search_loop();
         }
 
@@ -240,13 +247,13 @@ namespace newlang {
         }
 
         SCOPE(private) :
-        std::shared_ptr<T> m_iter_obj;
+        Ref<T> m_iter_obj;
         std::regex m_match;
         std::string m_filter;
         CompareFuncType *m_func;
         T *m_func_args;
         void *m_func_extra;
-        mutable typename Variable<T>::iterator m_found;
+        mutable int64_t m_found; ///< Позиция текущего элемента (END_POS после последнего)
         const char * m_base_filter;
 
         static const IterPairType m_interator_end;
@@ -292,15 +299,15 @@ namespace newlang {
 
         iterator end() {
             Iterator<T> copy(*this);
-            copy.m_found = copy.m_iter_obj->end();
+            copy.m_found = END_POS;
             return copy;
         }
 
         inline const IterPairType &data() {
-            if (m_found == m_iter_obj->end()) {
+            if (is_end()) {
                 return m_interator_end;
             }
-            return *m_found;
+            return found();
         }
 
         inline const IterPairType &operator*() {
@@ -308,10 +315,10 @@ namespace newlang {
         }
 
         inline const IterPairType &data() const {
-            if (m_found == m_iter_obj->end()) {
+            if (is_end()) {
                 return m_interator_end;
             }
-            return *m_found;
+            return found();
         }
 
         inline const IterPairType &operator*() const {
@@ -321,7 +328,7 @@ namespace newlang {
         ObjPtr read_and_next(int64_t count);
 
         const iterator &operator++() const {
-            if (m_found != m_iter_obj->end()) {
+            if (!is_end()) {
                 m_found++;
                 search_loop();
             }
@@ -341,20 +348,36 @@ namespace newlang {
         }
 
         inline void reset() {
-            m_found = m_iter_obj->begin();
+            m_found = 0;
             search_loop();
         }
 
 
     protected:
 
+        /*
+         * Позиция вместо итератора списка остается корректной при добавлении элементов во время обхода
+         */
+        constexpr static int64_t END_POS = -1;
+
+        inline bool is_end() const {
+            if (m_found != END_POS && m_found >= m_iter_obj->end() - m_iter_obj->begin()) {
+                m_found = END_POS;
+            }
+            return m_found == END_POS;
+        }
+
+        inline IterPairType & found() const {
+            return *(m_iter_obj->begin() + m_found);
+        }
+
         void search_loop() const {
-            while (m_found != m_iter_obj->end()) {
+            while (!is_end()) {
                 IterCmp result = IterCmp::Yes;
                 if (m_func) {
-                    result = (*m_func)(*m_found, m_func_args, m_func_extra);
+                    result = (*m_func)(found(), m_func_args, m_func_extra);
                     if (result == IterCmp::End) {
-                        m_found = m_iter_obj->end();
+                        m_found = END_POS;
                     }
                 }
                 if (result != IterCmp::No) {
@@ -370,7 +393,7 @@ namespace newlang {
      * 
      * 
      */
-    class Obj : protected Variable<Obj>, public std::enable_shared_from_this<Obj> {
+    class Obj : protected Variable<Obj>, public RefCounted {
     public:
 
         //    constexpr static const char * BUILDIN_TYPE = "__var_type__";
@@ -387,6 +410,8 @@ namespace newlang {
             m_check_args = false;
             m_dimensions = nullptr;
             m_is_reference = false;
+            m_is_shared = false;
+            m_jit_hot = 0;
             m_var_type_fixed = fixed;
             m_var_is_init = init;
             m_is_const = false;
@@ -425,11 +450,10 @@ namespace newlang {
         }
 
         inline ObjPtr shared() {
-            try {
-                return shared_from_this();
-            } catch (std::bad_weak_ptr &err) {
-                LOG_RUNTIME("Exception thrown bad_weak_ptr! %s", err.what());
+            if (!is_ref_heap()) {
+                LOG_RUNTIME("Object '%s' was not created with MakeRef!", m_var_name.c_str());
             }
+            return ObjPtr(this);
         }
 
         ObjPtr MakeConst() {
@@ -797,6 +821,9 @@ namespace newlang {
 
         PairType & push_back(const PairType & p) {
             if (is_indexing()) {
+                if (p.second && p.second->m_is_shared) {
+                    return Variable::push_back(p.second->CloneShared(), p.first);
+                }
                 return Variable::push_back(p);
             }
             LOG_RUNTIME("Operator push_back for object type %s not implemented!", newlang::toString(m_var_type_current));
@@ -804,6 +831,9 @@ namespace newlang {
 
         PairType & push_back(const Type value, const std::string &name = "") {
             if (is_indexing()) {
+                if (value && value->m_is_shared) {
+                    return Variable::push_back(value->CloneShared(), name);
+                }
                 return Variable::push_back(value, name);
             }
             LOG_RUNTIME("Operator push_back for object type %s not implemented!", newlang::toString(m_var_type_current));
@@ -921,6 +951,7 @@ namespace newlang {
 
         ObjPtr operator++() {
             if (is_tensor_type()) {
+                DetachTensor_();
                 m_tensor.add_(torch::ones_like(m_tensor));
 
                 return shared();
@@ -940,6 +971,7 @@ namespace newlang {
 
         ObjPtr operator--() {
             if (is_tensor_type()) {
+                DetachTensor_();
                 m_tensor.sub_(torch::ones_like(m_tensor));
                 return shared();
             }
@@ -956,7 +988,9 @@ namespace newlang {
 
         inline ObjPtr operator*(ObjPtr obj) {
             ASSERT(obj);
-            return operator*(*obj);
+            ObjPtr result = Clone();
+            result->operator*=(obj);
+            return result;
         }
 
         inline ObjPtr operator*(Obj value) {
@@ -1020,7 +1054,9 @@ namespace newlang {
 
         inline ObjPtr operator+(ObjPtr obj) {
             ASSERT(obj);
-            return operator+(*obj);
+            ObjPtr result = Clone();
+            result->operator+=(obj);
+            return result;
         }
 
         inline ObjPtr operator+(Obj value) {
@@ -1031,7 +1067,9 @@ namespace newlang {
 
         inline ObjPtr operator-(ObjPtr obj) {
             ASSERT(obj);
-            return operator-(*obj);
+            ObjPtr result = Clone();
+            result->operator-=(obj);
+            return result;
         }
 
         inline ObjPtr operator-(Obj value) {
@@ -1054,6 +1092,10 @@ namespace newlang {
 
         inline bool operator<(ObjPtr obj) {
             ASSERT(obj);
+            int cmp;
+            if (op_compare_scalar(*obj, cmp)) {
+                return cmp < 0;
+            }
             return operator<(*obj);
         }
 
@@ -1063,6 +1105,10 @@ namespace newlang {
 
         inline bool operator<=(ObjPtr obj) {
             ASSERT(obj);
+            int cmp;
+            if (op_compare_scalar(*obj, cmp)) {
+                return cmp <= 0;
+            }
             return operator<=(*obj);
         }
 
@@ -1072,6 +1118,10 @@ namespace newlang {
 
         inline bool operator>(ObjPtr obj) {
             ASSERT(obj);
+            int cmp;
+            if (op_compare_scalar(*obj, cmp)) {
+                return cmp > 0;
+            }
             return operator>(*obj);
         }
 
@@ -1081,6 +1131,10 @@ namespace newlang {
 
         inline bool operator>=(ObjPtr obj) {
             ASSERT(obj);
+            int cmp;
+            if (op_compare_scalar(*obj, cmp)) {
+                return cmp >= 0;
+            }
             return operator>=(*obj);
         }
 
@@ -1089,6 +1143,66 @@ namespace newlang {
         }
         int op_compare(Obj & value);
 
+        /*
+         * Сравнение пары скаляров int64/double без копирования операнда.
+         * Возвращает false, если сравнение нужно выполнять в общем случае (op_compare).
+         */
+        inline bool op_compare_scalar(const Obj &value, int &result) const {
+            if (this == &value || !is_scalar() || !value.is_scalar()) {
+                return false;
+            }
+            const bool l_int = is_integral() && at::holds_alternative<int64_t>(m_var);
+            const bool r_int = value.is_integral() && at::holds_alternative<int64_t>(value.m_var);
+            if (l_int && r_int) {
+                const int64_t left = at::get<int64_t>(m_var);
+                const int64_t right = at::get<int64_t>(value.m_var);
+                result = left < right ? -1 : (left > right ? 1 : 0);
+                return true;
+            }
+            const bool l_dbl = !l_int && is_floating() && at::holds_alternative<double>(m_var);
+            const bool r_dbl = !r_int && value.is_floating() && at::holds_alternative<double>(value.m_var);
+            if ((l_int || l_dbl) && (r_int || r_dbl)) {
+                const double left = l_int ? static_cast<double> (at::get<int64_t>(m_var)) : at::get<double>(m_var);
+                const double right = r_int ? static_cast<double> (at::get<int64_t>(value.m_var)) : at::get<double>(value.m_var);
+                result = left < right ? -1 : (left > right ? 1 : 0);
+                return true;
+            }
+            return false;
+        }
+
+        /*
+         * Арифметика с присвоением для пары скаляров int64/double без копирования операнда
+         * и без общих проверок типов. Результат совпадает с operator+=(Obj) и т.д.
+         * Возвращает false для фиксированного типа, тензоров или переполнения, 
+         * тогда операция выполняется в общем случае.
+         */
+        template <typename I, typename D>
+        inline bool op_scalar_(const Obj &value, I int_op, D dbl_op) {
+            if (m_var_type_fixed != ObjType::None || !is_scalar() || !value.is_scalar()) {
+                return false;
+            }
+            const bool l_int = is_integral() && at::holds_alternative<int64_t>(m_var);
+            const bool r_int = value.is_integral() && at::holds_alternative<int64_t>(value.m_var);
+            if (l_int && r_int) {
+                int64_t result;
+                if (int_op(at::get<int64_t>(m_var), at::get<int64_t>(value.m_var), &result)) {
+                    return false;
+                }
+                m_var = result;
+                m_var_type_current = typeFromLimit(result);
+                return true;
+            }
+            const bool l_dbl = !l_int && is_floating() && at::holds_alternative<double>(m_var);
+            const bool r_dbl = !r_int && value.is_floating() && at::holds_alternative<double>(value.m_var);
+            if ((l_int || l_dbl) && (r_int || r_dbl)) {
+                m_var = dbl_op(l_int ? static_cast<double> (at::get<int64_t>(m_var)) : at::get<double>(m_var),
+                        r_int ? static_cast<double> (at::get<int64_t>(value.m_var)) : at::get<double>(value.m_var));
+                m_var_type_current = ObjType::Float64;
+                return true;
+            }
+            return false;
+        }
+
         /*
          *  instanceof (проверка класса объекта) test_obj ~~ obj  объекты совместимы по свойствим и их типам (утиная типизация)
          *  in (проверка существования свойства)  test_obj ~~ (prop=,) объект содержит указанные свойства (т.к. пустой тип совместим с любым типом)
@@ -1114,6 +1228,10 @@ namespace newlang {
 
         inline bool op_equal(ObjPtr value) {
             ASSERT(value);
+            int cmp;
+            if (value && op_compare_scalar(*value, cmp)) {
+                return cmp == 0;
+            }
             if (value) {
                 return op_equal(*value);
             }
@@ -1204,6 +1322,13 @@ namespace newlang {
             if (!obj) {
                 ASSERT(obj);
             }
+            if (op_scalar_(*obj,[](int64_t a, int64_t b, int64_t * r) {
+                    return __builtin_mul_overflow(a, b, r);
+                }, [](double a, double b) {
+                    return a * b;
+                })) {
+                return shared();
+            }
             return operator*=(*obj);
         }
 
@@ -1232,12 +1357,26 @@ namespace newlang {
 
         inline ObjPtr operator+=(ObjPtr obj) {
             ASSERT(obj);
+            if (op_scalar_(*obj,[](int64_t a, int64_t b, int64_t * r) {
+                    return __builtin_add_overflow(a, b, r);
+                }, [](double a, double b) {
+                    return a + b;
+                })) {
+                return shared();
+            }
             return operator+=(*obj);
         }
         ObjPtr operator+=(Obj obj);
 
         inline ObjPtr operator-=(ObjPtr obj) {
             ASSERT(obj);
+            if (op_scalar_(*obj,[](int64_t a, int64_t b, int64_t * r) {
+                    return __builtin_sub_overflow(a, b, r);
+                }, [](double a, double b) {
+                    return a - b;
+                })) {
+                return shared();
+            }
             return operator-=(*obj);
         }
         ObjPtr operator-=(Obj obj);
@@ -1596,7 +1735,14 @@ namespace newlang {
 
         static ObjPtr CreateType(ObjType type, ObjType fixed = ObjType::None, bool is_init = false) {
 
-            return std::make_shared<Obj>(type, nullptr, nullptr, fixed, is_init);
+            return MakeRef<Obj>(type, nullptr, nullptr, fixed, is_init);
+        }
+
+        static ObjPtr CreateRational(const Rational &val) {
+            ObjPtr obj = Obj::CreateType(ObjType::Rational);
+            obj->m_rational = val;
+            obj->m_var_is_init = true;
+            return obj;
         }
 
         static ObjPtr CreateRational(const std::string val) {
@@ -1621,7 +1767,7 @@ namespace newlang {
                 // Знаменатель - правая часть
                 obj->m_rational.set_(str.substr(0, pos), str.substr(pos + 1, str.length()));
                 // Знаменатель не должен быть равен нулю
-                if (obj->m_rational.m_denominator.isZero()) {
+                if (obj->m_rational.isDenominatorZero()) {
                     LOG_RUNTIME("Denominator must be different from zero!");
                 }
             }
@@ -1650,6 +1796,9 @@ namespace newlang {
         static ObjPtr ConstructorReturn_(const Context *ctx, Obj & args);
         static ObjPtr ConstructorInterraption_(const Context *ctx, Obj & args, ObjType type);
 
+        static bool IsNativeData(const Obj &obj);
+        static std::function<void(void *)> NativeRelease(const Obj &func);
+
         static ObjPtr CreateBaseType(ObjType type);
 
         static ObjPtr CreateNone() {
@@ -1882,20 +2031,84 @@ namespace newlang {
             return result;
         }
 
-        inline static ObjPtr Yes() {
-            ObjPtr result = std::make_shared<Obj>(ObjType::Bool);
-            result->m_var = static_cast<int64_t> (1);
-            result->m_var_is_init = true;
+        /*
+         * Представление нативных данных (результата нативной функции или глобальной переменной)
+         * в виде тензора или байтовой строки (ViewChar) без копирования. Объект ссылается на память ptr,
+         * а функция release (если указана) вызывается после удаления последнего объекта, который
+         * использует эту память. Копия объекта (Clone) содержит собственные данные.
+         */
+        static ObjPtr CreateTensorView(void *ptr, ObjType type, const std::vector<int64_t> &shape, std::function<void(void *)> release = nullptr);
+        static ObjPtr CreateBytesView(void *ptr, int64_t size, std::function<void(void *)> release = nullptr);
+
+        /*
+         * Общие для всего процесса неизменяемые объекты None, true, false и малых целых чисел.
+         * Они создаются один раз и не изменяются, поэтому при помещении в словарь
+         * и перед изменением на месте заменяются своей копией (CopyOnWrite).
+         */
+        constexpr static int64_t SHARED_INT_MIN = -128;
+        constexpr static int64_t SHARED_INT_MAX = 1023;
+
+        inline static void CopyOnWrite(ObjPtr &obj) {
+            if (obj && obj->m_is_shared) {
+                obj = obj->CloneShared();
+            }
+        }
 
-            return result->MakeConst();
+        /*
+         * Копия общего объекта. Общие объекты отмечены как константы,
+         * а их копия принадлежит вызывающей стороне и может изменяться.
+         */
+        inline ObjPtr CloneShared() const {
+            ObjPtr clone = Clone();
+            clone->m_is_const = false;
+            return clone;
+        }
+
+        inline static ObjPtr None() {
+            static const ObjPtr none = MakeShared(CreateNone()->MakeConst());
+            return none;
+        }
+
+        inline static ObjPtr Yes() {
+            static const ObjPtr yes = []() {
+                ObjPtr result = MakeRef<Obj>(ObjType::Bool);
+                result->m_var = static_cast<int64_t> (1);
+                result->m_var_is_init = true;
+                return MakeShared(result->MakeConst());
+            }();
+            return yes;
         }
 
         inline static ObjPtr No() {
-            ObjPtr result = std::make_shared<Obj>(ObjType::Bool);
-            result->m_var = static_cast<int64_t> (0);
-            result->m_var_is_init = true;
+            static const ObjPtr no = []() {
+                ObjPtr result = MakeRef<Obj>(ObjType::Bool);
+                result->m_var = static_cast<int64_t> (0);
+                result->m_var_is_init = true;
+                return MakeShared(result->MakeConst());
+            }();
+            return no;
+        }
 
-            return result->MakeConst();
+        inline static ObjPtr SharedValue(int64_t value) {
+            if (value < SHARED_INT_MIN || value > SHARED_INT_MAX) {
+                return CreateValue(value, ObjType::None);
+            }
+            static const std::vector<ObjPtr> cache = []() {
+                std::vector<ObjPtr> result;
+                result.reserve(SHARED_INT_MAX - SHARED_INT_MIN + 1);
+                for (int64_t i = SHARED_INT_MIN; i <= SHARED_INT_MAX; i++) {
+                    result.push_back(MakeShared(CreateValue(i, ObjType::None)));
+                }
+                return result;
+            }();
+            return cache[value - SHARED_INT_MIN];
+        }
+
+        inline static ObjPtr MakeShared(ObjPtr obj) {
+            obj->m_is_shared = true;
+            // Общие объекты могут использоваться из разных потоков
+            obj->MakeRefAtomic();
+            return obj;
         }
 
         inline static ObjPtr CreateDict() {
@@ -1953,7 +2166,13 @@ namespace newlang {
         }
 
 
-        ObjPtr CallNative(Context *ctx, Obj args);
+        ObjPtr CallNative(Context *ctx, Obj &args);
+        /*
+         * Вызов нативной функции с позиционными аргументами без создания словаря параметров по прототипу (vm.h).
+         * Возвращает nullptr, если аргументы нужно обработать в Obj::Call (значения по умолчанию, многоточие,
+         * ссылки или ошибка приведения типа).
+         */
+        ObjPtr CallNativeDirect(Context *ctx, const ObjPtr *args, size_t count);
 
         ObjPtr Clone(const char *new_name = nullptr) const {
             ObjPtr clone = Obj::CreateNone();
@@ -1991,6 +2210,16 @@ namespace newlang {
         void CloneDataTo(Obj & clone) const;
         void ClonePropTo(Obj & clone) const;
 
+        /*
+         * Копия тензора (CloneDataTo) использует данные исходного объекта, пока один из них
+         * не изменит их на месте. Перед таким изменением объект получает собственную копию данных,
+         * если они используются еще где-то (копии объекта, представления из index_get).
+         * Данные нативной памяти (NativeData) всегда изменяются на месте, а копируются сразу.
+         */
+        torch::Tensor ShareTensor() const;
+        void DetachTensor_();
+        static std::string TensorStatInfo();
+
         inline ObjPtr toType(ObjType type) const {
             ObjPtr clone = Clone();
             clone->toType_(type);
@@ -2196,6 +2425,10 @@ namespace newlang {
                         //                            ASSERT(value->is_floating());
                         //                            m_var = value->GetValueAsNumber(); // Нужно считывать значение, т.к. может быть ссылка
                         //                        }
+                    } else if (at::holds_alternative<NativeData>(value->m_var)) {
+                        // Представление нативных данных (CreateTensorView) присваивается без копирования
+                        m_var = value->m_var;
+                        m_tensor = value->m_tensor;
                     } else {
                         m_tensor = value->m_tensor.clone();
                     }
@@ -2279,7 +2512,7 @@ namespace newlang {
 
                         m_var = at::monostate();
                         ASSERT(!m_tensor.defined());
-                        m_tensor = value->m_tensor.clone();
+                        m_tensor = value->ShareTensor();
 
                     } else if (!is_scalar() && value->is_scalar()) {
 
@@ -2294,7 +2527,16 @@ namespace newlang {
                     } else {
                         //  Продублировать значения тензора если они одинакового размера
                         if (m_tensor.sizes().equals(value->m_tensor.sizes())) {
-                            m_tensor = value->m_tensor.toType(m_tensor.scalar_type()).clone();
+                            if (at::holds_alternative<NativeData>(m_var)) {
+                                // Значения записываются в нативную память
+                                m_tensor.copy_(value->m_tensor);
+                            } else {
+                                if (value->m_tensor.scalar_type() == m_tensor.scalar_type()) {
+                                    m_tensor = value->ShareTensor();
+                                } else {
+                                    m_tensor = value->m_tensor.toType(m_tensor.scalar_type());
+                                }
+                            }
                         } else {
                             LOG_RUNTIME("Different sizes of tensors!");
                         }
@@ -2305,6 +2547,14 @@ namespace newlang {
 
             } else if ((is_none_type() || is_string_type()) && value->is_string_type()) {
 
+                if (is_none_type() && value->m_var_type_current == ObjType::ViewChar) {
+                    // Представление нативных данных (CreateBytesView) присваивается без копирования
+                    m_var = value->m_var;
+                    m_var_type_current = ObjType::ViewChar;
+                    m_var_is_init = true;
+                    return;
+                }
+
                 switch (m_var_type_current) {
                     case ObjType::None: // @todo Какой тип сроки по умолчанию? Пока байтовые
                     case ObjType::StrChar:
@@ -2425,6 +2675,11 @@ namespace newlang {
             Variable::remove(value);
         }
 
+        // Индекс имен нужно перестроить после изменения имен элементов по ссылке
+        void ResetIndex() {
+            Variable::ResetIndex();
+        }
+
         ObjType m_var_type_current; ///< Текущий тип значения объекта
         ObjType m_var_type_fixed; ///< Максимальный размер для арифметических типов, который задается разработчиком
         bool m_var_is_init; ///< Содержит ли объект корректное значение ???
@@ -2451,6 +2706,7 @@ namespace newlang {
         struct NativeData {
             void * ptr;
             int64_t size;
+            std::shared_ptr<void> hold; ///< Вызов release для ptr при удалении последнего представления (CreateBytesView)
         };
 
         at::variant < at::monostate, int64_t, double, void *, // None, скаляры и ссылки на функции (нужно различать чистые, обычные и нативные???)
@@ -2475,6 +2731,10 @@ namespace newlang {
 
         bool m_check_args; //< Проверять аргументы на корректность (для всех видов функций) @ref MakeArgs
 
+        int64_t m_jit_hot; ///< Количество вызовов и итераций циклов функции или -1, если функция не компилируется (jit.h)
+        JitCodePtr m_jit; ///< Машинный код функции
+        std::shared_ptr<NativeCall> m_native; ///< Подготовленный вызов нативной функции (libffi)
+
         /* Для будущей переделки системы типов и базового класса: 
          * Должен быть интерфейс с поддерживаемыми операциями для стандартных типов данных
          * и набор реализаций для скаляров, строк, тензоров, нативных функций, дробей, внутренних функций и т.д.
@@ -2483,6 +2743,7 @@ namespace newlang {
         //    SCOPE(protected) :
         bool m_is_const; //< Признак константы (по умолчанию изменения разрешено)
         bool m_is_reference; //< Признак ссылки на объект
+        bool m_is_shared; //< Общий для всего процесса неизменяемый объект (@ref CopyOnWrite)
     };
 
 } // namespace newlang
@@ -4,6 +4,7 @@
 
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <iosfwd>
 #include <memory>
 #include <vector>
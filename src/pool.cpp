@@ -0,0 +1,240 @@
+#include "pch.h"
+
+#include <atomic>
+#include <mutex>
+
+#include <pool.h>
+
+using namespace newlang;
+
+namespace {
+
+    struct FreeNode {
+        FreeNode *next;
+    };
+
+    /*
+     * Общие списки свободных элементов. Объект никогда не удаляется, т.к. память
+     * может освобождаться из деструкторов статических объектов при завершении процесса.
+     */
+    struct GlobalPool {
+        std::mutex mutex;
+        FreeNode * free_list[MemoryPool::CLASS_COUNT] = {};
+        size_t free_count[MemoryPool::CLASS_COUNT] = {};
+        std::vector<void *> slabs;
+    };
+
+    GlobalPool & Global() {
+        static GlobalPool *pool = new GlobalPool();
+        return *pool;
+    }
+
+    std::atomic<int64_t> g_live[MemoryPool::CLASS_COUNT];
+    std::atomic<int64_t> g_large_live;
+    std::atomic<int64_t> g_used_bytes;
+    std::atomic<int64_t> g_peak_bytes;
+    std::atomic<int64_t> g_slab_bytes;
+
+    /*
+     * Локальные списки потока без деструкторов, поэтому доступны всегда, в том числе
+     * при удалении объектов из деструкторов других thread_local и статических объектов.
+     */
+    thread_local FreeNode * t_free_list[MemoryPool::CLASS_COUNT];
+    thread_local size_t t_free_count[MemoryPool::CLASS_COUNT];
+    thread_local bool t_cache_closed;
+
+    void PutGlobal(size_t cls, FreeNode *head, FreeNode *tail, size_t count) {
+        GlobalPool &global = Global();
+        std::lock_guard<std::mutex> lock(global.mutex);
+        tail->next = global.free_list[cls];
+        global.free_list[cls] = head;
+        global.free_count[cls] += count;
+    }
+
+    /*
+     * Забрать из общего списка не более max элементов.
+     * Если свободных элементов нет, то выделяется новый блок памяти.
+     */
+    FreeNode * TakeGlobal(size_t cls, size_t max, size_t &count) {
+        GlobalPool &global = Global();
+        std::lock_guard<std::mutex> lock(global.mutex);
+
+        if(!global.free_list[cls]) {
+            const size_t node_size = (cls + 1) * MemoryPool::ALIGN;
+            const size_t slab_size = std::max(MemoryPool::SLAB_SIZE, node_size * 16);
+            char *slab = static_cast<char *> (::operator new(slab_size));
+            global.slabs.push_back(slab);
+            g_slab_bytes.fetch_add(slab_size, std::memory_order_relaxed);
+
+            FreeNode *head = nullptr;
+            for (size_t pos = slab_size / node_size; pos > 0; pos--) {
+                FreeNode *node = reinterpret_cast<FreeNode *> (slab + (pos - 1) * node_size);
+                node->next = head;
+                head = node;
+            }
+            global.free_list[cls] = head;
+            global.free_count[cls] = slab_size / node_size;
+        }
+
+        FreeNode *head = global.free_list[cls];
+        FreeNode *tail = head;
+        count = 1;
+        while (count < max && tail->next) {
+            tail = tail->next;
+            count++;
+        }
+        global.free_list[cls] = tail->next;
+        global.free_count[cls] -= count;
+        tail->next = nullptr;
+        return head;
+    }
+
+    void FlushCache() {
+        for (size_t cls = 0; cls < MemoryPool::CLASS_COUNT; cls++) {
+            if(t_free_list[cls]) {
+                FreeNode *tail = t_free_list[cls];
+                while (tail->next) {
+                    tail = tail->next;
+                }
+                PutGlobal(cls, t_free_list[cls], tail, t_free_count[cls]);
+                t_free_list[cls] = nullptr;
+                t_free_count[cls] = 0;
+            }
+        }
+    }
+
+    /*
+     * Возврат локальных списков в общий пул при завершении потока.
+     * После этого поток работает только с общими списками.
+     */
+    struct ThreadCacheGuard {
+        bool active = false;
+
+        ~ThreadCacheGuard() {
+            FlushCache();
+            t_cache_closed = true;
+        }
+    };
+
+    thread_local ThreadCacheGuard t_cache_guard;
+
+    void UpdateUsed(int64_t size) {
+        int64_t used = g_used_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        int64_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+        while (used > peak && !g_peak_bytes.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+        }
+    }
+
+}
+
+void * MemoryPool::Alloc(size_t size) {
+    if(size > MAX_SIZE) {
+        g_large_live.fetch_add(1, std::memory_order_relaxed);
+        UpdateUsed(size);
+        return ::operator new(size);
+    }
+
+    const size_t cls = SizeClass(size ? size : 1);
+    g_live[cls].fetch_add(1, std::memory_order_relaxed);
+    UpdateUsed((cls + 1) * ALIGN);
+
+    if(t_cache_closed) {
+        size_t count;
+        return TakeGlobal(cls, 1, count);
+    }
+
+    if(!t_free_list[cls]) {
+        t_cache_guard.active = true;
+        t_free_list[cls] = TakeGlobal(cls, CACHE_LIMIT, t_free_count[cls]);
+    }
+
+    FreeNode *node = t_free_list[cls];
+    t_free_list[cls] = node->next;
+    t_free_count[cls]--;
+    return node;
+}
+
+void MemoryPool::Free(void *ptr, size_t size) noexcept {
+    if(!ptr) {
+        return;
+    }
+    if(size > MAX_SIZE) {
+        g_large_live.fetch_sub(1, std::memory_order_relaxed);
+        g_used_bytes.fetch_sub(size, std::memory_order_relaxed);
+        ::operator delete(ptr);
+        return;
+    }
+
+    const size_t cls = SizeClass(size ? size : 1);
+    g_live[cls].fetch_sub(1, std::memory_order_relaxed);
+    g_used_bytes.fetch_sub((cls + 1) * ALIGN, std::memory_order_relaxed);
+
+    FreeNode *node = static_cast<FreeNode *> (ptr);
+    if(t_cache_closed) {
+        PutGlobal(cls, node, node, 1);
+        return;
+    }
+
+    if(!t_free_list[cls]) {
+        t_cache_guard.active = true;
+    }
+    node->next = t_free_list[cls];
+    t_free_list[cls] = node;
+    t_free_count[cls]++;
+
+    // Излишек возвращается в общий список, чтобы память могли использовать другие потоки
+    if(t_free_count[cls] > 2 * CACHE_LIMIT) {
+        FreeNode *tail = node;
+        for (size_t i = 1; i < CACHE_LIMIT; i++) {
+            tail = tail->next;
+        }
+        t_free_list[cls] = tail->next;
+        t_free_count[cls] -= CACHE_LIMIT;
+        PutGlobal(cls, node, tail, CACHE_LIMIT);
+    }
+}
+
+int64_t MemoryPool::GetLive(size_t size_class) {
+    if(size_class >= CLASS_COUNT) {
+        return g_large_live.load(std::memory_order_relaxed);
+    }
+    return g_live[size_class].load(std::memory_order_relaxed);
+}
+
+int64_t MemoryPool::GetUsedBytes() {
+    return g_used_bytes.load(std::memory_order_relaxed);
+}
+
+int64_t MemoryPool::GetPeakBytes() {
+    return g_peak_bytes.load(std::memory_order_relaxed);
+}
+
+int64_t MemoryPool::GetSlabBytes() {
+    return g_slab_bytes.load(std::memory_order_relaxed);
+}
+
+std::string MemoryPool::StatInfo() {
+#if NL_POOL_ALLOCATOR
+    std::string result("Pool used: ");
+    result += std::to_string(GetUsedBytes());
+    result += ", peak: ";
+    result += std::to_string(GetPeakBytes());
+    result += ", slabs: ";
+    result += std::to_string(GetSlabBytes());
+    result += ", live objects by size:";
+    for (size_t cls = 0; cls < CLASS_COUNT; cls++) {
+        int64_t live = GetLive(cls);
+        if(live) {
+            result += " ";
+            result += std::to_string((cls + 1) * ALIGN);
+            result += "=";
+            result += std::to_string(live);
+        }
+    }
+    result += " large=";
+    result += std::to_string(GetLive(CLASS_COUNT));
+    return result;
+#else
+    return "Pool allocator disabled";
+#endif
+}
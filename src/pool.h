@@ -0,0 +1,92 @@
+#pragma once
+#ifndef INCLUDED_NEWLANG_POOL_
+#define INCLUDED_NEWLANG_POOL_
+
+#include "pch.h"
+
+/*
+ * Пул памяти для часто создаваемых и удаляемых объектов (Obj, Term), буферов элементов Variable
+ * и узлов списка VariableList (контекст).
+ * При сборке с -DNL_POOL_ALLOCATOR=0 используется системный распределитель памяти.
+ */
+#ifndef NL_POOL_ALLOCATOR
+#define NL_POOL_ALLOCATOR 1
+#endif
+
+namespace newlang {
+
+    /*
+     * Память выделяется блоками (slab) и делится на элементы одного размера для каждого
+     * класса размеров (кратно ALIGN байт, но не более MAX_SIZE). Освобожденные элементы попадают
+     * в локальный список потока и повторно используются без блокировок. При переполнении
+     * локального списка или при завершении потока элементы возвращаются в общий список.
+     * Память блоков системе не возвращается до завершения процесса.
+     * Запросы больше MAX_SIZE передаются системному распределителю.
+     */
+    class MemoryPool {
+    public:
+
+        constexpr static size_t ALIGN = 16;
+        constexpr static size_t MAX_SIZE = 2048;
+        constexpr static size_t CLASS_COUNT = MAX_SIZE / ALIGN;
+        constexpr static size_t SLAB_SIZE = 64 * 1024;
+        constexpr static size_t CACHE_LIMIT = 256;
+
+        static void * Alloc(size_t size);
+        static void Free(void *ptr, size_t size) noexcept;
+
+        static inline size_t SizeClass(size_t size) {
+            return (size + ALIGN - 1) / ALIGN - 1;
+        }
+
+        // Статистика использования
+        static int64_t GetLive(size_t size_class);
+        static int64_t GetUsedBytes();
+        static int64_t GetPeakBytes();
+        static int64_t GetSlabBytes();
+        static std::string StatInfo();
+    };
+
+#if NL_POOL_ALLOCATOR
+
+    template <typename T>
+    class PoolAllocator {
+    public:
+        typedef T value_type;
+
+        PoolAllocator() noexcept = default;
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &) noexcept {
+        }
+
+        T * allocate(size_t count) {
+            static_assert(alignof (T) <= MemoryPool::ALIGN, "Unsupported alignment for pool allocator");
+            return static_cast<T *> (MemoryPool::Alloc(count * sizeof (T)));
+        }
+
+        void deallocate(T *ptr, size_t count) noexcept {
+            MemoryPool::Free(ptr, count * sizeof (T));
+        }
+    };
+
+    template <typename T, typename U>
+    inline bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) noexcept {
+        return true;
+    }
+
+    template <typename T, typename U>
+    inline bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) noexcept {
+        return false;
+    }
+
+#else
+
+    template <typename T>
+    using PoolAllocator = std::allocator<T>;
+
+#endif
+
+}
+
+#endif //INCLUDED_NEWLANG_POOL_
@@ -3,6 +3,12 @@
 #ifndef RATIONAL_H
 #define RATIONAL_H
 
+#include <numeric>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <sstream>
+
 #include <openssl/bn.h>
 
 namespace newlang {
@@ -14,7 +20,7 @@ namespace newlang {
             ASSERT(value);
         }
 
-        BigNum(const int64_t var) {
+        BigNum(const int64_t var) : BigNum() {
             set_(var);
         }
 
@@ -33,7 +39,7 @@ namespace newlang {
 
         inline BigNum& set_(const int64_t var) {
             if (var < 0) {
-                BN_set_word(value, -var);
+                BN_set_word(value, 0 - static_cast<uint64_t> (var));
                 BN_set_negative(value, -1);
             } else {
                 BN_set_word(value, var);
@@ -41,6 +47,17 @@ namespace newlang {
             return *this;
         }
 
+        BigNum& SetFromInt128(const __int128 var) {
+            unsigned __int128 abs = var < 0 ? 0 - static_cast<unsigned __int128> (var) : var;
+            VERIFY(BN_set_word(value, static_cast<uint64_t> (abs >> 64)));
+            VERIFY(BN_lshift(value, value, 64));
+            VERIFY(BN_add_word(value, static_cast<uint64_t> (abs)));
+            if (var < 0) {
+                BN_set_negative(value, -1);
+            }
+            return *this;
+        }
+
         BigNum& operator=(const BigNum & var) {
             return set_(var);
         }
@@ -56,18 +73,35 @@ namespace newlang {
             }
         }
 
+        /*
+         * Контекст OpenSSL для временных значений, один на поток и повторно используется всеми операциями
+         */
+        static BN_CTX * Ctx() {
+            thread_local std::unique_ptr<BN_CTX, decltype(&BN_CTX_free)> ctx(BN_CTX_new(), &BN_CTX_free);
+            ASSERT(ctx);
+            return ctx.get();
+        }
+
+        /*
+         * Временные значения из контекста потока (BN_CTX_start/BN_CTX_end)
+         */
         struct CtxHelper {
             BN_CTX *ctx;
 
-            CtxHelper() : ctx(BN_CTX_new()) {
-                ASSERT(ctx);
+            CtxHelper() : ctx(Ctx()) {
+                BN_CTX_start(ctx);
             }
 
             ~CtxHelper() {
-                if (ctx) {
-                    BN_CTX_free(ctx);
-                    ctx = nullptr;
+                BN_CTX_end(ctx);
+            }
+
+            BIGNUM * get() {
+                BIGNUM *result = BN_CTX_get(ctx);
+                if (!result) {
+                    LOG_RUNTIME("Fail call BN_CTX_get!");
                 }
+                return result;
             }
         };
 
@@ -94,16 +128,9 @@ namespace newlang {
                 // Точности мантисы хватает для хранения всех значащих бит длинного числа
                 return static_cast<double> (GetAsInteger());
             } else {
-                BigNum temp(*this);
-
-                BigNum one;
-                one.SetOne();
-
-                BigNum divider;
-                BN_lshift(divider.value, one.value, num_bits - 52);
-
-                BigNum remander;
-                temp.div(divider, remander);
+                // Сдвиг отбрасывает младшие биты модуля, как и деление на степень двойки
+                BigNum temp;
+                VERIFY(BN_rshift(temp.value, value, num_bits - 52));
 
                 ASSERT(!temp.isOverflow());
                 double result = static_cast<double> (temp.GetAsInteger());
@@ -118,50 +145,93 @@ namespace newlang {
              */
         }
 
+        /*
+         * Длинные строки разбираются делением пополам по степеням 10^(DECIMAL_LEAF*2^k)
+         * (субквадратично), короткие - функцией BN_dec2bn. Как и BN_dec2bn, разбор
+         * прекращается на первом символе, который не является цифрой.
+         */
         inline bool SetFromString(const std::string str) {
             ASSERT(!str.empty());
-            if (!BN_dec2bn(&value, str.c_str())) {
-                LOG_RUNTIME("Fail create BinNum from string '%s'!", str.c_str());
+            size_t sign = str[0] == '-' ? 1 : 0;
+            size_t len = sign;
+            while (len < str.size() && isdigit(static_cast<unsigned char> (str[len]))) {
+                len++;
+            }
+            if (len - sign <= 4 * DECIMAL_LEAF) {
+                if (!BN_dec2bn(&value, str.c_str())) {
+                    LOG_RUNTIME("Fail create BinNum from string '%s'!", str.c_str());
+                }
+                return value;
             }
+            ParseDecimal(str.c_str() + sign, len - sign, value);
+            BN_set_negative(value, static_cast<int> (sign));
             return value;
         }
 
         std::string GetAsString() const {
-            char * number_str = BN_bn2dec(value);
-            std::string result(number_str);
-            OPENSSL_free(number_str);
-            return result;
+            if (BN_num_bits(value) <= DECIMAL_BITS) {
+                char * number_str = BN_bn2dec(value);
+                std::string result(number_str);
+                OPENSSL_free(number_str);
+                return result;
+            }
+            std::ostringstream result;
+            GetAsString(result);
+            return result.str();
+        }
+
+        /*
+         * Вывод десятичного представления в поток без создания строки со всем числом.
+         * Длинное число делится на старшую и младшую части по степени 10^(DECIMAL_LEAF*2^k),
+         * деление выполняется умножением на заранее вычисленную обратную величину (Barrett),
+         * поэтому сложность определяется умножением (Karatsuba), а не BN_bn2dec (квадратичной).
+         */
+        void GetAsString(std::ostream &out) const {
+            if (BN_num_bits(value) <= DECIMAL_BITS) {
+                char * number_str = BN_bn2dec(value);
+                out << number_str;
+                OPENSSL_free(number_str);
+                return;
+            }
+            if (isNegative()) {
+                out << '-';
+            }
+            BigNum abs(*this);
+            BN_set_negative(abs.value, 0);
+
+            size_t index = 0;
+            while (BN_cmp(DecimalPower(index).power, abs.value) <= 0) {
+                index++;
+            }
+            WriteDecimal(out, abs.value, index, false);
         }
 
+        /*
+         * Операции выполняются на месте, OpenSSL допускает совпадение результата с аргументами
+         */
         BigNum &add(const BigNum &val) {
-            const BigNum temp(*this);
-            if (!BN_add(value, temp.value, val.value)) {
+            if (!BN_add(value, value, val.value)) {
                 LOG_RUNTIME("BN_add operation fail!");
             }
             return *this;
         }
 
         BigNum &sub(const BigNum &val) {
-            const BigNum temp(*this);
-            if (!BN_sub(value, temp.value, val.value)) {
+            if (!BN_sub(value, value, val.value)) {
                 LOG_RUNTIME("BN_sub operation fail!");
             }
             return *this;
         }
 
         BigNum &mul(const BigNum &val) {
-            CtxHelper ctx;
-            const BigNum temp(*this);
-            if (!BN_mul(value, temp.value, val.value, ctx.ctx)) {
+            if (!BN_mul(value, value, val.value, Ctx())) {
                 LOG_RUNTIME("BN_mul operation fail!");
             }
             return *this;
         }
 
         BigNum &div(const BigNum &val, BigNum &rem) {
-            CtxHelper ctx;
-            const BigNum temp(*this);
-            if (!BN_div(value, rem.value, temp.value, val.value, ctx.ctx)) {
+            if (!BN_div(value, rem.value, value, val.value, Ctx())) {
                 LOG_RUNTIME("BN_div operation fail!");
             }
             return *this;
@@ -191,18 +261,225 @@ namespace newlang {
             return BN_is_negative(value);
         }
 
+        /*
+         * Значение помещается в int64_t (кроме INT64_MIN)
+         */
+        inline bool isInt64() const {
+            return BN_num_bits(value) < 64;
+        }
+
+        constexpr static size_t DECIMAL_LEAF = 256; ///< Количество цифр, которые преобразуются BN_bn2dec и BN_dec2bn
+        constexpr static int DECIMAL_BITS = 4 * 851; ///< Размер числа для BN_bn2dec (около 4*DECIMAL_LEAF цифр)
+        constexpr static int MUL_BALANCED_BITS = 2048; ///< Минимальный размер множителя для умножения частями
+
+    protected:
+
+        /*
+         * Степень 10^(DECIMAL_LEAF*2^index) и обратная величина floor(2^(2*bits)/power) для деления
+         */
+        struct DecimalPowerItem {
+            BIGNUM *power;
+            BIGNUM *recip;
+            int bits;
+
+            DecimalPowerItem() : power(BN_new()), recip(BN_new()), bits(0) {
+                ASSERT(power && recip);
+            }
+
+            ~DecimalPowerItem() {
+                BN_free(power);
+                BN_free(recip);
+            }
+        };
+
+        /*
+         * Степени вычисляются при первом обращении и сохраняются для потока
+         */
+        static const DecimalPowerItem & DecimalPower(size_t index) {
+            thread_local std::vector<std::unique_ptr<DecimalPowerItem>> powers;
+            CtxHelper ctx;
+            while (powers.size() <= index) {
+                std::unique_ptr<DecimalPowerItem> item = std::make_unique<DecimalPowerItem>();
+                if (powers.empty()) {
+                    BIGNUM *temp = ctx.get();
+                    VERIFY(BN_set_word(temp, 10));
+                    VERIFY(BN_set_word(item->recip, DECIMAL_LEAF));
+                    VERIFY(BN_exp(item->power, temp, item->recip, ctx.ctx));
+                    BN_zero(item->recip);
+                } else {
+                    // BN_sqr для длинных чисел медленнее, чем BN_mul
+                    MulBalanced(item->power, powers.back()->power, powers.back()->power, ctx.ctx);
+                }
+                item->bits = BN_num_bits(item->power);
+                powers.push_back(std::move(item));
+            }
+            return *powers[index];
+        }
+
+        /*
+         * Обратная величина нужна только для деления (вывода числа) и вычисляется отдельно от степени
+         */
+        static const DecimalPowerItem & DecimalRecip(size_t index) {
+            DecimalPowerItem &item = const_cast<DecimalPowerItem &> (DecimalPower(index));
+            if (!BN_is_zero(item.recip)) {
+                return item;
+            }
+            CtxHelper ctx;
+            BIGNUM *temp = ctx.get();
+            BIGNUM *one = ctx.get();
+            BN_zero(one);
+            VERIFY(BN_set_bit(one, 2 * item.bits));
+            if (index == 0) {
+                VERIFY(BN_div(item.recip, nullptr, one, item.power, ctx.ctx));
+                return item;
+            }
+
+            // Начальное приближение из квадрата предыдущей обратной величины и один шаг Ньютона
+            const DecimalPowerItem &prev = DecimalRecip(index - 1);
+            BIGNUM *recip = item.recip;
+            MulBalanced(recip, prev.recip, prev.recip, ctx.ctx);
+            VERIFY(BN_rshift(recip, recip, 4 * prev.bits - 2 * item.bits));
+
+            MulBalanced(temp, item.power, recip, ctx.ctx);
+            VERIFY(BN_sub(temp, one, temp));
+            int negative = BN_is_negative(temp);
+            BN_set_negative(temp, 0);
+            MulBalanced(temp, temp, recip, ctx.ctx);
+            VERIFY(BN_rshift(temp, temp, 2 * item.bits));
+            BN_set_negative(temp, negative);
+            VERIFY(BN_add(recip, recip, temp));
+
+            // Точное значение после коррекции на несколько единиц
+            MulBalanced(temp, item.power, recip, ctx.ctx);
+            VERIFY(BN_sub(temp, one, temp));
+            while (BN_is_negative(temp)) {
+                VERIFY(BN_sub_word(recip, 1));
+                VERIFY(BN_add(temp, temp, item.power));
+            }
+            while (BN_cmp(temp, item.power) >= 0) {
+                VERIFY(BN_add_word(recip, 1));
+                VERIFY(BN_sub(temp, temp, item.power));
+            }
+            return item;
+        }
+
+        /*
+         * BN_mul использует алгоритм Karatsuba только для множителей одинаковой длины,
+         * поэтому больший множитель умножается частями размером с меньший (для неотрицательных чисел).
+         */
+        static void MulBalanced(BIGNUM *result, const BIGNUM *a, const BIGNUM *b, BN_CTX *ctx) {
+            if (BN_num_bits(a) < BN_num_bits(b)) {
+                std::swap(a, b);
+            }
+            int chunk = (BN_num_bits(b) + 63) / 64 * 64;
+            if (chunk < MUL_BALANCED_BITS || BN_num_bits(a) <= chunk + 64) {
+                VERIFY(BN_mul(result, a, b, ctx));
+                return;
+            }
+            CtxHelper helper;
+            BIGNUM *part = helper.get();
+            BIGNUM *product = helper.get();
+            BIGNUM *sum = helper.get();
+            BN_zero(sum);
+            for (int shift = 0; shift < BN_num_bits(a); shift += chunk) {
+                VERIFY(BN_rshift(part, a, shift));
+                VERIFY(BN_mask_bits(part, chunk) || BN_num_bits(part) <= chunk);
+                MulBalanced(product, part, b, ctx);
+                VERIFY(BN_lshift(product, product, shift));
+                VERIFY(BN_add(sum, sum, product));
+            }
+            VERIFY(BN_copy(result, sum));
+        }
+
+        /*
+         * Деление value < power^2 на степень index с остатком
+         */
+        static void DivDecimal(const BIGNUM *value, size_t index, BIGNUM *quot, BIGNUM *rem, BN_CTX *ctx) {
+            const DecimalPowerItem &item = DecimalRecip(index);
+            MulBalanced(quot, value, item.recip, ctx);
+            VERIFY(BN_rshift(quot, quot, 2 * item.bits));
+            MulBalanced(rem, quot, item.power, ctx);
+            VERIFY(BN_sub(rem, value, rem));
+            while (BN_cmp(rem, item.power) >= 0) {
+                VERIFY(BN_sub(rem, rem, item.power));
+                VERIFY(BN_add_word(quot, 1));
+            }
+        }
+
+        /*
+         * Вывод value < 10^(DECIMAL_LEAF*2^index), с ведущими нулями до полной ширины при pad
+         */
+        static void WriteDecimal(std::ostream &out, const BIGNUM *value, size_t index, bool pad) {
+            if (index == 0) {
+                char * number_str = BN_bn2dec(value);
+                if (pad) {
+                    for (size_t len = strlen(number_str); len < DECIMAL_LEAF; len++) {
+                        out << '0';
+                    }
+                }
+                out << number_str;
+                OPENSSL_free(number_str);
+                return;
+            }
+            if (!pad && BN_cmp(value, DecimalPower(index - 1).power) < 0) {
+                WriteDecimal(out, value, index - 1, false);
+                return;
+            }
+            CtxHelper ctx;
+            BIGNUM *quot = ctx.get();
+            BIGNUM *rem = ctx.get();
+            DivDecimal(value, index - 1, quot, rem, ctx.ctx);
+            WriteDecimal(out, quot, index - 1, pad);
+            WriteDecimal(out, rem, index - 1, true);
+        }
+
+        /*
+         * Разбор len цифр, старшая часть умножается на степень 10 и складывается с младшей
+         */
+        static void ParseDecimal(const char *str, size_t len, BIGNUM *result) {
+            if (len <= DECIMAL_LEAF) {
+                std::string part(str, len);
+                if (!BN_dec2bn(&result, part.c_str())) {
+                    LOG_RUNTIME("Fail create BinNum from string '%s'!", part.c_str());
+                }
+                return;
+            }
+            size_t index = 0;
+            while ((DECIMAL_LEAF << (index + 1)) < len) {
+                index++;
+            }
+            size_t low_len = DECIMAL_LEAF << index;
+            CtxHelper ctx;
+            BIGNUM *low = ctx.get();
+            ParseDecimal(str, len - low_len, result);
+            ParseDecimal(str + len - low_len, low_len, low);
+            MulBalanced(result, result, DecimalPower(index).power, ctx.ctx);
+            VERIFY(BN_add(result, result, low));
+        }
+
     };
 
+    /*
+     * Дробь из длинных чисел.
+     *
+     * Пока числитель и знаменатель помещаются в int64_t, они хранятся в m_num и m_den, а операции
+     * выполняются с промежуточными значениями __int128 без выделения памяти. При переполнении дробь
+     * переводится в BigNum (m_is_big), а после операции, результат которой снова помещается
+     * в int64_t, возвращается обратно. Значение INT64_MIN в малом представлении не используется,
+     * чтобы изменение знака не вызывало переполнения.
+     *
+     * Длинные числа создаются только при первом переполнении и затем повторно используются.
+     * Сокращение длинной дроби откладывается до вывода значения, возврата в малое представление
+     * или пока знаменатель не вырастет больше REDUCE_BITS и вдвое относительно прошлого сокращения.
+     */
     class Rational {
     public:
 
-        BigNum m_numerator; // Числитель
-        BigNum m_denominator; // Знаменатель
+        constexpr static int REDUCE_BITS = 256;
 
-    public:
         // Конструктор принимает значения числителя и знаменателя
 
-        Rational() : Rational("0", "1") {
+        Rational() : m_num(0), m_den(1), m_is_big(false) {
         }
 
         Rational(const int64_t value) {
@@ -217,129 +494,270 @@ namespace newlang {
             set_(numerator, denominator);
         }
 
+        Rational& operator=(const Rational &copy) {
+            return set_(copy);
+        }
+
         inline std::shared_ptr<Rational> clone() const {
             std::shared_ptr<Rational> result = std::make_shared<Rational>(*this);
             return result;
         }
 
+        inline bool isBig() const {
+            return m_is_big;
+        }
+
+        inline bool isDenominatorZero() const {
+            return m_is_big ? m_big->denominator.isZero() : m_den == 0;
+        }
+
         std::string GetAsString() const {
-            std::string result = m_numerator.GetAsString();
+            reduce_deferred();
+            if (!m_is_big) {
+                std::string result = std::to_string(m_num);
+                result += "\\";
+                result += std::to_string(m_den);
+                return result;
+            }
+            std::string result = m_big->numerator.GetAsString();
             result += "\\";
-            result += m_denominator.GetAsString();
+            result += m_big->denominator.GetAsString();
             return result;
         }
 
+        /*
+         * Вывод дроби в поток без создания строки (длинные числа выводятся частями)
+         */
+        void GetAsString(std::ostream &out) const {
+            reduce_deferred();
+            if (!m_is_big) {
+                out << m_num << "\\" << m_den;
+                return;
+            }
+            m_big->numerator.GetAsString(out);
+            out << "\\";
+            m_big->denominator.GetAsString(out);
+        }
+
         int64_t GetAsBoolean() const {
-            return !m_numerator.isZero();
+            return m_is_big ? !m_big->numerator.isZero() : m_num != 0;
         }
 
         int64_t GetAsInteger() const {
-            if (m_denominator.isZero()) {
+            if (isDenominatorZero()) {
                 LOG_RUNTIME("Denominator must be different from zero!");
             }
 
-            if (m_denominator.isOne()) {
-                return m_numerator.GetAsInteger();
+            if (!m_is_big) {
+                return m_num / m_den;
             }
 
-            BigNum result = m_numerator;
-
-            BigNum rem;
-            result.div(m_denominator, rem);
+            if (m_big->denominator.isOne()) {
+                return m_big->numerator.GetAsInteger();
+            }
 
+            BigNum::CtxHelper ctx;
+            BigNum result;
+            if (!BN_div(result.value, ctx.get(), m_big->numerator.value, m_big->denominator.value, ctx.ctx)) {
+                LOG_RUNTIME("BN_div operation fail!");
+            }
             return result.GetAsInteger();
         }
 
         double GetAsNumber() const {
-            if (m_denominator.isZero()) {
+            if (isDenominatorZero()) {
                 LOG_RUNTIME("Denominator must be different from zero!");
             }
-            if (m_denominator.isOne()) {
-                return m_numerator.GetAsNumber();
+            reduce_deferred();
+            if (!m_is_big) {
+                return static_cast<double> (m_num) / static_cast<double> (m_den);
+            }
+            if (m_big->denominator.isOne()) {
+                return m_big->numerator.GetAsNumber();
+            }
+            return m_big->numerator.GetAsNumber() / m_big->denominator.GetAsNumber();
+        }
+
+        /*
+         * Числитель и знаменатель в виде длинных чисел (без сокращения)
+         */
+        void GetAsBigNum(BigNum &numerator, BigNum &denominator) const {
+            if (m_is_big) {
+                numerator.set_(m_big->numerator);
+                denominator.set_(m_big->denominator);
+            } else {
+                numerator.set_(m_num);
+                denominator.set_(m_den);
+            }
+        }
+
+        Rational &SetFromBigNum(const BigNum &numerator, const BigNum &denominator) {
+            if (denominator.isZero()) {
+                LOG_RUNTIME("Denominator must be different from zero!");
             }
-            return m_numerator.GetAsNumber() / m_denominator.GetAsNumber();
+            big().numerator.set_(numerator);
+            m_big->denominator.set_(denominator);
+            m_is_big = true;
+            reduce();
+            return *this;
         }
 
         // Сокращения дроби
 
         void reduce() {
-            BigNum::CtxHelper ctx;
-            BigNum gcd;
+            if (!m_is_big) {
+                set_reduce(m_num, m_den);
+                return;
+            }
 
-            if (!BN_gcd(gcd.value, m_numerator.value, m_denominator.value, ctx.ctx)) {
-                LOG_RUNTIME("Fail call BN_gcd!");
+            Big &big = *m_big;
+            if (!big.denominator.isOne()) {
+                BigNum::CtxHelper ctx;
+                BIGNUM *gcd = ctx.get();
+
+                if (!BN_gcd(gcd, big.numerator.value, big.denominator.value, ctx.ctx)) {
+                    LOG_RUNTIME("Fail call BN_gcd!");
+                }
+                if (!BN_is_one(gcd) && !BN_is_zero(gcd)) {
+                    if (!BN_div(big.numerator.value, nullptr, big.numerator.value, gcd, ctx.ctx) ||
+                            !BN_div(big.denominator.value, nullptr, big.denominator.value, gcd, ctx.ctx)) {
+                        LOG_RUNTIME("BN_div operation fail!");
+                    }
+                }
             }
 
-            BigNum rem;
-            m_numerator.div(gcd, rem);
-            ASSERT(rem.isZero());
-            m_denominator.div(gcd, rem);
-            ASSERT(rem.isZero());
+            // Знак дроби хранится в числителе
+            if (big.denominator.isNegative()) {
+                BN_set_negative(big.numerator.value, !big.numerator.isNegative());
+                BN_set_negative(big.denominator.value, 0);
+            }
+            big.reduced = true;
+            big.reduced_bits = BN_num_bits(big.denominator.value);
+            shrink();
         }
 
         Rational &set_(const int64_t value) {
-            if (value < 0) {
-                BN_set_word(m_numerator.value, -value);
-                BN_set_negative(m_numerator.value, -1);
+            if (value == std::numeric_limits<int64_t>::min()) {
+                big().numerator.set_(value);
+                m_big->denominator.SetOne();
+                m_big->reduced = true;
+                m_is_big = true;
             } else {
-                BN_set_word(m_numerator.value, value);
+                m_num = value;
+                m_den = 1;
+                m_is_big = false;
             }
-            BN_set_word(m_denominator.value, 1);
             return *this;
         }
 
         Rational &set_(const Rational &copy) {
-            m_numerator.set_(copy.m_numerator);
-            m_denominator.set_(copy.m_denominator);
+            if (this == &copy) {
+                return *this;
+            }
+            m_is_big = copy.m_is_big;
+            if (m_is_big) {
+                big().numerator.set_(copy.m_big->numerator);
+                m_big->denominator.set_(copy.m_big->denominator);
+                m_big->reduced = copy.m_big->reduced;
+                m_big->reduced_bits = copy.m_big->reduced_bits;
+            } else {
+                m_num = copy.m_num;
+                m_den = copy.m_den;
+            }
             return *this;
         }
 
         Rational &set_(const std::string numerator, const std::string denominator) {
-            m_numerator.SetFromString(numerator);
-            m_denominator.SetFromString(denominator);
+            if (ParseInt64(numerator, m_num) && ParseInt64(denominator, m_den)) {
+                m_is_big = false;
+            } else {
+                // Литерал не сокращается и выводится так, как записан
+                big().numerator.SetFromString(numerator);
+                m_big->denominator.SetFromString(denominator);
+                m_big->reduced = true;
+                m_big->reduced_bits = BN_num_bits(m_big->denominator.value);
+                m_is_big = true;
+            }
             return *this;
         }
 
         Rational& operator*=(const Rational &rational) {
-            m_numerator.mul(rational.m_numerator);
-            m_denominator.mul(rational.m_denominator);
-            reduce();
+            if (!m_is_big && !rational.m_is_big) {
+                set_reduce(static_cast<__int128> (m_num) * rational.m_num, static_cast<__int128> (m_den) * rational.m_den);
+                return *this;
+            }
+            expand();
+            Rational temp;
+            const Big &value = *expanded(rational, temp).m_big;
+
+            m_big->numerator.mul(value.numerator);
+            if (!value.denominator.isOne()) {
+                m_big->denominator.mul(value.denominator);
+            }
+            reduce_lazy();
             return *this;
         }
 
         Rational& operator/=(const Rational &rational) {
-            m_numerator.mul(rational.m_denominator);
-            m_denominator.mul(rational.m_numerator);
-            reduce();
+            if (rational.isZero()) {
+                LOG_RUNTIME("Division by zero!");
+            }
+            if (!m_is_big && !rational.m_is_big) {
+                set_reduce(static_cast<__int128> (m_num) * rational.m_den, static_cast<__int128> (m_den) * rational.m_num);
+                return *this;
+            }
+            if (this == &rational) {
+                return set_(1);
+            }
+            expand();
+            Rational temp;
+            const Big &value = *expanded(rational, temp).m_big;
+
+            if (!value.denominator.isOne()) {
+                m_big->numerator.mul(value.denominator);
+            }
+            m_big->denominator.mul(value.numerator);
+            reduce_lazy();
 
             return *this;
         }
 
         Rational& operator-=(const Rational &rational) {
+            if (!m_is_big && !rational.m_is_big) {
+                if (m_den == rational.m_den) {
+                    set_reduce(static_cast<__int128> (m_num) - rational.m_num, m_den);
+                } else {
+                    set_reduce(static_cast<__int128> (m_num) * rational.m_den - static_cast<__int128> (rational.m_num) * m_den,
+                            static_cast<__int128> (m_den) * rational.m_den);
+                }
+                return *this;
+            }
+            expand();
+            Rational temp;
+            const Big &value = *expanded(rational, temp).m_big;
 
-            BigNum sub_num(rational.m_numerator);
-            sub_num.mul(m_denominator);
-
-            m_numerator.mul(rational.m_denominator);
-            m_denominator.mul(rational.m_denominator);
-
-            m_numerator.sub(sub_num);
-
-            reduce();
+            add_big(value, true);
+            reduce_lazy();
 
             return *this;
         }
 
         Rational& operator+=(const Rational &rational) {
-            BigNum add_num(rational.m_numerator);
-            add_num.mul(m_denominator);
-
-            m_numerator.mul(rational.m_denominator);
-            m_denominator.mul(rational.m_denominator);
-
-            m_numerator.add(add_num);
+            if (!m_is_big && !rational.m_is_big) {
+                if (m_den == rational.m_den) {
+                    set_reduce(static_cast<__int128> (m_num) + rational.m_num, m_den);
+                } else {
+                    set_reduce(static_cast<__int128> (m_num) * rational.m_den + static_cast<__int128> (rational.m_num) * m_den,
+                            static_cast<__int128> (m_den) * rational.m_den);
+                }
+                return *this;
+            }
+            expand();
+            Rational temp;
+            const Big &value = *expanded(rational, temp).m_big;
 
-            reduce();
+            add_big(value, false);
+            reduce_lazy();
 
             return *this;
         }
@@ -387,26 +805,44 @@ namespace newlang {
         }
 
         bool op_equal(const Rational &rational) const {
-            return BN_cmp(m_numerator.value, rational.m_numerator.value) == 0 &&
-                    BN_cmp(m_denominator.value, rational.m_denominator.value) == 0;
+            if (!m_is_big && !rational.m_is_big) {
+                if (m_num == rational.m_num && m_den == rational.m_den) {
+                    return true;
+                }
+            }
+            // Несокращенные дроби сравниваются по значению
+            return op_compare(rational) == 0;
         }
 
         int op_compare(const Rational &rational) const {
-            if (BN_cmp(m_denominator.value, rational.m_denominator.value) == 0) {
-                return BN_cmp(m_numerator.value, rational.m_numerator.value);
+            if (!m_is_big && !rational.m_is_big) {
+                // Произведения меньше 2^126, поэтому их разность помещается в __int128
+                __int128 diff = static_cast<__int128> (m_num) * rational.m_den - static_cast<__int128> (rational.m_num) * m_den;
+                if ((m_den < 0) != (rational.m_den < 0)) {
+                    diff = -diff;
+                }
+                return diff < 0 ? -1 : (diff > 0 ? 1 : 0);
             }
 
-            Rational first(*this);
-            Rational second(rational);
+            Rational temp_first;
+            Rational temp_second;
+            const Big &first = *expanded(*this, temp_first).m_big;
+            const Big &second = *expanded(rational, temp_second).m_big;
 
-            Rational mul;
-            mul.m_numerator.set_(m_denominator);
-            second *= mul;
-            mul.m_numerator.set_(rational.m_denominator);
-            first *= mul;
+            if (BN_cmp(first.denominator.value, second.denominator.value) == 0) {
+                int result = BN_cmp(first.numerator.value, second.numerator.value);
+                return first.denominator.isNegative() ? -result : result;
+            }
 
-            ASSERT(BN_cmp(first.m_denominator.value, second.m_denominator.value) == 0);
-            return BN_cmp(first.m_numerator.value, second.m_numerator.value);
+            BigNum::CtxHelper ctx;
+            BIGNUM *left = ctx.get();
+            BIGNUM *right = ctx.get();
+            if (!BN_mul(left, first.numerator.value, second.denominator.value, ctx.ctx) ||
+                    !BN_mul(right, second.numerator.value, first.denominator.value, ctx.ctx)) {
+                LOG_RUNTIME("BN_mul operation fail!");
+            }
+            int result = BN_cmp(left, right);
+            return first.denominator.isNegative() != second.denominator.isNegative() ? -result : result;
         }
 
         Rational &op_div_ceil_(Rational &rational) {
@@ -414,7 +850,183 @@ namespace newlang {
             return *this;
         }
 
+    protected:
+
+        struct Big {
+            BigNum numerator; // Числитель
+            BigNum denominator; // Знаменатель
+            bool reduced; // Дробь сокращена (или записана литералом)
+            int reduced_bits; // Размер знаменателя после последнего сокращения
+
+            Big() : reduced(true), reduced_bits(0) {
+            }
+        };
+
+        inline bool isZero() const {
+            return m_is_big ? m_big->numerator.isZero() : m_num == 0;
+        }
+
+        /*
+         * Длинные числа создаются при первом обращении
+         */
+        Big &big() {
+            if (!m_big) {
+                m_big = std::make_unique<Big>();
+            }
+            return *m_big;
+        }
+
+        /*
+         * Перевод в представление из длинных чисел
+         */
+        Rational &expand() {
+            if (!m_is_big) {
+                big().numerator.set_(m_num);
+                m_big->denominator.set_(m_den);
+                m_big->reduced = true;
+                m_big->reduced_bits = BN_num_bits(m_big->denominator.value);
+                m_is_big = true;
+            }
+            return *this;
+        }
+
+        /*
+         * Значение в представлении из длинных чисел (value или его копия в temp)
+         */
+        static const Rational & expanded(const Rational &value, Rational &temp) {
+            if (value.m_is_big) {
+                return value;
+            }
+            temp.set_(value);
+            return temp.expand();
+        }
+
+        /*
+         * Сложение или вычитание длинных дробей без сокращения. value может совпадать с собственным значением.
+         */
+        void add_big(const Big &value, bool sub) {
+            Big &big = *m_big;
+            if (BN_cmp(big.denominator.value, value.denominator.value) == 0) {
+                // Общий знаменатель, в том числе у целых чисел
+                if (!(sub ? BN_sub : BN_add)(big.numerator.value, big.numerator.value, value.numerator.value)) {
+                    LOG_RUNTIME("BN_add operation fail!");
+                }
+                return;
+            }
+
+            BigNum::CtxHelper ctx;
+            BIGNUM *cross = ctx.get();
+            if (!BN_mul(cross, value.numerator.value, big.denominator.value, ctx.ctx) ||
+                    !BN_mul(big.numerator.value, big.numerator.value, value.denominator.value, ctx.ctx) ||
+                    !BN_mul(big.denominator.value, big.denominator.value, value.denominator.value, ctx.ctx) ||
+                    !(sub ? BN_sub : BN_add)(big.numerator.value, big.numerator.value, cross)) {
+                LOG_RUNTIME("BigNum operation fail!");
+            }
+        }
+
+        /*
+         * Отложенное сокращение после операции с длинными числами
+         */
+        void reduce_lazy() {
+            Big &big = *m_big;
+            if (big.denominator.isNegative()) {
+                BN_set_negative(big.numerator.value, !big.numerator.isNegative());
+                BN_set_negative(big.denominator.value, 0);
+            }
+            if (big.denominator.isOne()) {
+                big.reduced = true;
+                big.reduced_bits = 1;
+                shrink();
+                return;
+            }
+            int bits = BN_num_bits(big.denominator.value);
+            if (bits > REDUCE_BITS && bits > 2 * big.reduced_bits) {
+                reduce();
+            } else if (big.numerator.isInt64() && big.denominator.isInt64()) {
+                // Малое представление всегда хранит сокращенную дробь
+                reduce();
+            } else {
+                big.reduced = false;
+            }
+        }
+
+        /*
+         * Сокращение перед выводом значения. Само значение дроби при этом не изменяется.
+         */
+        void reduce_deferred() const {
+            if (m_is_big && !m_big->reduced) {
+                const_cast<Rational *> (this)->reduce();
+            }
+        }
+
+        /*
+         * Возврат в малое представление, если значение помещается в int64_t
+         */
+        void shrink() {
+            if (m_is_big && m_big->numerator.isInt64() && m_big->denominator.isInt64()) {
+                m_num = m_big->numerator.GetAsInteger();
+                m_den = m_big->denominator.GetAsInteger();
+                m_is_big = false;
+            }
+        }
+
+        static unsigned __int128 gcd(unsigned __int128 a, unsigned __int128 b) {
+            if (!(a >> 64) && !(b >> 64)) {
+                return std::gcd(static_cast<uint64_t> (a), static_cast<uint64_t> (b));
+            }
+            while (b) {
+                unsigned __int128 temp = a % b;
+                a = b;
+                b = temp;
+            }
+            return a;
+        }
+
+        /*
+         * Сокращение дроби из промежуточных значений и выбор представления для результата
+         */
+        void set_reduce(__int128 num, __int128 den) {
+            if (den < 0) {
+                num = -num;
+                den = -den;
+            }
+            unsigned __int128 divider = gcd(num < 0 ? 0 - static_cast<unsigned __int128> (num) : num, den);
+            if (divider > 1) {
+                num /= static_cast<__int128> (divider);
+                den /= static_cast<__int128> (divider);
+            }
+            if (num > std::numeric_limits<int64_t>::min() && num <= std::numeric_limits<int64_t>::max()
+                    && den <= std::numeric_limits<int64_t>::max()) {
+                m_num = static_cast<int64_t> (num);
+                m_den = static_cast<int64_t> (den);
+                m_is_big = false;
+            } else {
+                big().numerator.SetFromInt128(num);
+                m_big->denominator.SetFromInt128(den);
+                m_big->reduced = true;
+                m_big->reduced_bits = BN_num_bits(m_big->denominator.value);
+                m_is_big = true;
+            }
+        }
+
+        /*
+         * Разбор десятичного числа без потери точности, иначе используется BigNum::SetFromString
+         */
+        static bool ParseInt64(const std::string &str, int64_t &value) {
+            if (str.empty() || !(isdigit(str[0]) || (str[0] == '-' && str.size() > 1))) {
+                return false;
+            }
+            errno = 0;
+            char *end;
+            value = std::strtoll(str.c_str(), &end, 10);
+            return errno == 0 && *end == '\0' && value != std::numeric_limits<int64_t>::min();
+        }
+
+        int64_t m_num; // Числитель в малом представлении
+        int64_t m_den; // Знаменатель в малом представлении
+        bool m_is_big; // Значение хранится в m_big
+
+        std::unique_ptr<Big> m_big; // Длинные числитель и знаменатель, создаются при первом переполнении
     };
 };
 #endif /* RATIONAL_H */
-
@@ -0,0 +1,409 @@
+#pragma once
+#ifndef INCLUDED_NEWLANG_REF_
+#define INCLUDED_NEWLANG_REF_
+
+#include "pch.h"
+
+#include <atomic>
+
+#include <pool.h>
+
+namespace newlang {
+
+    template <typename T> class Ref;
+    template <typename T> class WeakRef;
+
+    /*
+     * Базовый класс объектов со встроенным счетчиком ссылок (Obj, Term).
+     *
+     * В отличии от std::shared_ptr не требуется отдельный блок управления, а ссылка
+     * создается непосредственно из указателя this без shared_from_this().
+     * Счетчик изменяется без атомарных операций, т.к. объект используется одним потоком
+     * интерпретатора. Для объектов, которые используются одновременно несколькими потоками,
+     * необходимо вызвать MakeRefAtomic() до передачи объекта в другие потоки.
+     *
+     * Блок для слабых ссылок создается только при первом обращении (WeakRef)
+     * и всегда используется без атомарных операций. Поэтому MakeRefAtomic() разрешает
+     * только копирование и удаление сильных ссылок (Ref) из разных потоков, а слабые ссылки
+     * на объект должны создаваться, копироваться и блокироваться (lock) одним потоком.
+     * Ref и WeakRef без MakeRefAtomic() не потокобезопасны.
+     *
+     * Память под объекты выделяется в пуле (@ref MemoryPool),
+     * а при сборке с NL_POOL_ALLOCATOR=0 - системным распределителем.
+     */
+    class RefCounted {
+    public:
+
+        RefCounted() noexcept : m_ref_count(0), m_ref_atomic(false), m_ref_heap(false), m_ref_weak(nullptr) {
+        }
+
+        // Счетчик ссылок относится к конкретному объекту и не копируется
+        RefCounted(const RefCounted &) noexcept : RefCounted() {
+        }
+
+        RefCounted & operator=(const RefCounted &) noexcept {
+            return *this;
+        }
+
+        ~RefCounted() {
+            DetachWeak();
+        }
+
+        inline void MakeRefAtomic() const noexcept {
+            m_ref_atomic = true;
+        }
+
+        inline int64_t use_count() const noexcept {
+            return m_ref_count.load(std::memory_order_relaxed);
+        }
+
+        /*
+         * Объект создан с помощью MakeRef и ссылку на него можно получить из указателя this
+         */
+        inline bool is_ref_heap() const noexcept {
+            return m_ref_heap;
+        }
+
+#if NL_POOL_ALLOCATOR
+
+        static void * operator new(size_t size) {
+            return MemoryPool::Alloc(size);
+        }
+
+        static void operator delete(void *ptr, size_t size) noexcept {
+            MemoryPool::Free(ptr, size);
+        }
+
+#endif
+
+    protected:
+
+        template <typename T> friend class Ref;
+        template <typename T> friend class WeakRef;
+        template <typename T, typename... Args> friend Ref<T> MakeRef(Args &&... args);
+
+        struct WeakBlock {
+            uint32_t count; // Количество слабых ссылок + одна для самого объекта
+            bool alive;
+        };
+
+        inline void AddRef() const noexcept {
+            if (m_ref_atomic) {
+                m_ref_count.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                m_ref_count.store(m_ref_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+
+        /*
+         * Возвращает true, если удалена последняя ссылка на объект
+         */
+        inline bool ReleaseRef() const noexcept {
+            if (m_ref_atomic) {
+                return m_ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            }
+            uint32_t count = m_ref_count.load(std::memory_order_relaxed) - 1;
+            m_ref_count.store(count, std::memory_order_relaxed);
+            return count == 0;
+        }
+
+        WeakBlock * GetWeakBlock() const {
+            if (!m_ref_weak) {
+                m_ref_weak = new WeakBlock{1, true};
+            }
+            return m_ref_weak;
+        }
+
+        /*
+         * Вызывается до деструктора объекта, чтобы слабые ссылки больше не могли его получить
+         */
+        void DetachWeak() const noexcept {
+            if (m_ref_weak) {
+                m_ref_weak->alive = false;
+                ReleaseWeak(m_ref_weak);
+                m_ref_weak = nullptr;
+            }
+        }
+
+        static inline void ReleaseWeak(WeakBlock *block) noexcept {
+            if (--block->count == 0) {
+                delete block;
+            }
+        }
+
+        mutable std::atomic<uint32_t> m_ref_count;
+        mutable bool m_ref_atomic;
+        bool m_ref_heap;
+        mutable WeakBlock *m_ref_weak;
+    };
+
+    /*
+     * Ссылка на объект со встроенным счетчиком ссылок.
+     * Интерфейс совместим с используемой частью std::shared_ptr.
+     */
+    template <typename T>
+    class Ref {
+    public:
+        typedef T element_type;
+
+        Ref() noexcept : m_ptr(nullptr) {
+        }
+
+        Ref(std::nullptr_t) noexcept : m_ptr(nullptr) {
+        }
+
+        /*
+         * Ссылка из указателя на объект, например из this.
+         * Объект должен быть создан с помощью MakeRef.
+         */
+        explicit Ref(T *ptr) : m_ptr(ptr) {
+            if (m_ptr) {
+                ASSERT(m_ptr->is_ref_heap());
+                m_ptr->AddRef();
+            }
+        }
+
+        Ref(const Ref &other) noexcept : m_ptr(other.m_ptr) {
+            if (m_ptr) {
+                m_ptr->AddRef();
+            }
+        }
+
+        Ref(Ref &&other) noexcept : m_ptr(other.m_ptr) {
+            other.m_ptr = nullptr;
+        }
+
+        template <typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+        Ref(const Ref<U> &other) noexcept : m_ptr(other.get()) {
+            if (m_ptr) {
+                m_ptr->AddRef();
+            }
+        }
+
+        template <typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+        Ref(Ref<U> &&other) noexcept : m_ptr(other.release()) {
+        }
+
+        ~Ref() {
+            Release();
+        }
+
+        Ref & operator=(const Ref &other) noexcept {
+            Ref(other).swap(*this);
+            return *this;
+        }
+
+        Ref & operator=(Ref &&other) noexcept {
+            Ref(std::move(other)).swap(*this);
+            return *this;
+        }
+
+        template <typename U>
+        Ref & operator=(const Ref<U> &other) noexcept {
+            Ref(other).swap(*this);
+            return *this;
+        }
+
+        Ref & operator=(std::nullptr_t) noexcept {
+            reset();
+            return *this;
+        }
+
+        inline T * get() const noexcept {
+            return m_ptr;
+        }
+
+        inline T * operator->() const noexcept {
+            return m_ptr;
+        }
+
+        inline T & operator*() const noexcept {
+            return *m_ptr;
+        }
+
+        inline explicit operator bool() const noexcept {
+            return m_ptr != nullptr;
+        }
+
+        inline void reset() noexcept {
+            Release();
+            m_ptr = nullptr;
+        }
+
+        inline void swap(Ref &other) noexcept {
+            std::swap(m_ptr, other.m_ptr);
+        }
+
+        inline int64_t use_count() const noexcept {
+            return m_ptr ? m_ptr->use_count() : 0;
+        }
+
+        /*
+         * Передача владения без изменения счетчика ссылок
+         */
+        inline T * release() noexcept {
+            T *ptr = m_ptr;
+            m_ptr = nullptr;
+            return ptr;
+        }
+
+    protected:
+
+        template <typename U> friend class WeakRef;
+        template <typename U, typename... Args> friend Ref<U> MakeRef(Args &&... args);
+
+        struct Adopt {
+        };
+
+        // Ссылка без увеличения счетчика для уже учтенной ссылки
+        Ref(T *ptr, Adopt) noexcept : m_ptr(ptr) {
+        }
+
+        inline void Release() noexcept {
+            if (m_ptr && m_ptr->ReleaseRef()) {
+                m_ptr->DetachWeak();
+                delete m_ptr;
+            }
+        }
+
+        T *m_ptr;
+    };
+
+    template <typename T, typename U>
+    inline bool operator==(const Ref<T> &a, const Ref<U> &b) noexcept {
+        return a.get() == b.get();
+    }
+
+    template <typename T, typename U>
+    inline bool operator!=(const Ref<T> &a, const Ref<U> &b) noexcept {
+        return a.get() != b.get();
+    }
+
+    template <typename T, typename U>
+    inline bool operator<(const Ref<T> &a, const Ref<U> &b) noexcept {
+        return std::less<const void *>()(a.get(), b.get());
+    }
+
+    template <typename T>
+    inline bool operator==(const Ref<T> &a, std::nullptr_t) noexcept {
+        return !a;
+    }
+
+    template <typename T>
+    inline bool operator==(std::nullptr_t, const Ref<T> &a) noexcept {
+        return !a;
+    }
+
+    template <typename T>
+    inline bool operator!=(const Ref<T> &a, std::nullptr_t) noexcept {
+        return static_cast<bool> (a);
+    }
+
+    template <typename T>
+    inline bool operator!=(std::nullptr_t, const Ref<T> &a) noexcept {
+        return static_cast<bool> (a);
+    }
+
+    /*
+     * Создание объекта в пуле памяти со встроенным счетчиком ссылок
+     */
+    template <typename T, typename... Args>
+    inline Ref<T> MakeRef(Args &&... args) {
+        T *ptr = new T(std::forward<Args>(args)...);
+        ptr->m_ref_heap = true;
+        ptr->AddRef();
+        return Ref<T>(ptr, typename Ref<T>::Adopt());
+    }
+
+    /*
+     * Слабая ссылка, не продлевающая время жизни объекта
+     */
+    template <typename T>
+    class WeakRef {
+    public:
+
+        WeakRef() noexcept : m_ptr(nullptr), m_block(nullptr) {
+        }
+
+        template <typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+        WeakRef(const Ref<U> &ref) : m_ptr(ref.get()), m_block(m_ptr ? m_ptr->GetWeakBlock() : nullptr) {
+            if (m_block) {
+                m_block->count++;
+            }
+        }
+
+        WeakRef(const WeakRef &other) noexcept : m_ptr(other.m_ptr), m_block(other.m_block) {
+            if (m_block) {
+                m_block->count++;
+            }
+        }
+
+        WeakRef(WeakRef &&other) noexcept : m_ptr(other.m_ptr), m_block(other.m_block) {
+            other.m_ptr = nullptr;
+            other.m_block = nullptr;
+        }
+
+        ~WeakRef() {
+            reset();
+        }
+
+        WeakRef & operator=(const WeakRef &other) noexcept {
+            WeakRef(other).swap(*this);
+            return *this;
+        }
+
+        WeakRef & operator=(WeakRef &&other) noexcept {
+            WeakRef(std::move(other)).swap(*this);
+            return *this;
+        }
+
+        template <typename U>
+        WeakRef & operator=(const Ref<U> &ref) {
+            WeakRef(ref).swap(*this);
+            return *this;
+        }
+
+        inline bool expired() const noexcept {
+            return !m_block || !m_block->alive;
+        }
+
+        inline Ref<T> lock() const noexcept {
+            if (expired()) {
+                return Ref<T>();
+            }
+            m_ptr->AddRef();
+            return Ref<T>(m_ptr, typename Ref<T>::Adopt());
+        }
+
+        inline void reset() noexcept {
+            if (m_block) {
+                RefCounted::ReleaseWeak(m_block);
+            }
+            m_ptr = nullptr;
+            m_block = nullptr;
+        }
+
+        inline void swap(WeakRef &other) noexcept {
+            std::swap(m_ptr, other.m_ptr);
+            std::swap(m_block, other.m_block);
+        }
+
+    protected:
+        T *m_ptr;
+        RefCounted::WeakBlock *m_block;
+    };
+
+}
+
+namespace std {
+
+    template <typename T>
+    struct hash<newlang::Ref<T>> {
+
+        size_t operator()(const newlang::Ref<T> &ref) const noexcept {
+            return std::hash<T *>()(ref.get());
+        }
+    };
+}
+
+#endif //INCLUDED_NEWLANG_REF_
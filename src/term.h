@@ -116,15 +116,17 @@ namespace newlang {
         return false;
     }
 
-    class Term : public Variable<Term>, public std::enable_shared_from_this<Term> {
+    typedef ObjPtr(*TermOpFunction)(Context *ctx, const TermPtr & term, Obj * args, bool eval_block);
+
+    class Term : public Variable<Term>, public RefCounted {
     public:
 
         static TermPtr Create(Term * term) {
-            return std::make_shared<Term>(term);
+            return MakeRef<Term>(term);
         }
 
         static TermPtr Create(parser::token_type lex_type, TermID id, const char *text, size_t len = std::string::npos, location *loc = nullptr, std::shared_ptr<std::string> source = nullptr, Parser * parser = nullptr) {
-            return std::make_shared<Term>(lex_type, id, text, (len == std::string::npos ? strlen(text) : len), loc, source, parser);
+            return MakeRef<Term>(lex_type, id, text, (len == std::string::npos ? strlen(text) : len), loc, source, parser);
         }
 
         TermPtr Clone() {
@@ -154,6 +156,13 @@ namespace newlang {
             m_source = source;
             m_is_call = false;
             m_is_const = false;
+            m_op_func = nullptr;
+            m_op_mode = -1;
+            m_slot = -1;
+            m_slot_scope = nullptr;
+            m_frame_size = -1;
+            m_frame_args = 0;
+            m_const = nullptr;
             SetTermID(id);
         }
 
@@ -364,7 +373,7 @@ namespace newlang {
                     ASSERT(m_dims.empty());
 
                     result = "";
-                    temp = shared_from_this();
+                    temp = TermPtr(this);
                     if (temp->Left()) {
                         result = temp->Left()->toString();
                     }
@@ -794,7 +803,7 @@ namespace newlang {
                 }
                 return nullptr;
             }
-            return shared_from_this();
+            return TermPtr(this);
         }
 
         inline TermPtr Right(size_t pos = 1) {
@@ -808,21 +817,21 @@ namespace newlang {
                 }
                 return nullptr;
             }
-            return shared_from_this();
+            return TermPtr(this);
         }
 
         inline TermPtr Begin() {
             if (m_left) {
                 return m_left->Begin();
             }
-            return shared_from_this();
+            return TermPtr(this);
         }
 
         inline TermPtr End() {
             if (m_right) {
                 return m_right->End();
             }
-            return shared_from_this();
+            return TermPtr(this);
         }
 
         void SetSource(std::shared_ptr<std::string> source) {
@@ -839,12 +848,12 @@ namespace newlang {
                 }
             }
 
-            TermPtr next = shared_from_this()->Right();
+            TermPtr next = Right();
             while (next) {
                 next->SetSource(m_source);
                 next = next->Right();
             }
-            next = shared_from_this()->Left();
+            next = Left();
             while (next) {
                 next->SetSource(m_source);
                 next = next->Left();
@@ -913,7 +922,7 @@ namespace newlang {
         }
 
         inline TermPtr AppendList(TermPtr item) {
-            TermPtr next = shared_from_this();
+            TermPtr next = TermPtr(this);
 
             while (true) {
                 if (next->m_list) {
@@ -927,7 +936,7 @@ namespace newlang {
         }
 
         inline TermPtr AppendSequenceTerm(TermPtr item) {
-            TermPtr next = shared_from_this();
+            TermPtr next = TermPtr(this);
 
             while (true) {
                 if (next->m_sequence) {
@@ -946,7 +955,7 @@ namespace newlang {
                 return true;
             }
 
-            TermPtr next = shared_from_this();
+            TermPtr next = TermPtr(this);
             TermPtr prev;
 
             next = Clone();
@@ -1018,14 +1027,14 @@ namespace newlang {
             if (m_left) {
                 return m_left->First();
             }
-            return shared_from_this();
+            return TermPtr(this);
         }
 
         inline TermPtr Last() {
             if (m_right) {
                 return m_right->Last();
             }
-            return shared_from_this();
+            return TermPtr(this);
         }
 
         inline TermID GetTokenID() {
@@ -1050,7 +1059,7 @@ namespace newlang {
 
         inline TermPtr Find(TermID tok, const char *text = nullptr, int direction = RIGHT, TermPtr end = nullptr) {
             if (m_id == tok && (!text || std::string::npos != m_text.find(text))) {
-                return shared_from_this();
+                return TermPtr(this);
             }
             if (end && this == end.get()) {
                 return nullptr;
@@ -1355,6 +1364,23 @@ namespace newlang {
         bool m_is_call;
         bool m_is_const;
 
+        /// Обработчик оператора и режим сопоставления (MATCHING), которые определяются 
+        /// по тексту термина один раз, а не поиском строки при каждом выполнении.
+        TermOpFunction m_op_func;
+        int m_op_mode;
+
+        /// Индекс ячейки в кадре вызова функции (Context::Frame) для аргументов и локальных
+        /// переменных и тело функции, к кадру которой относится ячейка (Context::ResolveSlots).
+        int m_slot;
+        Term *m_slot_scope;
+        /// Размер кадра и количество ячеек для аргументов (у термина тела функции)
+        int m_frame_size;
+        int m_frame_args;
+
+        /// Объект литерала или свернутого константного выражения (Context::FoldConstants).
+        /// Создается один раз и никогда не изменяется, наружу отдаются только его копии.
+        ObjPtr m_const;
+
         /// Символьное описание потребуется для работы с пользовательскими типами данных.
         /// Итоговый тип может отличаться от указанного в исходнике для совместимых типов.
         std::string m_type_name;
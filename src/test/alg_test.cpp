@@ -997,4 +997,47 @@ TEST(Alg, Return) {
     ASSERT_EQ(9999, result->GetValueAsInteger());
 }
 
+/*
+ * Прерывание, записанное отдельным оператором, передается по блокам и циклам без исключения
+ * и с любым значением (:Break, :Continue, :Error).
+ */
+TEST(Alg, InterruptNoThrow) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ObjPtr result = ctx.ExecStr("i := 0; [i < 10] <-> {- [i == 5] --> --:Break--; i += 1; -}; i");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(5, result->GetValueAsInteger());
+    ASSERT_EQ(0, ctx.m_interrupt_throw);
+
+    result = ctx.ExecStr("{- [1] --> --:Continue--; 1; -}");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(ObjType::Type, result->getType()) << toString(result->getType());
+    ASSERT_EQ(ObjType::Continue, result->m_var_type_fixed) << toString(result->m_var_type_fixed);
+    ASSERT_EQ(0, ctx.m_interrupt_throw);
+
+    result = ctx.ExecStr("{* i := 0; [i < 10] <-> { i += 1; [i == 3] --> --:Error(i)--; }; 0; *}");
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(result->is_error()) << result->toString();
+    ASSERT_EQ(1, result->size()) << result->toString();
+    ASSERT_EQ(3, (*result)[0].second->GetValueAsInteger()) << result->toString();
+    ASSERT_EQ(0, ctx.m_interrupt_throw);
+
+    result = ctx.ExecStr("{+ i := 0; { i += 1; [i == 3] --> ++i++; } <-> [i < 10]; 0; +}");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(3, result->GetValueAsInteger());
+    ASSERT_EQ(0, ctx.m_interrupt_throw);
+
+    // Прерывание в выражении и не перехваченное прерывание передаются исключением
+    result = ctx.ExecStr("{+ res := ++42++; 0; +}");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(42, result->GetValueAsInteger());
+    ASSERT_EQ(1, ctx.m_interrupt_throw);
+
+    ASSERT_ANY_THROW(ctx.ExecStr("{ --:Error(1)--; 0; }"));
+    ASSERT_EQ(2, ctx.m_interrupt_throw);
+    ASSERT_FALSE(ctx.m_interrupt);
+}
+
 #endif // UNITTEST
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "parser.h"
 
 #include <signal.h>
+#include <chrono>
 
 #include <warning_pop.h>
 #include <warning_push.h>
@@ -20,6 +21,42 @@ int64_t func_export(int64_t arg_long, uint8_t arg_byte) {
     return arg_long + arg_byte;
 }
 
+double func_mix(int8_t arg_byte, float arg_single, double arg_double, int64_t arg_long) {
+    return arg_byte + arg_single + arg_double + arg_long;
+}
+
+int32_t func_data_global[4] = {1, 2, 3, 4};
+char func_data_bytes[] = "native";
+
+int32_t * func_data_buffer() {
+    return func_data_global;
+}
+
+int64_t func_data_sum(const int32_t *data, int64_t count) {
+    int64_t result = 0;
+    for (int64_t i = 0; i < count; i++) {
+        result += data[i];
+    }
+    return result;
+}
+
+double func_vsum(const char *types, ...) {
+    double result = 0;
+    va_list args;
+    va_start(args, types);
+    for (const char *ptr = types; *ptr; ptr++) {
+        if(*ptr == 'i') {
+            result += va_arg(args, int);
+        } else if(*ptr == 'l') {
+            result += va_arg(args, int64_t);
+        } else {
+            result += va_arg(args, double);
+        }
+    }
+    va_end(args);
+    return result;
+}
+
 TEST(Eval, Assign) {
 
     Context ctx(RunTime::Init());
@@ -208,6 +245,52 @@ TEST(Eval, Assign) {
     ASSERT_STREQ("[\n  [1, 1, 0, 0,], [10, 10, 0.1, 0.2,],\n]:Float64", tensor_all->GetValueAsString().c_str());
 }
 
+TEST(Eval, SymbolTable) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ASSERT_TRUE(ctx.ExecStr("sym1 := 1; sym2 := 2;"));
+
+    // Номер символа не меняется и может кешироваться
+    size_t sym1 = ctx.GetSymbol("sym1");
+    ASSERT_EQ(sym1, ctx.GetSymbol("sym1"));
+    ASSERT_NE(sym1, ctx.GetSymbol("sym2"));
+
+    ObjPtr obj = ctx.FindSymbol(sym1);
+    ASSERT_TRUE(obj);
+    ASSERT_EQ(1, obj->GetValueAsInteger());
+
+    uint64_t count = ctx.m_lookup_count;
+    uint64_t hit = ctx.m_lookup_hit;
+    ASSERT_TRUE(ctx.FindSymbol(sym1));
+    ASSERT_EQ(count + 1, ctx.m_lookup_count);
+    ASSERT_EQ(hit + 1, ctx.m_lookup_hit);
+
+    // Перекрытие имени и его восстановление
+    ObjPtr local = Obj::CreateValue(10, ObjType::None);
+    ctx.push_front(Context::pair(local, "sym1"));
+    ASSERT_EQ(10, ctx.FindSymbol(sym1)->GetValueAsInteger());
+    ctx.pop_front();
+    ASSERT_EQ(1, ctx.FindSymbol(sym1)->GetValueAsInteger());
+
+    // Освободившийся объект не находится, а его запись удаляется
+    {
+        ObjPtr temp = Obj::CreateValue(20, ObjType::None);
+        ctx.push_front(Context::pair(temp, "sym3"));
+        ASSERT_TRUE(ctx.FindSession("sym3"));
+    }
+    ASSERT_FALSE(ctx.FindSession("sym3"));
+    ASSERT_TRUE(ctx.find("sym3") == ctx.end());
+    ASSERT_FALSE(ctx.FindSession("not_found"));
+
+    ASSERT_TRUE(ctx.RemoveSession("sym2"));
+    ASSERT_FALSE(ctx.FindSession("sym2"));
+    ASSERT_FALSE(ctx.RemoveSession("sym2"));
+
+    ASSERT_TRUE(ctx.StatInfo().find("Lookup: ") == 0) << ctx.StatInfo();
+}
+
 TEST(Eval, Tensor) {
 
     Context ctx(RunTime::Init());
@@ -558,6 +641,122 @@ TEST(Eval, Fileio) {
     //    Context::Reset();
 }
 
+TEST(Eval, NativeCall) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    LLVMAddSymbol("func_mix", (void *) &func_mix);
+    ObjPtr mix = ctx.ExecStr("func_mix := :Pointer('func_mix(byte:Int8, single:Float32, double:Float64, long:Int64):Float64')");
+    ASSERT_TRUE(mix);
+    ASSERT_FALSE(mix->m_native);
+
+    // Аргументы передаются в размере из прототипа, а не в минимальном для значения
+    ObjPtr result = mix->Call(&ctx, Obj::Arg(-3), Obj::Arg(0.5), Obj::Arg(1), Obj::Arg(1000000));
+    ASSERT_DOUBLE_EQ(999998.5, result->GetValueAsNumber());
+
+    std::shared_ptr<NativeCall> native = mix->m_native;
+    ASSERT_TRUE(native);
+    for (int i = 0; i < 1000; i++) {
+        result = mix->Call(&ctx, Obj::Arg(i % 100), Obj::Arg(0.25), Obj::Arg(i), Obj::Arg(1));
+        ASSERT_DOUBLE_EQ(i % 100 + 0.25 + i + 1, result->GetValueAsNumber());
+    }
+    ASSERT_EQ(native, mix->m_native);
+
+    ASSERT_ANY_THROW(mix->Call(&ctx, Obj::Arg(1000), Obj::Arg(0.5), Obj::Arg(1), Obj::Arg(1)));
+
+    // Разное количество и типы дополнительных аргументов
+    LLVMAddSymbol("func_vsum", (void *) &func_vsum);
+    ObjPtr vsum = ctx.ExecStr("func_vsum := :Pointer('func_vsum(types:StrChar, ...):Float64')");
+    ASSERT_TRUE(vsum);
+    ASSERT_DOUBLE_EQ(3.5, vsum->Call(&ctx, Obj::Arg("iid"), Obj::Arg(1), Obj::Arg(2), Obj::Arg(0.5))->GetValueAsNumber());
+    ASSERT_DOUBLE_EQ(10000000000.25, vsum->Call(&ctx, Obj::Arg("ld"), Obj::Arg(10000000000), Obj::Arg(0.25))->GetValueAsNumber());
+    ASSERT_DOUBLE_EQ(0, vsum->Call(&ctx, Obj::Arg(""))->GetValueAsNumber());
+    ASSERT_DOUBLE_EQ(4.5, vsum->Call(&ctx, Obj::Arg("iid"), Obj::Arg(2), Obj::Arg(2), Obj::Arg(0.5))->GetValueAsNumber());
+}
+
+TEST(Eval, NativeData) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    // Представление без копирования и освобождение памяти вместе с последним объектом
+    int released = 0;
+    int32_t *data = new int32_t[6]{1, 2, 3, 4, 5, 6};
+    ObjPtr view = Obj::CreateTensorView(data, ObjType::Int32, {2, 3}, [&released](void *ptr) {
+        delete [] static_cast<int32_t *> (ptr);
+        released++;
+    });
+    ASSERT_TRUE(view->is_tensor_type());
+    ASSERT_EQ(ObjType::Int32, view->getType());
+    ASSERT_EQ(data, view->m_tensor.data_ptr());
+    ASSERT_STREQ("[\n  [1, 2, 3,], [4, 5, 6,],\n]:Int32", view->GetValueAsString().c_str());
+
+    data[0] = 10;
+    ASSERT_EQ(10, view->index_get({0, 0})->GetValueAsInteger());
+    view->index_set_({1, 2}, Obj::CreateValue(60, ObjType::None));
+    ASSERT_EQ(60, data[5]);
+
+    ObjPtr clone = view->Clone();
+    ASSERT_NE(data, clone->m_tensor.data_ptr());
+    view.reset();
+    ASSERT_EQ(1, released);
+    ASSERT_EQ(60, clone->index_get({1, 2})->GetValueAsInteger());
+
+    char bytes[] = "bytes";
+    ObjPtr str = Obj::CreateBytesView(bytes, 5, [&released](void *) {
+        released++;
+    });
+    ASSERT_EQ(ObjType::ViewChar, str->getType());
+    ASSERT_EQ(5, str->size());
+    ASSERT_STREQ("bytes", str->GetValueAsString().c_str());
+    str->index_set_({0}, Obj::CreateString("B"));
+    ASSERT_STREQ("Bytes", bytes);
+    ASSERT_STREQ("y", str->index_get({1})->GetValueAsString().c_str());
+    ASSERT_STREQ("s", str->index_get({-1})->GetValueAsString().c_str());
+    ASSERT_STREQ("s", str->at(-1).second->GetValueAsString().c_str());
+    ASSERT_STREQ("B", str->at(-5).second->GetValueAsString().c_str());
+    ASSERT_ANY_THROW(str->at(-6));
+    ASSERT_ANY_THROW(str->at(5));
+    ASSERT_ANY_THROW(str->index_get({-6}));
+
+    ObjPtr copy = str->Clone();
+    ASSERT_EQ(ObjType::StrChar, copy->getType());
+    bytes[1] = 'Y';
+    ASSERT_STREQ("Bytes", copy->GetValueAsString().c_str());
+    str.reset();
+    ASSERT_EQ(2, released);
+
+    // Глобальная переменная и результат нативной функции
+    LLVMAddSymbol("func_data_global", (void *) &func_data_global);
+    LLVMAddSymbol("func_data_bytes", (void *) &func_data_bytes);
+    LLVMAddSymbol("func_data_buffer", (void *) &func_data_buffer);
+    LLVMAddSymbol("func_data_sum", (void *) &func_data_sum);
+
+    ObjPtr global = ctx.ExecStr("global := :Pointer('func_data_global:Int32[4]')");
+    ASSERT_TRUE(global);
+    ASSERT_EQ(func_data_global, global->m_tensor.data_ptr());
+    ASSERT_EQ(4, global->size());
+
+    ObjPtr name = ctx.ExecStr("name := :Pointer('func_data_bytes:ViewChar[6]')");
+    ASSERT_TRUE(name);
+    ASSERT_STREQ("native", name->GetValueAsString().c_str());
+
+    ASSERT_TRUE(ctx.ExecStr("buffer := :Pointer('func_data_buffer():Pointer')"));
+    ASSERT_TRUE(ctx.ExecStr("sum := :Pointer('func_data_sum(data:Pointer, count:Int64):Int64')"));
+
+    ObjPtr buffer = ctx.ExecStr("data := :Int32[4](buffer())");
+    ASSERT_TRUE(buffer);
+    ASSERT_EQ(func_data_global, buffer->m_tensor.data_ptr());
+
+    ctx.ExecStr("data[3] = 40");
+    ASSERT_EQ(40, func_data_global[3]);
+
+    // Данные тензора передаются в нативную функцию по указателю
+    ASSERT_EQ(46, ctx.ExecStr("sum(data, 4)")->GetValueAsInteger());
+    ASSERT_EQ(21, ctx.ExecStr("sum(:Int32[6](1, 2, 3, 4, 5, 6), 6)")->GetValueAsInteger());
+}
+
 TEST(ExecStr, Funcs) {
 
     Context::Reset();
@@ -605,6 +804,177 @@ TEST(ExecStr, Funcs) {
     ASSERT_STREQ("Привет, мир2!\n", result->GetValueAsString().c_str());
 }
 
+TEST(ExecStr, FuncSlots) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    // Аргументы и локальные переменные функции адресуются по индексу ячейки кадра вызова
+    ObjPtr func = ctx.ExecStr("func_slot(arg1, arg2) := { local := $arg1 + arg2; local += $1; local; }");
+    ASSERT_TRUE(func);
+    ASSERT_TRUE(func->m_sequence);
+    ASSERT_EQ(3, func->m_sequence->m_frame_args); // $0, arg1, arg2
+    ASSERT_EQ(4, func->m_sequence->m_frame_size); // + local
+
+    ObjPtr result = ctx.ExecStr("func_slot(10, 2)");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(22, result->GetValueAsInteger());
+    ASSERT_FALSE(ctx.m_frame);
+
+    result = ctx.ExecStr("func_slot(arg2=1, arg1=5)");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(11, result->GetValueAsInteger());
+
+    // Каждый вызов при рекурсии получает собственный кадр
+    ObjPtr fact = ctx.ExecStr("fact(n) := {+ [n <= 1] --> ++1++; n * fact(n - 1) +}");
+    ASSERT_TRUE(fact);
+    ASSERT_EQ(2, fact->m_sequence->m_frame_size);
+
+    result = ctx.ExecStr("fact(5)");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(120, result->GetValueAsInteger());
+    ASSERT_FALSE(ctx.m_frame);
+
+    // Внутри блока пространства имен то же имя обозначает другой объект и ячейка кадра не используется
+    ObjPtr func_ns = ctx.ExecStr("func_ns() := { ns_val := 1; ns_slot { ns_val := 2; }; ns_val * 10 + ns_slot::ns_val; }");
+    ASSERT_TRUE(func_ns);
+    ASSERT_EQ(2, func_ns->m_sequence->m_frame_size); // $0, ns_val
+
+    result = ctx.ExecStr("func_ns()");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(12, result->GetValueAsInteger());
+    ASSERT_EQ(0, ctx.m_ns_stack.size());
+    ASSERT_FALSE(ctx.m_frame);
+}
+
+TEST(ExecStr, ConstFolding) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    // Выражение из литералов вычисляется один раз при загрузке
+    TermPtr ast = Parser::ParseString("2 * 3 + 4", nullptr);
+    ASSERT_TRUE(ast);
+    ASSERT_EQ(TermID::OPERATOR, ast->getTermID()) << newlang::toString(ast->getTermID());
+    ASSERT_FALSE(ast->m_const);
+    ASSERT_TRUE(Context::FoldConstants(&ctx, ast));
+    ASSERT_TRUE(ast->m_const);
+    ASSERT_EQ(10, ast->m_const->GetValueAsInteger());
+    ASSERT_TRUE(ast->Left()->m_const);
+
+    ast = Parser::ParseString("'abc' ++ 'def'", nullptr);
+    ASSERT_TRUE(Context::FoldConstants(&ctx, ast));
+    ASSERT_STREQ("abcdef", ast->m_const->GetValueAsString().c_str());
+
+    ast = Parser::ParseString("1\\2", nullptr);
+    ASSERT_TRUE(Context::FoldConstants(&ctx, ast));
+    ASSERT_EQ(ObjType::Rational, ast->m_const->getType());
+
+    // Выражения с переменными не сворачиваются
+    ast = Parser::ParseString("var + 1", nullptr);
+    ASSERT_FALSE(Context::FoldConstants(&ctx, ast));
+    ASSERT_FALSE(ast->m_const);
+    ASSERT_TRUE(ast->Right()->m_const);
+
+    ObjPtr result = ctx.ExecStr("2 * 3 + 4");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(10, result->GetValueAsInteger());
+
+    // Значение константы не изменяется при изменении переменной
+    ObjPtr func = ctx.ExecStr("func_const() := { val := 1; val += 1; str := 'a'; str += 'b'; val }");
+    ASSERT_TRUE(func);
+    ASSERT_EQ(2, ctx.ExecStr("func_const()")->GetValueAsInteger());
+    ASSERT_EQ(2, ctx.ExecStr("func_const()")->GetValueAsInteger());
+
+    result = ctx.ExecStr("cnt := 0; [cnt < 5] <-> { cnt += 1; }; cnt");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(5, result->GetValueAsInteger());
+}
+
+TEST(ExecStr, TensorLiteral) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    // Литерал тензора из констант создается один раз при загрузке
+    TermPtr ast = Parser::ParseString("[[1, 2,], [3, 4,],]:Int32", nullptr);
+    ASSERT_TRUE(Context::FoldConstants(&ctx, ast));
+    ASSERT_TRUE(ast->m_const);
+    ASSERT_EQ(ObjType::Int32, ast->m_const->getType());
+    ASSERT_TRUE(torch::equal(torch::tensor({1, 2, 3, 4}, torch::kInt32).reshape({2, 2}), ast->m_const->m_tensor));
+
+    ast = Parser::ParseString("[1, var,]", nullptr);
+    ASSERT_FALSE(Context::FoldConstants(&ctx, ast));
+    ASSERT_FALSE(ast->m_const);
+
+    // Значение константы не изменяется при изменении переменной
+    ASSERT_TRUE(ctx.ExecStr("func_tensor() := { val := [1, 2, 3,]; val += 1; val }"));
+    ASSERT_STREQ("[2, 3, 4,]:Int8", ctx.ExecStr("func_tensor()")->GetValueAsString().c_str());
+    ASSERT_STREQ("[2, 3, 4,]:Int8", ctx.ExecStr("func_tensor()")->GetValueAsString().c_str());
+
+    // Общий тип элементов
+    ASSERT_EQ(ObjType::Float64, ctx.ExecStr("[1, 2.5, 3,]")->getType());
+    ASSERT_EQ(ObjType::Int16, ctx.ExecStr("[[1, 2,], [3, 1000,],]")->getType());
+
+    // Большой литерал
+    const int64_t rows = 1000;
+    const int64_t cols = 1000;
+    std::string source("[");
+    for (int64_t row = 0; row < rows; row++) {
+        source += "[";
+        for (int64_t col = 0; col < cols; col++) {
+            source += std::to_string((row * cols + col) % 100);
+            source += ", ";
+        }
+        source += "], ";
+    }
+    source += "]";
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    ObjPtr result = ctx.ExecStr(source);
+    int64_t literal_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    ASSERT_TRUE(result);
+    ASSERT_EQ(ObjType::Int8, result->getType());
+    ASSERT_TRUE(torch::equal(torch::arange(rows * cols).remainder(100).reshape({rows, cols}).toType(torch::kInt8), result->m_tensor));
+
+    // Словарь в тензор
+    ObjPtr dict = Obj::CreateDict();
+    for (int64_t i = 0; i < rows * cols; i++) {
+        dict->push_back(Obj::CreateValue(i));
+    }
+    begin = std::chrono::steady_clock::now();
+    dict->toType_(ObjType::Tensor);
+    int64_t dict_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    ASSERT_EQ(ObjType::Int32, dict->getType());
+    ASSERT_TRUE(torch::equal(torch::arange(rows * cols, torch::kInt32), dict->m_tensor));
+
+    LOG_INFO("Tensor literal %dx%d: %d ms, dictionary of %d items: %d ms",
+            (int) rows, (int) cols, (int) literal_time, (int) (rows * cols), (int) dict_time);
+}
+
+TEST(ExecStr, CopyOnWrite) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ASSERT_TRUE(ctx.ExecStr("tensor := [1, 2, 3,]"));
+
+    // Копия в другой переменной и аргумент функции изменяются отдельно от исходного тензора
+    ASSERT_TRUE(ctx.ExecStr("copy := tensor"));
+    ASSERT_STREQ("[1, 2, 3,]:Int8", ctx.ExecStr("copy")->GetValueAsString().c_str());
+    ASSERT_TRUE(ctx.ExecStr("copy += 10"));
+    ASSERT_STREQ("[11, 12, 13,]:Int8", ctx.ExecStr("copy")->GetValueAsString().c_str());
+    ASSERT_STREQ("[1, 2, 3,]:Int8", ctx.ExecStr("tensor")->GetValueAsString().c_str());
+
+    ASSERT_TRUE(ctx.ExecStr("func_cow(arg) := { arg *= 2; arg }"));
+    ASSERT_STREQ("[2, 4, 6,]:Int8", ctx.ExecStr("func_cow(tensor)")->GetValueAsString().c_str());
+    ASSERT_STREQ("[1, 2, 3,]:Int8", ctx.ExecStr("tensor")->GetValueAsString().c_str());
+
+    ASSERT_TRUE(ctx.ExecStr("tensor[1] = 20"));
+    ASSERT_STREQ("[1, 20, 3,]:Int8", ctx.ExecStr("tensor")->GetValueAsString().c_str());
+    ASSERT_STREQ("[11, 12, 13,]:Int8", ctx.ExecStr("copy")->GetValueAsString().c_str());
+}
+
 /*
  * scalar_int := 100:Int32; # Тип скаляра во время компиляции
  * scalar_int := 100:Int32(__device__="GPU"); # Тип скаляра во время компиляции
@@ -1730,6 +2100,98 @@ TEST(EvalOp, InstanceName) {
 
 }
 
+TEST(Eval, AssignInPlace) {
+
+    for (int vm = 0; vm < 2; vm++) {
+        Context::Reset();
+        Context ctx(RunTime::Init());
+        ctx.m_vm_enable = vm;
+
+        ObjPtr x = ctx.ExecStr("x := :Float64([1, 2, 3,])");
+        ASSERT_TRUE(x);
+        void *data = x->m_tensor.data_ptr();
+
+        // Результат записывается в данные переменной
+        ASSERT_EQ(x.get(), ctx.ExecStr("x = x + [1, 1, 1,]").get());
+        ASSERT_EQ(1, ctx.m_inplace_count);
+        ctx.ExecStr("x = x * 2");
+        ctx.ExecStr("x = x - x / 4");
+        ASSERT_EQ(4, ctx.m_inplace_count);
+        ASSERT_EQ(data, x->m_tensor.data_ptr());
+        ASSERT_EQ(ObjType::Float64, x->getType());
+        ASSERT_DOUBLE_EQ(3, x->index_get({0})->GetValueAsNumber());
+        ASSERT_DOUBLE_EQ(4.5, x->index_get({1})->GetValueAsNumber());
+        ASSERT_DOUBLE_EQ(6, x->index_get({2})->GetValueAsNumber());
+
+        // Данные используются другим объектом - присвоение с копией
+        ObjPtr alias = Obj::CreateTensor(x->m_tensor);
+        ctx.ExecStr("x = x + 1");
+        ASSERT_EQ(4, ctx.m_inplace_count);
+        ASSERT_EQ(1, ctx.m_inplace_shared);
+        ASSERT_DOUBLE_EQ(4, x->index_get({0})->GetValueAsNumber());
+        ASSERT_DOUBLE_EQ(3, alias->index_get({0})->GetValueAsNumber());
+        alias.reset();
+
+        // Тип переменной не изменяется
+        ObjPtr i = ctx.ExecStr("i := [10, 21,]");
+        ObjType type = i->getType();
+        ASSERT_TRUE(isIntegralType(type, true));
+        ctx.ExecStr("i = i / 4");
+        ASSERT_EQ(5, ctx.m_inplace_count);
+        ASSERT_EQ(type, i->getType());
+        ASSERT_EQ(2, i->index_get({0})->GetValueAsInteger());
+        ASSERT_EQ(5, i->index_get({1})->GetValueAsInteger());
+
+        // Левый операнд - другая переменная
+        ctx.ExecStr("y := :Float64([0, 0, 0,])");
+        ctx.ExecStr("y = x + y");
+        ASSERT_EQ(5, ctx.m_inplace_count);
+        ASSERT_DOUBLE_EQ(4, ctx.ExecStr("y")->index_get({0})->GetValueAsNumber());
+
+        // Размерности не совпадают - ошибку выдает присвоение с копией, а переменная не изменяется
+        ASSERT_ANY_THROW(ctx.ExecStr("x = x + [1, 1,]"));
+        ASSERT_EQ(5, ctx.m_inplace_count);
+        ASSERT_EQ(ObjType::Float64, x->getType());
+        ASSERT_EQ(3, x->size());
+        ASSERT_DOUBLE_EQ(4, x->index_get({0})->GetValueAsNumber());
+        ASSERT_ANY_THROW(ctx.ExecStr("i = i * [0.5, 0.5, 0.5,]"));
+        ASSERT_EQ(type, i->getType());
+        ASSERT_EQ(2, i->index_get({0})->GetValueAsInteger());
+
+        ObjPtr str = ctx.ExecStr("str := 'first'");
+        ctx.ExecStr("str = str + ' second'");
+        ASSERT_STREQ("first second", str->GetValueAsString().c_str());
+        ASSERT_EQ(6, ctx.m_inplace_count);
+        ASSERT_STREQ("first second third", ctx.ExecStr("str = str ++ ' third'")->GetValueAsString().c_str());
+        ASSERT_STREQ("first second third", str->GetValueAsString().c_str());
+    }
+
+    // Накопление в тензоре из 4 млн элементов с копией (данные используются другим объектом) и без нее
+    int64_t times[2];
+    for (int inplace = 0; inplace < 2; inplace++) {
+        Context::Reset();
+        Context ctx(RunTime::Init());
+
+        ObjPtr acc = ctx.ExecStr("acc := :Float32([0,])");
+        acc->m_tensor = torch::zeros({4 * 1024 * 1024}, torch::kFloat32);
+        ObjPtr step = ctx.ExecStr("step := :Float32([0,])");
+        step->m_tensor = torch::ones({4 * 1024 * 1024}, torch::kFloat32);
+
+        torch::Tensor alias;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < 20; i++) {
+            if(!inplace) {
+                alias = acc->m_tensor;
+            }
+            ctx.ExecStr("acc = acc + step");
+        }
+        times[inplace] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+        ASSERT_EQ(inplace ? 20 : 0, ctx.m_inplace_count);
+        ASSERT_DOUBLE_EQ(20, acc->index_get({0})->GetValueAsNumber());
+    }
+    LOG_INFO("20 assignments 'acc = acc + step' of 4M elements: with copy %d ms, in-place %d ms", (int) times[0], (int) times[1]);
+}
+
 TEST(Eval, System) {
 
     Context ctx(RunTime::Init());
@@ -178,6 +178,54 @@ TEST(Example, DISABLED_SpeedNewLang) {
      */
 }
 
+/*
+ * Досрочный выход из функции внутри цикла.
+ * Прерывание ++i++ как отдельный оператор передается вверх по блокам без исключения,
+ * а в составе выражения (res := ++i++) по прежнему выбрасывается исключение Return.
+ */
+TEST(Example, SpeedInterrupt) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ASSERT_TRUE(ctx.ExecStr("find_fast(n) := {+ i := 0; [i < 100] <-> { [i == n] --> ++i++; i += 1; }; -1; +};"));
+    ASSERT_TRUE(ctx.ExecStr("find_throw(n) := {+ i := 0; [i < 100] <-> { [i == n] --> { res := ++i++; }; i += 1; }; -1; +};"));
+
+    ObjPtr result = ctx.ExecStr("find_fast(7)");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(7, result->GetValueAsInteger());
+    ASSERT_FALSE(ctx.m_interrupt);
+
+    result = ctx.ExecStr("find_throw(7)");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(7, result->GetValueAsInteger());
+    ASSERT_FALSE(ctx.m_interrupt);
+
+    ctx.m_interrupt_throw = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    ObjPtr fast = ctx.ExecStr("cnt := 0; sum := 0; [cnt < 500] <-> { sum += find_fast(50); cnt += 1; }; sum");
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    int sec = (int) std::chrono::duration_cast<std::chrono::seconds>(end - begin).count();
+    int usec = (int) std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() % 1000000;
+    LOG_INFO("Return without exception at %d.%06d sec", sec, usec);
+    ASSERT_EQ(0, ctx.m_interrupt_throw);
+
+    begin = std::chrono::steady_clock::now();
+    ObjPtr slow = ctx.ExecStr("cnt := 0; sum := 0; [cnt < 500] <-> { sum += find_throw(50); cnt += 1; }; sum");
+    end = std::chrono::steady_clock::now();
+
+    sec = (int) std::chrono::duration_cast<std::chrono::seconds>(end - begin).count();
+    usec = (int) std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() % 1000000;
+    LOG_INFO("Return with exception at %d.%06d sec", sec, usec);
+    ASSERT_EQ(500, ctx.m_interrupt_throw);
+
+    ASSERT_TRUE(fast);
+    ASSERT_TRUE(slow);
+    ASSERT_EQ(25000, fast->GetValueAsInteger());
+    ASSERT_EQ(25000, slow->GetValueAsInteger());
+}
+
 TEST(Example, DISABLED_Rational) {
 
     Context::Reset();
@@ -0,0 +1,186 @@
+#include "pch.h"
+
+#ifdef UNITTEST
+
+#include <warning_push.h>
+#include <gtest/gtest.h>
+#include <warning_pop.h>
+
+#include <chrono>
+
+#include <jit.h>
+#include <newlang.h>
+
+using namespace newlang;
+
+TEST(JIT, Compile) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+    ctx.m_jit_enable = true;
+
+    ObjPtr func = ctx.ExecStr("jit_sum(count:Int64, step:Float64) := { cnt := 0; sum := 0.0; [cnt < $count] <-> { sum += cnt * step; cnt += 1; }; [sum > 100] --> { sum // 3 }, [_] --> { sum / 2 }; }");
+    ASSERT_TRUE(func);
+    ASSERT_FALSE(func->m_jit);
+
+    // Результат интерпретатора
+    ObjPtr eval = func->Call(&ctx, Obj::Arg(10), Obj::Arg(0.5));
+    ASSERT_TRUE(eval->is_floating());
+    ASSERT_DOUBLE_EQ(11.25, eval->GetValueAsNumber());
+    ASSERT_LT(10, func->m_jit_hot); // Вызов и итерации цикла
+
+    while(!func->m_jit) {
+        ASSERT_LE(0, func->m_jit_hot);
+        func->Call(&ctx, Obj::Arg(10), Obj::Arg(0.5));
+    }
+
+    ObjPtr native = func->Call(&ctx, Obj::Arg(10), Obj::Arg(0.5));
+    ASSERT_TRUE(native->is_floating());
+    ASSERT_DOUBLE_EQ(eval->GetValueAsNumber(), native->GetValueAsNumber());
+
+    native = func->Call(&ctx, Obj::Arg(100), Obj::Arg(1.0));
+    ASSERT_DOUBLE_EQ(1650, native->GetValueAsNumber());
+
+    // Аргумент приводится к объявленному типу до проверки типов
+    int64_t deopt = func->m_jit->GetDeoptCount();
+    ObjPtr cast = func->Call(&ctx, Obj::Arg(10), Obj::Arg(1));
+    ASSERT_EQ(deopt, func->m_jit->GetDeoptCount());
+    ASSERT_DOUBLE_EQ(22.5, cast->GetValueAsNumber());
+
+    LOG_INFO("%s", JitCode::StatInfo().c_str());
+}
+
+TEST(JIT, Deopt) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+    ctx.m_jit_enable = true;
+
+    // Типы аргументов без объявления определяются при компиляции
+    ObjPtr func = ctx.ExecStr("jit_mod(val, div) := { $val % $div + 1 }");
+    ASSERT_TRUE(func);
+    for (int64_t i = 0; i <= JitCode::HOT_THRESHOLD && !func->m_jit; i++) {
+        ASSERT_EQ(i % 7 + 1, func->Call(&ctx, Obj::Arg(i), Obj::Arg(7))->GetValueAsInteger());
+    }
+    ASSERT_TRUE(func->m_jit);
+    ASSERT_EQ(4, func->Call(&ctx, Obj::Arg(1003), Obj::Arg(-1000))->GetValueAsInteger());
+    ASSERT_EQ(1, func->Call(&ctx, Obj::Arg(-5), Obj::Arg(-1))->GetValueAsInteger());
+
+    // Тип аргумента не совпадает - вызов выполняет интерпретатор
+    int64_t deopt = func->m_jit->GetDeoptCount();
+    ObjPtr guard = func->Call(&ctx, Obj::Arg(1.5), Obj::Arg(7));
+    ASSERT_EQ(deopt + 1, func->m_jit->GetDeoptCount());
+    ASSERT_TRUE(guard->is_floating());
+    ASSERT_DOUBLE_EQ(2.5, guard->GetValueAsNumber());
+
+    // После DEOPT_LIMIT неудачных проверок машинный код удаляется
+    for (int64_t i = 0; i <= JitCode::DEOPT_LIMIT && func->m_jit; i++) {
+        ASSERT_DOUBLE_EQ(2.5, func->Call(&ctx, Obj::Arg(1.5), Obj::Arg(7))->GetValueAsNumber());
+    }
+    ASSERT_FALSE(func->m_jit);
+    ASSERT_EQ(-1, func->m_jit_hot);
+
+    // Функции с побочными эффектами не компилируются
+    ctx.ExecStr("jit_global := 0");
+    func = ctx.ExecStr("jit_side(val) := { jit_global += $val; }");
+    for (int64_t i = 0; i <= JitCode::HOT_THRESHOLD; i++) {
+        func->Call(&ctx, Obj::Arg(1));
+    }
+    ASSERT_FALSE(func->m_jit);
+    ASSERT_EQ(-1, func->m_jit_hot);
+    ASSERT_EQ(JitCode::HOT_THRESHOLD + 1, ctx.ExecStr("jit_global")->GetValueAsInteger());
+}
+
+TEST(JIT, Compare) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+    ctx.m_jit_enable = true;
+
+    // Результат сравнения возвращается как логическое значение, как у интерпретатора
+    ObjPtr func = ctx.ExecStr("jit_less(val, lim) := { $val < $lim }");
+    ASSERT_TRUE(func);
+    for (int64_t i = 0; i <= JitCode::HOT_THRESHOLD && !func->m_jit; i++) {
+        ASSERT_TRUE(func->Call(&ctx, Obj::Arg(i), Obj::Arg(10))->is_bool_type());
+    }
+    ASSERT_TRUE(func->m_jit);
+
+    ObjPtr yes = func->Call(&ctx, Obj::Arg(1), Obj::Arg(2));
+    ASSERT_TRUE(yes->is_bool_type());
+    ASSERT_TRUE(yes->GetValueAsBoolean());
+    ObjPtr no = func->Call(&ctx, Obj::Arg(2), Obj::Arg(1));
+    ASSERT_TRUE(no->is_bool_type());
+    ASSERT_FALSE(no->GetValueAsBoolean());
+}
+
+extern "C" int16_t jit_native_clamp(bool neg, int16_t value, int8_t limit);
+
+int16_t jit_native_clamp(bool neg, int16_t value, int8_t limit) {
+    int16_t result = value > limit ? limit : value;
+    return neg ? -result : result;
+}
+
+TEST(JIT, Trampoline) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    LLVMAddSymbol("jit_native_clamp", (void *) &jit_native_clamp);
+    ObjPtr clamp = ctx.ExecStr("jit_native_clamp := :Pointer('jit_native_clamp(neg:Bool, value:Int16, limit:Int8):Int16')");
+    ASSERT_TRUE(clamp);
+
+    // Первые вызовы выполняются через ffi_call, следующие через переходник
+    for (int64_t i = 0; i < 300; i++) {
+        ObjPtr result = clamp->Call(&ctx, Obj::Arg(Obj::Yes()), Obj::Arg(i), Obj::Arg(-100 + i % 200));
+        ASSERT_TRUE(result->is_integer());
+        ASSERT_EQ(jit_native_clamp(true, static_cast<int16_t> (i), static_cast<int8_t> (-100 + i % 200)), result->GetValueAsInteger());
+    }
+    ASSERT_EQ(-10, clamp->Call(&ctx, Obj::Arg(Obj::Yes()), Obj::Arg(1000), Obj::Arg(10))->GetValueAsInteger());
+    ASSERT_EQ(-5, clamp->Call(&ctx, Obj::Arg(Obj::No()), Obj::Arg(-5), Obj::Arg(-1))->GetValueAsInteger());
+
+    // Переходники кешируются по сигнатуре
+    ObjType args[] = {ObjType::Bool, ObjType::Int16, ObjType::Int8};
+    JitCode::TrampolineType *trampoline = JitCode::GetTrampoline(args, 3, ObjType::Int16);
+    ASSERT_TRUE(trampoline);
+    ASSERT_EQ(trampoline, JitCode::GetTrampoline(args, 3, ObjType::Int16));
+    ASSERT_FALSE(JitCode::GetTrampoline(args, 3, ObjType::Dictionary));
+
+    // Функции с переменным числом аргументов вызываются через libffi
+    ObjPtr p = ctx.ExecStr("printf := :Pointer('printf(format:FmtChar, ...):Int32')");
+    for (int64_t i = 0; i < 200; i++) {
+        ASSERT_EQ(0, p->Call(&ctx, Obj::Arg(Obj::CreateString("%s")), Obj::Arg(Obj::CreateString("")))->GetValueAsInteger());
+    }
+
+    LOG_INFO("%s", JitCode::StatInfo().c_str());
+}
+
+TEST(JIT, DISABLED_Benchmark) {
+
+    const char * source = "jit_bench(count:Int64) := { cnt := 0; sum := 0; [cnt < $count] <-> { sum += cnt * 2 % 7; cnt += 1; }; sum }";
+    const int64_t calls = 2000;
+
+    int64_t times[2];
+    int64_t sums[2];
+    for (int jit = 0; jit < 2; jit++) {
+        Context::Reset();
+        Context ctx(RunTime::Init());
+        ctx.m_jit_enable = jit;
+
+        ObjPtr func = ctx.ExecStr(source);
+        ASSERT_TRUE(func);
+
+        sums[jit] = 0;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (int64_t i = 0; i < calls; i++) {
+            sums[jit] += func->Call(&ctx, Obj::Arg(100))->GetValueAsInteger();
+        }
+        times[jit] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        ASSERT_EQ(static_cast<bool> (jit), static_cast<bool> (func->m_jit));
+    }
+    ASSERT_EQ(sums[0], sums[1]);
+
+    LOG_INFO("%d calls with 100 iterations: interpreter %d us, JIT %d us",
+            (int) calls, (int) times[0], (int) times[1]);
+}
+
+#endif // UNITTEST
@@ -0,0 +1,126 @@
+#include "pch.h"
+
+#ifdef UNITTEST
+
+#include <warning_push.h>
+#include <gtest/gtest.h>
+#include <warning_pop.h>
+
+#include <chrono>
+
+#include <lazy.h>
+#include <newlang.h>
+
+using namespace newlang;
+
+/*
+ * Переменная с тензором заданного размера (создается скриптом, данные заменяются).
+ */
+static ObjPtr CreateLazyTensor(Context &ctx, const char *source, torch::Tensor tensor) {
+    ObjPtr result = ctx.ExecStr(source);
+    EXPECT_TRUE(result);
+    EXPECT_EQ(toTorchType(result->getType()), tensor.scalar_type());
+    result->m_tensor = tensor;
+    return result;
+}
+
+static void CheckLazyExpr(Context &ctx, const char *source) {
+    ctx.m_lazy_enable = false;
+    ObjPtr eager = ctx.ExecStr(source);
+    ctx.m_lazy_enable = true;
+    ObjPtr lazy = ctx.ExecStr(source);
+    ctx.m_lazy_enable = false;
+
+    ASSERT_TRUE(eager) << source;
+    ASSERT_TRUE(lazy) << source;
+    ASSERT_EQ(eager->getType(), lazy->getType()) << source;
+    ASSERT_EQ(eager->m_tensor.defined(), lazy->m_tensor.defined()) << source;
+    if(eager->m_tensor.defined()) {
+        ASSERT_EQ(eager->m_tensor.sizes(), lazy->m_tensor.sizes()) << source;
+        ASSERT_TRUE(torch::allclose(eager->m_tensor, lazy->m_tensor)) << source;
+    } else {
+        ASSERT_STREQ(eager->GetValueAsString().c_str(), lazy->GetValueAsString().c_str()) << source;
+    }
+}
+
+TEST(Lazy, Fusion) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    // Последний блок неполный
+    const int64_t size = TensorExpr::CHUNK_NUMEL * 3 + 5;
+
+    CreateLazyTensor(ctx, "a := :Float64([0.5,])", torch::rand({2, size}, torch::kFloat64));
+    CreateLazyTensor(ctx, "b := :Float64([0.5,])", torch::rand({2, size}, torch::kFloat64) + 1);
+    CreateLazyTensor(ctx, "c := :Float32([0.5,])", torch::rand({2, size}, torch::kFloat32));
+    CreateLazyTensor(ctx, "i := :Int32([1,])", torch::randint(-1000, 1000, {2, size}, torch::kInt32));
+    CreateLazyTensor(ctx, "row := :Float64([0.5,])", torch::rand({size}, torch::kFloat64));
+    ctx.ExecStr("scalar := 3");
+
+    CheckLazyExpr(ctx, "a + b * a - b");
+    CheckLazyExpr(ctx, "(a - 0.5) * (b + 2) / (a * a + 1)");
+    CheckLazyExpr(ctx, "a * (scalar + 1) - scalar");
+    CheckLazyExpr(ctx, "i * 3 + i - 7");
+    CheckLazyExpr(ctx, "i * i - i * 2");
+
+    // Повышение типа промежуточных значений
+    CheckLazyExpr(ctx, "c * 2 + c / 3");
+    CheckLazyExpr(ctx, "i / 2 + a");
+    CheckLazyExpr(ctx, "a + i * 2");
+    CheckLazyExpr(ctx, "c + a * c");
+
+    // Вычисляются обычными операторами
+    CheckLazyExpr(ctx, "a + row");
+    CheckLazyExpr(ctx, "[1, 2, 3,] * 2 + [4, 5, 6,]");
+    CheckLazyExpr(ctx, "scalar * 2 + 1");
+    CheckLazyExpr(ctx, "1\\2 + scalar");
+
+    // Результат вычисляется при выходе из выражения
+    ctx.m_lazy_enable = true;
+    ObjPtr total = ctx.ExecStr("total := a * 2 + b");
+    ASSERT_TRUE(total);
+    ASSERT_EQ(ObjType::Float64, total->getType());
+    ASSERT_TRUE(torch::allclose(total->m_tensor, ctx.ExecStr("a")->m_tensor * 2 + ctx.ExecStr("b")->m_tensor));
+    ASSERT_TRUE(ctx.ExecStr("a * 2 == a + a")->GetValueAsBoolean());
+    ASSERT_FALSE(ctx.ExecStr("total == a + b")->GetValueAsBoolean());
+
+    LOG_INFO("%s", TensorExpr::StatInfo().c_str());
+}
+
+TEST(Lazy, Benchmark) {
+
+    // Цепочка из 15 поэлементных операторов над тензорами из 4 млн элементов
+    const char * source = "(a * 0.5 + b) * (a - b) / (b + 1) + a * a - b * 3 + (a + 2) * (b - 0.25) - a / 4";
+    const int64_t size = 4 * 1024 * 1024;
+    const int repeat = 5;
+
+    torch::Tensor data_a = torch::rand({size}, torch::kFloat32);
+    torch::Tensor data_b = torch::rand({size}, torch::kFloat32);
+
+    int64_t times[2];
+    torch::Tensor results[2];
+    for (int lazy = 0; lazy < 2; lazy++) {
+        Context::Reset();
+        Context ctx(RunTime::Init());
+
+        CreateLazyTensor(ctx, "a := :Float32([0.5,])", data_a);
+        CreateLazyTensor(ctx, "b := :Float32([0.5,])", data_b);
+        ctx.m_lazy_enable = lazy;
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++) {
+            ObjPtr result = ctx.ExecStr(source);
+            ASSERT_TRUE(result);
+            results[lazy] = result->m_tensor;
+        }
+        times[lazy] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    }
+    ASSERT_EQ(results[0].scalar_type(), results[1].scalar_type());
+    ASSERT_TRUE(torch::allclose(results[0], results[1]));
+
+    LOG_INFO("%d evaluations of 15 operators on %d elements: eager %d ms, lazy %d ms",
+            repeat, (int) size, (int) times[0], (int) times[1]);
+}
+
+#endif // UNITTEST
@@ -6,6 +6,8 @@
 #include <gtest/gtest.h>
 #include <warning_pop.h>
 
+#include <chrono>
+
 #include <nlc.h>
 #include "builtin.h"
 
@@ -120,6 +122,234 @@ TEST(NLC, Eval) {
     ASSERT_EQ(1, nlc7.Run());
 }
 
+/*
+ * Восстанавливает количество потоков и привязку к процессорам при выходе из теста, в том числе при ошибке
+ */
+class ThreadsGuard {
+public:
+
+    ThreadsGuard() : m_threads(RunTime::GetThreads()), m_affinity(RunTime::GetAffinity()) {
+    }
+
+    ~ThreadsGuard() {
+        RunTime::SetThreads(m_threads);
+        if(!m_affinity.empty()) {
+            RunTime::SetAffinity(m_affinity);
+        }
+    }
+
+    const int64_t m_threads;
+    const std::string m_affinity;
+};
+
+TEST(NLC, Threads) {
+
+    ThreadsGuard guard;
+    const std::string &affinity = guard.m_affinity;
+    ASSERT_FALSE(affinity.empty());
+
+    // Системные аргументы RunTime (первый доступный процессор)
+    std::string cpu = affinity.substr(0, affinity.find_first_of(",-"));
+    std::string affinity_arg("-nlc-affinity=");
+    affinity_arg += cpu;
+    const char * args[] = {"path", "-nlc-threads=1", affinity_arg.c_str()};
+    RuntimePtr rt = RunTime::Init(3, args);
+    ASSERT_TRUE(rt);
+    ASSERT_EQ(1, RunTime::GetThreads());
+    ASSERT_STREQ(cpu.c_str(), RunTime::GetAffinity().c_str());
+
+    RunTime::SetAffinity(affinity);
+    ASSERT_STREQ(affinity.c_str(), RunTime::GetAffinity().c_str());
+
+    const char * bad_count[] = {"path", "-nlc-threads=0"};
+    ASSERT_ANY_THROW(RunTime::Init(2, bad_count));
+    const char * bad_arg[] = {"path", "-nlc-unknown=1"};
+    ASSERT_ANY_THROW(RunTime::Init(2, bad_arg));
+    ASSERT_ANY_THROW(RunTime::SetAffinity("1-"));
+    ASSERT_ANY_THROW(RunTime::SetInteropThreads(-1));
+
+    // Аргументы -nlc-... не передаются в разбор опций nlc
+    NLC nlc("path -nlc-threads=2 --load=module.nlm 100+200");
+    ASSERT_EQ(NLC::Mode::ModeEval, nlc.m_mode) << nlc.m_output;
+    ASSERT_STREQ("100+200", nlc.m_eval.c_str());
+    ASSERT_EQ(2, RunTime::GetThreads());
+
+    // Управление потоками из скрипта
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ObjPtr info = ctx.ExecStr("threads()");
+    ASSERT_TRUE(info);
+    ASSERT_EQ(2, info->at("threads").second->GetValueAsInteger());
+    ASSERT_EQ(RunTime::GetInteropThreads(), info->at("interop").second->GetValueAsInteger());
+    ASSERT_STREQ(affinity.c_str(), info->at("affinity").second->GetValueAsString().c_str());
+
+    info = ctx.ExecStr("threads(1)");
+    ASSERT_EQ(1, info->at("threads").second->GetValueAsInteger());
+    ASSERT_EQ(1, RunTime::GetThreads());
+
+    info = ctx.ExecStr("threads(threads=3)");
+    ASSERT_EQ(3, RunTime::GetThreads());
+    ASSERT_ANY_THROW(ctx.ExecStr("threads(unknown=1)"));
+}
+
+/*
+ * Время основных операций над тензорами в зависимости от количества потоков libtorch.
+ */
+TEST(NLC, DISABLED_ThreadsBenchmark) {
+
+    ThreadsGuard guard;
+    const int64_t threads = guard.m_threads;
+    const int64_t size = 4 * 1024 * 1024;
+    const int repeat = 5;
+    const char * ops[] = {
+        "a + b",
+        "a * b - a",
+        "a / (b + 1)",
+        "a * 0.5 + b * a - b / 4",
+    };
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ObjPtr a = ctx.ExecStr("a := :Float32([0.5,])");
+    ObjPtr b = ctx.ExecStr("b := :Float32([0.5,])");
+    ASSERT_TRUE(a && b);
+    a->m_tensor = torch::rand({size}, torch::kFloat32);
+    b->m_tensor = torch::rand({size}, torch::kFloat32);
+    torch::Tensor matrix = torch::rand({512, 512}, torch::kFloat32);
+
+    std::vector<int64_t> counts;
+    for (int64_t count = 1; count < std::max<int64_t>(threads, 2); count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(std::max<int64_t>(threads, 2));
+
+    std::map<std::string, torch::Tensor> results;
+    for (int64_t count : counts) {
+        RunTime::SetThreads(count);
+        ASSERT_EQ(count, RunTime::GetThreads());
+
+        std::string line("threads ");
+        line += std::to_string(count);
+        line += ":";
+        for (int lazy = 0; lazy < 2; lazy++) {
+            ctx.m_lazy_enable = lazy;
+            for (auto op : ops) {
+                std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+                ObjPtr result;
+                for (int i = 0; i < repeat; i++) {
+                    result = ctx.ExecStr(op);
+                }
+                int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+                ASSERT_TRUE(result);
+
+                // Результат не зависит от количества потоков
+                std::string key(op);
+                key += lazy ? " (lazy)" : "";
+                if(results.find(key) == results.end()) {
+                    results[key] = result->m_tensor;
+                } else {
+                    ASSERT_TRUE(torch::allclose(results[key], result->m_tensor)) << key;
+                }
+                line += "  '" + key + "' ";
+                line += std::to_string(time / repeat / 1000);
+                line += " ms";
+            }
+        }
+        ctx.m_lazy_enable = false;
+
+        torch::Tensor product;
+        torch::Tensor total;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++) {
+            product = torch::matmul(matrix, matrix);
+            total = a->m_tensor.sum();
+        }
+        ASSERT_TRUE(product.defined() && total.defined());
+        int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        line += "  'matmul 512x512 + sum' ";
+        line += std::to_string(time / repeat / 1000);
+        line += " ms";
+
+        LOG_INFO("%s", line.c_str());
+    }
+}
+
+TEST(NLC, ExecModule) {
+
+    std::filesystem::create_directories("temp");
+    ASSERT_TRUE(std::filesystem::is_directory("temp"));
+
+    std::ofstream out("temp/exec.temp.nlp", std::ios::trunc);
+    out << "exec_str := \"Привет, мир??!\"; exec_val := 10;\n";
+    out << "exec_val * 2\n";
+    out.close();
+
+    NLC compile("path --compile=temp/exec.temp.nlp");
+    ASSERT_EQ(NLC::Mode::ModeCompile, compile.m_mode) << compile.m_output;
+    ASSERT_STREQ("temp/exec.temp.nlp", compile.m_ifile.c_str());
+
+    NLC exec("path -x temp/exec.temp");
+    ASSERT_EQ(NLC::Mode::ModeExec, exec.m_mode) << exec.m_output;
+
+    std::string key = Compiler::MakeModuleKey(ReadFile("temp/exec.temp.nlp"));
+    ASSERT_EQ(32, key.size());
+    std::string stamp = Compiler::MakeModuleStamp("temp/exec.temp.nlp");
+    ASSERT_FALSE(stamp.empty());
+    ASSERT_TRUE(Compiler::MakeModuleStamp("temp/not_found.temp.nlp").empty());
+    std::string cache = Compiler::MakeModuleCacheName("temp/exec.temp.nlp");
+    ASSERT_STREQ("temp/exec.temp.nlm", cache.c_str());
+    std::remove(cache.c_str());
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    // md5 модуля считается по исходному тексту, а не по уже прочитанному файлу
+    Ref<Module> module = MakeRef<Module>();
+    ASSERT_TRUE(module->Load(ctx, "temp/exec.temp.nlp", false));
+    ASSERT_STREQ(GetTextMD5(ReadFile("temp/exec.temp.nlp")).c_str(), module->m_md5.c_str());
+    ASSERT_STRNE(GetTextMD5("").c_str(), module->m_md5.c_str());
+
+    // Модуль, собранный nlc --compile, находит nlc --exec
+    if(!Compiler::GetCompilerVersion().empty()) {
+        ASSERT_EQ(0, compile.Run());
+        ASSERT_STREQ(cache.c_str(), compile.m_ofile.c_str());
+        ASSERT_TRUE(std::filesystem::exists(cache));
+        std::remove(cache.c_str());
+    }
+
+    // Без компилятора модуль не создается и файл выполняется интерпретатором
+    ObjPtr result = ctx.m_runtime->ExecModule("temp/exec.temp.nlp", nullptr, true, &ctx);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(20, result->GetValueAsInteger());
+    ASSERT_EQ(!Compiler::GetCompilerVersion().empty(), std::filesystem::exists(cache));
+
+    result = ctx.m_runtime->ExecModule("temp/exec.temp.nlp", nullptr, true, &ctx);
+    ASSERT_EQ(20, result->GetValueAsInteger());
+    ASSERT_STREQ("Привет, мир??!", ctx.ExecStr("exec_str")->GetValueAsString().c_str());
+
+    // При неизменной метке файла исходный текст не читается и выполняется текст из модуля
+    if(!Compiler::GetCompilerVersion().empty()) {
+        std::filesystem::file_time_type time = std::filesystem::last_write_time("temp/exec.temp.nlp");
+        out.open("temp/exec.temp.nlp", std::ios::trunc);
+        out << "exec_str := \"Привет, мир??!\"; exec_val := 10;\n";
+        out << "exec_val * 4\n";
+        out.close();
+        std::filesystem::last_write_time("temp/exec.temp.nlp", time);
+        ASSERT_STREQ(stamp.c_str(), Compiler::MakeModuleStamp("temp/exec.temp.nlp").c_str());
+        ASSERT_EQ(20, ctx.m_runtime->ExecModule("temp/exec.temp.nlp", nullptr, true, &ctx)->GetValueAsInteger());
+    }
+
+    // Другой исходный текст - другой ключ и метка модуля
+    out.open("temp/exec.temp.nlp", std::ios::trunc);
+    out << "exec_val := 10; exec_val * 3\n";
+    out.close();
+    ASSERT_STRNE(key.c_str(), Compiler::MakeModuleKey(ReadFile("temp/exec.temp.nlp")).c_str());
+    ASSERT_STRNE(stamp.c_str(), Compiler::MakeModuleStamp("temp/exec.temp.nlp").c_str());
+    ASSERT_EQ(30, ctx.m_runtime->ExecModule("temp/exec.temp.nlp", nullptr, true, &ctx)->GetValueAsInteger());
+}
+
 /*
  * #!./dist/Debug/GNU-Linux/nlc --exec
  * print(str="") $= { %{ printf("%s", static_cast<char *>($str)); return $str; %} };
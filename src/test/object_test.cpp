@@ -8,6 +8,8 @@
 #include <gtest/gtest.h>
 #include <warning_pop.h>
 
+#include <chrono>
+
 #include <term.h>
 #include <context.h>
 #include <object.h>
@@ -219,6 +221,129 @@ TEST(ObjTest, Dict) {
     ASSERT_TRUE((*var3)[3].second->op_accurate(Obj::CreateString(L"Test3")));
 }
 
+TEST(ObjTest, DictIndex) {
+
+    ObjPtr dict = Obj::CreateDict();
+    for (int64_t i = 0; i < 100; i++) {
+        dict->push_back(Obj::CreateValue(i, ObjType::None), "name" + std::to_string(i));
+    }
+
+    // Поиск по имени через индекс и позиционный доступ
+    ASSERT_EQ(57, dict->at("name57").second->GetValueAsInteger());
+    ASSERT_TRUE(dict->find("none") == dict->end());
+    ASSERT_EQ(99, dict->at(-1).second->GetValueAsInteger());
+    ASSERT_EQ(0, dict->at(-100).second->GetValueAsInteger());
+    ASSERT_ANY_THROW(dict->at(100));
+    ASSERT_ANY_THROW(dict->at(-101));
+
+    // При повторе имени находится первый элемент
+    dict->push_back(Obj::CreateValue(1000, ObjType::None), "name10");
+    ASSERT_EQ(10, dict->at("name10").second->GetValueAsInteger());
+
+    dict->erase(0);
+    ASSERT_TRUE(dict->find("name0") == dict->end());
+    ASSERT_EQ(10, dict->at("name10").second->GetValueAsInteger());
+
+    dict->insert(dict->at_index_const(0), Obj::Arg(-1, "first"));
+    ASSERT_EQ(-1, dict->at("first").second->GetValueAsInteger());
+    ASSERT_EQ(57, dict->at("name57").second->GetValueAsInteger());
+
+    // Отрицательный размер удаляет или добавляет элементы в начале
+    dict->resize_(-10, nullptr);
+    ASSERT_EQ(10, dict->size());
+    ASSERT_EQ(91, dict->at(0).second->GetValueAsInteger());
+    ASSERT_TRUE(dict->find("name57") == dict->end());
+    ASSERT_EQ(95, dict->at("name95").second->GetValueAsInteger());
+
+    dict->resize_(-12, nullptr);
+    ASSERT_EQ(12, dict->size());
+    ASSERT_TRUE(dict->at(0).second->is_none_type());
+    ASSERT_EQ(91, dict->at(2).second->GetValueAsInteger());
+
+    dict->resize_(-12, nullptr);
+    ASSERT_EQ(12, dict->size());
+
+    // Индекс не должен указывать на удаленные с конца элементы
+    Variable<Obj> var;
+    for (int64_t i = 0; i < 100; i++) {
+        var.push_back(Obj::CreateValue(i, ObjType::None), "item" + std::to_string(i));
+    }
+    ASSERT_EQ(99, var.at("item99").second->GetValueAsInteger());
+    var.pop_back();
+    var.push_back(Obj::CreateValue(1000, ObjType::None), "last");
+    ASSERT_TRUE(var.find("item99") == var.end());
+    ASSERT_EQ(1000, var.at("last").second->GetValueAsInteger());
+
+    var.resize(50, nullptr);
+    var.push_back(Obj::CreateValue(2000, ObjType::None), "tail");
+    ASSERT_TRUE(var.find("item60") == var.end());
+    ASSERT_EQ(49, var.at("item49").second->GetValueAsInteger());
+    ASSERT_EQ(2000, var.at("tail").second->GetValueAsInteger());
+
+    // Удаление элементов по именам другого словаря (operator -=)
+    ObjPtr names = Obj::CreateDict();
+    for (int64_t i = 0; i < 100; i++) {
+        names->push_back(Obj::CreateValue(i, ObjType::None), "name" + std::to_string(i));
+    }
+    ASSERT_EQ(50, names->at("name50").second->GetValueAsInteger());
+    names->operator-=(Obj::CreateDict(Obj::Arg(0, "name50")));
+    names->push_back(Obj::CreateValue(3000, ObjType::None), "added");
+    ASSERT_EQ(100, names->size());
+    ASSERT_TRUE(names->find("name50") == names->end());
+    ASSERT_EQ(51, names->at("name51").second->GetValueAsInteger());
+    ASSERT_EQ(3000, names->at("added").second->GetValueAsInteger());
+
+    // Отрицательный размер для списка на основе std::list
+    VariableList<Obj> list;
+    for (int64_t i = 0; i < 3; i++) {
+        list.push_back(Obj::CreateValue(i, ObjType::None), "list" + std::to_string(i));
+    }
+    ASSERT_EQ(5, list.resize(-5, nullptr));
+    ASSERT_FALSE(list.at(0).second);
+    ASSERT_EQ(0, list.at(2).second->GetValueAsInteger());
+    ASSERT_EQ(5, list.resize(-5, nullptr));
+    ASSERT_EQ(2, list.resize(-2, nullptr));
+    ASSERT_EQ(1, list.at("list1").second->GetValueAsInteger());
+}
+
+TEST(ObjTest, DISABLED_DictBenchmark) {
+
+    for (int64_t count : {10000, 1000000}) {
+
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (int64_t i = 0; i < count; i++) {
+            names.push_back("name" + std::to_string(i));
+        }
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        ObjPtr dict = Obj::CreateDict();
+        for (int64_t i = 0; i < count; i++) {
+            dict->push_back(Obj::CreateValue(i, ObjType::None), names[i]);
+        }
+        std::chrono::steady_clock::time_point build = std::chrono::steady_clock::now();
+
+        int64_t sum = 0;
+        for (int64_t i = 0; i < count; i++) {
+            sum += dict->at(i).second->GetValueAsInteger();
+        }
+        std::chrono::steady_clock::time_point index = std::chrono::steady_clock::now();
+
+        for (int64_t i = 0; i < count; i++) {
+            sum -= dict->at(names[i]).second->GetValueAsInteger();
+        }
+        std::chrono::steady_clock::time_point name = std::chrono::steady_clock::now();
+
+        ASSERT_EQ(0, sum);
+        ASSERT_EQ(count, dict->size());
+
+        LOG_INFO("Dictionary of %d items: build %d ms, access by index %d ms, by name %d ms", (int) count,
+                (int) std::chrono::duration_cast<std::chrono::milliseconds>(build - begin).count(),
+                (int) std::chrono::duration_cast<std::chrono::milliseconds>(index - build).count(),
+                (int) std::chrono::duration_cast<std::chrono::milliseconds>(name - index).count());
+    }
+}
+
 TEST(ObjTest, AsMap) {
 
     ObjPtr map = Obj::CreateType(ObjType::Dictionary);
@@ -347,6 +472,93 @@ TEST(ObjTest, Ops) {
     EXPECT_EQ(ObjType::Float64, var_tensor->m_var_type_current) << newlang::toString(var_char->m_var_type_current);
 }
 
+TEST(ObjTest, ScalarOps) {
+
+    ObjPtr var = Obj::CreateValue(1);
+    var->operator+=(Obj::CreateValue(100));
+    ASSERT_EQ(101, var->GetValueAsInteger());
+    ASSERT_EQ(ObjType::Int8, var->m_var_type_current);
+
+    var->operator*=(Obj::CreateValue(1000));
+    ASSERT_EQ(101000, var->GetValueAsInteger());
+    ASSERT_EQ(ObjType::Int32, var->m_var_type_current);
+
+    var->operator-=(Obj::CreateValue(0.5));
+    ASSERT_DOUBLE_EQ(100999.5, var->GetValueAsNumber());
+    ASSERT_EQ(ObjType::Float64, var->m_var_type_current);
+
+    ObjPtr sum = Obj::CreateValue(2)->operator+(Obj::CreateValue(3));
+    ASSERT_EQ(5, sum->GetValueAsInteger());
+    ASSERT_EQ(ObjType::Int8, sum->m_var_type_current);
+
+    ObjPtr fixed = Obj::CreateValue(10, ObjType::Int8);
+    fixed->operator+=(Obj::CreateValue(1));
+    ASSERT_EQ(11, fixed->GetValueAsInteger());
+    ASSERT_EQ(ObjType::Int8, fixed->m_var_type_fixed);
+
+    ASSERT_TRUE(Obj::CreateValue(1)->operator<(Obj::CreateValue(1.5)));
+    ASSERT_TRUE(Obj::CreateValue(2)->operator>=(Obj::CreateValue(2)));
+    ASSERT_FALSE(Obj::CreateValue(3)->operator<=(Obj::CreateValue(-3)));
+    ASSERT_TRUE(Obj::CreateValue(2)->op_equal(Obj::CreateValue(2.0)));
+    ASSERT_FALSE(Obj::CreateValue(2)->op_equal(Obj::CreateValue(3)));
+}
+
+TEST(ObjTest, Shared) {
+
+    // Один и тот же объект для всех вызовов
+    ASSERT_EQ(Obj::Yes().get(), Obj::Yes().get());
+    ASSERT_EQ(Obj::No().get(), Obj::No().get());
+    ASSERT_EQ(Obj::None().get(), Obj::None().get());
+    ASSERT_TRUE(Obj::Yes()->GetValueAsBoolean());
+    ASSERT_FALSE(Obj::No()->GetValueAsBoolean());
+    ASSERT_TRUE(Obj::None()->is_none_type());
+    ASSERT_TRUE(Obj::Yes()->is_const());
+    ASSERT_TRUE(Obj::No()->is_const());
+    ASSERT_TRUE(Obj::None()->is_const());
+    ASSERT_ANY_THROW(Obj::None()->SetValue_(Obj::CreateValue(1)));
+    ASSERT_TRUE(Obj::None()->is_none_type());
+
+    // Копия общего объекта изменяется без ошибки
+    ObjPtr none = Obj::None();
+    Obj::CopyOnWrite(none);
+    ASSERT_NE(Obj::None().get(), none.get());
+    ASSERT_FALSE(none->is_const());
+    ObjPtr yes = Obj::Yes();
+    Obj::CopyOnWrite(yes);
+    ASSERT_FALSE(yes->is_const());
+
+    ObjPtr value = Obj::SharedValue(100);
+    ASSERT_TRUE(value->m_is_shared);
+    ASSERT_EQ(value.get(), Obj::SharedValue(100).get());
+    ASSERT_EQ(100, value->GetValueAsInteger());
+    ASSERT_EQ(ObjType::Int8, value->m_var_type_current);
+    ASSERT_EQ(Obj::SHARED_INT_MIN, Obj::SharedValue(Obj::SHARED_INT_MIN)->GetValueAsInteger());
+    ASSERT_EQ(Obj::SHARED_INT_MAX, Obj::SharedValue(Obj::SHARED_INT_MAX)->GetValueAsInteger());
+
+    // Значения вне диапазона создаются каждый раз
+    ObjPtr big = Obj::SharedValue(Obj::SHARED_INT_MAX + 1);
+    ASSERT_FALSE(big->m_is_shared);
+    ASSERT_NE(big.get(), Obj::SharedValue(Obj::SHARED_INT_MAX + 1).get());
+
+    // Копирование при записи
+    ObjPtr write = value;
+    Obj::CopyOnWrite(write);
+    ASSERT_NE(value.get(), write.get());
+    ASSERT_FALSE(write->m_is_shared);
+    write->operator+=(Obj::CreateValue(1));
+    ASSERT_EQ(101, write->GetValueAsInteger());
+    ASSERT_EQ(100, Obj::SharedValue(100)->GetValueAsInteger());
+
+    ObjPtr dict = Obj::CreateDict();
+    dict->push_back(Obj::SharedValue(5));
+    dict->push_back(Obj::Yes());
+    ASSERT_NE(Obj::SharedValue(5).get(), (*dict)[0].second.get());
+    ASSERT_NE(Obj::Yes().get(), (*dict)[1].second.get());
+    (*dict)[0].second->operator+=(Obj::CreateValue(1));
+    ASSERT_EQ(6, (*dict)[0].second->GetValueAsInteger());
+    ASSERT_EQ(5, Obj::SharedValue(5)->GetValueAsInteger());
+}
+
 TEST(ObjTest, Exist) {
 
     Obj var_array(ObjType::Dictionary);
@@ -887,6 +1099,42 @@ TEST(ObjTest, Tensor) {
 
 }
 
+TEST(ObjTest, CopyOnWrite) {
+
+    // Копия использует данные исходного тензора до первого изменения
+    ObjPtr tensor = Obj::CreateTensor(torch::arange(1000, torch::kInt32));
+    ObjPtr copy = tensor->Clone();
+    ASSERT_EQ(tensor->m_tensor.data_ptr(), copy->m_tensor.data_ptr());
+
+    copy->operator+=(Obj::CreateValue(1));
+    ASSERT_NE(tensor->m_tensor.data_ptr(), copy->m_tensor.data_ptr());
+    ASSERT_TRUE(torch::equal(torch::arange(1000, torch::kInt32), tensor->m_tensor));
+    ASSERT_TRUE(torch::equal(torch::arange(1, 1001, torch::kInt32), copy->m_tensor));
+
+    // Изменение исходного объекта не затрагивает копию
+    copy = tensor->Clone();
+    tensor->index_set_({0}, Obj::CreateValue(100));
+    ASSERT_EQ(100, tensor->index_get({0})->GetValueAsInteger());
+    ASSERT_EQ(0, copy->index_get({0})->GetValueAsInteger());
+
+    // Данные без копий изменяются на месте
+    copy.reset();
+    void *ptr = tensor->m_tensor.data_ptr();
+    tensor->operator*=(Obj::CreateValue(2));
+    ASSERT_EQ(ptr, tensor->m_tensor.data_ptr());
+    ASSERT_EQ(200, tensor->index_get({0})->GetValueAsInteger());
+
+    // Представление строки матрицы
+    ObjPtr matrix = Obj::CreateTensor(torch::arange(12, torch::kInt32).reshape({3, 4}));
+    ObjPtr row = matrix->index_get({1});
+    ASSERT_EQ(matrix->m_tensor[1].data_ptr(), row->m_tensor.data_ptr());
+    row->operator+=(Obj::CreateValue(10));
+    ASSERT_EQ(4, matrix->index_get({1, 0})->GetValueAsInteger());
+    ASSERT_EQ(14, row->index_get({0})->GetValueAsInteger());
+
+    LOG_INFO("%s", Obj::TensorStatInfo().c_str());
+}
+
 TEST(ObjTest, Iterator) {
 
     ObjPtr dict = Obj::CreateDict();
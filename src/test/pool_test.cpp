@@ -0,0 +1,82 @@
+#include "pch.h"
+
+#ifdef UNITTEST
+
+#include <warning_push.h>
+#include <gtest/gtest.h>
+#include <warning_pop.h>
+
+#include <thread>
+
+#include <pool.h>
+#include <object.h>
+
+using namespace newlang;
+
+TEST(Pool, Alloc) {
+
+    const size_t cls = MemoryPool::SizeClass(40);
+    ASSERT_EQ(MemoryPool::SizeClass(33), cls);
+    ASSERT_EQ(MemoryPool::SizeClass(48), cls);
+    ASSERT_NE(MemoryPool::SizeClass(49), cls);
+
+    int64_t live = MemoryPool::GetLive(cls);
+    int64_t used = MemoryPool::GetUsedBytes();
+
+    void *first = MemoryPool::Alloc(40);
+    void *second = MemoryPool::Alloc(40);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    ASSERT_NE(first, second);
+    ASSERT_EQ(0U, reinterpret_cast<uintptr_t> (first) % MemoryPool::ALIGN);
+    ASSERT_EQ(live + 2, MemoryPool::GetLive(cls));
+    ASSERT_EQ(used + 96, MemoryPool::GetUsedBytes());
+    ASSERT_LE(MemoryPool::GetUsedBytes(), MemoryPool::GetPeakBytes());
+
+    // Освобожденный элемент используется повторно
+    MemoryPool::Free(second, 40);
+    ASSERT_EQ(second, MemoryPool::Alloc(48));
+
+    MemoryPool::Free(first, 40);
+    MemoryPool::Free(second, 48);
+    ASSERT_EQ(live, MemoryPool::GetLive(cls));
+    ASSERT_EQ(used, MemoryPool::GetUsedBytes());
+
+    // Большие блоки передаются системному распределителю
+    int64_t large = MemoryPool::GetLive(MemoryPool::CLASS_COUNT);
+    void *big = MemoryPool::Alloc(MemoryPool::MAX_SIZE + 1);
+    ASSERT_EQ(large + 1, MemoryPool::GetLive(MemoryPool::CLASS_COUNT));
+    MemoryPool::Free(big, MemoryPool::MAX_SIZE + 1);
+    ASSERT_EQ(large, MemoryPool::GetLive(MemoryPool::CLASS_COUNT));
+}
+
+TEST(Pool, Threads) {
+
+    std::vector<ObjPtr> shared;
+    std::vector<std::thread> threads;
+
+    // Объекты, созданные в одном потоке, удаляются в другом
+    for (int i = 0; i < 4; i++) {
+        shared.push_back(Obj::CreateDict());
+    }
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([i, &shared]() {
+            ObjPtr dict = shared[i];
+            for (int64_t pos = 0; pos < 10000; pos++) {
+                dict->push_back(Obj::CreateValue(pos, ObjType::None));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(10000, shared[i]->size());
+        ASSERT_EQ(9999, (*shared[i])[9999].second->GetValueAsInteger());
+    }
+
+    LOG_INFO("%s", MemoryPool::StatInfo().c_str());
+    shared.clear();
+}
+
+#endif // UNITTEST
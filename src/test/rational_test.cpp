@@ -8,7 +8,12 @@
 #include <gtest/gtest.h>
 #include <warning_pop.h>
 
+#include <chrono>
+#include <random>
+#include <sstream>
+
 #include <rational.h>
+#include <newlang.h>
 
 using namespace newlang;
 
@@ -64,4 +69,380 @@ TEST(ObjTest, BigNum) {
 
 }
 
+TEST(ObjTest, Rational) {
+
+    Rational value("1", "3");
+    value += Rational("1", "6");
+    ASSERT_STREQ("1\\2", value.GetAsString().c_str());
+    ASSERT_FALSE(value.isBig());
+
+    // Литерал сохраняется без сокращения
+    ASSERT_STREQ("2\\4", Rational("2", "4").GetAsString().c_str());
+    ASSERT_TRUE(Rational("222222222222222222222222", "1111").isBig());
+
+    // Переполнение int64_t переводит дробь в BigNum и обратно
+    Rational max(std::numeric_limits<int64_t>::max());
+    max += Rational(1);
+    ASSERT_TRUE(max.isBig());
+    ASSERT_STREQ("9223372036854775808\\1", max.GetAsString().c_str());
+    max -= Rational(1);
+    ASSERT_FALSE(max.isBig());
+    ASSERT_EQ(std::numeric_limits<int64_t>::max(), max.GetAsInteger());
+    ASSERT_TRUE(Rational(std::numeric_limits<int64_t>::min()).isBig());
+
+    Rational fact(1);
+    for (int i = 1; i <= 30; i++) {
+        fact *= Rational(i);
+    }
+    ASSERT_TRUE(fact.isBig());
+    ASSERT_STREQ("265252859812191058636308480000000\\1", fact.GetAsString().c_str());
+    ASSERT_LT(0, fact.op_compare(Rational(1)));
+    ASSERT_GT(0, Rational(1).op_compare(fact));
+    ASSERT_FALSE(fact.op_equal(Rational(1)));
+
+    Rational div(fact);
+    for (int i = 30; i >= 1; i--) {
+        div /= Rational(i);
+    }
+    ASSERT_FALSE(div.isBig());
+    ASSERT_STREQ("1\\1", div.GetAsString().c_str());
+
+    // Знак дроби хранится в числителе
+    Rational neg(3);
+    neg /= Rational(-6);
+    ASSERT_STREQ("-1\\2", neg.GetAsString().c_str());
+    ASSERT_EQ(0, Rational("1", "3").op_compare(Rational("2", "6")));
+    ASSERT_ANY_THROW(neg /= Rational(0));
+
+    // Сокращение длинной дроби откладывается, но не влияет на значение
+    Rational big_frac("100000000000000000000", "3");
+    big_frac *= Rational("3", "100000000000000000000");
+    ASSERT_TRUE(big_frac.op_equal(Rational(1)));
+    ASSERT_STREQ("1\\1", big_frac.GetAsString().c_str());
+
+    Rational self(fact);
+    self += self;
+    self /= self;
+    ASSERT_STREQ("1\\1", self.GetAsString().c_str());
+}
+
+namespace {
+
+    /*
+     * Дробь только из BigNum с сокращением после каждой операции (как до появления малого представления)
+     */
+    struct BigRational {
+        BigNum num;
+        BigNum den;
+
+        BigRational(int64_t value) : num(value), den(1) {
+        }
+
+        void reduce() {
+            BigNum::CtxHelper ctx;
+            BigNum gcd;
+            BN_gcd(gcd.value, num.value, den.value, ctx.ctx);
+            BigNum rem;
+            num.div(gcd, rem);
+            den.div(gcd, rem);
+        }
+
+        void add(const BigRational &value) {
+            BigNum add_num(value.num);
+            add_num.mul(den);
+            num.mul(value.den);
+            den.mul(value.den);
+            num.add(add_num);
+            reduce();
+        }
+
+        void mul(const BigRational &value) {
+            num.mul(value.num);
+            den.mul(value.den);
+            reduce();
+        }
+
+        void div(const BigRational &value) {
+            num.mul(value.den);
+            den.mul(value.num);
+            reduce();
+        }
+    };
+
+    int64_t ElapsedMicro(std::chrono::steady_clock::time_point begin) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    /*
+     * Левая свертка элементов диапазона для проверки prod и sum
+     */
+    std::string FoldRange(int64_t start, int64_t stop, int64_t step, bool product) {
+        Rational result(product ? 1 : 0);
+        for (int64_t i = start; step > 0 ? i < stop : i > stop; i += step) {
+            if(product) {
+                result *= Rational(i);
+            } else {
+                result += Rational(i);
+            }
+        }
+        return result.GetAsString();
+    }
+
+    /*
+     * Восстанавливает количество потоков libtorch при выходе из теста
+     */
+    struct ThreadsRestore {
+        const int64_t threads = RunTime::GetThreads();
+
+        ~ThreadsRestore() {
+            RunTime::SetThreads(threads);
+        }
+    };
+}
+
+TEST(ObjTest, RationalBenchmark) {
+
+    const int64_t count = 1000;
+
+    // Гармонический ряд и факториал с результатами в пределах int64_t
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    BigRational big_sum(0);
+    for (int64_t rep = 0; rep < count; rep++) {
+        BigRational sum(0);
+        for (int64_t i = 1; i <= 20; i++) {
+            BigRational item(1);
+            item.div(BigRational(i));
+            sum.add(item);
+        }
+        BigRational fact(1);
+        for (int64_t i = 1; i <= 20; i++) {
+            fact.mul(BigRational(i));
+        }
+        big_sum = sum;
+    }
+    int64_t big_time = ElapsedMicro(begin);
+
+    begin = std::chrono::steady_clock::now();
+    Rational small_sum;
+    for (int64_t rep = 0; rep < count; rep++) {
+        Rational sum(0);
+        for (int64_t i = 1; i <= 20; i++) {
+            Rational item(1);
+            item /= Rational(i);
+            sum += item;
+        }
+        Rational fact(1);
+        for (int64_t i = 1; i <= 20; i++) {
+            fact *= Rational(i);
+        }
+        ASSERT_FALSE(fact.isBig());
+        small_sum = sum;
+    }
+    int64_t small_time = ElapsedMicro(begin);
+
+    ASSERT_STREQ("55835135\\15519504", small_sum.GetAsString().c_str());
+    ASSERT_STREQ(big_sum.num.GetAsString().c_str(), "55835135");
+    ASSERT_STREQ(big_sum.den.GetAsString().c_str(), "15519504");
+
+    LOG_INFO("%d rational series: BigNum only %d us, int64_t with BigNum on overflow %d us",
+            (int) count, (int) big_time, (int) small_time);
+
+
+    // Вычисления в скрипте как в examples/rational.nlp
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    begin = std::chrono::steady_clock::now();
+    ObjPtr fact;
+    for (int64_t rep = 0; rep < 100; rep++) {
+        fact = ctx.ExecStr("frac := 1\\1; cnt := 1; [cnt <= 20] <-> { frac *= cnt; cnt += 1; }; frac");
+    }
+    int64_t script_time = ElapsedMicro(begin);
+    ASSERT_TRUE(fact);
+    ASSERT_STREQ("2432902008176640000\\1", fact->GetValueAsString().c_str());
+
+    LOG_INFO("100 script factorials 20!: %d us", (int) script_time);
+}
+
+TEST(ObjTest, RationalFactorial) {
+
+    // 1000! как в examples/fact_1000.nlp
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    BigNum big(1);
+    for (int64_t i = 1000; i >= 1; i--) {
+        big.mul(BigNum(i));
+    }
+    int64_t big_time = ElapsedMicro(begin);
+
+    begin = std::chrono::steady_clock::now();
+    Rational fact(1);
+    for (int64_t i = 1000; i >= 1; i--) {
+        fact *= Rational(i);
+    }
+    int64_t rational_time = ElapsedMicro(begin);
+    ASSERT_TRUE(fact.isBig());
+    ASSERT_STREQ((big.GetAsString() + "\\1").c_str(), fact.GetAsString().c_str());
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    begin = std::chrono::steady_clock::now();
+    ObjPtr result = ctx.ExecStr("fact := 1\\1; mult := 1000..1..-1?; [mult?!] <-> { fact *= mult!; }; fact");
+    int64_t script_time = ElapsedMicro(begin);
+    ASSERT_TRUE(result);
+    ASSERT_STREQ(fact.GetAsString().c_str(), result->GetValueAsString().c_str());
+
+    LOG_INFO("1000!: BigNum %d us, Rational %d us, script %d us", (int) big_time, (int) rational_time, (int) script_time);
+}
+
+TEST(ObjTest, RationalReduce) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ASSERT_STREQ("3628800\\1", ctx.ExecStr("prod(1..11)")->GetValueAsString().c_str());
+    ASSERT_STREQ("55\\1", ctx.ExecStr("sum(1..11)")->GetValueAsString().c_str());
+    ASSERT_STREQ("22\\1", ctx.ExecStr("sum(10..0..-3)")->GetValueAsString().c_str());
+    ASSERT_STREQ("1\\1", ctx.ExecStr("prod(5..5)")->GetValueAsString().c_str());
+    ASSERT_STREQ("11\\6", ctx.ExecStr("sum(1\\1, 1\\2, 1\\3)")->GetValueAsString().c_str());
+    ASSERT_STREQ("24\\1", ctx.ExecStr("prod([1, 2, 3, 4,])")->GetValueAsString().c_str());
+    ASSERT_STREQ("10\\1", ctx.ExecStr("sum((1, 2, 3, 4,))")->GetValueAsString().c_str());
+    ASSERT_ANY_THROW(ctx.ExecStr("sum(0..1..0.1)"));
+
+    // Итератор по диапазону полностью читается
+    ObjPtr fact = ctx.ExecStr("mult := 1000..1..-1?; prod(mult)");
+    ASSERT_TRUE(fact);
+    ASSERT_EQ(ObjType::IteratorEnd, ctx.ExecStr("mult?!")->getType());
+
+    Rational check(1);
+    for (int64_t i = 1000; i >= 1; i--) {
+        check *= Rational(i);
+    }
+    ASSERT_STREQ(check.GetAsString().c_str(), fact->GetValueAsString().c_str());
+
+    // Левая свертка в цикле и бинарное разбиение
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    ObjPtr loop = ctx.ExecStr("fact := 1\\1; mult := 20000..1..-1?; [mult?!] <-> { fact *= mult!; }; fact");
+    int64_t loop_time = ElapsedMicro(begin);
+
+    begin = std::chrono::steady_clock::now();
+    ObjPtr split = ctx.ExecStr("prod(20000..1..-1)");
+    int64_t split_time = ElapsedMicro(begin);
+
+    ASSERT_TRUE(loop);
+    ASSERT_TRUE(split);
+    ASSERT_STREQ(loop->GetValueAsString().c_str(), split->GetValueAsString().c_str());
+
+    LOG_INFO("20000!: loop %d us, prod %d us", (int) loop_time, (int) split_time);
+}
+
+TEST(ObjTest, RationalReduceFold) {
+
+    ThreadsRestore restore;
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ASSERT_STREQ(FoldRange(1, 21, 1, true).c_str(), ctx.ExecStr("prod(1..21)")->GetValueAsString().c_str());
+    ASSERT_STREQ(FoldRange(1, 21, 1, false).c_str(), ctx.ExecStr("sum(1..21)")->GetValueAsString().c_str());
+    ASSERT_STREQ(FoldRange(10, -8, -3, false).c_str(), ctx.ExecStr("sum(10..-8..-3)")->GetValueAsString().c_str());
+
+    // Словарь, итератор по словарю и целочисленный тензор
+    Rational fold_prod(1);
+    Rational fold_sum(0);
+    for (auto &item : {Rational(3), Rational("1", "2"), Rational(-5), Rational("7", "3")}) {
+        fold_prod *= item;
+        fold_sum += item;
+    }
+    ASSERT_STREQ(fold_prod.GetAsString().c_str(), ctx.ExecStr("prod((3, 1\\2, -5, 7\\3,))")->GetValueAsString().c_str());
+    ASSERT_STREQ(fold_sum.GetAsString().c_str(), ctx.ExecStr("sum((3, 1\\2, -5, 7\\3,))")->GetValueAsString().c_str());
+    ASSERT_STREQ(fold_prod.GetAsString().c_str(), ctx.ExecStr("items := (3, 1\\2, -5, 7\\3,)?; prod(items)")->GetValueAsString().c_str());
+    ASSERT_STREQ(FoldRange(2, 12, 3, true).c_str(), ctx.ExecStr("prod([2, 5, 8, 11,])")->GetValueAsString().c_str());
+    ASSERT_STREQ(FoldRange(2, 12, 3, false).c_str(), ctx.ExecStr("sum([2, 5, 8, 11,])")->GetValueAsString().c_str());
+
+    ObjPtr tensor = Obj::CreateTensor(torch::arange(1, 10001, torch::kLong));
+    tensor->m_var_name = "reduce_tensor";
+    ctx.RegisterObject(tensor);
+
+    // Не менее REDUCE_PARALLEL (4096) элементов на поток: части вычисляются параллельно и объединяются попарно
+    const std::string prod_range = FoldRange(20000, 0, -1, true);
+    const std::string sum_range = FoldRange(20000, 0, -1, false);
+    const std::string prod_tensor = FoldRange(1, 10001, 1, true);
+    const std::string sum_tensor = FoldRange(1, 10001, 1, false);
+    for (int64_t threads : {1, 2, 3, 4}) {
+        RunTime::SetThreads(threads);
+        ASSERT_EQ(threads, RunTime::GetThreads());
+
+        ASSERT_TRUE(prod_range == ctx.ExecStr("prod(20000..0..-1)")->GetValueAsString()) << threads;
+        ASSERT_TRUE(sum_range == ctx.ExecStr("sum(20000..0..-1)")->GetValueAsString()) << threads;
+        ASSERT_TRUE(prod_tensor == ctx.ExecStr("prod(reduce_tensor)")->GetValueAsString()) << threads;
+        ASSERT_TRUE(sum_tensor == ctx.ExecStr("sum(reduce_tensor)")->GetValueAsString()) << threads;
+
+        // Итератор по диапазону остается в конце
+        ASSERT_TRUE(prod_range == ctx.ExecStr("mult := 20000..0..-1?; prod(mult)")->GetValueAsString()) << threads;
+        ASSERT_EQ(ObjType::IteratorEnd, ctx.ExecStr("mult?!")->getType()) << threads;
+        ASSERT_STREQ("0\\1", ctx.ExecStr("sum(mult)")->GetValueAsString().c_str()) << threads;
+    }
+}
+
+TEST(ObjTest, RationalDecimal) {
+
+    std::mt19937 rand(1);
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    for (int64_t digits : {10000, 100000, 1000000}) {
+        std::string str("-9");
+        for (int64_t i = 1; i < digits; i++) {
+            str += static_cast<char> ('0' + rand() % 10);
+        }
+
+        // До: BN_dec2bn и BN_bn2dec
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        BIGNUM *bn = nullptr;
+        ASSERT_TRUE(BN_dec2bn(&bn, str.c_str()));
+        int64_t bn_parse = ElapsedMicro(begin);
+
+        int64_t bn_print = -1;
+        if(digits <= 100000) { // Для 10^6 цифр занимает десятки секунд
+            begin = std::chrono::steady_clock::now();
+            char *bn_str = BN_bn2dec(bn);
+            bn_print = ElapsedMicro(begin);
+            ASSERT_STREQ(str.c_str(), bn_str);
+            OPENSSL_free(bn_str);
+        }
+
+        // После: деление пополам по степеням 10
+        begin = std::chrono::steady_clock::now();
+        BigNum num;
+        num.SetFromString(str);
+        int64_t parse = ElapsedMicro(begin);
+        ASSERT_EQ(0, BN_cmp(bn, num.value));
+        BN_free(bn);
+
+        begin = std::chrono::steady_clock::now();
+        std::ostringstream out;
+        num.GetAsString(out);
+        int64_t print = ElapsedMicro(begin);
+        ASSERT_TRUE(out.str() == str);
+
+        LOG_INFO("%d digits: parse BN_dec2bn %d us, BigNum %d us; print BN_bn2dec %d us, BigNum %d us",
+                (int) digits, (int) bn_parse, (int) parse, (int) bn_print, (int) print);
+
+        if(digits <= 100000) {
+            // Литерал и вывод результата в скрипте
+            std::string positive = str.substr(1) + "\\1";
+            ObjPtr literal = ctx.ExecStr(positive);
+            ASSERT_TRUE(literal);
+            ASSERT_TRUE(literal->GetValueAsString() == positive);
+            std::ostringstream stream;
+            stream << literal;
+            ASSERT_TRUE(stream.str() == positive);
+        }
+    }
+
+    BigNum zeros;
+    zeros.SetFromString("1" + std::string(5000, '0'));
+    ASSERT_TRUE(zeros.GetAsString() == "1" + std::string(5000, '0'));
+}
+
 #endif
\ No newline at end of file
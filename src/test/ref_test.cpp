@@ -0,0 +1,127 @@
+#include "pch.h"
+
+#ifdef UNITTEST
+
+#include <warning_push.h>
+#include <gtest/gtest.h>
+#include <warning_pop.h>
+
+#include <chrono>
+
+#include <ref.h>
+#include <newlang.h>
+
+using namespace newlang;
+
+TEST(Ref, Obj) {
+
+    ObjPtr obj = Obj::CreateValue(10, ObjType::None);
+    ASSERT_EQ(1, obj.use_count());
+
+    // Ссылка из this без отдельного блока управления
+    ObjPtr self = obj->shared();
+    ASSERT_EQ(obj, self);
+    ASSERT_EQ(2, obj.use_count());
+    self.reset();
+    ASSERT_EQ(1, obj.use_count());
+
+    ObjPtrConst const_obj = obj;
+    ASSERT_EQ(2, obj.use_count());
+    const_obj = nullptr;
+
+    // Копирование объекта не копирует счетчик ссылок
+    ObjPtr clone = obj->Clone();
+    ASSERT_EQ(1, clone.use_count());
+
+    WeakRef<Obj> weak = obj;
+    ASSERT_FALSE(weak.expired());
+    ASSERT_EQ(obj.get(), weak.lock().get());
+    ASSERT_EQ(1, obj.use_count());
+
+    obj.reset();
+    ASSERT_TRUE(weak.expired());
+    ASSERT_FALSE(weak.lock());
+
+    Obj stack(ObjType::None);
+    ASSERT_ANY_THROW(stack.shared());
+}
+
+TEST(Ref, Term) {
+
+    TermPtr term = Term::Create(parser::token_type::NAME, TermID::NAME, "name");
+    ASSERT_EQ(1, term.use_count());
+    ASSERT_EQ(term, term->First());
+    ASSERT_EQ(term, term->Last());
+    ASSERT_EQ(1, term.use_count());
+}
+
+namespace {
+
+    struct SharedItem : public std::enable_shared_from_this<SharedItem> {
+        int64_t value = 0;
+    };
+
+    struct RefItem : public RefCounted {
+        int64_t value = 0;
+    };
+
+    int64_t ElapsedMicro(std::chrono::steady_clock::time_point begin) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    }
+}
+
+TEST(Ref, Benchmark) {
+
+    const int64_t count = 10000000;
+
+    // До: std::shared_ptr и shared_from_this()
+    std::shared_ptr<SharedItem> shared_item = std::make_shared<SharedItem>();
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < count; i++) {
+        std::shared_ptr<SharedItem> copy = shared_item->shared_from_this();
+        copy->value++;
+    }
+    int64_t shared_time = ElapsedMicro(begin);
+
+    // После: встроенный счетчик ссылок и Ref(this)
+    Ref<RefItem> ref_item = MakeRef<RefItem>();
+    begin = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < count; i++) {
+        Ref<RefItem> copy(ref_item.get());
+        copy->value++;
+    }
+    int64_t ref_time = ElapsedMicro(begin);
+
+    ASSERT_EQ(count, shared_item->value);
+    ASSERT_EQ(count, ref_item->value);
+    ASSERT_EQ(1, ref_item.use_count());
+
+    LOG_INFO("%d handles from this: std::shared_ptr %d us, Ref %d us",
+            (int) count, (int) shared_time, (int) ref_time);
+
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+
+    ObjPtr func = ctx.ExecStr("bench_call(arg1, arg2) := { $arg1 + $arg2; }");
+    ASSERT_TRUE(func);
+
+    const int64_t calls = 100000;
+    begin = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < calls; i++) {
+        ObjPtr result = func->Call(&ctx, Obj::Arg(i), Obj::Arg(1));
+        ASSERT_EQ(i + 1, result->GetValueAsInteger());
+    }
+    int64_t call_time = ElapsedMicro(begin);
+
+    begin = std::chrono::steady_clock::now();
+    ObjPtr loop = ctx.ExecStr("cnt := 0; sum := 0; [cnt < 100000] <-> { sum += cnt * 2; cnt += 1; }; sum");
+    int64_t loop_time = ElapsedMicro(begin);
+    ASSERT_TRUE(loop);
+    ASSERT_EQ(9999900000, loop->GetValueAsInteger());
+
+    LOG_INFO("Obj::Call %d calls: %d us, arithmetic loop %d iterations: %d us",
+            (int) calls, (int) call_time, 100000, (int) loop_time);
+}
+
+#endif // UNITTEST
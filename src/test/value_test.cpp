@@ -0,0 +1,179 @@
+#include "pch.h"
+
+#ifdef UNITTEST
+
+#include <warning_push.h>
+#include <gtest/gtest.h>
+#include <warning_pop.h>
+
+#include <atomic>
+#include <malloc.h>
+
+#include <value.h>
+
+using namespace newlang;
+
+/*
+ * Подсчет количества выделений памяти оператором new для отчета о расходе памяти.
+ * Память для BIGNUM в Rational выделяется OpenSSL через malloc и учитывается
+ * только в общем объеме занятой памяти кучи.
+ */
+static std::atomic<bool> alloc_enable(false);
+static std::atomic<size_t> alloc_count(0);
+
+void * operator new(size_t size) {
+    if(alloc_enable) {
+        alloc_count++;
+    }
+    void *ptr = malloc(size ? size : 1);
+    if(!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+static size_t HeapUsage() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return static_cast<size_t> (mallinfo().uordblks);
+#endif
+}
+
+TEST(Value, Inline) {
+
+    ASSERT_EQ(16, static_cast<int> (sizeof (Value)));
+
+    Value none;
+    ASSERT_TRUE(none.is_none());
+    ASSERT_TRUE(none.GetObj()->is_none_type());
+
+    Value int_val(static_cast<int64_t> (-12345));
+    ASSERT_EQ(Value::Tag::Integer, int_val.getTag());
+    ASSERT_EQ(-12345, int_val.GetValueAsInteger());
+    ObjPtr obj = int_val.GetObj();
+    ASSERT_EQ(-12345, obj->GetValueAsInteger());
+    ASSERT_EQ(ObjType::Int16, obj->getType());
+
+    Value dbl_val(0.5);
+    ASSERT_EQ(Value::Tag::Number, dbl_val.getTag());
+    ASSERT_DOUBLE_EQ(0.5, dbl_val.GetValueAsNumber());
+
+    Value bool_val(true);
+    ASSERT_EQ(Value::Tag::Bool, bool_val.getTag());
+    ASSERT_TRUE(bool_val.GetValueAsBoolean());
+    ASSERT_EQ(ObjType::Bool, bool_val.GetObj()->getType());
+
+    Value str_val(std::string("short string"));
+    ASSERT_EQ(Value::Tag::String, str_val.getTag());
+    ASSERT_STREQ("short string", str_val.GetValueAsString().c_str());
+    ASSERT_STREQ("short string", str_val.GetObj()->GetValueAsString().c_str());
+
+    Value long_val(std::string("long string more than 14 bytes"));
+    ASSERT_EQ(Value::Tag::Object, long_val.getTag());
+    ASSERT_STREQ("long string more than 14 bytes", long_val.GetValueAsString().c_str());
+
+    // Копирование и перемещение ссылок на объекты
+    Value copy(long_val);
+    ASSERT_EQ(long_val.GetObj().get(), copy.GetObj().get());
+    Value moved(std::move(copy));
+    ASSERT_TRUE(copy.is_none());
+    ASSERT_EQ(long_val.GetObj().get(), moved.GetObj().get());
+    moved = int_val;
+    ASSERT_EQ(-12345, moved.GetValueAsInteger());
+}
+
+TEST(Value, FromObj) {
+
+    ASSERT_EQ(Value::Tag::Integer, Value::FromObj(Obj::CreateValue(100)).getTag());
+    ASSERT_EQ(Value::Tag::Number, Value::FromObj(Obj::CreateValue(1.5)).getTag());
+    ASSERT_EQ(Value::Tag::Bool, Value::FromObj(Obj::CreateBool(false)).getTag());
+    ASSERT_EQ(Value::Tag::String, Value::FromObj(Obj::CreateString("str")).getTag());
+    ASSERT_EQ(Value::Tag::None, Value::FromObj(Obj::CreateNone()).getTag());
+
+    // Свойства объекта сохраняются только в самом объекте
+    ObjPtr fixed = Obj::CreateValue(100, ObjType::Int32);
+    Value fixed_val = Value::FromObj(fixed);
+    ASSERT_EQ(Value::Tag::Object, fixed_val.getTag());
+    ASSERT_EQ(fixed.get(), fixed_val.GetObj().get());
+
+    // Ссылка на объект хранится непосредственно в значении без выделения памяти
+    alloc_count = 0;
+    alloc_enable = true;
+    Value copy(fixed_val);
+    Value moved(std::move(copy));
+    alloc_enable = false;
+    ASSERT_EQ(0U, alloc_count);
+    ASSERT_TRUE(copy.is_none());
+    ASSERT_EQ(fixed.get(), moved.GetObjRef().get());
+    ASSERT_EQ(3, fixed.use_count());
+    moved.SetInteger(5);
+    ASSERT_EQ(2, fixed.use_count());
+
+    ObjPtr dict = Obj::CreateDict(Obj::Arg(1), Obj::Arg(2));
+    ASSERT_EQ(Value::Tag::Object, Value::FromObj(dict).getTag());
+}
+
+/*
+ * Значение используется только для регистров виртуальной машины (VmReg), элементы
+ * словарей (Variable<Obj>) по прежнему хранятся как ObjPtr. Поэтому сравнивается
+ * хранение промежуточных целочисленных результатов в виде объектов и в виде Value.
+ */
+TEST(Value, RegisterMemoryReport) {
+
+    const size_t count = 1000000;
+
+    size_t heap = HeapUsage();
+    alloc_count = 0;
+    alloc_enable = true;
+
+    std::vector<ObjPtr> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        objects.push_back(Obj::CreateValue(static_cast<int64_t> (i), ObjType::None));
+    }
+
+    alloc_enable = false;
+    size_t obj_alloc = alloc_count;
+    size_t obj_heap = HeapUsage() - heap;
+
+    heap = HeapUsage();
+    alloc_count = 0;
+    alloc_enable = true;
+
+    std::vector<Value> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        values.emplace_back(static_cast<int64_t> (i));
+    }
+
+    alloc_enable = false;
+    size_t value_alloc = alloc_count;
+    size_t value_heap = HeapUsage() - heap;
+
+    ASSERT_EQ(count, objects.size());
+    ASSERT_EQ(count, values.size());
+    ASSERT_EQ(static_cast<int64_t> (count - 1), objects[count - 1]->GetValueAsInteger());
+    ASSERT_EQ(static_cast<int64_t> (count - 1), values[count - 1].GetValueAsInteger());
+
+    LOG_INFO("sizeof(Obj) = %d, sizeof(ObjPtr) = %d, sizeof(Value) = %d",
+            (int) sizeof (Obj), (int) sizeof (ObjPtr), (int) sizeof (Value));
+    LOG_INFO("%d integer registers as ObjPtr: %d allocations, %d bytes (%d per item)",
+            (int) count, (int) obj_alloc, (int) obj_heap, (int) (obj_heap / count));
+    LOG_INFO("%d integer registers as Value: %d allocations, %d bytes (%d per item)",
+            (int) count, (int) value_alloc, (int) value_heap, (int) (value_heap / count));
+
+    ASSERT_EQ(1U, value_alloc);
+    ASSERT_LT(value_alloc, obj_alloc);
+    ASSERT_LT(value_heap, obj_heap);
+}
+
+#endif // UNITTEST
@@ -0,0 +1,196 @@
+#include "pch.h"
+
+#ifdef UNITTEST
+
+#include <warning_push.h>
+#include <gtest/gtest.h>
+#include <warning_pop.h>
+
+#include <builtin.h>
+#include <newlang.h>
+#include <vm.h>
+
+#include <chrono>
+
+using namespace newlang;
+
+/*
+ * Результаты выполнения байт-кода должны совпадать с интерпретатором
+ */
+static ObjPtr ExecBoth(const char *source, bool vm) {
+    Context::Reset();
+    Context ctx(RunTime::Init());
+    ctx.m_vm_enable = vm;
+    return ctx.ExecStr(source);
+}
+
+TEST(VM, Loop) {
+
+    const char * source = "count:=0; sum:=0; [count < 100] <-> { sum += count; count += 1; }; sum";
+
+    ObjPtr eval = ExecBoth(source, false);
+    ObjPtr vm = ExecBoth(source, true);
+    ASSERT_TRUE(eval);
+    ASSERT_TRUE(vm);
+    ASSERT_EQ(4950, eval->GetValueAsInteger());
+    ASSERT_EQ(4950, vm->GetValueAsInteger());
+    ASSERT_EQ(eval->getType(), vm->getType());
+
+    source = "x:=0.5; x += 1; x * 2";
+    eval = ExecBoth(source, false);
+    vm = ExecBoth(source, true);
+    ASSERT_TRUE(vm->is_floating());
+    ASSERT_DOUBLE_EQ(eval->GetValueAsNumber(), vm->GetValueAsNumber());
+    ASSERT_DOUBLE_EQ(3.0, vm->GetValueAsNumber());
+}
+
+TEST(VM, Follow) {
+
+    const char * source = "val:=5; [val < 3] --> {1}, [val < 10] --> {2}, [_] --> {3}";
+
+    ObjPtr eval = ExecBoth(source, false);
+    ObjPtr vm = ExecBoth(source, true);
+    ASSERT_EQ(2, eval->GetValueAsInteger());
+    ASSERT_EQ(2, vm->GetValueAsInteger());
+
+    source = "val:=50; [val < 3] --> {1}, [val < 10] --> {2}, [_] --> {3}";
+    ASSERT_EQ(3, ExecBoth(source, false)->GetValueAsInteger());
+    ASSERT_EQ(3, ExecBoth(source, true)->GetValueAsInteger());
+}
+
+TEST(VM, Fallback) {
+
+    const char * source = "str:=''; i:=0; [i < 3] <-> { str += 'a'; i += 1; }; str";
+
+    ObjPtr eval = ExecBoth(source, false);
+    ObjPtr vm = ExecBoth(source, true);
+    ASSERT_STREQ("aaa", eval->GetValueAsString().c_str());
+    ASSERT_STREQ("aaa", vm->GetValueAsString().c_str());
+
+    TermPtr ast = Parser::ParseString("i:=0; [i < 3] <-> { i += 1; };", nullptr);
+    VmProgramPtr prog = VmProgram::Compile(ast);
+    ASSERT_TRUE(prog);
+    std::string dump = prog->Dump();
+    ASSERT_TRUE(dump.find("LOOPCTL") != std::string::npos) << dump;
+    ASSERT_TRUE(dump.find("ADD_") != std::string::npos) << dump;
+    ASSERT_TRUE(dump.find("EVAL") == std::string::npos) << dump;
+}
+
+extern "C" int8_t vm_native_next(int8_t sym);
+
+int8_t vm_native_next(int8_t sym) {
+    return sym + 1;
+}
+
+TEST(VM, IndexCall) {
+
+    LLVMAddSymbol("vm_native_next", (void *) &vm_native_next);
+
+    const char * source = "vm_next := :Pointer('vm_native_next(sym:Int8):Int8'); str := 'abc'; i := 0;"
+            "[i < 3] <-> { str[i] := vm_next(str[i]); i += 1; }; str";
+    ObjPtr eval = ExecBoth(source, false);
+    ObjPtr vm = ExecBoth(source, true);
+    ASSERT_STREQ("bcd", eval->GetValueAsString().c_str());
+    ASSERT_STREQ("bcd", vm->GetValueAsString().c_str());
+
+    source = "t := [1, 2, 3,]; t[1] = t[1] * 10; t[1] + t[-1]";
+    ASSERT_EQ(23, ExecBoth(source, false)->GetValueAsInteger());
+    ASSERT_EQ(23, ExecBoth(source, true)->GetValueAsInteger());
+
+    // Обращение по индексу, присвоение элементу и вызовы выполняются без интерпретатора
+    TermPtr ast = Parser::ParseString("[i < 3] <-> { str[i] := vm_next(str[i]); i += 1; };", nullptr);
+    VmProgramPtr prog = VmProgram::Compile(ast);
+    ASSERT_TRUE(prog);
+    std::string dump = prog->Dump();
+    ASSERT_TRUE(dump.find("INDEX") != std::string::npos) << dump;
+    ASSERT_TRUE(dump.find("SETIDX") != std::string::npos) << dump;
+    ASSERT_TRUE(dump.find("CALL") != std::string::npos) << dump;
+    ASSERT_TRUE(dump.find("EVAL") == std::string::npos) << dump;
+}
+
+TEST(VM, Shared) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+    ctx.m_vm_enable = true;
+
+    // Общий объект не изменяется на месте, результат записывается в его копию
+    ObjPtr shared = Obj::CreateValue(5, ObjType::None);
+    shared->m_var_name = "vm_shared";
+    shared->m_is_shared = true;
+    ctx.RegisterObject(shared);
+
+    ASSERT_EQ(6, ctx.ExecStr("vm_shared += 1")->GetValueAsInteger());
+    ASSERT_EQ(5, shared->GetValueAsInteger());
+}
+
+TEST(VM, Cache) {
+
+    Context::Reset();
+    Context ctx(RunTime::Init());
+    ctx.m_vm_enable = true;
+
+    const char * source = "count:=0; sum:=0; [count < 10] <-> { sum += count; count += 1; }; sum";
+
+    const size_t repeat = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repeat; i++) {
+        ASSERT_EQ(45, ctx.ExecStr(source)->GetValueAsInteger());
+    }
+    std::chrono::duration<double> cached = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(1, ctx.m_vm_compile);
+    ASSERT_EQ(repeat - 1, ctx.m_vm_cached);
+    ASSERT_EQ(1, ctx.m_vm_cache.size());
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repeat; i++) {
+        ctx.m_vm_cache.clear();
+        ASSERT_EQ(45, ctx.ExecStr(source)->GetValueAsInteger());
+    }
+    std::chrono::duration<double> compiled = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(repeat + 1, ctx.m_vm_compile);
+    LOG_INFO("VM cache: cached %f sec, parse and compile %f sec (%d runs)", cached.count(), compiled.count(), (int) repeat);
+
+    // Другой исходный текст компилируется отдельно
+    ASSERT_EQ(3, ctx.ExecStr("1+2")->GetValueAsInteger());
+    ASSERT_EQ(repeat + 2, ctx.m_vm_compile);
+    ASSERT_EQ(2, ctx.m_vm_cache.size());
+}
+
+static char vm_convert(char c) {
+    if(c == 'A') return 'C';
+    if(c == 'C') return 'G';
+    if(c == 'G') return 'T';
+    if(c == 'T') return 'A';
+    return ' ';
+}
+
+/*
+ * Время выполнения examples/speed_test.nlp интерпретатором и байт-кодом
+ */
+TEST(VM, DISABLED_SpeedTest) {
+
+    LLVMAddSymbol("convert", (void *) &vm_convert);
+
+    int64_t times[2];
+    for (int vm = 0; vm < 2; vm++) {
+        Context::Reset();
+        Context ctx(RunTime::Init());
+        ctx.m_vm_enable = vm;
+
+        utils::Logger::LogLevelType save = utils::Logger::Instance()->SetLogLevel(LOG_LEVEL_INFO);
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        ObjPtr result = ctx.ExecFile("../examples/speed_test.nlp");
+        times[vm] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        utils::Logger::Instance()->SetLogLevel(save);
+
+        ASSERT_TRUE(result);
+        ASSERT_STREQ("OK", result->GetValueAsString().c_str());
+    }
+    LOG_INFO("speed_test.nlp: interpreter %d ms, VM %d ms (x%.1f)", (int) (times[0] / 1000), (int) (times[1] / 1000),
+            times[1] ? static_cast<double> (times[0]) / times[1] : 0.0);
+}
+
+#endif // UNITTEST
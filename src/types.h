@@ -3,6 +3,8 @@
 
 #include "pch.h"
 
+#include <ref.h>
+
 namespace newlang {
 
     static constexpr const char* ws = " \t\n\r\f\v";
@@ -31,10 +33,12 @@ class Obj;
 class Context;
 class Compiler;
 class RunTime;
+class JitCode;
+struct NativeCall;
 
-typedef std::shared_ptr<Term> TermPtr;
-typedef std::shared_ptr<Obj> ObjPtr;
-typedef std::shared_ptr<const Obj> ObjPtrConst;
+typedef Ref<Term> TermPtr;
+typedef Ref<Obj> ObjPtr;
+typedef Ref<const Obj> ObjPtrConst;
 typedef std::shared_ptr<RunTime> RuntimePtr;
 
 typedef ObjPtr FunctionType(Context *ctx, Obj &in);
@@ -0,0 +1,154 @@
+#include "pch.h"
+
+#include <value.h>
+
+using namespace newlang;
+
+/*
+ * Объект можно хранить непосредственно в значении, если у него нет свойств,
+ * которые будут потеряны при обратном преобразовании в Obj.
+ */
+static bool IsPlainObj(const Obj &obj) {
+    return obj.m_var_name.empty() && obj.m_class_name.empty() && obj.m_class_parents.empty() &&
+            !obj.m_is_const && !obj.m_is_reference && obj.m_var_type_fixed == ObjType::None &&
+            !obj.m_dimensions && !obj.m_prototype && !obj.m_sequence && !obj.m_return_obj;
+}
+
+Value::Value(const std::string &str) {
+    Clear();
+    if(str.size() <= INLINE_SIZE) {
+        memcpy(m_data, str.data(), str.size());
+        m_data[SIZE_POS] = static_cast<uint8_t> (str.size());
+        m_data[TAG_POS] = static_cast<uint8_t> (Tag::String);
+    } else {
+        SetObj(Obj::CreateString(str));
+    }
+}
+
+Value::Value(ObjPtr obj) {
+    Clear();
+    SetObj(std::move(obj));
+}
+
+void Value::Copy(const Value &other) {
+    if(other.getTag() == Tag::Object) {
+        new (m_data) ObjPtr(other.GetObjRef());
+        m_data[TAG_POS] = static_cast<uint8_t> (Tag::Object);
+    } else {
+        memcpy(m_data, other.m_data, sizeof (m_data));
+    }
+}
+
+void Value::Release() {
+    if(getTag() == Tag::Object) {
+        std::launder(reinterpret_cast<ObjPtr *> (m_data))->~ObjPtr();
+    }
+    Clear();
+}
+
+Value Value::FromObj(const ObjPtr &obj) {
+    if(!obj) {
+        return Value();
+    }
+    if(IsPlainObj(*obj)) {
+        if(obj->m_var_type_current == ObjType::None && !obj->m_var_is_init) {
+            return Value();
+        } else if(obj->m_var_type_current == ObjType::Bool && at::holds_alternative<int64_t>(obj->m_var)) {
+            return Value(obj->GetValueAsBoolean());
+        } else if(obj->is_integer() && at::holds_alternative<int64_t>(obj->m_var)) {
+            int64_t value = at::get<int64_t>(obj->m_var);
+            // Тип должен восстанавливаться по значению так же, как в Obj::CreateValue
+            if(obj->m_var_type_current == typeFromLimit(value)) {
+                return Value(value);
+            }
+        } else if(obj->is_floating() && at::holds_alternative<double>(obj->m_var)) {
+            double value = at::get<double>(obj->m_var);
+            if(obj->m_var_type_current == typeFromLimit(value)) {
+                return Value(value);
+            }
+        } else if(obj->m_var_type_current == ObjType::StrChar && obj->m_value.size() <= INLINE_SIZE) {
+            return Value(obj->m_value);
+        }
+    }
+    return Value(obj);
+}
+
+ObjPtr Value::GetObj() const {
+    switch(getTag()) {
+        case Tag::None:
+            return Obj::CreateNone();
+        case Tag::Bool:
+            return Obj::CreateBool(GetPayload<int64_t>());
+        case Tag::Integer:
+            return Obj::CreateValue(GetPayload<int64_t>(), ObjType::None);
+        case Tag::Number:
+            return Obj::CreateValue(GetPayload<double>(), ObjType::None);
+        case Tag::String:
+            return Obj::CreateString(GetValueAsString());
+        case Tag::Object:
+            return GetObjRef();
+    }
+    LOG_RUNTIME("Unknown value tag %d!", static_cast<int> (getTag()));
+}
+
+int64_t Value::GetValueAsInteger() const {
+    switch(getTag()) {
+        case Tag::None:
+            return 0;
+        case Tag::Bool:
+        case Tag::Integer:
+            return GetPayload<int64_t>();
+        case Tag::Number:
+            return static_cast<int64_t> (GetPayload<double>());
+        case Tag::Object:
+            return GetObjRef()->GetValueAsInteger();
+        default:
+            LOG_RUNTIME("Value '%s' not convertible to integer!", toString().c_str());
+    }
+}
+
+double Value::GetValueAsNumber() const {
+    switch(getTag()) {
+        case Tag::Number:
+            return GetPayload<double>();
+        case Tag::Object:
+            return GetObjRef()->GetValueAsNumber();
+        default:
+            return static_cast<double> (GetValueAsInteger());
+    }
+}
+
+bool Value::GetValueAsBoolean() const {
+    switch(getTag()) {
+        case Tag::None:
+            return false;
+        case Tag::Bool:
+        case Tag::Integer:
+            return GetPayload<int64_t>();
+        case Tag::Number:
+            return GetPayload<double>();
+        case Tag::String:
+            return m_data[SIZE_POS];
+        case Tag::Object:
+            return GetObjRef()->GetValueAsBoolean();
+    }
+    LOG_RUNTIME("Unknown value tag %d!", static_cast<int> (getTag()));
+}
+
+std::string Value::GetValueAsString() const {
+    switch(getTag()) {
+        case Tag::String:
+            return std::string(reinterpret_cast<const char *> (m_data), m_data[SIZE_POS]);
+        case Tag::Object:
+            return GetObjRef()->GetValueAsString();
+        default:
+            return GetObj()->GetValueAsString();
+    }
+}
+
+std::string Value::toString() const {
+    if(getTag() == Tag::Object) {
+        return GetObjRef()->toString();
+    }
+    return GetObj()->toString();
+}
@@ -0,0 +1,206 @@
+#pragma once
+#ifndef INCLUDED_NEWLANG_VALUE_
+#define INCLUDED_NEWLANG_VALUE_
+
+#include "pch.h"
+
+#include <new>
+
+#include <object.h>
+
+namespace newlang {
+
+    /*
+     * Компактное представление значения размером 16 байт.
+     *
+     * Скаляры (целые и числа с плавающей точкой), логические значения, None и короткие
+     * строки (до INLINE_SIZE байт в UTF-8) хранятся непосредственно в значении без выделения памяти.
+     * Составные данные (словари, классы, тензоры, дроби, функции, длинные строки),
+     * а так же объекты с именем, фиксированным типом или другими свойствами
+     * хранятся в объекте Obj в куче, а в значении хранится ссылка на него (ObjPtr
+     * размещается непосредственно в первых 8 байтах без дополнительного выделения памяти).
+     *
+     * Последний байт содержит тег типа, предпоследний - длину короткой строки.
+     * Используется для регистров виртуальной машины (VmReg). Элементы словарей и
+     * аргументы вызовов (Variable<Obj>) пока хранятся как ObjPtr.
+     */
+    class Value {
+    public:
+
+        enum class Tag : uint8_t {
+            None,
+            Bool,
+            Integer,
+            Number,
+            String,
+            Object,
+        };
+
+        constexpr static size_t INLINE_SIZE = 14;
+
+        Value() {
+            Clear();
+        }
+
+        explicit Value(bool value) {
+            Clear();
+            SetPayload(static_cast<int64_t> (value), Tag::Bool);
+        }
+
+        explicit Value(int64_t value) {
+            Clear();
+            SetPayload(value, Tag::Integer);
+        }
+
+        explicit Value(double value) {
+            Clear();
+            SetPayload(value, Tag::Number);
+        }
+
+        explicit Value(const std::string &str);
+        explicit Value(ObjPtr obj);
+
+        Value(const Value &other) {
+            Clear();
+            Copy(other);
+        }
+
+        Value(Value &&other) noexcept {
+            memcpy(m_data, other.m_data, sizeof (m_data));
+            other.Clear();
+        }
+
+        Value & operator=(const Value &other) {
+            if (this != &other) {
+                Release();
+                Copy(other);
+            }
+            return *this;
+        }
+
+        Value & operator=(Value &&other) noexcept {
+            if (this != &other) {
+                Release();
+                memcpy(m_data, other.m_data, sizeof (m_data));
+                other.Clear();
+            }
+            return *this;
+        }
+
+        ~Value() {
+            Release();
+        }
+
+        /*
+         * Преобразование объекта в компактное значение. Объект сохраняется по ссылке,
+         * если при обратном преобразовании (GetObj) его свойства не будут восстановлены.
+         */
+        static Value FromObj(const ObjPtr &obj);
+
+        /*
+         * Объект для интерпретатора. Для значений, хранящихся непосредственно,
+         * каждый раз создается новый объект, который можно изменять.
+         */
+        ObjPtr GetObj() const;
+
+        inline Tag getTag() const {
+            return static_cast<Tag> (m_data[TAG_POS]);
+        }
+
+        inline bool is_none() const {
+            return getTag() == Tag::None;
+        }
+
+        inline bool is_inline() const {
+            return getTag() != Tag::Object;
+        }
+
+        /*
+         * Изменение значения без создания временного Value (регистры VmReg)
+         */
+        inline void SetNone() {
+            Release();
+        }
+
+        inline void SetBool(bool value) {
+            Release();
+            SetPayload(static_cast<int64_t> (value), Tag::Bool);
+        }
+
+        inline void SetInteger(int64_t value) {
+            Release();
+            SetPayload(value, Tag::Integer);
+        }
+
+        inline void SetNumber(double value) {
+            Release();
+            SetPayload(value, Tag::Number);
+        }
+
+        inline void SetObj(ObjPtr obj) {
+            Release();
+            if (obj) {
+                new (m_data) ObjPtr(std::move(obj));
+                m_data[TAG_POS] = static_cast<uint8_t> (Tag::Object);
+            }
+        }
+
+        /*
+         * Значение без проверок и преобразований, тег должен быть проверен вызывающей стороной:
+         * GetInteger - для Bool и Integer, GetNumber - для Number, GetObjRef - для Object.
+         */
+        inline int64_t GetInteger() const {
+            return GetPayload<int64_t>();
+        }
+
+        inline double GetNumber() const {
+            return GetPayload<double>();
+        }
+
+        inline const ObjPtr & GetObjRef() const {
+            ASSERT(getTag() == Tag::Object);
+            return *std::launder(reinterpret_cast<const ObjPtr *> (m_data));
+        }
+
+        int64_t GetValueAsInteger() const;
+        double GetValueAsNumber() const;
+        bool GetValueAsBoolean() const;
+        std::string GetValueAsString() const;
+
+        std::string toString() const;
+
+    protected:
+
+        constexpr static size_t SIZE_POS = 14;
+        constexpr static size_t TAG_POS = 15;
+
+        inline void Clear() {
+            memset(m_data, 0, sizeof (m_data));
+        }
+
+        template <typename T>
+        inline void SetPayload(T value, Tag tag) {
+            static_assert(sizeof (T) == 8, "Payload must be 8 bytes");
+            memcpy(m_data, &value, sizeof (value));
+            m_data[TAG_POS] = static_cast<uint8_t> (tag);
+        }
+
+        template <typename T>
+        inline T GetPayload() const {
+            T value;
+            memcpy(&value, m_data, sizeof (value));
+            return value;
+        }
+
+        void Copy(const Value &other);
+        void Release();
+
+        alignas(8) uint8_t m_data[16];
+    };
+
+    static_assert(sizeof (Value) == 16, "Value must be 16 bytes");
+    static_assert(sizeof (ObjPtr) <= Value::INLINE_SIZE && alignof (ObjPtr) <= 8, "ObjPtr must fit into Value payload");
+
+}
+
+#endif //INCLUDED_NEWLANG_VALUE_
@@ -4,6 +4,7 @@
 #include "pch.h"
 
 #include <types.h>
+#include <pool.h>
 
 namespace newlang {
 
@@ -64,13 +65,265 @@ namespace newlang {
      * новые аргументы по мимо тех, которые уже определены в прототипе функции.
      */
 
-    template <typename T, typename PTR = std::shared_ptr<T>>
-    class Variable : public std::list<std::pair<std::string, PTR>>
+    template <typename T, typename PTR = Ref<T>>
+    class Variable : public std::vector<std::pair<std::string, PTR>, PoolAllocator<std::pair<std::string, PTR>>>
     {
         public:
         typedef PTR Type;
         typedef std::pair<std::string, Type> PairType;
-        typedef std::list<PairType> ListType;
+        typedef std::vector<PairType, PoolAllocator<PairType>> ListType;
+
+        /*
+         * Индекс имен элементов создается при первом поиске по имени, если в списке
+         * не меньше INDEX_MIN элементов. Добавленные в конец элементы индексируются
+         * при следующем поиске, а после других изменений списка индекс строится заново.
+         * При изменении имени элемента по ссылке нужно вызвать ResetIndex().
+         */
+        constexpr static size_t INDEX_MIN = 16;
+
+        friend class Context;
+
+        template <typename I>
+                typename std::enable_if < std::is_integral<I>::value && !std::is_pointer<I>::value, const PairType &>::type
+                inline operator[](I index) {
+            return at(index);
+        }
+
+        template <typename N>
+                typename std::enable_if < std::is_same<N, std::string>::value || std::is_pointer<N>::value, const PairType &>::type
+                inline operator[](N name) {
+            return at(name);
+        }
+
+        inline PairType & push_back(const PairType & p) {
+            ListType::push_back(p);
+            return ListType::back();
+        }
+
+        inline PairType & push_back(const Type value, const std::string &name = "") {
+            return push_back(pair(value, name));
+        }
+
+        inline void push_front(const PairType & p) {
+            ResetIndex();
+            ListType::insert(ListType::begin(), p);
+        }
+
+        inline void pop_back() {
+            ResetIndex();
+            ListType::pop_back();
+        }
+
+        typename ListType::iterator insert(typename ListType::const_iterator pos, const PairType & p) {
+            ResetIndex();
+            return ListType::insert(pos, p);
+        }
+
+        typename ListType::iterator insert(typename ListType::const_iterator pos, size_t count, const PairType & p) {
+            ResetIndex();
+            return ListType::insert(pos, count, p);
+        }
+
+        template <typename I>
+        typename ListType::iterator insert(typename ListType::const_iterator pos, I first, I last) {
+            ResetIndex();
+            return ListType::insert(pos, first, last);
+        }
+
+        typename ListType::iterator erase(typename ListType::const_iterator pos) {
+            ResetIndex();
+            return ListType::erase(pos);
+        }
+
+        typename ListType::iterator erase(typename ListType::const_iterator first, typename ListType::const_iterator last) {
+            ResetIndex();
+            return ListType::erase(first, last);
+        }
+
+        inline void clear() {
+            ResetIndex();
+            ListType::clear();
+        }
+
+        void remove(const PairType & value) {
+            ResetIndex();
+            // Копия, т.к. value может быть ссылкой на элемент списка
+            const PairType item(value);
+            ListType::erase(std::remove(ListType::begin(), ListType::end(), item), ListType::end());
+        }
+
+        static inline PairType pair(const Type value, const std::string name = "") {
+            return std::pair<std::string, Type>(name, value);
+        }
+
+        virtual PairType & at(const int64_t index) {
+            return *at_index(index);
+        }
+
+        virtual const PairType & at(const int64_t index) const {
+            return *at_index_const(index);
+        }
+
+        typename ListType::iterator find(const std::string &name) {
+            int64_t pos = IndexOf(name);
+            return pos < 0 ? ListType::end() : ListType::begin() + pos;
+        }
+
+        /*
+         * Позиция первого элемента с указанным именем или -1, если элемента нет
+         */
+        int64_t IndexOf(const std::string &name) {
+            if (name.empty() || ListType::size() < INDEX_MIN) {
+                for (size_t pos = 0; pos < ListType::size(); pos++) {
+                    if (ListType::operator[](pos).first.compare(name) == 0) {
+                        return pos;
+                    }
+                }
+                return -1;
+            }
+            UpdateIndex();
+            const size_t mask = m_index.size() - 1;
+            for (size_t slot = std::hash<std::string>()(name) & mask; m_index[slot]; slot = (slot + 1) & mask) {
+                if (ListType::operator[](m_index[slot] - 1).first.compare(name) == 0) {
+                    return m_index[slot] - 1;
+                }
+            }
+            return -1;
+        }
+
+        inline void ResetIndex() {
+            m_index.clear();
+            m_index_count = 0;
+        }
+
+        virtual PairType & at(const std::string name) {
+            auto iter = find(name);
+            if (iter != ListType::end()) {
+                return *iter;
+            }
+            LOG_RUNTIME("Property '%s' not found!", name.c_str());
+        }
+
+        virtual const std::string & name(const int64_t index) const {
+            return at_index_const(index)->first;
+        }
+
+        virtual void clear_() {
+            clear();
+        }
+
+        virtual int64_t resize(int64_t new_size, const Type fill, const std::string &name = "") {
+            if (new_size >= 0) {
+                // Размер положительный, просто изменить число элементов добавив или удалив последние
+                if (new_size < static_cast<int64_t> (ListType::size())) {
+                    // Добавленные в конец элементы индексируются при следующем поиске, а удаленные нет
+                    ResetIndex();
+                }
+                ListType::resize(new_size, std::pair<std::string, Type>(name, fill));
+            } else {
+                // Если размер отрицательный - добавить или удалить вначале
+                new_size = -new_size;
+                const int64_t count = ListType::size();
+                if (count > new_size) {
+                    erase(ListType::begin(), ListType::begin() + (count - new_size));
+                } else if (count < new_size) {
+                    insert(ListType::begin(), new_size - count, std::pair<std::string, Type>(name, fill));
+                }
+            }
+            return ListType::size();
+        }
+
+        typename ListType::iterator at_index(const int64_t index) {
+            return ListType::begin() + CheckIndex(index);
+        }
+
+        typename ListType::const_iterator at_index_const(const int64_t index) const {
+            return ListType::begin() + CheckIndex(index);
+        }
+
+        virtual void erase(const int64_t index) {
+            erase(ListType::begin() + CheckIndex(index));
+        }
+
+        virtual ~Variable() {
+        }
+
+        /* 
+         * Конструкторы для создания списка параметров (при подготовке аргументов перед вызовом функции)
+         */
+        Variable() : m_index_count(0) {
+        }
+
+        Variable(PairType arg) : m_index_count(0) {
+            push_back(arg);
+        }
+
+        template <class... A> inline Variable(PairType arg, A... rest) : Variable(rest...) {
+            push_front(arg);
+        }
+
+    protected:
+
+        inline int64_t CheckIndex(const int64_t index) const {
+            const int64_t count = ListType::size();
+            if (index < 0 && -index <= count) {
+                return count + index;
+            } else if (index >= 0 && index < count) {
+                return index;
+            }
+            LOG_RUNTIME("Index '%ld' not exists!", index);
+        }
+
+        /*
+         * Хеш-таблица с открытой адресацией, в ячейке хранится позиция элемента + 1 (0 - свободная ячейка).
+         * Заполнение таблицы не превышает половины, поэтому поиск всегда завершается.
+         */
+        void UpdateIndex() {
+            const size_t count = ListType::size();
+            if (m_index_count > count) {
+                ResetIndex();
+            }
+            if (m_index.size() < 2 * count) {
+                size_t slots = 4 * INDEX_MIN;
+                while (slots < 4 * count) {
+                    slots *= 2;
+                }
+                m_index.assign(slots, 0);
+                m_index_count = 0;
+            }
+            const size_t mask = m_index.size() - 1;
+            for (; m_index_count < count; m_index_count++) {
+                const std::string &name = ListType::operator[](m_index_count).first;
+                if (name.empty()) {
+                    continue;
+                }
+                size_t slot = std::hash<std::string>()(name) & mask;
+                while (m_index[slot] && ListType::operator[](m_index[slot] - 1).first.compare(name) != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                if (!m_index[slot]) {
+                    // При повторе имени в индексе остается первый элемент
+                    m_index[slot] = static_cast<uint32_t> (m_index_count + 1);
+                }
+            }
+        }
+
+        std::vector<uint32_t> m_index;
+        size_t m_index_count;
+    };
+
+    /*
+     * Список именованных элементов на основе std::list для сессии Context.
+     * В отличии от Variable итераторы на элементы остаются действительными при добавлении
+     * и удалении других элементов, что используется в индексе символов контекста.
+     */
+    template <typename T, typename PTR = Ref<T>>
+    class VariableList : public std::list<std::pair<std::string, PTR>, PoolAllocator<std::pair<std::string, PTR>>>
+    {
+        public:
+        typedef PTR Type;
+        typedef std::pair<std::string, Type> PairType;
+        typedef std::list<PairType, PoolAllocator<PairType>> ListType;
         
         friend class Context;
 
@@ -152,14 +405,11 @@ namespace newlang {
             } else {
                 // Если размер отрицательный - добавить или удалить вначале
                 new_size = -new_size;
-                if (static_cast<int64_t> (ListType::size()) > new_size) {
-
-                    ListType::erase(ListType::begin(), at_index(ListType::size() - new_size));
-
-                } else if (static_cast<int64_t> (ListType::size()) < new_size) {
-                    ListType::insert(ListType::begin(), (ListType::size() - new_size), std::pair<std::string, Type>(name, fill));
-                } else {
-                    ListType::clear();
+                const int64_t count = ListType::size();
+                if (count > new_size) {
+                    ListType::erase(ListType::begin(), at_index(count - new_size));
+                } else if (count < new_size) {
+                    ListType::insert(ListType::begin(), new_size - count, std::pair<std::string, Type>(name, fill));
                 }
             }
             return ListType::size();
@@ -223,22 +473,22 @@ namespace newlang {
             ListType::erase(at_index_const(index));
         }
 
-        virtual ~Variable() {
+        virtual ~VariableList() {
         }
 
         /* 
          * Конструкторы для создания списка параметров (при подготовке аргументов перед вызовом функции)
          */
-        Variable() {
+        VariableList() {
         }
 
-        Variable(PairType arg) {
+        VariableList(PairType arg) {
 
-            push_front(arg.second, arg.first);
+            ListType::push_front(arg);
         }
 
-        template <class... A> inline Variable(PairType arg, A... rest) : Variable(rest...) {
-            push_front(arg.second, arg.first);
+        template <class... A> inline VariableList(PairType arg, A... rest) : VariableList(rest...) {
+            ListType::push_front(arg);
         }
     };
 
@@ -0,0 +1,1108 @@
+#include "pch.h"
+
+#include <vm.h>
+#include <context.h>
+#include <term.h>
+#include <types.h>
+
+using namespace newlang;
+
+const char * newlang::toString(VmOp op) {
+    switch(op) {
+#define DEFINE_CASE(name) \
+        case VmOp::name: \
+            return #name;
+            NL_VM_OPCODES(DEFINE_CASE)
+#undef DEFINE_CASE
+    }
+    LOG_ERROR("UNKNOWN VM OPCODE %d", static_cast<int> (op));
+    return "UNKNOWN OPCODE";
+}
+
+ObjPtr Context::ExecVM(const std::string &source, Obj *args) {
+
+    if(m_vm_macros != m_macros.GetCount()) {
+        m_vm_cache.clear();
+        m_vm_macros = m_macros.GetCount();
+    }
+
+    auto found = m_vm_cache.find(source);
+    if(found == m_vm_cache.end()) {
+        TermPtr exec = Parser::ParseString(source, &m_macros);
+        FoldConstants(this, exec);
+        if(m_vm_macros != m_macros.GetCount()) {
+            // Исходный текст определяет макросы и при повторном разборе результат будет другим
+            m_vm_cache.clear();
+            m_vm_macros = m_macros.GetCount();
+            return ExecVM(exec, args);
+        }
+        if(m_vm_cache.size() >= VM_CACHE_SIZE) {
+            m_vm_cache.clear();
+        }
+        VmProgramPtr prog = VmProgram::Compile(exec);
+        ASSERT(prog);
+        m_vm_compile++;
+        found = m_vm_cache.emplace(source, VmCacheItem{exec, prog}).first;
+    } else {
+        m_vm_cached++;
+    }
+
+    // Повторный вход в ту же программу (рекурсивный вызов ExecStr) выполняется отдельной копией,
+    // т.к. ячейки переменных принадлежат выполняемой программе
+    VmProgramPtr prog = found->second.prog;
+    if(prog->m_running) {
+        return ExecVM(found->second.exec, args);
+    }
+    return prog->Run(this, args);
+}
+
+ObjPtr Context::ExecVM(TermPtr exec, Obj *args) {
+    VmProgramPtr prog = VmProgram::Compile(exec);
+    ASSERT(prog);
+    m_vm_compile++;
+    return prog->Run(this, args);
+}
+
+/*
+ * Упаковка значения регистра в объект
+ */
+ObjPtr VmReg::GetObj() const {
+    ObjPtr result;
+    switch(m_value.getTag()) {
+        case Value::Tag::None:
+            return Obj::None();
+
+        case Value::Tag::Integer:
+            if(m_proto) {
+                result = m_proto->Clone();
+                result->m_var = m_value.GetInteger();
+                result->m_var_type_current = typeFromLimit(m_value.GetInteger());
+                return result;
+            }
+            return Obj::SharedValue(m_value.GetInteger());
+
+        case Value::Tag::Number:
+            if(m_proto) {
+                result = m_proto->Clone();
+                result->m_var = m_value.GetNumber();
+                result->m_var_type_current = ObjType::Float64;
+                return result;
+            }
+            return Obj::CreateValue(m_value.GetNumber());
+
+        case Value::Tag::Bool:
+            return m_value.GetInteger() ? Obj::Yes() : Obj::No();
+
+        case Value::Tag::Object:
+            return m_value.GetObjRef();
+
+        case Value::Tag::String:
+            return m_value.GetObj();
+    }
+    LOG_RUNTIME("Unknown register tag %d!", static_cast<int> (m_value.getTag()));
+}
+
+bool VmReg::GetValueAsBoolean() const {
+    switch(m_value.getTag()) {
+        case Value::Tag::None:
+            return false;
+        case Value::Tag::Integer:
+        case Value::Tag::Bool:
+            return m_value.GetInteger();
+        case Value::Tag::Object:
+            return m_value.GetObjRef()->GetValueAsBoolean();
+        default:
+            return GetObj()->GetValueAsBoolean();
+    }
+}
+
+/*
+ * Значение регистра как скаляр без упаковки (если это возможно).
+ * Объекты с фиксированным типом обрабатываются интерпретатором, т.к. для них
+ * выполняется контроль допустимости изменения типа данных.
+ */
+static inline bool GetScalar(const VmReg &reg, int64_t &integer, double &number, bool &is_float) {
+    switch(reg.m_value.getTag()) {
+        case Value::Tag::Integer:
+            integer = reg.m_value.GetInteger();
+            is_float = false;
+            return true;
+
+        case Value::Tag::Number:
+            number = reg.m_value.GetNumber();
+            is_float = true;
+            return true;
+
+        case Value::Tag::Object:
+        {
+            const ObjPtr &obj = reg.m_value.GetObjRef();
+            if(obj->m_var_type_fixed == ObjType::None && obj->is_scalar()) {
+                if(obj->is_integral() && at::holds_alternative<int64_t>(obj->m_var)) {
+                    integer = at::get<int64_t>(obj->m_var);
+                    is_float = false;
+                    return true;
+                } else if(obj->is_floating() && at::holds_alternative<double>(obj->m_var)) {
+                    number = at::get<double>(obj->m_var);
+                    is_float = true;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/*
+ * Объект в регистре (переменная или результат вычисления) или nullptr для скаляров
+ */
+static inline Obj * GetRegObj(const VmReg &reg) {
+    return reg.m_value.getTag() == Value::Tag::Object ? reg.m_value.GetObjRef().get() : nullptr;
+}
+
+/*
+ * Прототип скалярного результата арифметической операции - объект левого операнда (Obj::Clone)
+ */
+static inline ObjPtr GetProto(const VmReg &reg) {
+    return reg.m_value.getTag() == Value::Tag::Object ? reg.m_value.GetObjRef() : reg.m_proto;
+}
+
+static inline void SetObject(VmReg &reg, ObjPtr obj) {
+    reg.m_value.SetObj(std::move(obj));
+    reg.m_proto.reset();
+}
+
+static inline void SetBoolean(VmReg &reg, bool value) {
+    reg.m_value.SetBool(value);
+    reg.m_proto.reset();
+}
+
+/*
+ * Инструкция присвоения x = x + y (флаг): если левый операнд - объект переменной
+ * из регистра c, результат записывается в него на месте (Context::AssignInPlace).
+ */
+static inline bool AssignInPlace(Context *ctx, const VmInstr &op, VmReg *reg, char sym) {
+    Obj *target = GetRegObj(reg[op.a]);
+    if(!op.flag || !target || target != GetRegObj(reg[op.c])) {
+        return false;
+    }
+    if(!Context::AssignInPlace(ctx, *target, sym, reg[op.b].GetObj())) {
+        return false;
+    }
+    SetObject(reg[op.dst], reg[op.c].m_value.GetObjRef());
+    return true;
+}
+
+/*
+ * Индекс из значений последовательных регистров (Context::MakeIndex)
+ */
+static inline void MakeIndex(const TermPtr &term, const VmReg *reg, std::vector<Index> &index) {
+    index.clear();
+    for (int i = 0; i < term->size(); i++) {
+        if(reg[i].m_value.getTag() == Value::Tag::Integer) {
+            index.push_back(Index(reg[i].m_value.GetInteger()));
+        } else {
+            ObjPtr value = reg[i].GetObj();
+            index.push_back(Context::MakeIndexValue(term->at(i).second, i, *value));
+        }
+    }
+}
+
+/*
+ * Максимальное число аргументов нативной функции, которые передаются без создания словаря
+ */
+static const size_t VM_NATIVE_ARGS = 8;
+
+/*
+ * Арифметика над скалярами без создания промежуточных объектов.
+ * Возвращает false, если операцию нужно выполнить через методы Obj.
+ */
+static inline bool ArithScalar(VmOp op, const VmReg &left, const VmReg &right, Value &result) {
+    int64_t li, ri, res;
+    double ld, rd;
+    bool lf, rf;
+
+    if(!GetScalar(left, li, ld, lf) || !GetScalar(right, ri, rd, rf)) {
+        return false;
+    }
+
+    if(!lf && !rf) {
+        bool overflow;
+        switch(op) {
+            case VmOp::ADD:
+            case VmOp::ADD_:
+                overflow = __builtin_add_overflow(li, ri, &res);
+                break;
+            case VmOp::SUB:
+            case VmOp::SUB_:
+                overflow = __builtin_sub_overflow(li, ri, &res);
+                break;
+            case VmOp::MUL:
+            case VmOp::MUL_:
+                overflow = __builtin_mul_overflow(li, ri, &res);
+                break;
+            default:
+                return false;
+        }
+        if(overflow) {
+            return false;
+        }
+        result.SetInteger(res);
+        return true;
+    }
+
+    if(!lf) {
+        ld = static_cast<double> (li);
+    }
+    if(!rf) {
+        rd = static_cast<double> (ri);
+    }
+    switch(op) {
+        case VmOp::ADD:
+        case VmOp::ADD_:
+            result.SetNumber(ld + rd);
+            return true;
+        case VmOp::SUB:
+        case VmOp::SUB_:
+            result.SetNumber(ld - rd);
+            return true;
+        case VmOp::MUL:
+        case VmOp::MUL_:
+            result.SetNumber(ld * rd);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Сравнение скаляров по правилам Obj::op_compare и Obj::op_equal
+ */
+static inline bool CompareScalar(VmOp op, const VmReg &left, const VmReg &right, bool &result) {
+    int64_t li, ri;
+    double ld, rd;
+    bool lf, rf;
+
+    if(GetRegObj(left) && GetRegObj(left) == GetRegObj(right)) {
+        // Сравнение объекта с самим собой
+        return false;
+    }
+    if(!GetScalar(left, li, ld, lf) || !GetScalar(right, ri, rd, rf)) {
+        return false;
+    }
+
+    int cmp;
+    if(lf || rf) {
+        if(!lf) {
+            ld = static_cast<double> (li);
+        }
+        if(!rf) {
+            rd = static_cast<double> (ri);
+        }
+        if(op == VmOp::EQ || op == VmOp::NE) {
+            result = (ld == rd) == (op == VmOp::EQ);
+            return true;
+        }
+        cmp = ld < rd ? -1 : (ld > rd ? 1 : 0);
+    } else {
+        cmp = li < ri ? -1 : (li > ri ? 1 : 0);
+    }
+
+    switch(op) {
+        case VmOp::LT:
+            result = cmp < 0;
+            return true;
+        case VmOp::GT:
+            result = cmp > 0;
+            return true;
+        case VmOp::LE:
+            result = cmp <= 0;
+            return true;
+        case VmOp::GE:
+            result = cmp >= 0;
+            return true;
+        case VmOp::EQ:
+            result = cmp == 0;
+            return true;
+        case VmOp::NE:
+            result = cmp != 0;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Компиляция
+ */
+
+size_t VmProgram::Emit(VmOp op, int32_t dst, int32_t a, int32_t b, int32_t c, uint8_t flag) {
+    VmInstr instr;
+    instr.op = op;
+    instr.flag = flag;
+    instr.dst = dst;
+    instr.a = a;
+    instr.b = b;
+    instr.c = c;
+    m_code.push_back(instr);
+    return m_code.size() - 1;
+}
+
+int32_t VmProgram::AddTerm(const TermPtr &term) {
+    m_terms.push_back(term);
+    return static_cast<int32_t> (m_terms.size() - 1);
+}
+
+int32_t VmProgram::AddSlot(const TermPtr &term) {
+    auto found = m_slot_index.find(term->GetFullName());
+    if(found != m_slot_index.end()) {
+        return found->second;
+    }
+    VmSlot slot;
+    slot.term = term;
+    slot.gen = 0;
+    m_slots.push_back(slot);
+    int32_t index = static_cast<int32_t> (m_slots.size() - 1);
+    m_slot_index[term->GetFullName()] = index;
+    return index;
+}
+
+/*
+ * Имя объекта, который можно получить через Context::GetTerm без дополнительной
+ * обработки (модули, типы и системные имена выполняются интерпретатором).
+ */
+bool VmProgram::IsPlainText(const TermPtr &term) {
+    if(term->getTermID() != TermID::NAME || term->isReturn() || term->GetType()) {
+        return false;
+    }
+    const std::string &name = term->m_text;
+    if(name.compare("_") == 0 || name.compare("$$") == 0 || name.compare("$*") == 0
+            || name.compare("@@") == 0 || name.compare("@$") == 0 || name.compare("@*") == 0) {
+        return false;
+    }
+    return !isModule(name) && !isLocal(name) && !isType(name);
+}
+
+/*
+ * Имя переменной без вызова, полей и индексов
+ */
+bool VmProgram::IsPlainName(const TermPtr &term) {
+    return IsPlainText(term) && !term->isCall() && !term->Right() && !term->size();
+}
+
+/*
+ * Переменная с одним индексом: name[i, j]
+ */
+bool VmProgram::IsIndexName(const TermPtr &term) {
+    if(!IsPlainText(term) || term->isCall() || term->size() || !term->Right()) {
+        return false;
+    }
+    const TermPtr &index = term->Right();
+    return index->getTermID() == TermID::INDEX && !index->Right() && IsPlainList(index, true);
+}
+
+/*
+ * Вызов функции по имени с позиционными аргументами: name(a, b)
+ */
+bool VmProgram::IsCallName(const TermPtr &term) {
+    return IsPlainText(term) && term->isCall() && !term->Right() && (!term->size() || IsPlainList(term, false));
+}
+
+/*
+ * Список значений без имен и многоточий, а для индекса еще и без строк (Context::MakeIndex)
+ */
+bool VmProgram::IsPlainList(const TermPtr &term, bool is_index) {
+    if(!term->size()) {
+        return false;
+    }
+    for (int i = 0; i < term->size(); i++) {
+        const TermPtr &elem = term->at(i).second;
+        if(!term->name(i).empty() || !elem || elem->getTermID() == TermID::ELLIPSIS || elem->getTermID() == TermID::FILLING || (is_index && elem->IsString())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Присвоение x = x + y (-, *, /), результат которого можно записать в объект переменной.
+ */
+bool VmProgram::IsAssignOperator(const TermPtr &lval, const TermPtr &rval) {
+    if(rval->getTermID() != TermID::OPERATOR || rval->m_const || rval->m_text.size() != 1 || !rval->Left() || !rval->Right()) {
+        return false;
+    }
+    if(std::string("+-*/").find(rval->m_text[0]) == std::string::npos) {
+        return false;
+    }
+    return IsPlainName(rval->Left()) && rval->Left()->m_text.compare(lval->m_text) == 0;
+}
+
+/*
+ * Простой блок кода, который можно развернуть в последовательность инструкций.
+ */
+bool VmProgram::IsInlineBlock(const TermPtr &term) {
+    return term->getTermID() == TermID::BLOCK && !term->m_block.empty() && term->m_follow.empty() && term->m_type_allowed.empty();
+}
+
+VmProgramPtr VmProgram::Compile(TermPtr term) {
+    ASSERT(term);
+    VmProgramPtr prog = std::make_shared<VmProgram>();
+    prog->m_result = prog->NewReg();
+    prog->CompileExpr(term, prog->m_result);
+    return prog;
+}
+
+/*
+ * Аналог Context::CallBlock(ctx, term, args, true, CatchType::CATCH_AUTO, has_interrupt)
+ */
+void VmProgram::CompileCallBlock(const TermPtr &term, int32_t dst, int32_t flag) {
+    if(IsInlineBlock(term)) {
+
+        if(flag >= 0) {
+            Emit(VmOp::CLRINT, flag);
+        }
+        Emit(VmOp::NONE, dst);
+        for (auto &elem : term->m_block) {
+            CompileStatement(elem, dst, flag);
+        }
+
+    } else if(term->IsBlock() || !term->m_follow.empty()) {
+
+        Emit(VmOp::CALLBLOCK, dst, AddTerm(term), flag);
+
+    } else {
+
+        // Исключения в выражении без блока преобразуются в объект с ошибкой
+        if(flag >= 0) {
+            Emit(VmOp::CLRINT, flag);
+        }
+        VmGuard guard;
+        guard.start = m_code.size();
+        CompileExpr(term, dst);
+        guard.end = m_code.size();
+        guard.target = guard.end;
+        guard.reg = dst;
+        guard.flag = flag;
+        m_guards.push_back(guard);
+    }
+}
+
+/*
+ * Значения списка вычисляются в последовательные регистры, возвращается первый из них
+ */
+int32_t VmProgram::CompileList(const TermPtr &term) {
+    int32_t first = static_cast<int32_t> (m_reg_count);
+    m_reg_count += term->size();
+    for (int i = 0; i < term->size(); i++) {
+        CompileExpr(term->at(i).second, first + i);
+    }
+    return first;
+}
+
+void VmProgram::CompileStatement(const TermPtr &term, int32_t dst, int32_t flag) {
+    if(term->IsBlock()) {
+        if(IsInlineBlock(term) && term->m_class.empty()) {
+            CompileCallBlock(term, dst, flag);
+        } else {
+            // Вложенный блок выполняется в своем пространстве имен
+            Emit(VmOp::CALLBLOCK, dst, AddTerm(term), flag, 0, 1);
+        }
+    } else {
+        CompileExpr(term, dst);
+    }
+}
+
+void VmProgram::CompileExpr(const TermPtr &term, int32_t dst) {
+    VmReg value;
+    switch(term->getTermID()) {
+        case TermID::INTEGER:
+            if(term->GetType()) {
+                break;
+            }
+            value.m_value.SetInteger(parseInteger(term->getText().c_str()));
+            m_const.push_back(value);
+            Emit(VmOp::CONST, dst, static_cast<int32_t> (m_const.size() - 1));
+            return;
+
+        case TermID::NUMBER:
+            if(term->GetType()) {
+                break;
+            }
+            value.m_value.SetNumber(parseDouble(term->getText().c_str()));
+            m_const.push_back(value);
+            Emit(VmOp::CONST, dst, static_cast<int32_t> (m_const.size() - 1));
+            return;
+
+        case TermID::NAME:
+            if(IsPlainName(term)) {
+                Emit(VmOp::LOAD, dst, AddSlot(term));
+                return;
+            } else if(IsIndexName(term)) {
+                int32_t obj = NewReg();
+                Emit(VmOp::LOAD, obj, AddSlot(term));
+                int32_t index = CompileList(term->Right());
+                Emit(VmOp::INDEX, dst, obj, AddTerm(term->Right()), index);
+                return;
+            } else if(IsCallName(term)) {
+                // Функция ищется до вычисления аргументов, как в Context::CreateRVal
+                int32_t func = NewReg();
+                Emit(VmOp::LOAD, func, AddSlot(term));
+                int32_t args = CompileList(term);
+                Emit(VmOp::CALL, dst, func, AddTerm(term), args);
+                return;
+            }
+            break;
+
+        case TermID::BLOCK:
+            if(IsInlineBlock(term)) {
+                CompileCallBlock(term, dst, -1);
+                return;
+            }
+            break;
+
+        case TermID::OPERATOR:
+            // Выражение из литералов, вычисленное при загрузке (Context::FoldConstants)
+            if(term->m_const && term->m_const->m_var_type_fixed == ObjType::None) {
+                if(term->m_const->is_integer()) {
+                    value.m_value.SetInteger(term->m_const->GetValueAsInteger());
+                } else if(term->m_const->is_floating()) {
+                    value.m_value.SetNumber(term->m_const->GetValueAsNumber());
+                }
+                if(!value.m_value.is_none()) {
+                    m_const.push_back(value);
+                    Emit(VmOp::CONST, dst, static_cast<int32_t> (m_const.size() - 1));
+                    return;
+                }
+            }
+            if(CompileOperator(term, dst)) {
+                return;
+            }
+            break;
+
+        case TermID::ASSIGN:
+        case TermID::CREATE:
+        case TermID::CREATE_OR_ASSIGN:
+            if(CompileAssign(term, dst)) {
+                return;
+            }
+            break;
+
+        case TermID::WHILE:
+            if(term->m_follow.empty()) {
+                CompileWhile(term, dst);
+                return;
+            }
+            break;
+
+        case TermID::FOLLOW:
+            CompileFollow(term, dst);
+            return;
+
+        default:
+            break;
+    }
+    Emit(VmOp::EVAL, dst, AddTerm(term));
+}
+
+bool VmProgram::CompileOperator(const TermPtr &term, int32_t dst) {
+    static const std::map<std::string, VmOp> ops = {
+        {"+", VmOp::ADD},
+        {"-", VmOp::SUB},
+        {"*", VmOp::MUL},
+        {"/", VmOp::DIV},
+        {"<", VmOp::LT},
+        {">", VmOp::GT},
+        {"<=", VmOp::LE},
+        {">=", VmOp::GE},
+        {"==", VmOp::EQ},
+        {"!=", VmOp::NE},
+        {"+=", VmOp::ADD_},
+        {"-=", VmOp::SUB_},
+        {"*=", VmOp::MUL_},
+        {"/=", VmOp::DIV_},
+    };
+
+    auto found = ops.find(term->m_text);
+    if(found == ops.end() || !term->Left() || !term->Right()) {
+        return false;
+    }
+
+    int32_t left = NewReg();
+    int32_t right = NewReg();
+    CompileExpr(term->Left(), left);
+    CompileExpr(term->Right(), right);
+    Emit(found->second, dst, left, right);
+    return true;
+}
+
+bool VmProgram::CompileAssign(const TermPtr &term, int32_t dst) {
+    // Только присвоение одной переменной (или ее элементу по индексу) без раскрытия словарей
+    TermPtr lval = term->Left();
+    TermPtr rval = term->Right();
+    if(!lval || !rval || lval->m_list || rval->m_list) {
+        return false;
+    }
+    if(lval->getTermID() != TermID::NAME || lval->isCall() || isType(lval->m_text)) {
+        return false;
+    }
+    if(lval->Right() && !IsIndexName(lval)) {
+        return false;
+    }
+    if(rval->getTermID() == TermID::ELLIPSIS || rval->getTermID() == TermID::CLASS) {
+        return false;
+    }
+
+    Context::CreateMode mode = Context::CreateMode::CREATE_AUTO;
+    if(term->getTermID() == TermID::ASSIGN) {
+        mode = Context::CreateMode::ASSIGN_ONLY;
+    } else if(term->getTermID() == TermID::CREATE) {
+        mode = Context::CreateMode::CREATE_ONLY;
+    }
+
+    // Переменная создается до вычисления правой части, как в Context::CREATE_OR_ASSIGN
+    Emit(VmOp::LVAL, dst, AddTerm(term), static_cast<int32_t> (mode));
+    int32_t value = NewReg();
+    if(lval->Right()) {
+        // Индекс вычисляется после значения, как в Context::CREATE_OR_ASSIGN
+        CompileExpr(rval, value);
+        int32_t index = CompileList(lval->Right());
+        Emit(VmOp::SETIDX, dst, value, AddTerm(lval->Right()), index);
+        return true;
+    } else if(IsAssignOperator(lval, rval)) {
+        // x = x + y: флаг и регистр переменной в c для записи результата на место (Context::AssignInPlace)
+        static const std::map<char, VmOp> ops = {
+            {'+', VmOp::ADD},
+            {'-', VmOp::SUB},
+            {'*', VmOp::MUL},
+            {'/', VmOp::DIV},
+        };
+        int32_t left = NewReg();
+        int32_t right = NewReg();
+        CompileExpr(rval->Left(), left);
+        CompileExpr(rval->Right(), right);
+        Emit(ops.at(rval->m_text[0]), value, left, right, dst, 1);
+    } else {
+        CompileExpr(rval, value);
+    }
+    Emit(VmOp::SETVAL, dst, value);
+    return true;
+}
+
+/*
+ * Аналог Context::eval_WHILE
+ */
+void VmProgram::CompileWhile(const TermPtr &term, int32_t dst) {
+    ASSERT(term->Left());
+    ASSERT(term->Right());
+
+    int32_t cond = NewReg();
+    int32_t flag = static_cast<int32_t> (m_flag_count++);
+
+    Emit(VmOp::NONE, dst);
+    CompileCallBlock(term->Left(), cond, -1);
+    size_t test = Emit(VmOp::JMPF, cond);
+
+    CompileCallBlock(term->Right(), dst, flag);
+    size_t ctl = Emit(VmOp::LOOPCTL, dst, 0, static_cast<int32_t> (test), flag);
+
+    CompileCallBlock(term->Left(), cond, -1);
+    Emit(VmOp::JMP, 0, static_cast<int32_t> (test));
+
+    m_code[test].a = static_cast<int32_t> (m_code.size());
+    m_code[ctl].a = static_cast<int32_t> (m_code.size());
+}
+
+/*
+ * Аналог Context::eval_FOLLOW
+ */
+void VmProgram::CompileFollow(const TermPtr &term, int32_t dst) {
+    std::vector<size_t> jumps;
+    for (size_t i = 0; i < term->m_follow.size(); i++) {
+        ASSERT(term->m_follow[i]->Left());
+
+        int32_t cond = NewReg();
+        CompileExpr(term->m_follow[i]->Left(), cond);
+        // Для последнего условия значение None тоже считается истиной ([_] --> {else})
+        size_t test = Emit(VmOp::JMPF, cond, 0, 0, 0, i + 1 == term->m_follow.size());
+        CompileCallBlock(term->m_follow[i]->Right(), dst, -1);
+        jumps.push_back(Emit(VmOp::JMP, 0));
+        m_code[test].a = static_cast<int32_t> (m_code.size());
+    }
+    Emit(VmOp::NONE, dst);
+    for (auto pos : jumps) {
+        m_code[pos].a = static_cast<int32_t> (m_code.size());
+    }
+}
+
+std::string VmProgram::Dump() const {
+    std::string result;
+    char buffer[100];
+    for (size_t i = 0; i < m_code.size(); i++) {
+        snprintf(buffer, sizeof (buffer), "%04zu %-9s %d %d %d %d %d\n", i, toString(m_code[i].op),
+                m_code[i].dst, m_code[i].a, m_code[i].b, m_code[i].c, m_code[i].flag);
+        result += buffer;
+    }
+    return result;
+}
+
+/*
+ * Выполнение
+ */
+
+ObjPtr VmProgram::Run(Context *ctx, Obj *args) {
+    ASSERT(ctx);
+    ASSERT(args);
+
+    std::vector<VmReg> reg(m_reg_count);
+    std::vector<uint8_t> interrupt(m_flag_count, 0);
+    std::vector<Index> index;
+
+    /*
+     * Программа может повторно выполняться из кеша Context::m_vm_cache,
+     * поэтому после выполнения (в том числе с исключением) ячейки не удерживают объекты переменных.
+     */
+    struct RunScope {
+        VmProgram &prog;
+
+        explicit RunScope(VmProgram &p) : prog(p) {
+            prog.m_running++;
+            prog.ResetSlots();
+        }
+
+        ~RunScope() {
+            prog.m_running--;
+            prog.ResetSlots();
+        }
+    } scope(*this);
+
+    // Поколение кеша переменных, увеличивается при любом изменении контекста
+    uint64_t gen = 1;
+
+    size_t pc = 0;
+    size_t current = 0;
+    while(pc < m_code.size()) {
+        try {
+            while(pc < m_code.size()) {
+                current = pc++;
+                const VmInstr &op = m_code[current];
+
+                switch(op.op) {
+                    case VmOp::NOP:
+                        break;
+
+                    case VmOp::NONE:
+                        reg[op.dst].m_value.SetNone();
+                        reg[op.dst].m_proto.reset();
+                        break;
+
+                    case VmOp::CONST:
+                        reg[op.dst] = m_const[op.a];
+                        break;
+
+                    case VmOp::LOAD:
+                    {
+                        VmSlot &slot = m_slots[op.a];
+                        if(slot.gen != gen || !slot.obj) {
+                            slot.obj = ctx->GetTerm(slot.term->GetFullName(), slot.term->isRef());
+                            if(!slot.obj) {
+                                LOG_RUNTIME("Term '%s' not found!", slot.term->GetFullName().c_str());
+                            }
+                            slot.gen = gen;
+                        }
+                        SetObject(reg[op.dst], slot.obj);
+                        break;
+                    }
+
+                    case VmOp::LVAL:
+                    {
+                        const TermPtr &term = m_terms[op.a];
+                        const TermPtr &elem = term->Left();
+                        Context::CreateMode mode = static_cast<Context::CreateMode> (op.b);
+
+                        ObjPtr result;
+                        auto found = ctx->find(ctx->NamespaseFull(elem->GetFullName()));
+                        if(found != ctx->end()) {
+                            result = (*found).second.lock();
+                        }
+                        if(!result && mode == Context::CreateMode::ASSIGN_ONLY) {
+                            NL_PARSER(elem, "Object '%s' (%s) not found!", elem->m_text.c_str(), ctx->NamespaseFull(elem->GetFullName()).c_str());
+                        }
+                        if(result && mode == Context::CreateMode::CREATE_ONLY) {
+                            NL_PARSER(elem, "Object '%s' (%s) already exists!", elem->m_text.c_str(), ctx->NamespaseFull(elem->GetFullName()).c_str());
+                        }
+                        if(!result) {
+                            result = Context::CreateLVal(ctx, elem, args);
+                            if(!result) {
+                                NL_PARSER(elem, "Fail create lvalue object!");
+                            }
+                            gen++;
+                        }
+                        SetObject(reg[op.dst], result);
+                        break;
+                    }
+
+                    case VmOp::SETVAL:
+                    {
+                        ObjPtr value = reg[op.a].GetObj();
+                        Obj *obj = GetRegObj(reg[op.dst]);
+                        ASSERT(obj);
+                        if(value.get() != obj) {
+                            obj->SetValue_(value);
+                        }
+                        if(obj->m_var_type_current == ObjType::Function && value->is_block()) {
+                            obj->m_var_type_current = ObjType::EVAL_FUNCTION;
+                        }
+                        break;
+                    }
+
+                    case VmOp::EVAL:
+                        SetObject(reg[op.dst], Context::Eval(ctx, m_terms[op.a], args, true));
+                        gen++;
+                        break;
+
+                    case VmOp::CALLBLOCK:
+                    {
+                        const TermPtr &term = m_terms[op.a];
+                        bool has_interrupt = false;
+                        bool is_ns = op.flag ? ctx->NamespasePush(term->m_class) : false;
+                        ObjPtr result;
+                        try {
+                            result = Context::CallBlock(ctx, term, args, true, Context::CatchType::CATCH_AUTO, &has_interrupt);
+                        } catch (...) {
+                            if(is_ns) {
+                                ctx->NamespasePop();
+                            }
+                            gen++;
+                            throw;
+                        }
+                        if(is_ns) {
+                            ctx->NamespasePop();
+                        }
+                        if(op.b >= 0) {
+                            interrupt[op.b] = has_interrupt;
+                        }
+                        SetObject(reg[op.dst], result);
+                        gen++;
+                        break;
+                    }
+
+                    case VmOp::INDEX:
+                        MakeIndex(m_terms[op.b], &reg[op.c], index);
+                        SetObject(reg[op.dst], reg[op.a].GetObj()->index_get(index));
+                        break;
+
+                    case VmOp::SETIDX:
+                    {
+                        Obj *obj = GetRegObj(reg[op.dst]);
+                        ASSERT(obj);
+                        ObjPtr value = reg[op.a].GetObj();
+                        MakeIndex(m_terms[op.b], &reg[op.c], index);
+                        obj->index_set_(index, value);
+                        break;
+                    }
+
+                    case VmOp::CALL:
+                    {
+                        size_t count = m_terms[op.b]->size();
+                        ObjPtr func = reg[op.a].GetObj();
+                        ObjPtr result;
+                        if(func->m_var_type_current == ObjType::NativeFunc && count <= VM_NATIVE_ARGS) {
+                            ObjPtr native[VM_NATIVE_ARGS];
+                            for (size_t i = 0; i < count; i++) {
+                                native[i] = reg[op.c + i].GetObj();
+                            }
+                            result = func->CallNativeDirect(ctx, native, count);
+                        }
+                        if(!result) {
+                            ObjPtr args = Obj::CreateDict();
+                            for (size_t i = 0; i < count; i++) {
+                                args->push_back(reg[op.c + i].GetObj());
+                            }
+                            result = func->Call(ctx, args.get());
+                            gen++;
+                        }
+                        SetObject(reg[op.dst], result);
+                        break;
+                    }
+
+                    case VmOp::ADD:
+                    case VmOp::SUB:
+                    case VmOp::MUL:
+                    {
+                        Value value;
+                        if(ArithScalar(op.op, reg[op.a], reg[op.b], value)) {
+                            // Свойства результата берутся от левого операнда (Obj::Clone),
+                            // прототип сохраняется до записи результата, т.к. регистры могут совпадать
+                            reg[op.dst].m_proto = GetProto(reg[op.a]);
+                            reg[op.dst].m_value = std::move(value);
+                        } else if(op.op == VmOp::ADD) {
+                            if(!AssignInPlace(ctx, op, reg.data(), '+')) {
+                                SetObject(reg[op.dst], reg[op.a].GetObj()->operator+(reg[op.b].GetObj()));
+                            }
+                        } else if(op.op == VmOp::SUB) {
+                            if(!AssignInPlace(ctx, op, reg.data(), '-')) {
+                                SetObject(reg[op.dst], reg[op.a].GetObj()->operator-(reg[op.b].GetObj()));
+                            }
+                        } else {
+                            if(!AssignInPlace(ctx, op, reg.data(), '*')) {
+                                SetObject(reg[op.dst], reg[op.a].GetObj()->operator*(reg[op.b].GetObj()));
+                            }
+                        }
+                        break;
+                    }
+
+                    case VmOp::DIV:
+                        if(!AssignInPlace(ctx, op, reg.data(), '/')) {
+                            SetObject(reg[op.dst], reg[op.a].GetObj()->operator/(reg[op.b].GetObj()));
+                        }
+                        break;
+
+                    case VmOp::LT:
+                    case VmOp::GT:
+                    case VmOp::LE:
+                    case VmOp::GE:
+                    case VmOp::EQ:
+                    case VmOp::NE:
+                    {
+                        bool result;
+                        if(!CompareScalar(op.op, reg[op.a], reg[op.b], result)) {
+                            ObjPtr left = reg[op.a].GetObj();
+                            ObjPtr right = reg[op.b].GetObj();
+                            switch(op.op) {
+                                case VmOp::LT:
+                                    result = left->operator<(right);
+                                    break;
+                                case VmOp::GT:
+                                    result = left->operator>(right);
+                                    break;
+                                case VmOp::LE:
+                                    result = left->operator<=(right);
+                                    break;
+                                case VmOp::GE:
+                                    result = left->operator>=(right);
+                                    break;
+                                case VmOp::EQ:
+                                    result = left->op_equal(right);
+                                    break;
+                                default:
+                                    result = !left->op_equal(right);
+                                    break;
+                            }
+                        }
+                        SetBoolean(reg[op.dst], result);
+                        break;
+                    }
+
+                    case VmOp::ADD_:
+                    case VmOp::SUB_:
+                    case VmOp::MUL_:
+                    {
+                        Value result;
+                        Obj *obj = GetRegObj(reg[op.a]);
+                        // Общие объекты и константы изменяются через методы Obj (CopyOnWrite и проверка константы)
+                        if(obj && !obj->m_is_shared && !obj->m_is_const && ArithScalar(op.op, reg[op.a], reg[op.b], result)) {
+                            // Изменение значения переменной на месте без создания временных объектов
+                            if(result.getTag() == Value::Tag::Integer) {
+                                obj->m_var = result.GetInteger();
+                                obj->m_var_type_current = typeFromLimit(result.GetInteger());
+                            } else {
+                                obj->m_var = result.GetNumber();
+                                obj->m_var_type_current = ObjType::Float64;
+                            }
+                            SetObject(reg[op.dst], reg[op.a].m_value.GetObjRef());
+                        } else {
+                            ObjPtr left = reg[op.a].GetObj();
+                            ObjPtr right = reg[op.b].GetObj();
+                            Obj::CopyOnWrite(left);
+                            if(op.op == VmOp::ADD_) {
+                                SetObject(reg[op.dst], left->operator+=(right));
+                            } else if(op.op == VmOp::SUB_) {
+                                SetObject(reg[op.dst], left->operator-=(right));
+                            } else {
+                                SetObject(reg[op.dst], left->operator*=(right));
+                            }
+                        }
+                        break;
+                    }
+
+                    case VmOp::DIV_:
+                    {
+                        ObjPtr left = reg[op.a].GetObj();
+                        Obj::CopyOnWrite(left);
+                        SetObject(reg[op.dst], left->operator/=(reg[op.b].GetObj()));
+                        break;
+                    }
+
+                    case VmOp::JMP:
+                        pc = op.a;
+                        break;
+
+                    case VmOp::JMPF:
+                        if(!reg[op.dst].GetValueAsBoolean()) {
+                            if(!op.flag || !reg[op.dst].GetObj()->is_none_type()) {
+                                pc = op.a;
+                            }
+                        }
+                        break;
+
+                    case VmOp::CLRINT:
+                        interrupt[op.dst] = 0;
+                        break;
+
+                    case VmOp::LOOPCTL:
+                    {
+                        if(ctx->m_frame) {
+                            ctx->m_frame->m_loops++;
+                        }
+                        if(interrupt[op.c]) {
+                            pc = op.a;
+                            break;
+                        }
+                        ObjPtr result = reg[op.dst].GetObj();
+                        if(Context::TestInterrupt(*result, ObjType::Break, Return::Break, ctx)) {
+                            pc = op.a;
+                        } else if(Context::TestInterrupt(*result, ObjType::Continue, Return::Continue, ctx)) {
+                            // Условие цикла повторно не вычисляется
+                            pc = op.b;
+                        }
+                        break;
+                    }
+
+                    default:
+                        LOG_RUNTIME("Opcode %s not implemented!", toString(op.op));
+                }
+            }
+
+        } catch (Return &) {
+            throw;
+        } catch (std::exception &err) {
+
+            // Ближайшая (вложенная) область перехвата исключения
+            const VmGuard *guard = nullptr;
+            for (auto &elem : m_guards) {
+                if(current >= elem.start && current < elem.end) {
+                    if(!guard || (elem.end - elem.start) < (guard->end - guard->start)) {
+                        guard = &elem;
+                    }
+                }
+            }
+            if(!guard) {
+                throw;
+            }
+
+            ObjPtr error = Obj::CreateType(ObjType::Error, ObjType::Error, true);
+            error->m_value = std::string(err.what());
+            SetObject(reg[guard->reg], error);
+            if(guard->flag >= 0) {
+                interrupt[guard->flag] = 1;
+            }
+            pc = guard->target;
+            gen++;
+        }
+    }
+
+    ASSERT(m_result >= 0);
+    return reg[m_result].GetObj();
+}
@@ -0,0 +1,173 @@
+#pragma once
+#ifndef INCLUDED_NEWLANG_VM_
+#define INCLUDED_NEWLANG_VM_
+
+#include "pch.h"
+
+#include <term.h>
+#include <object.h>
+#include <value.h>
+
+namespace newlang {
+
+    /*
+     * Байт-код и регистровая виртуальная машина для интерпретатора.
+     *
+     * Дерево терминов компилируется в плоский массив инструкций с регистрами
+     * вместо рекурсивного обхода через Context::Eval. Напрямую компилируются только
+     * циклы, условные переходы, присвоения, арифметика/сравнения, обращения по индексу
+     * и вызовы функций по имени (нативные функции вызываются без создания словаря параметров),
+     * а все остальные термины выполняются инструкцией EVAL, т.е. обычным интерпретатором (fallback).
+     *
+     * Скалярные значения (целые и числа с плавающей точкой) хранятся в регистрах
+     * без упаковки в Obj и упаковываются только при выходе за пределы байт-кода.
+     */
+
+#define NL_VM_OPCODES(_) \
+        _(NOP) \
+        _(NONE) \
+        _(CONST) \
+        _(LOAD) \
+        _(LVAL) \
+        _(SETVAL) \
+        _(EVAL) \
+        _(CALLBLOCK) \
+        _(INDEX) \
+        _(SETIDX) \
+        _(CALL) \
+        _(ADD) \
+        _(SUB) \
+        _(MUL) \
+        _(DIV) \
+        _(LT) \
+        _(GT) \
+        _(LE) \
+        _(GE) \
+        _(EQ) \
+        _(NE) \
+        _(ADD_) \
+        _(SUB_) \
+        _(MUL_) \
+        _(DIV_) \
+        _(JMP) \
+        _(JMPF) \
+        _(CLRINT) \
+        _(LOOPCTL)
+
+    enum class VmOp : uint8_t {
+#define DEFINE_ENUM(name) name,
+        NL_VM_OPCODES(DEFINE_ENUM)
+#undef DEFINE_ENUM
+    };
+
+    const char * toString(VmOp op);
+
+    /*
+     * Регистр виртуальной машины. Скаляры хранятся в Value без создания объекта,
+     * а для Integer и Number в m_proto может храниться объект-прототип (левый операнд
+     * арифметической операции), свойства которого копируются при упаковке значения,
+     * как это делает Obj::Clone() в интерпретаторе.
+     */
+    struct VmReg {
+        Value m_value;
+        ObjPtr m_proto;
+
+        ObjPtr GetObj() const;
+        bool GetValueAsBoolean() const;
+    };
+
+    struct VmInstr {
+        VmOp op;
+        uint8_t flag;
+        int32_t dst;
+        int32_t a;
+        int32_t b;
+        int32_t c;
+    };
+
+    /*
+     * Ячейка переменной. Объект переменной ищется при первом обращении через
+     * Context::GetTerm и кешируется до выполнения инструкций, которые могут
+     * изменить набор объектов в контексте (EVAL, CALLBLOCK или создание переменной).
+     */
+    struct VmSlot {
+        TermPtr term;
+        ObjPtr obj;
+        uint64_t gen;
+    };
+
+    /*
+     * Область перехвата исключений для выражений, которые интерпретатор
+     * вычисляет через Context::CallBlock (условие и тело цикла без фигурных скобок).
+     */
+    struct VmGuard {
+        size_t start;
+        size_t end;
+        size_t target;
+        int32_t reg;
+        int32_t flag;
+    };
+
+    class VmProgram {
+    public:
+
+        VmProgram() : m_result(-1) {
+        }
+
+        static std::shared_ptr<VmProgram> Compile(TermPtr term);
+
+        ObjPtr Run(Context *ctx, Obj *args);
+
+        std::string Dump() const;
+
+        void ResetSlots() {
+            for (auto &slot : m_slots) {
+                slot.obj.reset();
+                slot.gen = 0;
+            }
+        }
+
+        std::vector<VmInstr> m_code;
+        std::vector<VmReg> m_const;
+        std::vector<TermPtr> m_terms;
+        std::vector<VmSlot> m_slots;
+        std::vector<VmGuard> m_guards;
+        size_t m_reg_count = 0;
+        size_t m_flag_count = 0;
+        int32_t m_result;
+        size_t m_running = 0; ///< Глубина вложенных вызовов Run для этой программы
+
+    protected:
+
+        int32_t NewReg() {
+            return static_cast<int32_t> (m_reg_count++);
+        }
+        size_t Emit(VmOp op, int32_t dst, int32_t a = 0, int32_t b = 0, int32_t c = 0, uint8_t flag = 0);
+        int32_t AddTerm(const TermPtr &term);
+        int32_t AddSlot(const TermPtr &term);
+
+        static bool IsPlainText(const TermPtr &term);
+        static bool IsPlainName(const TermPtr &term);
+        static bool IsIndexName(const TermPtr &term);
+        static bool IsCallName(const TermPtr &term);
+        static bool IsPlainList(const TermPtr &term, bool is_index);
+        static bool IsAssignOperator(const TermPtr &lval, const TermPtr &rval);
+        static bool IsInlineBlock(const TermPtr &term);
+
+        void CompileExpr(const TermPtr &term, int32_t dst);
+        void CompileStatement(const TermPtr &term, int32_t dst, int32_t flag);
+        void CompileCallBlock(const TermPtr &term, int32_t dst, int32_t flag);
+        int32_t CompileList(const TermPtr &term);
+        bool CompileOperator(const TermPtr &term, int32_t dst);
+        bool CompileAssign(const TermPtr &term, int32_t dst);
+        void CompileWhile(const TermPtr &term, int32_t dst);
+        void CompileFollow(const TermPtr &term, int32_t dst);
+
+        std::map<std::string, int32_t> m_slot_index;
+    };
+
+    typedef std::shared_ptr<VmProgram> VmProgramPtr;
+
+}
+
+#endif //INCLUDED_NEWLANG_VM_